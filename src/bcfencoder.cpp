@@ -0,0 +1,154 @@
+#include "bcfencoder.hpp"
+#include <stdexcept>
+#include <sstream>
+#include <algorithm>
+
+using namespace std;
+
+const int32_t BcfEncoder::INT_MISSING = INT32_MIN;
+const uint8_t BcfEncoder::BCF_TYPE_INT8;
+const uint8_t BcfEncoder::BCF_TYPE_INT16;
+const uint8_t BcfEncoder::BCF_TYPE_INT32;
+const uint8_t BcfEncoder::BCF_TYPE_FLOAT;
+const uint8_t BcfEncoder::BCF_TYPE_CHAR;
+
+// the smallest values of each integer type are reserved (missing value, end of vector)
+static const int32_t BCF_MIN_INT8 = -120;
+static const int32_t BCF_MIN_INT16 = -32760;
+static const uint32_t BCF_FLOAT_MISSING = 0x7F800001;
+
+template<class T>
+static void append_value(string& buffer, T value) {
+	buffer.append((const char*) &value, sizeof(T));
+}
+
+BcfEncoder::BcfEncoder(const string& header) {
+	// PASS is always the first entry of the string dictionary
+	this->key_ids["PASS"] = 0;
+	istringstream lines(header);
+	string line;
+	while (getline(lines, line)) {
+		if (line.substr(0, 2) != "##") continue;
+		size_t equal = line.find("=<ID=");
+		if (equal == string::npos) continue;
+		string key = line.substr(2, equal - 2);
+		size_t start = equal + 5;
+		size_t end = line.find_first_of(",>", start);
+		if (end == string::npos) {
+			throw runtime_error("BcfEncoder::BcfEncoder: malformed header line " + line);
+		}
+		string id = line.substr(start, end - start);
+		if (key == "contig") {
+			if (this->contig_ids.find(id) != this->contig_ids.end()) {
+				throw runtime_error("BcfEncoder::BcfEncoder: contig " + id + " is declared twice.");
+			}
+			this->contig_ids[id] = this->contigs.size();
+			this->contigs.push_back(id);
+		} else if ((key == "FILTER") || (key == "INFO") || (key == "FORMAT")) {
+			// INFO and FORMAT fields of the same name share an entry
+			if (this->key_ids.find(id) == this->key_ids.end()) {
+				int32_t index = this->key_ids.size();
+				this->key_ids[id] = index;
+			}
+		}
+	}
+}
+
+int32_t BcfEncoder::contig_index(const string& name) const {
+	auto it = this->contig_ids.find(name);
+	if (it == this->contig_ids.end()) {
+		throw runtime_error("BcfEncoder::contig_index: contig " + name + " is not declared in the header.");
+	}
+	return it->second;
+}
+
+int32_t BcfEncoder::key_index(const string& id) const {
+	auto it = this->key_ids.find(id);
+	if (it == this->key_ids.end()) {
+		throw runtime_error("BcfEncoder::key_index: " + id + " is not declared in the header.");
+	}
+	return it->second;
+}
+
+const vector<string>& BcfEncoder::get_contigs() const {
+	return this->contigs;
+}
+
+void BcfEncoder::encode_site(string& buffer, int32_t contig, int32_t position, int32_t length, size_t nr_info, size_t nr_alleles, size_t nr_format, size_t nr_samples) {
+	if ((nr_info > 0xffff) || (nr_alleles > 0xffff) || (nr_format > 0xff) || (nr_samples > 0xffffff)) {
+		throw runtime_error("BcfEncoder::encode_site: too many fields, alleles or samples.");
+	}
+	append_value<int32_t>(buffer, contig);
+	append_value<int32_t>(buffer, position);
+	append_value<int32_t>(buffer, length);
+	append_value<uint32_t>(buffer, BCF_FLOAT_MISSING);
+	append_value<uint32_t>(buffer, nr_info | (nr_alleles << 16));
+	append_value<uint32_t>(buffer, nr_samples | (nr_format << 24));
+}
+
+void BcfEncoder::encode_type(string& buffer, uint8_t type, size_t count) {
+	if (count < 15) {
+		buffer += (char) ((count << 4) | type);
+	} else {
+		// larger counts follow as typed integer
+		buffer += (char) ((15 << 4) | type);
+		if (count > INT32_MAX) {
+			throw runtime_error("BcfEncoder::encode_type: vector too long.");
+		}
+		encode_int(buffer, count);
+	}
+}
+
+void BcfEncoder::encode_ints(string& buffer, const vector<int32_t>& values) {
+	int32_t min_value = INT32_MAX;
+	int32_t max_value = INT32_MIN;
+	for (int32_t value : values) {
+		if (value == INT_MISSING) continue;
+		min_value = min(min_value, value);
+		max_value = max(max_value, value);
+	}
+	uint8_t type = BCF_TYPE_INT32;
+	if ((min_value > max_value) || ((min_value >= BCF_MIN_INT8) && (max_value <= INT8_MAX))) {
+		type = BCF_TYPE_INT8;
+	} else if ((min_value >= BCF_MIN_INT16) && (max_value <= INT16_MAX)) {
+		type = BCF_TYPE_INT16;
+	}
+	encode_type(buffer, type, values.size());
+	for (int32_t value : values) {
+		bool missing = (value == INT_MISSING);
+		if (type == BCF_TYPE_INT8) {
+			append_value<int8_t>(buffer, missing ? INT8_MIN : value);
+		} else if (type == BCF_TYPE_INT16) {
+			append_value<int16_t>(buffer, missing ? INT16_MIN : value);
+		} else {
+			append_value<int32_t>(buffer, value);
+		}
+	}
+}
+
+void BcfEncoder::encode_int(string& buffer, int32_t value) {
+	encode_ints(buffer, {value});
+}
+
+void BcfEncoder::encode_floats(string& buffer, const vector<float>& values) {
+	encode_type(buffer, BCF_TYPE_FLOAT, values.size());
+	for (float value : values) {
+		append_value<float>(buffer, value);
+	}
+}
+
+void BcfEncoder::encode_string(string& buffer, string_view value) {
+	encode_type(buffer, BCF_TYPE_CHAR, value.size());
+	buffer += value;
+}
+
+void BcfEncoder::append_record(string& buffer, const string& shared, const string& individual) {
+	append_value<uint32_t>(buffer, shared.size());
+	append_value<uint32_t>(buffer, individual.size());
+	buffer += shared;
+	buffer += individual;
+}
+
+int32_t BcfEncoder::encode_allele(int allele, bool phased) {
+	return ((allele + 1) << 1) | (phased ? 1 : 0);
+}
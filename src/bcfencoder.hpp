@@ -0,0 +1,57 @@
+#ifndef BCFENCODER_HPP
+#define BCFENCODER_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <stdint.h>
+
+/**
+* Encodes records in BCF2 format (version 2.2). The dictionaries of contigs and of FILTER/INFO/FORMAT
+* IDs are taken from the VCF header text the encoder is constructed with, which must therefore
+* declare every contig and key used. Values are written as typed vectors, integers with the
+* smallest type that can hold them.
+**/
+
+class BcfEncoder {
+public:
+	/**
+	* @param header VCF header text (meta-information lines and #CHROM line)
+	**/
+	BcfEncoder(const std::string& header);
+	/** index of the given contig (throws if it is not declared in the header) **/
+	int32_t contig_index(const std::string& name) const;
+	/** index of the given FILTER/INFO/FORMAT ID in the string dictionary (throws if it is not declared) **/
+	int32_t key_index(const std::string& id) const;
+	/** contigs in the order of the header **/
+	const std::vector<std::string>& get_contigs() const;
+	/** write the fixed fields of a record (QUAL is missing) **/
+	static void encode_site(std::string& buffer, int32_t contig, int32_t position, int32_t length, size_t nr_info, size_t nr_alleles, size_t nr_format, size_t nr_samples);
+	/** write a type descriptor for count values of the given type **/
+	static void encode_type(std::string& buffer, uint8_t type, size_t count);
+	/** write integers as a typed vector, INT_MISSING marks missing values **/
+	static void encode_ints(std::string& buffer, const std::vector<int32_t>& values);
+	static void encode_int(std::string& buffer, int32_t value);
+	static void encode_floats(std::string& buffer, const std::vector<float>& values);
+	/** write a string, the empty string is written as missing value **/
+	static void encode_string(std::string& buffer, std::string_view value);
+	/** append a complete record consisting of the shared (site) and individual (FORMAT) part **/
+	static void append_record(std::string& buffer, const std::string& shared, const std::string& individual);
+	/** genotype value of an allele (-1: missing) **/
+	static int32_t encode_allele(int allele, bool phased);
+
+	static const int32_t INT_MISSING;
+	static const uint8_t BCF_TYPE_INT8 = 1;
+	static const uint8_t BCF_TYPE_INT16 = 2;
+	static const uint8_t BCF_TYPE_INT32 = 3;
+	static const uint8_t BCF_TYPE_FLOAT = 5;
+	static const uint8_t BCF_TYPE_CHAR = 7;
+
+private:
+	std::vector<std::string> contigs;
+	std::map<std::string, int32_t> contig_ids;
+	std::map<std::string, int32_t> key_ids;
+};
+
+#endif // BCFENCODER_HPP
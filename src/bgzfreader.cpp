@@ -0,0 +1,106 @@
+#include "bgzfreader.hpp"
+#include <stdexcept>
+#include <sstream>
+#include <zlib.h>
+
+using namespace std;
+
+// size of the BGZF block header (gzip header + BC extra field) and trailer (CRC32 + ISIZE)
+const size_t BGZF_HEADER_SIZE = 18;
+const size_t BGZF_TRAILER_SIZE = 8;
+
+static uint32_t read_uint32_le(const char* data) {
+	const unsigned char* d = (const unsigned char*) data;
+	return (uint32_t) d[0] | ((uint32_t) d[1] << 8) | ((uint32_t) d[2] << 16) | ((uint32_t) d[3] << 24);
+}
+
+static uint16_t read_uint16_le(const char* data) {
+	const unsigned char* d = (const unsigned char*) data;
+	return (uint16_t) d[0] | ((uint16_t) d[1] << 8);
+}
+
+static bool is_bgzf_header(const char* header) {
+	const unsigned char* h = (const unsigned char*) header;
+	return (h[0] == 31) && (h[1] == 139) && (h[2] == 8) && ((h[3] & 4) != 0) && (read_uint16_le(header + 10) == 6) && (h[12] == 'B') && (h[13] == 'C') && (read_uint16_le(header + 14) == 2);
+}
+
+BgzfReader::BgzfReader(string filename)
+	:filename(filename)
+{
+	this->file.open(filename, ios::in | ios::binary);
+	if (!this->file.good()) {
+		throw runtime_error("BgzfReader::BgzfReader: file " + filename + " cannot be opened.");
+	}
+}
+
+BgzfReader::~BgzfReader() {
+	if (this->file.is_open()) {
+		this->file.close();
+	}
+}
+
+bool BgzfReader::is_bgzf(string filename) {
+	ifstream file(filename, ios::in | ios::binary);
+	char header[BGZF_HEADER_SIZE];
+	if (!file.read(header, BGZF_HEADER_SIZE)) return false;
+	return is_bgzf_header(header);
+}
+
+bool BgzfReader::read_block(vector<char>& block, uint64_t* block_offset) {
+	uint64_t offset = this->file.tellg();
+	block.resize(BGZF_HEADER_SIZE);
+	this->file.read(block.data(), BGZF_HEADER_SIZE);
+	if (this->file.gcount() == 0) return false;
+	if ((this->file.gcount() != (streamsize) BGZF_HEADER_SIZE) || !is_bgzf_header(block.data())) {
+		throw runtime_error("BgzfReader::read_block: file " + this->filename + " is not properly BGZF-compressed.");
+	}
+	// BSIZE is the total block size minus one
+	size_t block_size = read_uint16_le(block.data() + 16) + 1;
+	if (block_size < BGZF_HEADER_SIZE + BGZF_TRAILER_SIZE) {
+		throw runtime_error("BgzfReader::read_block: file " + this->filename + " contains a malformed block.");
+	}
+	block.resize(block_size);
+	this->file.read(block.data() + BGZF_HEADER_SIZE, block_size - BGZF_HEADER_SIZE);
+	if (this->file.gcount() != (streamsize) (block_size - BGZF_HEADER_SIZE)) {
+		throw runtime_error("BgzfReader::read_block: file " + this->filename + " is truncated.");
+	}
+	if (block_offset != nullptr) *block_offset = offset;
+	return true;
+}
+
+void BgzfReader::seek(uint64_t block_offset) {
+	this->file.clear();
+	this->file.seekg(block_offset, ios::beg);
+	if (!this->file.good()) {
+		throw runtime_error("BgzfReader::seek: cannot seek in file " + this->filename + ".");
+	}
+}
+
+void BgzfReader::decompress_block(const vector<char>& block, string& result) {
+	size_t block_size = block.size();
+	uint32_t expected_crc = read_uint32_le(block.data() + block_size - 8);
+	uint32_t uncompressed_size = read_uint32_le(block.data() + block_size - 4);
+	result.resize(uncompressed_size);
+	if (uncompressed_size == 0) return;
+
+	z_stream stream;
+	stream.zalloc = Z_NULL;
+	stream.zfree = Z_NULL;
+	stream.opaque = Z_NULL;
+	stream.next_in = (Bytef*) (block.data() + BGZF_HEADER_SIZE);
+	stream.avail_in = block_size - BGZF_HEADER_SIZE - BGZF_TRAILER_SIZE;
+	stream.next_out = (Bytef*) result.data();
+	stream.avail_out = uncompressed_size;
+	// negative window bits: raw deflate data without zlib header
+	if (inflateInit2(&stream, -15) != Z_OK) {
+		throw runtime_error("BgzfReader::decompress_block: failed to initialize zlib.");
+	}
+	int status = inflate(&stream, Z_FINISH);
+	inflateEnd(&stream);
+	if ((status != Z_STREAM_END) || (stream.total_out != uncompressed_size)) {
+		throw runtime_error("BgzfReader::decompress_block: failed to decompress block.");
+	}
+	if (crc32(crc32(0L, Z_NULL, 0), (const Bytef*) result.data(), uncompressed_size) != expected_crc) {
+		throw runtime_error("BgzfReader::decompress_block: checksum mismatch in decompressed block.");
+	}
+}
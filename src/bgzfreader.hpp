@@ -0,0 +1,37 @@
+#ifndef BGZFREADER_HPP
+#define BGZFREADER_HPP
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <stdint.h>
+
+/**
+* Reads files compressed in BGZF format (bgzip). The file consists of independently
+* compressed blocks, which allows blocks to be decompressed in parallel.
+**/
+
+class BgzfReader {
+public:
+	/**
+	* @param filename name of the BGZF-compressed file
+	**/
+	BgzfReader(std::string filename);
+	~BgzfReader();
+	/** check whether the given file is BGZF-compressed **/
+	static bool is_bgzf(std::string filename);
+	/** read the next compressed block (including header and trailer). Returns false at the end of the file.
+	* @param block_offset if given, set to the offset of the block in the compressed file
+	**/
+	bool read_block(std::vector<char>& block, uint64_t* block_offset = nullptr);
+	/** continue reading with the block starting at the given offset of the compressed file **/
+	void seek(uint64_t block_offset);
+	/** decompress a block returned by read_block **/
+	static void decompress_block(const std::vector<char>& block, std::string& result);
+
+private:
+	std::string filename;
+	std::ifstream file;
+};
+
+#endif // BGZFREADER_HPP
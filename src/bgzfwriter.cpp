@@ -0,0 +1,163 @@
+#include "bgzfwriter.hpp"
+#include <stdexcept>
+#include <iostream>
+#include <algorithm>
+#include <exception>
+#include <zlib.h>
+#include "threadpool.hpp"
+
+using namespace std;
+
+const size_t BgzfWriter::BGZF_BLOCK_SIZE;
+
+// header of a BGZF block (gzip header with BC extra field, BSIZE is set for each block) and empty end-of-file block
+static const unsigned char BGZF_BLOCK_HEADER[18] = {31, 139, 8, 4, 0, 0, 0, 0, 0, 255, 6, 0, 'B', 'C', 2, 0, 0, 0};
+static const unsigned char BGZF_EOF[28] = {31, 139, 8, 4, 0, 0, 0, 0, 0, 255, 6, 0, 66, 67, 2, 0, 27, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+// blocks compressed per batch and thread
+static const size_t BLOCKS_PER_THREAD = 8;
+
+static void store_uint32_le(char* data, uint32_t value) {
+	for (size_t i = 0; i < 4; ++i) data[i] = (char) ((value >> (8*i)) & 0xff);
+}
+
+BgzfWriter::BgzfWriter(string filename, size_t nr_threads)
+	:filename(filename),
+	 file(filename, ios::out | ios::binary | ios::trunc),
+	 nr_threads(max(nr_threads, (size_t) 1)),
+	 uncompressed_written(0),
+	 compressed_written(0),
+	 closed(false)
+{
+	if (!this->file.good()) {
+		throw runtime_error("BgzfWriter::BgzfWriter: file " + filename + " cannot be created. Note that the filename must not contain non-existing directories.");
+	}
+}
+
+BgzfWriter::~BgzfWriter() {
+	if (!this->closed) {
+		try {
+			close();
+		} catch (const exception& e) {
+			cerr << e.what() << endl;
+		}
+	}
+}
+
+void BgzfWriter::compress_block(const char* data, size_t size, string& result) {
+	if (size > BGZF_BLOCK_SIZE) {
+		throw runtime_error("BgzfWriter::compress_block: block too large.");
+	}
+	// BSIZE is a 16 bit value, stored deflate data of BGZF_BLOCK_SIZE bytes still fits
+	size_t max_size = 65536;
+	result.resize(max_size);
+	for (int level : {Z_DEFAULT_COMPRESSION, 0}) {
+		z_stream stream;
+		stream.zalloc = Z_NULL;
+		stream.zfree = Z_NULL;
+		stream.opaque = Z_NULL;
+		// negative window bits: raw deflate data without zlib header
+		if (deflateInit2(&stream, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+			throw runtime_error("BgzfWriter::compress_block: failed to initialize zlib.");
+		}
+		stream.next_in = (Bytef*) data;
+		stream.avail_in = size;
+		stream.next_out = (Bytef*) &result[18];
+		stream.avail_out = max_size - 18 - 8;
+		int status = deflate(&stream, Z_FINISH);
+		size_t compressed_size = stream.total_out;
+		deflateEnd(&stream);
+		if (status != Z_STREAM_END) {
+			// incompressible data, store it instead
+			if (level != 0) continue;
+			throw runtime_error("BgzfWriter::compress_block: failed to compress block.");
+		}
+		size_t block_size = 18 + compressed_size + 8;
+		copy(BGZF_BLOCK_HEADER, BGZF_BLOCK_HEADER + 18, result.begin());
+		result[16] = (char) ((block_size - 1) & 0xff);
+		result[17] = (char) ((block_size - 1) >> 8);
+		store_uint32_le(&result[18 + compressed_size], crc32(crc32(0L, Z_NULL, 0), (const Bytef*) data, size));
+		store_uint32_le(&result[18 + compressed_size + 4], size);
+		result.resize(block_size);
+		return;
+	}
+}
+
+void BgzfWriter::write(const char* data, size_t size) {
+	if (this->closed) {
+		throw runtime_error("BgzfWriter::write: file " + this->filename + " is already closed.");
+	}
+	this->pending.append(data, size);
+	size_t batch_size = BGZF_BLOCK_SIZE * BLOCKS_PER_THREAD * this->nr_threads;
+	if (this->pending.size() >= batch_size) {
+		compress_pending(this->pending.size() - (this->pending.size() % BGZF_BLOCK_SIZE));
+	}
+}
+
+void BgzfWriter::write(const string& data) {
+	write(data.data(), data.size());
+}
+
+uint64_t BgzfWriter::tell() const {
+	return this->uncompressed_written + this->pending.size();
+}
+
+void BgzfWriter::compress_pending(size_t size) {
+	size_t nr_blocks = (size + BGZF_BLOCK_SIZE - 1) / BGZF_BLOCK_SIZE;
+	vector<string> blocks(nr_blocks);
+	vector<exception_ptr> errors(nr_blocks);
+	{
+		ThreadPool threadPool (min(this->nr_threads, nr_blocks));
+		for (size_t b = 0; b < nr_blocks; ++b) {
+			const char* data = this->pending.data() + b * BGZF_BLOCK_SIZE;
+			size_t block_size = min(BGZF_BLOCK_SIZE, size - b * BGZF_BLOCK_SIZE);
+			string* block = &blocks[b];
+			exception_ptr* error = &errors[b];
+			threadPool.submit([data, block_size, block, error](){
+				try {
+					compress_block(data, block_size, *block);
+				} catch (...) {
+					*error = current_exception();
+				}
+			});
+		}
+	}
+	for (auto& error : errors) {
+		if (error) rethrow_exception(error);
+	}
+	for (size_t b = 0; b < nr_blocks; ++b) {
+		this->block_starts.push_back(this->uncompressed_written);
+		this->block_offsets.push_back(this->compressed_written);
+		this->file.write(blocks[b].data(), blocks[b].size());
+		this->uncompressed_written += min(BGZF_BLOCK_SIZE, size - b * BGZF_BLOCK_SIZE);
+		this->compressed_written += blocks[b].size();
+	}
+	if (!this->file.good()) {
+		throw runtime_error("BgzfWriter::compress_pending: file " + this->filename + " could not be written.");
+	}
+	this->pending.erase(0, size);
+}
+
+void BgzfWriter::flush() {
+	if (!this->pending.empty()) compress_pending(this->pending.size());
+}
+
+void BgzfWriter::close() {
+	if (this->closed) return;
+	flush();
+	this->closed = true;
+	this->file.write((const char*) BGZF_EOF, sizeof(BGZF_EOF));
+	this->file.close();
+	if (this->file.fail()) {
+		throw runtime_error("BgzfWriter::close: file " + this->filename + " could not be written.");
+	}
+}
+
+uint64_t BgzfWriter::virtual_offset(uint64_t position) const {
+	if (position > this->uncompressed_written) {
+		throw runtime_error("BgzfWriter::virtual_offset: position has not been written yet.");
+	}
+	// the end of the written data is the start of the next block
+	if (position == this->uncompressed_written) return this->compressed_written << 16;
+	size_t block = upper_bound(this->block_starts.begin(), this->block_starts.end(), position) - this->block_starts.begin() - 1;
+	return (this->block_offsets[block] << 16) | (position - this->block_starts[block]);
+}
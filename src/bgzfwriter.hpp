@@ -0,0 +1,57 @@
+#ifndef BGZFWRITER_HPP
+#define BGZFWRITER_HPP
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <stdint.h>
+
+/**
+* Writes files in BGZF format (bgzip). Data is cut into blocks of at most BGZF_BLOCK_SIZE bytes,
+* which are compressed in parallel. Positions in the uncompressed data can be translated into
+* virtual offsets (compressed block offset << 16 | offset within the block) once they have been
+* written, e.g. to build a tabix index.
+**/
+
+class BgzfWriter {
+public:
+	/**
+	* @param filename name of the output file
+	* @param nr_threads number of threads used to compress blocks
+	**/
+	BgzfWriter(std::string filename, size_t nr_threads = 1);
+	~BgzfWriter();
+	BgzfWriter(const BgzfWriter&) = delete;
+	BgzfWriter& operator=(const BgzfWriter&) = delete;
+	void write(const char* data, size_t size);
+	void write(const std::string& data);
+	/** number of uncompressed bytes given so far **/
+	uint64_t tell() const;
+	/** compress and write all data given so far (the last block may be smaller than BGZF_BLOCK_SIZE) **/
+	void flush();
+	/** write remaining data and the end-of-file marker **/
+	void close();
+	/** virtual offset of the given position of the uncompressed data, which must have been written (see flush) **/
+	uint64_t virtual_offset(uint64_t position) const;
+	/** compress data (at most BGZF_BLOCK_SIZE bytes) into a complete BGZF block **/
+	static void compress_block(const char* data, size_t size, std::string& result);
+	/** maximum number of uncompressed bytes per block **/
+	static const size_t BGZF_BLOCK_SIZE = 0xff00;
+
+private:
+	std::string filename;
+	std::ofstream file;
+	size_t nr_threads;
+	/** data not compressed yet **/
+	std::string pending;
+	/** uncompressed start and compressed offset of each written block **/
+	std::vector<uint64_t> block_starts;
+	std::vector<uint64_t> block_offsets;
+	uint64_t uncompressed_written;
+	uint64_t compressed_written;
+	bool closed;
+	/** compress the first size bytes of pending **/
+	void compress_pending(size_t size);
+};
+
+#endif // BGZFWRITER_HPP
@@ -1,203 +1,308 @@
 #include <stdexcept>
 #include "dnasequence.hpp"
 #include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <stdint.h>
+#include <string_view>
 #include "sequenceutils.hpp"
 
 using namespace std;
 
-DnaSequence::DnaSequence() 
-	:even_length(true),
-	 is_undefined(false)
+/** lookup tables used to process four packed bases at once **/
+struct PackedBaseTables {
+	/** 2-bit code of each character (4 for undefined bases) **/
+	unsigned char encode[256];
+	/** the four bases stored in a byte **/
+	char decode[256][4];
+	/** byte with the order of its four bases reversed **/
+	unsigned char reverse[256];
+	/** byte with its four bases reverse complemented **/
+	unsigned char reverse_complement[256];
+	PackedBaseTables() {
+		for (size_t c = 0; c < 256; ++c) {
+			encode[c] = ::encode((char) c);
+		}
+		for (size_t b = 0; b < 256; ++b) {
+			unsigned char reversed = 0;
+			for (size_t i = 0; i < 4; ++i) {
+				unsigned char number = (b >> (6 - 2*i)) & 3;
+				decode[b][i] = ::decode(number);
+				reversed |= number << (2*i);
+			}
+			reverse[b] = reversed;
+			// complement of base x is 3 - x
+			reverse_complement[b] = reversed ^ 255;
+		}
+	}
+};
+
+const PackedBaseTables TABLES;
+
+inline unsigned char packed_base(const vector<unsigned char>& sequence, size_t position) {
+	return (sequence[position >> 2] >> (6 - 2 * (position & 3))) & 3;
+}
+
+DnaSequence::DnaSequence()
+	:length(0)
 {}
 
-DnaSequence::DnaSequence(string& sequence)
-	:even_length(true),
-	 is_undefined(false)
+DnaSequence::DnaSequence(const string& sequence)
+	:length(0)
 {
-	this->append(sequence);	
-}
-
-void DnaSequence::append(string& seq) {
-	for (auto base : seq) {
-		unsigned char number = encode(base);
-		// check whether base was defined
-		if (number == 4) this->is_undefined = true;
-		if (this->even_length) {
-			this->sequence.push_back(number << 4);
-		} else {
-			size_t index = this->size() / 2;
-			unsigned char updated = (this->sequence[index]) | number;
-			this->sequence[index] = updated;
-		}
-		this->even_length = !(this->even_length);
+	this->append(sequence);
+}
+
+void DnaSequence::push_base(unsigned char number) {
+	if ((this->length & 3) == 0) this->sequence.push_back(0);
+	this->sequence.back() |= number << (6 - 2 * (this->length & 3));
+	this->length += 1;
+}
+
+void DnaSequence::add_undefined(size_t start, size_t length) {
+	if (!this->undefined_runs.empty() && (this->undefined_runs.back().first + this->undefined_runs.back().second == start)) {
+		this->undefined_runs.back().second += length;
+	} else {
+		this->undefined_runs.push_back(make_pair(start, length));
 	}
 }
 
-void DnaSequence::append(DnaSequence seq) {
-	if (this->even_length) {
-		for (size_t i = 0; i < seq.sequence.size(); ++i) {
-			this->sequence.push_back(seq.sequence.at(i));
+void DnaSequence::append(const string& seq) {
+	auto append_base = [this](char base) {
+		unsigned char number = TABLES.encode[(unsigned char) base];
+		if (number == 4) {
+			add_undefined(this->length, 1);
+			number = 0;
 		}
-	} else {
-		if (seq.size() == 0) return;
-		unsigned char current = this->sequence.at(this->sequence.size()-1);
-		this->sequence.pop_back();
-		for (size_t i = 0; i < seq.size(); ++i) {
-			unsigned char s = seq.sequence.at(i/2);
-			if (i % 2 == 0) {
-				current |= (s >> 4);
-				this->sequence.push_back(current);
-			} else {
-				current = (s << 4);
-			}
+		push_base(number);
+	};
+	this->sequence.reserve((this->length + seq.size() + 3) / 4);
+	size_t i = 0;
+	while ((i < seq.size()) && ((this->length & 3) != 0)) {
+		append_base(seq[i]);
+		++i;
+	}
+	// encode four bases at once as long as they are all defined
+	for (; i + 4 <= seq.size(); i += 4) {
+		unsigned char c0 = TABLES.encode[(unsigned char) seq[i]];
+		unsigned char c1 = TABLES.encode[(unsigned char) seq[i+1]];
+		unsigned char c2 = TABLES.encode[(unsigned char) seq[i+2]];
+		unsigned char c3 = TABLES.encode[(unsigned char) seq[i+3]];
+		if (((c0 | c1 | c2 | c3) & 4) != 0) {
+			for (size_t j = i; j < i + 4; ++j) append_base(seq[j]);
+			continue;
 		}
-		if (seq.size() % 2 == 0) this->sequence.push_back(current);
+		this->sequence.push_back((c0 << 6) | (c1 << 4) | (c2 << 2) | c3);
+		this->length += 4;
+	}
+	for (; i < seq.size(); ++i) {
+		append_base(seq[i]);
 	}
-	this->even_length = this->even_length == (seq.size() % 2 == 0);
-	this->is_undefined = this->is_undefined || seq.contains_undefined();
 }
 
-void DnaSequence::reverse() {
-	vector<unsigned char> reversed;
-	if (this->even_length) {
-		for (vector<unsigned char>::reverse_iterator it = this->sequence.rbegin(); it != this->sequence.rend(); ++it) {
-			unsigned char reversed_element = ((*it) >> 4) | ((*it) << 4);
-			reversed.push_back(reversed_element);
-		}
+void DnaSequence::append(const DnaSequence& seq) {
+	append_range(seq, 0, seq.size());
+}
+
+void DnaSequence::append(const DnaSequenceView& seq) {
+	append_range(*seq.sequence, seq.start, seq.start + seq.length);
+}
+
+void DnaSequence::append_range(const DnaSequence& other, size_t start, size_t end) {
+	if (&other == this) {
+		DnaSequence copy(other);
+		append_range(copy, start, end);
+		return;
+	}
+	for (auto& run : other.undefined_runs) {
+		if (run.first >= end) break;
+		size_t run_start = max(run.first, start);
+		size_t run_end = min(run.first + run.second, end);
+		if (run_start < run_end) add_undefined(this->length + (run_start - start), run_end - run_start);
+	}
+	size_t position = start;
+	while ((position < end) && ((this->length & 3) != 0)) {
+		push_base(packed_base(other.sequence, position));
+		++position;
+	}
+	if (position == end) return;
+
+	// copy whole bytes, shifting them if the bases are not aligned in the same way
+	size_t nr_bases = end - position;
+	size_t nr_bytes = (nr_bases + 3) / 4;
+	size_t first = position >> 2;
+	size_t shift = 2 * (position & 3);
+	size_t previous_size = this->sequence.size();
+	this->sequence.resize(previous_size + nr_bytes);
+	if (shift == 0) {
+		memcpy(this->sequence.data() + previous_size, other.sequence.data() + first, nr_bytes);
 	} else {
-		unsigned char current = this->sequence[this->sequence.size() - 1];
-		this->sequence.pop_back();
-		for (vector<unsigned char>::reverse_iterator it = this->sequence.rbegin(); it != this->sequence.rend(); ++it) {
-			unsigned char second = (*it) << 4;
-			reversed.push_back( (second >> 4) | current );
-			current = (*it) & 240;
+		for (size_t i = 0; i < nr_bytes; ++i) {
+			unsigned char element = other.sequence[first + i] << shift;
+			if (first + i + 1 < other.sequence.size()) element |= other.sequence[first + i + 1] >> (8 - shift);
+			this->sequence[previous_size + i] = element;
 		}
-		reversed.push_back(current);
 	}
-	this->sequence = move(reversed);
+	// unused bits of the last byte are kept zero
+	if ((nr_bases & 3) != 0) this->sequence.back() &= (unsigned char) (255 << (8 - 2 * (nr_bases & 3)));
+	this->length += nr_bases;
+}
+
+void DnaSequence::align_reversed() {
+	size_t shift = 2 * ((4 - (this->length & 3)) & 3);
+	if (shift == 0) return;
+	for (size_t i = 0; i < this->sequence.size(); ++i) {
+		unsigned char element = this->sequence[i] << shift;
+		if (i + 1 < this->sequence.size()) element |= this->sequence[i+1] >> (8 - shift);
+		this->sequence[i] = element;
+	}
+}
+
+void DnaSequence::reverse() {
+	std::reverse(this->sequence.begin(), this->sequence.end());
+	for (auto& element : this->sequence) element = TABLES.reverse[element];
+	align_reversed();
+	vector<pair<size_t,size_t>> reversed_runs;
+	for (auto it = this->undefined_runs.rbegin(); it != this->undefined_runs.rend(); ++it) {
+		reversed_runs.push_back(make_pair(this->length - it->first - it->second, it->second));
+	}
+	this->undefined_runs = move(reversed_runs);
 }
 
 void DnaSequence::reverse_complement() {
-	vector<unsigned char> reverse_compl;
-	if (this->even_length) {
-		for (vector<unsigned char>::reverse_iterator it = this->sequence.rbegin(); it != this->sequence.rend(); ++it) {
-			unsigned char first = complement((*it) >> 4);
-			unsigned char second = complement((*it) & 15);
-			reverse_compl.push_back( (second << 4) | first);
+	std::reverse(this->sequence.begin(), this->sequence.end());
+	for (auto& element : this->sequence) element = TABLES.reverse_complement[element];
+	align_reversed();
+	vector<pair<size_t,size_t>> reversed_runs;
+	for (auto it = this->undefined_runs.rbegin(); it != this->undefined_runs.rend(); ++it) {
+		size_t start = this->length - it->first - it->second;
+		reversed_runs.push_back(make_pair(start, it->second));
+		// undefined bases are stored as A
+		for (size_t i = start; i < start + it->second; ++i) {
+			this->sequence[i >> 2] &= (unsigned char) ~(3 << (6 - 2 * (i & 3)));
 		}
-	} else {
-		unsigned char current = complement(this->sequence[this->sequence.size() - 1] >> 4) << 4;
-		this->sequence.pop_back();
-		for (vector<unsigned char>::reverse_iterator it = this->sequence.rbegin(); it != this->sequence.rend(); ++it) {
-			unsigned char second = complement((*it) & 15);
-			unsigned char first = complement((*it) >> 4);
-			reverse_compl.push_back(current | second);
-			current = (first << 4);
-		}
-		reverse_compl.push_back(current);
 	}
-	this->sequence = move(reverse_compl);
+	this->undefined_runs = move(reversed_runs);
+}
+
+bool DnaSequence::is_undefined(size_t position) const {
+	if (this->undefined_runs.empty()) return false;
+	auto it = upper_bound(this->undefined_runs.begin(), this->undefined_runs.end(), make_pair(position, (size_t) SIZE_MAX));
+	if (it == this->undefined_runs.begin()) return false;
+	--it;
+	return position < it->first + it->second;
 }
 
 char DnaSequence::operator[](size_t position) const {
 	if (position >= this->size()) {
 		throw runtime_error("DnaSequence::operator[]: index out of bounds.");
 	}
+	if (is_undefined(position)) return 'N';
+	return TABLES.decode[this->sequence[position >> 2]][position & 3];
+}
 
-	unsigned char number = this->sequence[position / 2];
-	if (position % 2 == 0) {
-		return decode(number >> 4);
-	} else {
-		return decode(number & 15);
+unsigned char DnaSequence::encoded_at(size_t position) const {
+	if (position >= this->size()) {
+		throw runtime_error("DnaSequence::encoded_at: index out of bounds.");
 	}
+	if (is_undefined(position)) return 4;
+	return packed_base(this->sequence, position);
 }
 
 DnaSequence DnaSequence::base_at(size_t position) const {
 	if (position >= this->size()) {
 		throw runtime_error("DnaSequence::base_at: index out of bounds.");
 	}
-
 	DnaSequence result;
-	unsigned char number = this->sequence[position / 2];
-	if (position % 2 == 0) {
-		result.sequence.push_back(number & 240);
-	} else {
-		result.sequence.push_back(number << 4);
-	}
-	result.even_length = false;
+	result.append_range(*this, position, position + 1);
 	return result;
 }
 
 size_t DnaSequence::size() const {
-	size_t result = this->sequence.size() * 2;
-	if (!this->even_length) {
-		result -= 1;
+	return this->length;
+}
+
+void DnaSequence::decode_range(size_t start, size_t end, char* result) const {
+	char* output = result;
+	size_t position = start;
+	while ((position < end) && ((position & 3) != 0)) {
+		*output++ = TABLES.decode[this->sequence[position >> 2]][position & 3];
+		++position;
+	}
+	// decode four bases at once
+	for (; position + 4 <= end; position += 4) {
+		memcpy(output, TABLES.decode[this->sequence[position >> 2]], 4);
+		output += 4;
+	}
+	for (; position < end; ++position) {
+		*output++ = TABLES.decode[this->sequence[position >> 2]][position & 3];
+	}
+	for (auto& run : this->undefined_runs) {
+		if (run.first >= end) break;
+		size_t run_start = max(run.first, start);
+		size_t run_end = min(run.first + run.second, end);
+		for (size_t i = run_start; i < run_end; ++i) result[i - start] = 'N';
 	}
-	return result;
 }
 
 void DnaSequence::substr(size_t start, size_t end, string& result) const {
-	result.clear();
-	for (size_t i = start; i < end; ++i) {
-		result += (*this)[i];
+	if ((start > end) || (end > this->size())) {
+		throw runtime_error("DnaSequence::substr: index out of bounds.");
 	}
+	result.resize(end - start);
+	if (end > start) decode_range(start, end, &result[0]);
 }
 
 void DnaSequence::substr(size_t start, size_t end, DnaSequence& result) const {
-	vector<unsigned char> substring;
-	if (start % 2 == 0) {
-		size_t start_index = start / 2;
-		size_t steps = ((end + 1) -start)/ 2;
-		substring = vector<unsigned char>(this->sequence.begin() + start_index, this->sequence.begin() + start_index + steps);
-		if (end % 2 != 0) substring[substring.size()-1] &= 240;
-	} else {
-		unsigned char current = (this->sequence[start/2]) << 4;
-		for (size_t i = start+1; i < end; i+=2) {
-			unsigned char element = this->sequence[i/2];
-			current |= (element >> 4);
-			substring.push_back(current);
-			current = element <<  4;
-		}
-		if (end % 2 == 0) {
-			substring.push_back(current);	
-		}
-	}
-
-	bool undefined = false;
-	if (this->is_undefined) {
-		// check whether there is an undefined base in subsequence
-		for (auto elem : substring) {
-			if ((elem & 68) != 0) {
-				undefined = true;
-				break;
-			}
-		}
+	if ((start > end) || (end > this->size())) {
+		throw runtime_error("DnaSequence::substr: index out of bounds.");
 	}
+	DnaSequence substring;
+	substring.append_range(*this, start, end);
+	result = move(substring);
+}
 
-	result.sequence = move(substring); 
-	result.even_length = ((end - start) % 2 == 0);
-	result.is_undefined = undefined;
+DnaSequenceView DnaSequence::view(size_t start, size_t end) const {
+	return DnaSequenceView(*this, start, end);
 }
 
 string DnaSequence::to_string() const {
-	string result;
-	for (size_t i = 0; i < this->size(); ++i) {
-		result += (*this)[i];
-	}
+	string result(this->length, 'A');
+	if (this->length > 0) decode_range(0, this->length, &result[0]);
 	return result;
 }
 
 void DnaSequence::clear() {
 	this->sequence.clear();
-	this->even_length = true;
+	this->length = 0;
+	this->undefined_runs.clear();
 }
 
 bool DnaSequence::operator<(const DnaSequence& dna) const {
-	return (this->sequence < dna.sequence);
+	// order is the same as the one of the corresponding strings
+	size_t common = min(this->length, dna.length);
+	if (this->undefined_runs.empty() && dna.undefined_runs.empty()) {
+		// A < C < G < T, so whole bytes can be compared directly
+		size_t nr_bytes = common / 4;
+		int comparison = (nr_bytes > 0) ? memcmp(this->sequence.data(), dna.sequence.data(), nr_bytes) : 0;
+		if (comparison != 0) return comparison < 0;
+		for (size_t i = nr_bytes * 4; i < common; ++i) {
+			unsigned char a = packed_base(this->sequence, i);
+			unsigned char b = packed_base(dna.sequence, i);
+			if (a != b) return a < b;
+		}
+	} else {
+		for (size_t i = 0; i < common; ++i) {
+			char a = (*this)[i];
+			char b = dna[i];
+			if (a != b) return a < b;
+		}
+	}
+	return this->length < dna.length;
 }
 
 bool operator==(const DnaSequence& dna1, const DnaSequence& dna2) {
-	return (dna1.sequence == dna2.sequence) && (dna1.size() == dna2.size());
+	return (dna1.length == dna2.length) && (dna1.sequence == dna2.sequence) && (dna1.undefined_runs == dna2.undefined_runs);
 }
 
 bool operator!=(const DnaSequence& dna1, const DnaSequence& dna2) {
@@ -205,5 +310,72 @@ bool operator!=(const DnaSequence& dna1, const DnaSequence& dna2) {
 }
 
 bool DnaSequence::contains_undefined() const {
-	return this->is_undefined;
+	return !this->undefined_runs.empty();
+}
+
+size_t DnaSequenceHash::operator()(const DnaSequence& sequence) const {
+	// unused bits of the last byte are always zero, so equal sequences have equal bytes
+	size_t bytes = hash<string_view>()(string_view((const char*) sequence.sequence.data(), sequence.sequence.size()));
+	return bytes ^ (sequence.length * 0x9e3779b97f4a7c15ULL);
+}
+
+DnaSequenceView::DnaSequenceView(const DnaSequence& sequence)
+	:sequence(&sequence),
+	 start(0),
+	 length(sequence.size())
+{}
+
+DnaSequenceView::DnaSequenceView(const DnaSequence& sequence, size_t start, size_t end)
+	:sequence(&sequence),
+	 start(start),
+	 length(end - start)
+{
+	if ((start > end) || (end > sequence.size())) {
+		throw runtime_error("DnaSequenceView::DnaSequenceView: index out of bounds.");
+	}
+}
+
+char DnaSequenceView::operator[](size_t position) const {
+	if (position >= this->length) {
+		throw runtime_error("DnaSequenceView::operator[]: index out of bounds.");
+	}
+	return (*this->sequence)[this->start + position];
+}
+
+unsigned char DnaSequenceView::encoded_at(size_t position) const {
+	if (position >= this->length) {
+		throw runtime_error("DnaSequenceView::encoded_at: index out of bounds.");
+	}
+	return this->sequence->encoded_at(this->start + position);
+}
+
+size_t DnaSequenceView::size() const {
+	return this->length;
+}
+
+string DnaSequenceView::to_string() const {
+	string result(this->length, 'A');
+	if (this->length > 0) this->sequence->decode_range(this->start, this->start + this->length, &result[0]);
+	return result;
+}
+
+bool DnaSequenceView::contains_undefined() const {
+	size_t end = this->start + this->length;
+	for (auto& run : this->sequence->undefined_runs) {
+		if (run.first >= end) break;
+		if (run.first + run.second > this->start) return true;
+	}
+	return false;
+}
+
+bool operator==(const DnaSequenceView& view1, const DnaSequenceView& view2) {
+	if (view1.length != view2.length) return false;
+	for (size_t i = 0; i < view1.length; ++i) {
+		if (view1.encoded_at(i) != view2.encoded_at(i)) return false;
+	}
+	return true;
+}
+
+bool operator!=(const DnaSequenceView& view1, const DnaSequenceView& view2) {
+	return !(view1 == view2);
 }
@@ -3,34 +3,43 @@
 
 #include <string>
 #include <vector>
-#include "cereal/access.hpp"
-/** 
-* Represents a DNA sequence.
+#include <utility>
+
+class DnaSequenceView;
+
+/**
+* Represents a DNA sequence. Bases are stored with 2 bits each, positions of
+* undefined bases (N) are kept as a list of runs.
 **/
 
 class DnaSequence {
 public:
 	DnaSequence();
-	DnaSequence(std::string& sequence);
+	DnaSequence(const std::string& sequence);
 	/** append string sequence to the end of DNA. **/
-	void append(std::string& sequence);
+	void append(const std::string& sequence);
 	/** append DnaSequence to the end of DNA **/
-	void append(DnaSequence sequence);
+	void append(const DnaSequence& sequence);
+	void append(const DnaSequenceView& sequence);
 	/** reverse sequence **/
 	void reverse();
 	/** compute reverse complement **/
 	void reverse_complement();
 	/** get base at index position. **/
 	char operator[](size_t position) const;
+	/** get base at index position encoded as 0,1,2,3 (A,C,G,T) or 4 (undefined) **/
+	unsigned char encoded_at(size_t position) const;
 	DnaSequence base_at(size_t position) const;
 	size_t size() const;
-	/** get subsequence 
+	/** get subsequence
 	* @param start, end start and end of the subsequence
 	* @param result resulting DnaSequence
 	**/
 	void substr(size_t start, size_t end, DnaSequence& result) const;
 	/** get subsequence a string **/
 	void substr(size_t start, size_t end, std::string& result) const;
+	/** get a view of the subsequence without copying it **/
+	DnaSequenceView view(size_t start, size_t end) const;
 	/** convert DnaSequence to string **/
 	std::string to_string() const;
 	/** clear sequence **/
@@ -43,17 +52,60 @@ public:
 	bool contains_undefined() const;
     template<class Archive>
     void serialize(Archive& archive) {  // NOLINT
-      archive(sequence, even_length, is_undefined);
+      archive(sequence, length, undefined_runs);
     }
 
 private:
-    friend cereal::access;
-	/** store 2 bases per char (using 4 bits for each) **/
+	friend class DnaSequenceView;
+	friend struct DnaSequenceHash;
+	/** store 4 bases per char (using 2 bits for each, first base in the highest bits). Undefined bases are stored as A. **/
 	std::vector<unsigned char> sequence;
-	/** true if the length is even **/
-	bool even_length;
-	/** is true if sequence contains any undefined bases (N,n) **/
-	bool is_undefined;
+	/** number of bases **/
+	size_t length;
+	/** sorted runs (start, length) of undefined bases **/
+	std::vector<std::pair<size_t,size_t>> undefined_runs;
+	bool is_undefined(size_t position) const;
+	void push_base(unsigned char number);
+	void add_undefined(size_t start, size_t length);
+	/** append bases [start, end) of the given sequence **/
+	void append_range(const DnaSequence& other, size_t start, size_t end);
+	/** write the bases [start, end) as characters to result **/
+	void decode_range(size_t start, size_t end, char* result) const;
+	/** shift out the unused bits at the beginning after the packed bases have been reversed **/
+	void align_reversed();
+};
+
+/** hash of a DnaSequence computed from its length and packed bases **/
+struct DnaSequenceHash {
+	size_t operator()(const DnaSequence& sequence) const;
+};
+
+/**
+* Non-owning view of a part of a DnaSequence. It stays valid as long as the sequence is
+* neither modified nor destroyed.
+**/
+
+class DnaSequenceView {
+public:
+	DnaSequenceView(const DnaSequence& sequence);
+	DnaSequenceView(const DnaSequence& sequence, size_t start, size_t end);
+	/** get base at index position (relative to the start of the view) **/
+	char operator[](size_t position) const;
+	/** get base at index position encoded as 0,1,2,3 (A,C,G,T) or 4 (undefined) **/
+	unsigned char encoded_at(size_t position) const;
+	size_t size() const;
+	std::string to_string() const;
+	/** returns true if the viewed part contains at least one undefined base **/
+	bool contains_undefined() const;
+	/** comparision operators (compare the viewed bases) **/
+	friend bool operator==(const DnaSequenceView& view1, const DnaSequenceView& view2);
+	friend bool operator!=(const DnaSequenceView& view1, const DnaSequenceView& view2);
+
+private:
+	friend class DnaSequence;
+	const DnaSequence* sequence;
+	size_t start;
+	size_t length;
 };
 
 #endif // DNASEQUENCE_HPP
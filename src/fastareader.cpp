@@ -1,12 +1,15 @@
 #include <iostream>
 #include <fstream>
 #include "fastareader.hpp"
+#include "bgzfreader.hpp"
 
 using namespace std;
 
 FastaReader::FastaReader(string filename) {
 	parse_file(filename);
-	cerr << "Found " << this->name_to_sequence.size() << " chromosome(s) from the reference file." << endl;
+	vector<string> names;
+	get_sequence_names(names);
+	cerr << "Found " << names.size() << " chromosome(s) from the reference file." << endl;
 }
 
 
@@ -16,6 +19,14 @@ void FastaReader::parse_file(string filename) {
 	if (!file.good()) {
 		throw runtime_error("FastaReader::parse_file: reference file cannot be opened.");
 	}
+	// indexed files are not loaded into memory
+	if (IndexedFasta::has_index(filename)) {
+		this->indexed_fasta = unique_ptr<IndexedFasta>(new IndexedFasta(filename));
+		return;
+	}
+	if (BgzfReader::is_bgzf(filename)) {
+		throw runtime_error("FastaReader::parse_file: bgzipped reference file " + filename + " is not indexed (run samtools faidx to create .fai and .gzi indices).");
+	}
 	string line;
 	DnaSequence* dna_seq = nullptr;
 	while (getline(file, line)) {
@@ -55,11 +66,13 @@ FastaReader::~FastaReader() {
 }
 
 bool FastaReader::contains_name(string name) const {
+	if (this->indexed_fasta) return this->indexed_fasta->contains_name(name);
 	auto it = this->name_to_sequence.find(name);
 	return (it != this->name_to_sequence.end());
 }
 
 size_t FastaReader::get_size_of(string name) const {
+	if (this->indexed_fasta) return this->indexed_fasta->get_size_of(name);
 	if (this->contains_name(name)) {
 		return this->name_to_sequence.at(name)->size();
 	} else {
@@ -68,6 +81,10 @@ size_t FastaReader::get_size_of(string name) const {
 }
 
 void FastaReader::get_sequence_names(vector<string>& names) const {
+	if (this->indexed_fasta) {
+		this->indexed_fasta->get_sequence_names(names);
+		return;
+	}
 	for (auto it = this->name_to_sequence.begin(); it != this->name_to_sequence.end(); ++it) {
 		names.push_back(it->first);
 	}
@@ -75,13 +92,19 @@ void FastaReader::get_sequence_names(vector<string>& names) const {
 
 size_t FastaReader::get_total_kmers(size_t kmer_size) const {
 	size_t total_kmers = 0;
-	for (auto it = this->name_to_sequence.begin(); it != this->name_to_sequence.end(); ++it) {
-		total_kmers += get_size_of(it->first) - kmer_size + 1;
+	vector<string> names;
+	get_sequence_names(names);
+	for (auto name : names) {
+		total_kmers += get_size_of(name) - kmer_size + 1;
 	}
 	return total_kmers;
 }
 
 void FastaReader::get_subsequence(string name, size_t start, size_t end, string& result) const {
+	if (this->indexed_fasta) {
+		this->indexed_fasta->get_subsequence(name, start, end, result);
+		return;
+	}
 	if (this->contains_name(name)) {
 		this->name_to_sequence.at(name)->substr(start, end, result);
 	} else {
@@ -90,9 +113,19 @@ void FastaReader::get_subsequence(string name, size_t start, size_t end, string&
 }
 
 void FastaReader::get_subsequence(std::string name, size_t start, size_t end, DnaSequence& result) const {
+	if (this->indexed_fasta) {
+		string sequence;
+		this->indexed_fasta->get_subsequence(name, start, end, sequence);
+		result = DnaSequence(sequence);
+		return;
+	}
 	if (this->contains_name(name)) {
 		this->name_to_sequence.at(name)->substr(start, end, result);
 	} else {
 		throw runtime_error("FastaReader::get_subsequence (DnaSequence): chromosome " + name + " is not present in FASTA-file.");
 	}
 }
+
+void FastaReader::release(string name) const {
+	if (this->indexed_fasta) this->indexed_fasta->release(name);
+}
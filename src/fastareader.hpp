@@ -3,10 +3,13 @@
 
 #include <string>
 #include <map>
+#include <memory>
 #include "dnasequence.hpp"
+#include "indexedfasta.hpp"
 
 /**
-* Represents FASTA-sequence.
+* Represents FASTA-sequence. If the file is indexed (samtools faidx), sequences are read
+* from the file on demand instead of being loaded into memory.
 **/
 
 class FastaReader {
@@ -28,9 +31,13 @@ public:
 	/** get a subsequence **/
 	void get_subsequence(std::string name, size_t start, size_t end, std::string& result) const;
 	void get_subsequence(std::string name, size_t start, size_t end, DnaSequence& result) const; 
+	/** release memory used to access the given sequence (only has an effect for indexed files) **/
+	void release(std::string name) const;
     void parse_file(std::string filename);   
 private:
 	std::map<std::string, DnaSequence*> name_to_sequence;
+	/** set if the file is indexed **/
+	std::unique_ptr<IndexedFasta> indexed_fasta;
 };
 
 #endif // FASTAREADER_HPP
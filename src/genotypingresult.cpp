@@ -174,3 +174,9 @@ void GenotypingResult::normalize () {
 		this->divide_likelihoods_by(normalization_sum);
 	}
 }
+
+size_t GenotypingResult::estimate_memory(size_t nr_alleles) {
+	// one map node (including the tree pointers and allocation overhead) per unordered genotype
+	size_t nr_genotypes = nr_alleles * (nr_alleles + 1) / 2;
+	return sizeof(GenotypingResult) + nr_genotypes * (sizeof(pair<const pair<unsigned char,unsigned char>, long double>) + 32 + 16);
+}
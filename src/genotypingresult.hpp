@@ -42,6 +42,8 @@ public:
 	 **/
 	void combine(GenotypingResult& likelihoods);
 	void normalize();
+	/** estimate the number of bytes allocated for the likelihoods of all genotypes of a variant with the given number of alleles **/
+	static size_t estimate_memory(size_t nr_alleles);
 
 private:
 	/** map genotype -> likelihood. genotype alleles are ordered in ascending order **/
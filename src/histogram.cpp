@@ -8,9 +8,9 @@ Histogram::Histogram(size_t max_value)
 	:histogram(max_value+1, 0)
 {}
 
-void Histogram::add_value(size_t value) {
+void Histogram::add_value(size_t value, size_t count) {
 	if (value < this->histogram.size()) {
-		this->histogram[value] += 1;
+		this->histogram[value] += count;
 	}
 }
 
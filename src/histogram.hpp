@@ -7,7 +7,7 @@
 class Histogram {
 public:
 	Histogram(size_t max_value);
-	void add_value(size_t value);
+	void add_value(size_t value, size_t count = 1);
 	void write_to_file(std::string filename) const;
 	void smooth_histogram();
 	void find_peaks(std::vector<size_t>& peak_ids, std::vector<size_t>& peak_values) const;
@@ -564,4 +564,15 @@ vector<GenotypingResult> HMM::get_genotyping_result() const {
 
 vector<GenotypingResult> HMM::move_genotyping_result() {
 	return move(this->genotyping_result);
-}
\ No newline at end of file
+}
+
+size_t HMM::estimate_memory(size_t nr_variants, size_t nr_paths) {
+	size_t nr_states = nr_paths * nr_paths;
+	// ColumnIndexers (paths and alleles), column pointers and normalization sums
+	size_t memory = nr_variants * (sizeof(ColumnIndexer) + 16 + 3 * nr_paths + 32 + 4 * sizeof(void*) + sizeof(long double));
+	// sparse tables keep every k-th column (k = sqrt(nr_variants)) plus the block being recomputed, Viterbi also keeps backtrace columns
+	size_t k = (size_t) sqrt(nr_variants) + 1;
+	size_t stored_columns = nr_variants / k + k + 2;
+	memory += stored_columns * (nr_states * (sizeof(long double) + sizeof(size_t)) + 32);
+	return memory;
+}
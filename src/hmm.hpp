@@ -27,6 +27,8 @@ public:
 	/** moves the GenotypingResults to the caller such that they will no longer be stored in the class. Use with care! **/
 	std::vector<GenotypingResult> move_genotyping_result();
 	~HMM();
+	/** estimate the number of bytes allocated while running on the given number of variants and paths (without the GenotypingResults) **/
+	static size_t estimate_memory(size_t nr_variants, size_t nr_paths);
 
 private:
 	std::vector<ColumnIndexer*> column_indexers;
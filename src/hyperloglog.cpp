@@ -0,0 +1,173 @@
+#include "hyperloglog.hpp"
+#include <stdexcept>
+#include <math.h>
+#include <algorithm>
+#include <sys/stat.h>
+#include <zlib.h>
+#include "sequenceutils.hpp"
+
+using namespace std;
+
+typedef unsigned __int128 kmer_bits;
+
+static uint64_t mix_hash(uint64_t x) {
+	// finalizer of MurmurHash3
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdULL;
+	x ^= x >> 33;
+	x *= 0xc4ceb9fe1a85ec53ULL;
+	x ^= x >> 33;
+	return x;
+}
+
+HyperLogLog::HyperLogLog(unsigned char precision)
+	:precision(precision),
+	 registers(1 << precision, 0),
+	 total_kmers(0)
+{
+	if ((precision < 4) || (precision > 18)) {
+		throw runtime_error("HyperLogLog::HyperLogLog: precision must be between 4 and 18.");
+	}
+}
+
+void HyperLogLog::add(uint64_t hash) {
+	size_t index = hash >> (64 - this->precision);
+	uint64_t rest = (hash << this->precision) | (1ULL << (this->precision - 1));
+	unsigned char rank = __builtin_clzll(rest) + 1;
+	if (rank > this->registers[index]) this->registers[index] = rank;
+}
+
+void HyperLogLog::add_sequence(const string& sequence, size_t kmer_size) {
+	if ((kmer_size == 0) || (kmer_size > 64)) {
+		throw runtime_error("HyperLogLog::add_sequence: kmer size must be between 1 and 64.");
+	}
+	kmer_bits mask = (kmer_size == 64) ? ~((kmer_bits) 0) : ((((kmer_bits) 1) << (2*kmer_size)) - 1);
+	size_t shift = 2*kmer_size - 2;
+	kmer_bits forward = 0;
+	kmer_bits reverse = 0;
+	size_t valid = 0;
+	for (char c : sequence) {
+		unsigned char base = encode(c);
+		if (base == 4) {
+			// kmers containing undefined bases are not counted
+			valid = 0;
+			continue;
+		}
+		forward = ((forward << 2) | base) & mask;
+		reverse = (reverse >> 2) | (((kmer_bits) (3 - base)) << shift);
+		valid += 1;
+		if (valid >= kmer_size) {
+			kmer_bits canonical = (forward < reverse) ? forward : reverse;
+			uint64_t low = (uint64_t) canonical;
+			uint64_t high = (uint64_t) (canonical >> 64);
+			this->add(mix_hash(low ^ mix_hash(high + 0x9e3779b97f4a7c15ULL)));
+			this->total_kmers += 1;
+		}
+	}
+}
+
+static bool read_line(gzFile file, string& line) {
+	line.clear();
+	char buffer[1 << 16];
+	while (gzgets(file, buffer, sizeof(buffer)) != NULL) {
+		line += buffer;
+		if (line.back() == '\n') {
+			line.pop_back();
+			if (!line.empty() && (line.back() == '\r')) line.pop_back();
+			return true;
+		}
+	}
+	return !line.empty();
+}
+
+double HyperLogLog::add_file(string filename, size_t kmer_size, size_t max_sequences) {
+	struct stat file_stat;
+	if (stat(filename.c_str(), &file_stat) != 0) {
+		throw runtime_error("HyperLogLog::add_file: file " + filename + " cannot be opened.");
+	}
+	double file_size = file_stat.st_size;
+	// gzip-compressed files are decompressed on the fly, uncompressed ones are read as they are
+	gzFile file = gzopen(filename.c_str(), "rb");
+	if (file == NULL) {
+		throw runtime_error("HyperLogLog::add_file: file " + filename + " cannot be opened.");
+	}
+	gzbuffer(file, 1 << 18);
+
+	string line;
+	string sequence;
+	size_t nr_sequences = 0;
+	bool is_fastq = false;
+	size_t line_in_record = 0;
+	while (read_line(file, line)) {
+		if (line.empty()) continue;
+		if (nr_sequences == 0 && sequence.empty() && line_in_record == 0) {
+			if ((line[0] != '>') && (line[0] != '@')) {
+				gzclose(file);
+				throw runtime_error("HyperLogLog::add_file: file " + filename + " is neither in FASTA nor in FASTQ format.");
+			}
+			is_fastq = (line[0] == '@');
+		}
+		if (is_fastq) {
+			// FASTQ records consist of four lines: header, sequence, separator, qualities
+			if (line_in_record == 1) {
+				this->add_sequence(line, kmer_size);
+				nr_sequences += 1;
+			}
+			line_in_record = (line_in_record + 1) % 4;
+			if ((line_in_record == 0) && (max_sequences > 0) && (nr_sequences >= max_sequences)) break;
+		} else {
+			if (line[0] == '>') {
+				if (!sequence.empty()) {
+					this->add_sequence(sequence, kmer_size);
+					sequence.clear();
+					nr_sequences += 1;
+					if ((max_sequences > 0) && (nr_sequences >= max_sequences)) break;
+				}
+				line_in_record = 1;
+			} else {
+				sequence += line;
+			}
+		}
+	}
+	if (!sequence.empty()) {
+		this->add_sequence(sequence, kmer_size);
+	}
+
+	// position in the (compressed) file determines the fraction processed
+	bool at_end = gzeof(file);
+	double processed = gzoffset(file);
+	gzclose(file);
+	if (at_end || (file_size == 0)) return 1.0;
+	return (processed > 0) ? min(1.0, processed / file_size) : 1.0;
+}
+
+void HyperLogLog::merge(const HyperLogLog& other) {
+	if (this->precision != other.precision) {
+		throw runtime_error("HyperLogLog::merge: sketches have different precisions.");
+	}
+	for (size_t i = 0; i < this->registers.size(); ++i) {
+		if (other.registers[i] > this->registers[i]) this->registers[i] = other.registers[i];
+	}
+	this->total_kmers += other.total_kmers;
+}
+
+size_t HyperLogLog::estimate() const {
+	double m = this->registers.size();
+	double alpha = 0.7213 / (1.0 + 1.079 / m);
+	double sum = 0.0;
+	size_t zeros = 0;
+	for (auto r : this->registers) {
+		sum += ldexp(1.0, -r);
+		if (r == 0) zeros += 1;
+	}
+	double estimate = alpha * m * m / sum;
+	// small range correction (linear counting)
+	if ((estimate <= 2.5 * m) && (zeros > 0)) {
+		estimate = m * log(m / zeros);
+	}
+	return (size_t) llround(estimate);
+}
+
+size_t HyperLogLog::get_total_kmers() const {
+	return this->total_kmers;
+}
@@ -0,0 +1,41 @@
+#ifndef HYPERLOGLOG_HPP
+#define HYPERLOGLOG_HPP
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+
+/**
+* Estimates the number of distinct canonical kmers in a set of sequences
+* using the HyperLogLog sketch. Used to size the Jellyfish hashes before counting.
+**/
+
+class HyperLogLog {
+public:
+	/**
+	* @param precision number of bits used to select a register (2^precision registers)
+	**/
+	HyperLogLog(unsigned char precision = 14);
+	/** add a hash value to the sketch **/
+	void add(uint64_t hash);
+	/** add all canonical kmers of the given sequence (kmers containing undefined bases are skipped) **/
+	void add_sequence(const std::string& sequence, size_t kmer_size);
+	/** add the kmers of all sequences contained in a FASTA/FASTQ file (uncompressed or gzip-compressed).
+	* @param max_sequences stop after this many sequences (0: read the whole file)
+	* @returns fraction of the (compressed) file that has been processed
+	**/
+	double add_file(std::string filename, size_t kmer_size, size_t max_sequences = 0);
+	/** merge another sketch (with same precision) into this one **/
+	void merge(const HyperLogLog& other);
+	/** estimated number of distinct kmers **/
+	size_t estimate() const;
+	/** total number of kmers added (including duplicates) **/
+	size_t get_total_kmers() const;
+
+private:
+	unsigned char precision;
+	std::vector<unsigned char> registers;
+	size_t total_kmers;
+};
+
+#endif // HYPERLOGLOG_HPP
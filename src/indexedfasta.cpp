@@ -0,0 +1,188 @@
+#include "indexedfasta.hpp"
+#include <stdexcept>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include "bgzfreader.hpp"
+#include "sequenceutils.hpp"
+
+using namespace std;
+
+IndexedFasta::IndexedFasta(string filename, size_t max_cached_blocks)
+	:filename(filename),
+	 compressed(BgzfReader::is_bgzf(filename)),
+	 max_cached_blocks(max(max_cached_blocks, (size_t) 1))
+{
+	read_fai(filename + ".fai");
+	if (this->compressed) read_gzi(filename + ".gzi");
+	this->file = unique_ptr<MappedFile>(new MappedFile(filename));
+}
+
+bool IndexedFasta::has_index(string filename) {
+	if (!ifstream(filename + ".fai").good()) return false;
+	if (BgzfReader::is_bgzf(filename)) return ifstream(filename + ".gzi").good();
+	return true;
+}
+
+void IndexedFasta::read_fai(string fai_filename) {
+	ifstream fai(fai_filename);
+	if (!fai.good()) {
+		throw runtime_error("IndexedFasta::read_fai: index file " + fai_filename + " cannot be opened.");
+	}
+	string line;
+	while (getline(fai, line)) {
+		if (line.empty()) continue;
+		istringstream fields(line);
+		string name;
+		FaiEntry entry;
+		if (!(fields >> name >> entry.length >> entry.offset >> entry.line_bases >> entry.line_width) || (entry.line_bases == 0) || (entry.line_width < entry.line_bases)) {
+			throw runtime_error("IndexedFasta::read_fai: index file " + fai_filename + " is malformed.");
+		}
+		this->entries[name] = entry;
+	}
+}
+
+void IndexedFasta::read_gzi(string gzi_filename) {
+	ifstream gzi(gzi_filename, ios::in | ios::binary);
+	if (!gzi.good()) {
+		throw runtime_error("IndexedFasta::read_gzi: index file " + gzi_filename + " cannot be opened (use samtools faidx to create it).");
+	}
+	uint64_t nr_entries = 0;
+	gzi.read((char*) &nr_entries, sizeof(uint64_t));
+	// the first block is not listed in the index
+	this->blocks.push_back(make_pair(0, 0));
+	for (uint64_t i = 0; i < nr_entries; ++i) {
+		uint64_t offsets[2];
+		if (!gzi.read((char*) offsets, sizeof(offsets))) {
+			throw runtime_error("IndexedFasta::read_gzi: index file " + gzi_filename + " is truncated.");
+		}
+		this->blocks.push_back(make_pair(offsets[0], offsets[1]));
+	}
+}
+
+const IndexedFasta::FaiEntry& IndexedFasta::get_entry(string name, string caller) const {
+	auto it = this->entries.find(name);
+	if (it == this->entries.end()) {
+		throw runtime_error("IndexedFasta::" + caller + ": chromosome " + name + " is not present in FASTA-file.");
+	}
+	return it->second;
+}
+
+bool IndexedFasta::contains_name(string name) const {
+	return this->entries.find(name) != this->entries.end();
+}
+
+size_t IndexedFasta::get_size_of(string name) const {
+	return get_entry(name, "get_size_of").length;
+}
+
+void IndexedFasta::get_sequence_names(vector<string>& names) const {
+	for (auto it = this->entries.begin(); it != this->entries.end(); ++it) {
+		names.push_back(it->first);
+	}
+}
+
+shared_ptr<string> IndexedFasta::get_block(size_t index) const {
+	{
+		lock_guard<mutex> lock (this->cache_mutex);
+		auto it = this->cache_index.find(index);
+		if (it != this->cache_index.end()) {
+			this->cache.splice(this->cache.begin(), this->cache, it->second);
+			return it->second->second;
+		}
+	}
+	// decompress outside of the lock so that threads can work on different blocks in parallel
+	uint64_t offset = this->blocks[index].first;
+	if (offset + 18 > this->file->size()) {
+		throw runtime_error("IndexedFasta::get_block: file " + this->filename + " is truncated.");
+	}
+	const unsigned char* header = (const unsigned char*) this->file->data() + offset;
+	size_t block_size = ((size_t) header[16] | ((size_t) header[17] << 8)) + 1;
+	if (offset + block_size > this->file->size()) {
+		throw runtime_error("IndexedFasta::get_block: file " + this->filename + " is truncated.");
+	}
+	vector<char> block(this->file->data() + offset, this->file->data() + offset + block_size);
+	shared_ptr<string> result = make_shared<string>();
+	BgzfReader::decompress_block(block, *result);
+
+	lock_guard<mutex> lock (this->cache_mutex);
+	if (this->cache_index.find(index) == this->cache_index.end()) {
+		this->cache.push_front(make_pair(index, result));
+		this->cache_index[index] = this->cache.begin();
+		if (this->cache.size() > this->max_cached_blocks) {
+			this->cache_index.erase(this->cache.back().first);
+			this->cache.pop_back();
+		}
+	}
+	return result;
+}
+
+void IndexedFasta::read_raw(size_t begin, size_t end, string& result) const {
+	if (!this->compressed) {
+		if (end > this->file->size()) {
+			throw runtime_error("IndexedFasta::read_raw: file " + this->filename + " is truncated.");
+		}
+		result.append(this->file->data() + begin, end - begin);
+		return;
+	}
+	// find the block containing the first position
+	auto it = upper_bound(this->blocks.begin(), this->blocks.end(), make_pair((uint64_t) UINT64_MAX, (uint64_t) begin),
+		[](const pair<uint64_t,uint64_t>& a, const pair<uint64_t,uint64_t>& b) { return a.second < b.second; });
+	size_t index = (it - this->blocks.begin()) - 1;
+	size_t position = begin;
+	while (position < end) {
+		if (index >= this->blocks.size()) {
+			throw runtime_error("IndexedFasta::read_raw: file " + this->filename + " is truncated.");
+		}
+		shared_ptr<string> block = get_block(index);
+		size_t block_start = this->blocks[index].second;
+		size_t block_end = block_start + block->size();
+		if (block_end > position) {
+			size_t stop = min(end, block_end);
+			result.append(block->data() + (position - block_start), stop - position);
+			position = stop;
+		}
+		index += 1;
+	}
+}
+
+void IndexedFasta::get_subsequence(string name, size_t start, size_t end, string& result) const {
+	result.clear();
+	const FaiEntry& entry = get_entry(name, "get_subsequence");
+	if ((start > end) || (end > entry.length)) {
+		throw runtime_error("IndexedFasta::get_subsequence: invalid interval on chromosome " + name + ".");
+	}
+	if (start == end) return;
+	// lines have a fixed number of bases, followed by line_width - line_bases newline characters
+	size_t raw_start = entry.offset + (start / entry.line_bases) * entry.line_width + (start % entry.line_bases);
+	size_t raw_end = entry.offset + ((end - 1) / entry.line_bases) * entry.line_width + ((end - 1) % entry.line_bases) + 1;
+	string raw;
+	raw.reserve(raw_end - raw_start);
+	read_raw(raw_start, raw_end, raw);
+	result.reserve(result.size() + (end - start));
+	for (char c : raw) {
+		if ((c == '\n') || (c == '\r')) continue;
+		result.push_back(decode(encode(c)));
+	}
+}
+
+void IndexedFasta::release(string name) const {
+	const FaiEntry& entry = get_entry(name, "release");
+	size_t raw_start = entry.offset;
+	size_t raw_end = entry.offset + (entry.length / entry.line_bases) * entry.line_width + (entry.length % entry.line_bases);
+	if (!this->compressed) {
+		this->file->release(raw_start, raw_end - raw_start);
+		return;
+	}
+	lock_guard<mutex> lock (this->cache_mutex);
+	for (auto it = this->cache.begin(); it != this->cache.end();) {
+		size_t block_start = this->blocks[it->first].second;
+		size_t block_end = block_start + it->second->size();
+		if ((block_start >= raw_start) && (block_end <= raw_end)) {
+			this->cache_index.erase(it->first);
+			it = this->cache.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
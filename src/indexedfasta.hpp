@@ -0,0 +1,69 @@
+#ifndef INDEXEDFASTA_HPP
+#define INDEXEDFASTA_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <list>
+#include <mutex>
+#include <memory>
+#include <stdint.h>
+#include "mappedfile.hpp"
+
+/**
+* Random access to a FASTA-file indexed by samtools faidx (.fai). Plain files are memory mapped,
+* bgzipped files (additionally requiring the .gzi index) are decompressed block-wise on demand.
+* Sequences are only read when they are requested, so that the whole reference never needs
+* to be held in memory.
+**/
+
+class IndexedFasta {
+public:
+	/**
+	* @param filename name of the FASTA-file (plain or bgzipped), index files must be <filename>.fai (and <filename>.gzi)
+	* @param max_cached_blocks maximum number of decompressed BGZF blocks kept in memory
+	**/
+	IndexedFasta(std::string filename, size_t max_cached_blocks = 1024);
+	/** check whether the index files needed to read the given FASTA-file exist **/
+	static bool has_index(std::string filename);
+	/** check if sequence with given name exists in file. **/
+	bool contains_name(std::string name) const;
+	/** get length of sequence with name **/
+	size_t get_size_of(std::string name) const;
+	/** get names of seqences present in the file **/
+	void get_sequence_names(std::vector<std::string>& names) const;
+	/** get a subsequence (upper case, non-ACGT characters are replaced by N) **/
+	void get_subsequence(std::string name, size_t start, size_t end, std::string& result) const;
+	/** release the memory used for the given sequence, it will be read again if requested later **/
+	void release(std::string name) const;
+
+private:
+	/** entry of the .fai index **/
+	struct FaiEntry {
+		size_t length;
+		size_t offset;
+		size_t line_bases;
+		size_t line_width;
+	};
+	std::string filename;
+	std::map<std::string, FaiEntry> entries;
+	std::unique_ptr<MappedFile> file;
+	bool compressed;
+	/** (compressed offset, uncompressed offset) of each BGZF block, read from the .gzi index **/
+	std::vector<std::pair<uint64_t,uint64_t>> blocks;
+	size_t max_cached_blocks;
+	/** decompressed blocks, most recently used first **/
+	mutable std::list<std::pair<size_t, std::shared_ptr<std::string>>> cache;
+	mutable std::map<size_t, std::list<std::pair<size_t, std::shared_ptr<std::string>>>::iterator> cache_index;
+	mutable std::mutex cache_mutex;
+
+	const FaiEntry& get_entry(std::string name, std::string caller) const;
+	void read_fai(std::string fai_filename);
+	void read_gzi(std::string gzi_filename);
+	/** decompressed block with the given index **/
+	std::shared_ptr<std::string> get_block(size_t index) const;
+	/** copy the uncompressed bytes [begin, end) of the file into result **/
+	void read_raw(size_t begin, size_t end, std::string& result) const;
+};
+
+#endif // INDEXEDFASTA_HPP
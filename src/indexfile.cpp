@@ -0,0 +1,221 @@
+#include "indexfile.hpp"
+#include <algorithm>
+#include <iostream>
+#include <sys/stat.h>
+
+using namespace std;
+
+const char INDEX_MAGIC[8] = {'P', 'G', 'I', 'N', 'D', 'E', 'X', '\0'};
+const uint32_t INDEX_VERSION = 3;
+
+uint64_t file_fingerprint(string filename) {
+	if (filename.empty()) return 0;
+	ifstream file(filename, ios::in | ios::binary);
+	if (!file.good()) {
+		throw runtime_error("file_fingerprint: file " + filename + " cannot be opened.");
+	}
+	// FNV-1a on 8-byte words, so that large files are hashed at the speed they are read.
+	// The buffer size is a multiple of 8, only the last bytes of the file are hashed one by one.
+	uint64_t hash = 14695981039346656037ULL;
+	uint64_t size = 0;
+	vector<char> buffer(1 << 22);
+	while (file) {
+		file.read(buffer.data(), buffer.size());
+		size_t length = file.gcount();
+		size_t i = 0;
+		for (; i + sizeof(uint64_t) <= length; i += sizeof(uint64_t)) {
+			uint64_t word;
+			memcpy(&word, buffer.data() + i, sizeof(uint64_t));
+			hash = (hash ^ word) * 1099511628211ULL;
+			hash ^= hash >> 32;
+		}
+		for (; i < length; ++i) {
+			hash = (hash ^ (unsigned char) buffer[i]) * 1099511628211ULL;
+		}
+		size += length;
+	}
+	if (file.bad()) {
+		throw runtime_error("file_fingerprint: failed to read file " + filename + ".");
+	}
+	return (hash ^ size) * 1099511628211ULL;
+}
+
+/** size, modification time and inode of the file **/
+static FileStamp stat_file(string filename) {
+	struct stat file_stat;
+	if (stat(filename.c_str(), &file_stat) != 0) {
+		throw runtime_error("file_stamp: file " + filename + " cannot be opened.");
+	}
+	FileStamp stamp = {};
+	stamp.size = file_stat.st_size;
+	stamp.modification_time = (int64_t) file_stat.st_mtim.tv_sec * 1000000000 + file_stat.st_mtim.tv_nsec;
+	stamp.inode = file_stat.st_ino;
+	return stamp;
+}
+
+FileStamp file_stamp(string filename) {
+	if (filename.empty()) return FileStamp();
+	FileStamp stamp = stat_file(filename);
+	stamp.fingerprint = file_fingerprint(filename);
+	return stamp;
+}
+
+bool file_matches_stamp(string filename, const FileStamp& stamp) {
+	FileStamp current = stat_file(filename);
+	if (current.size != stamp.size) return false;
+	if ((current.modification_time == stamp.modification_time) && (current.inode == stamp.inode)) return true;
+	return file_fingerprint(filename) == stamp.fingerprint;
+}
+
+IndexWriter::IndexWriter(string filename, const IndexHeader& header)
+	:filename(filename),
+	 file(filename, ios::out | ios::binary | ios::trunc),
+	 header(header),
+	 position(0),
+	 section_start(0),
+	 closed(false)
+{
+	if (!this->file.good()) {
+		throw runtime_error("IndexWriter::IndexWriter: index file " + filename + " cannot be created.");
+	}
+	memcpy(this->header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+	this->header.version = INDEX_VERSION;
+	// placeholder, rewritten by close()
+	write_raw(&this->header, sizeof(IndexHeader));
+}
+
+IndexWriter::~IndexWriter() {
+	if (!this->closed) {
+		try {
+			close();
+		} catch (const exception& e) {
+			cerr << e.what() << endl;
+		}
+	}
+}
+
+void IndexWriter::write_raw(const void* data, size_t size) {
+	if (size == 0) return;
+	this->file.write((const char*) data, size);
+	this->position += size;
+}
+
+void IndexWriter::align() {
+	static const char padding[8] = {0};
+	size_t remainder = this->position % 8;
+	if (remainder > 0) write_raw(padding, 8 - remainder);
+}
+
+void IndexWriter::end_section() {
+	if (this->current_section.empty()) return;
+	this->sections[this->current_section] = make_pair(this->section_start, this->position - this->section_start);
+	this->current_section.clear();
+}
+
+void IndexWriter::begin_section(string name) {
+	if (name.empty() || (this->sections.find(name) != this->sections.end()) || (name == this->current_section)) {
+		throw runtime_error("IndexWriter::begin_section: invalid or duplicate section name \"" + name + "\".");
+	}
+	end_section();
+	align();
+	this->current_section = name;
+	this->section_start = this->position;
+}
+
+void IndexWriter::close() {
+	if (this->closed) return;
+	this->closed = true;
+	end_section();
+	align();
+	this->header.table_offset = this->position;
+	write_value(this->sections);
+	this->header.table_size = this->position - this->header.table_offset;
+	this->file.seekp(0);
+	this->file.write((const char*) &this->header, sizeof(IndexHeader));
+	this->file.close();
+	if (this->file.fail()) {
+		throw runtime_error("IndexWriter::close: index file " + this->filename + " could not be written.");
+	}
+}
+
+IndexReader::IndexReader(string filename)
+	:filename(filename),
+	 position(0),
+	 end(0)
+{
+	ifstream check(filename);
+	if (!check.good()) {
+		throw runtime_error("IndexReader::IndexReader: index file " + filename + " cannot be opened.");
+	}
+	check.close();
+	this->file = unique_ptr<MappedFile>(new MappedFile(filename));
+	if (this->file->size() < sizeof(IndexHeader)) {
+		throw runtime_error("IndexReader::IndexReader: " + filename + " is not a PanGenie index.");
+	}
+	memcpy(&this->header, this->file->data(), sizeof(IndexHeader));
+	if (memcmp(this->header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0) {
+		throw runtime_error("IndexReader::IndexReader: " + filename + " is not a PanGenie index.");
+	}
+	if (this->header.version != INDEX_VERSION) {
+		throw runtime_error("IndexReader::IndexReader: index " + filename + " has format version " + to_string(this->header.version) + ", but version " + to_string(INDEX_VERSION) + " is required. Please rebuild the index.");
+	}
+	if ((this->header.table_offset > this->file->size()) || (this->header.table_size > this->file->size() - this->header.table_offset)) {
+		throw runtime_error("IndexReader::IndexReader: index file " + filename + " is truncated.");
+	}
+	this->position = this->header.table_offset;
+	this->end = this->header.table_offset + this->header.table_size;
+	read_value(this->sections);
+	for (auto& section : this->sections) {
+		if ((section.second.first > this->file->size()) || (section.second.second > this->file->size() - section.second.first)) {
+			throw runtime_error("IndexReader::IndexReader: index file " + filename + " is truncated.");
+		}
+	}
+	this->position = 0;
+	this->end = 0;
+}
+
+const IndexHeader& IndexReader::get_header() const {
+	return this->header;
+}
+
+bool IndexReader::has_section(string name) const {
+	return this->sections.find(name) != this->sections.end();
+}
+
+vector<string> IndexReader::get_section_names() const {
+	vector<string> result;
+	for (auto& section : this->sections) result.push_back(section.first);
+	return result;
+}
+
+void IndexReader::seek_section(string name) {
+	auto it = this->sections.find(name);
+	if (it == this->sections.end()) {
+		throw runtime_error("IndexReader::seek_section: section " + name + " is not present in index file " + this->filename + ".");
+	}
+	this->position = it->second.first;
+	this->end = it->second.first + it->second.second;
+}
+
+void IndexReader::check_available(uint64_t count, size_t element_size) const {
+	if ((this->position > this->end) || (count > (this->end - this->position) / element_size)) {
+		throw runtime_error("IndexReader::read: index file " + this->filename + " is corrupt.");
+	}
+}
+
+void IndexReader::read_raw(void* data, size_t size) {
+	check_available(size, 1);
+	memcpy(data, this->file->data() + this->position, size);
+	this->position += size;
+}
+
+void IndexReader::align() {
+	this->position = (this->position + 7) / 8 * 8;
+}
+
+uint64_t IndexReader::read_size(size_t element_size) {
+	uint64_t size = 0;
+	read_raw(&size, sizeof(uint64_t));
+	check_available(size, element_size);
+	return size;
+}
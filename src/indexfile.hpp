@@ -0,0 +1,217 @@
+#ifndef INDEXFILE_HPP
+#define INDEXFILE_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include <fstream>
+#include <memory>
+#include <cstring>
+#include <type_traits>
+#include <stdexcept>
+#include <stdint.h>
+#include "mappedfile.hpp"
+
+/**
+* Binary index of a variant panel. The file starts with a fixed size header, followed by sections
+* and a table listing name, offset and size of each section. Sections and arrays of plain values
+* start at 8-byte aligned offsets, so that the latter can be copied directly out of the memory
+* mapped file. Classes are written through their serialize(Archive&) member.
+**/
+
+/** identifies an input file of the index (see file_stamp) **/
+struct FileStamp {
+	/** hash of the full content (see file_fingerprint) **/
+	uint64_t fingerprint;
+	uint64_t size;
+	/** modification time (in nanoseconds) and inode **/
+	int64_t modification_time;
+	uint64_t inode;
+};
+
+struct IndexHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t kmer_size;
+	uint8_t add_reference;
+	uint8_t reserved[7];
+	/** the VCF and reference the index was built from **/
+	FileStamp vcf;
+	FileStamp reference;
+	/** offset and size of the section table **/
+	uint64_t table_offset;
+	uint64_t table_size;
+};
+
+static_assert(sizeof(IndexHeader) == 104, "IndexHeader must not contain padding.");
+
+/** magic number and version of the current index format **/
+extern const char INDEX_MAGIC[8];
+extern const uint32_t INDEX_VERSION;
+
+/** hash of the full file content and its size. Returns 0 for an empty filename. **/
+uint64_t file_fingerprint(std::string filename);
+
+/** fingerprint, size, modification time and inode of the file (all 0 for an empty filename) **/
+FileStamp file_stamp(std::string filename);
+
+/**
+* check whether the file is the one the stamp was taken of. If its size, modification time and inode are
+* unchanged, it is assumed to be unmodified. Otherwise (e.g. the file was copied or touched), its content is
+* hashed and compared to the fingerprint.
+**/
+bool file_matches_stamp(std::string filename, const FileStamp& stamp);
+
+/** arrays of these types are stored as one aligned block **/
+template<class T>
+struct is_flat : std::is_arithmetic<T> {};
+
+template<class T>
+struct is_flat<std::pair<T,T>> : std::bool_constant<std::is_arithmetic<T>::value && sizeof(std::pair<T,T>) == 2 * sizeof(T)> {};
+
+class IndexWriter {
+public:
+	/** create the index file, the header is completed by close() **/
+	IndexWriter(std::string filename, const IndexHeader& header);
+	~IndexWriter();
+	/** start a new section, the previous one ends here **/
+	void begin_section(std::string name);
+	/** write the section table and header **/
+	void close();
+	template<class... Ts>
+	void operator()(const Ts&... values) {
+		(write_value(values), ...);
+	}
+
+private:
+	std::string filename;
+	std::ofstream file;
+	IndexHeader header;
+	uint64_t position;
+	std::string current_section;
+	uint64_t section_start;
+	std::map<std::string, std::pair<uint64_t,uint64_t>> sections;
+	bool closed;
+	void write_raw(const void* data, size_t size);
+	void align();
+	void end_section();
+
+	template<class T>
+	void write_value(const T& value) {
+		if constexpr (std::is_arithmetic<T>::value) {
+			write_raw(&value, sizeof(T));
+		} else {
+			// serialize() is shared with reading and therefore not const
+			const_cast<T&>(value).serialize(*this);
+		}
+	}
+	void write_value(const std::string& value) {
+		uint64_t size = value.size();
+		write_raw(&size, sizeof(uint64_t));
+		write_raw(value.data(), size);
+	}
+	template<class A, class B>
+	void write_value(const std::pair<A,B>& value) {
+		write_value(value.first);
+		write_value(value.second);
+	}
+	template<class T>
+	void write_value(const std::vector<T>& values) {
+		uint64_t size = values.size();
+		write_raw(&size, sizeof(uint64_t));
+		if constexpr (is_flat<T>::value) {
+			align();
+			write_raw(values.data(), size * sizeof(T));
+		} else {
+			for (const T& value : values) write_value(value);
+		}
+	}
+	template<class K, class V>
+	void write_value(const std::map<K,V>& values) {
+		uint64_t size = values.size();
+		write_raw(&size, sizeof(uint64_t));
+		for (const auto& value : values) {
+			write_value(value.first);
+			write_value(value.second);
+		}
+	}
+};
+
+class IndexReader {
+public:
+	/** memory map the index file and check its header **/
+	IndexReader(std::string filename);
+	const IndexHeader& get_header() const;
+	bool has_section(std::string name) const;
+	/** names of all sections in the file **/
+	std::vector<std::string> get_section_names() const;
+	/** continue reading at the beginning of the given section **/
+	void seek_section(std::string name);
+	template<class... Ts>
+	void operator()(Ts&... values) {
+		(read_value(values), ...);
+	}
+
+private:
+	std::string filename;
+	std::unique_ptr<MappedFile> file;
+	IndexHeader header;
+	std::map<std::string, std::pair<uint64_t,uint64_t>> sections;
+	uint64_t position;
+	uint64_t end;
+	void read_raw(void* data, size_t size);
+	void align();
+
+	template<class T>
+	void read_value(T& value) {
+		if constexpr (std::is_arithmetic<T>::value) {
+			read_raw(&value, sizeof(T));
+		} else {
+			value.serialize(*this);
+		}
+	}
+	void read_value(std::string& value) {
+		uint64_t size = read_size(1);
+		value.assign(this->file->data() + this->position, size);
+		this->position += size;
+	}
+	template<class A, class B>
+	void read_value(std::pair<A,B>& value) {
+		read_value(value.first);
+		read_value(value.second);
+	}
+	template<class T>
+	void read_value(std::vector<T>& values) {
+		if constexpr (is_flat<T>::value) {
+			uint64_t size = 0;
+			read_raw(&size, sizeof(uint64_t));
+			align();
+			check_available(size, sizeof(T));
+			values.resize(size);
+			if (size > 0) std::memcpy((void*) values.data(), this->file->data() + this->position, size * sizeof(T));
+			this->position += size * sizeof(T);
+		} else {
+			uint64_t size = read_size(1);
+			values.clear();
+			values.resize(size);
+			for (T& value : values) read_value(value);
+		}
+	}
+	template<class K, class V>
+	void read_value(std::map<K,V>& values) {
+		uint64_t size = read_size(1);
+		values.clear();
+		for (uint64_t i = 0; i < size; ++i) {
+			std::pair<K,V> value;
+			read_value(value.first);
+			read_value(value.second);
+			values.emplace_hint(values.end(), std::move(value));
+		}
+	}
+	/** read a number of elements and check that at least that many elements of the given size can follow **/
+	uint64_t read_size(size_t element_size);
+	void check_available(uint64_t count, size_t element_size) const;
+};
+
+#endif // INDEXFILE_HPP
@@ -5,9 +5,18 @@
 #include <math.h>
 #include <fstream>
 #include "histogram.hpp"
+#include "readstreams.hpp"
 
 using namespace std;
 
+static file_vector to_file_vector(const vector<string>& paths) {
+	file_vector result;
+	for (auto& path : paths) {
+		result.push_back(path.c_str());
+	}
+	return result;
+}
+
 /*
 vector<char*> to_args(string readfile) {
 	vector<char*> args;
@@ -25,6 +34,10 @@ vector<char*> to_args(string readfile) {
 */
 
 JellyfishCounter::JellyfishCounter (string readfile, size_t kmer_size, size_t nr_threads, uint64_t hash)
+	:JellyfishCounter(vector<string>{readfile}, kmer_size, nr_threads, hash)
+{}
+
+JellyfishCounter::JellyfishCounter (vector<string> readfiles, size_t kmer_size, size_t nr_threads, uint64_t hash)
 {
 	jellyfish::mer_dna::k(kmer_size); // Set length of mers
 	const uint64_t hash_size    = hash; // Initial size of hash, default = 3000000000.
@@ -35,24 +48,25 @@ JellyfishCounter::JellyfishCounter (string readfile, size_t kmer_size, size_t nr
 
 	// create the hash
 	this->jellyfish_hash = new mer_hash_type(hash_size, jellyfish::mer_dna::k()*2, counter_len, num_threads, num_reprobes);
-	// convert the readfile to char**
-	//vector<char*> args = to_args(readfile);
-
-	// count kmers
-    
-    stream_manager_type streams(true);
-    file_vector X{readfile.c_str()};
-    streams.paths(X.begin(), X.end());
-	mer_counter jellyfish_counter(num_threads, (*jellyfish_hash), streams, canonical, COUNT);
-	jellyfish_counter.exec_join(num_threads);
-
-	// delete the readfile char**
-	//for(size_t i = 0; i < args.size(); i++)
-    //  delete[] args[i];
 
+	// count kmers (compressed files are decompressed on the fly)
+	ReadStreams read_streams(readfiles, num_threads);
+	vector<string> paths = read_streams.get_paths();
+	{
+		stream_manager_type streams(true);
+		file_vector X = to_file_vector(paths);
+		streams.paths(X.begin(), X.end());
+		mer_counter jellyfish_counter(num_threads, (*jellyfish_hash), streams, canonical, COUNT);
+		jellyfish_counter.exec_join(num_threads);
+	}
+	read_streams.finish();
 }
 
 JellyfishCounter::JellyfishCounter (string readfile, string kmerfile, size_t kmer_size, size_t nr_threads, uint64_t hash)
+	:JellyfishCounter(vector<string>{readfile}, kmerfile, kmer_size, nr_threads, hash)
+{}
+
+JellyfishCounter::JellyfishCounter (vector<string> readfiles, string kmerfile, size_t kmer_size, size_t nr_threads, uint64_t hash)
 {
 	jellyfish::mer_dna::k(kmer_size); // Set length of mers
 	const uint64_t hash_size    = hash; // Initial size of hash.
@@ -64,36 +78,26 @@ JellyfishCounter::JellyfishCounter (string readfile, string kmerfile, size_t kme
 	// create the hash
 	this->jellyfish_hash = new mer_hash_type(hash_size, jellyfish::mer_dna::k()*2, counter_len, num_threads, num_reprobes);
 
-	// convert the filenames to char**
-	//vector<char*> reads_args = to_args(readfile);
-	//vector<char*> kmer_args = to_args(kmerfile);
-    
-    {
-    stream_manager_type streams(true);
-    file_vector X{kmerfile.c_str()};
-    streams.paths(X.begin(), X.end());
-	// process input kmers
-        std::cout<< "about to count graph kmer" << std::endl;
+	{
+		stream_manager_type streams(true);
+		file_vector X{kmerfile.c_str()};
+		streams.paths(X.begin(), X.end());
+		// process input kmers
 		mer_counter jellyfish_counter(num_threads, (*jellyfish_hash), streams, canonical, PRIME);
 		jellyfish_counter.exec_join(num_threads);
 	}
 
-	// process read kmers
-    stream_manager_type streams(true);
-    file_vector X{readfile.c_str()};
-	streams.paths(X.begin(), X.end());
-    std::cout << "about to read read kmer" << std::endl;
-    mer_counter jellyfish_counter(num_threads, (*jellyfish_hash), streams, canonical, UPDATE);
-	jellyfish_counter.exec_join(num_threads);
-    /*
-	// delete the kmerfile char**
-	for(size_t i = 0; i < kmer_args.size(); i++)
-		delete[] kmer_args[i];
-
-	// delete the readfile char**
-	for(size_t i = 0; i < reads_args.size(); i++)
-		delete[] reads_args[i];
-    */
+	// process read kmers (compressed files are decompressed on the fly)
+	ReadStreams read_streams(readfiles, num_threads);
+	vector<string> paths = read_streams.get_paths();
+	{
+		stream_manager_type streams(true);
+		file_vector X = to_file_vector(paths);
+		streams.paths(X.begin(), X.end());
+		mer_counter jellyfish_counter(num_threads, (*jellyfish_hash), streams, canonical, UPDATE);
+		jellyfish_counter.exec_join(num_threads);
+	}
+	read_streams.finish();
 }
 
 size_t JellyfishCounter::getKmerAbundance(string kmer){
@@ -200,6 +204,18 @@ size_t JellyfishCounter::computeHistogram(size_t max_count, bool largest_peak, s
 	return kmer_coverage_estimate;
 }
 
+size_t JellyfishCounter::estimate_memory(uint64_t hash_size, size_t kmer_size) {
+	// jellyfish rounds the hash size up to the next power of two and stores only the part
+	// of the key not implied by the position in the hash, plus reprobe information and the counter
+	size_t size_bits = 0;
+	while ((1ULL << size_bits) < hash_size) size_bits += 1;
+	const size_t key_bits = 2 * kmer_size;
+	const size_t reprobe_bits = 7; // enough to encode 126 reprobes
+	const size_t counter_len  = 7;
+	size_t entry_bits = ((key_bits > size_bits) ? (key_bits - size_bits) : 0) + reprobe_bits + counter_len + 1;
+	return ((1ULL << size_bits) * entry_bits) / 8;
+}
+
 JellyfishCounter::~JellyfishCounter() {
 	delete this->jellyfish_hash;
 	this->jellyfish_hash = nullptr;
@@ -83,6 +83,11 @@ public:
 	**/
 	JellyfishCounter(std::string readfile, size_t kmer_size, size_t nr_threads = 1, uint64_t hash = 3000000000);
 
+	/** 
+	* @param readfiles names of the FASTA/FASTQ-files containing reads (uncompressed, gzip, bgzip or zstd)
+	**/
+	JellyfishCounter(std::vector<std::string> readfiles, size_t kmer_size, size_t nr_threads = 1, uint64_t hash = 3000000000);
+
 	/** 
 	* @param readfile name of the FASTQ-files containing reads
 	* @param kmerfile only count kmers contained in sequences given in this FASTQ-file
@@ -91,6 +96,12 @@ public:
 	**/
 	JellyfishCounter (std::string readfile, std::string kmerfile, size_t kmer_size, size_t nr_threads = 1, uint64_t hash = 3000000000);
 
+	/** 
+	* @param readfiles names of the FASTA/FASTQ-files containing reads (uncompressed, gzip, bgzip or zstd)
+	* @param kmerfile only count kmers contained in sequences given in this FASTQ-file
+	**/
+	JellyfishCounter (std::vector<std::string> readfiles, std::string kmerfile, size_t kmer_size, size_t nr_threads = 1, uint64_t hash = 3000000000);
+
 	~JellyfishCounter();
 	
 	/** get the abundance of given kmer (string) **/
@@ -105,6 +116,9 @@ public:
 	/** computes kmer abundance histogram and returns the three highest peaks **/
 	size_t computeHistogram(size_t max_count, bool largest_peak, std::string filename = "");
 
+	/** estimate the number of bytes allocated by a jellyfish hash of the given size **/
+	static size_t estimate_memory(uint64_t hash_size, size_t kmer_size);
+
 private:
 	mer_hash_type* jellyfish_hash;
 };
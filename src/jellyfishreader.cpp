@@ -4,7 +4,11 @@
 #include <stdexcept>
 #include <math.h>
 #include <fstream>
+#include <cstring>
+#include <algorithm>
 #include "histogram.hpp"
+#include "kmerprofile.hpp"
+#include "threadpool.hpp"
 
 using namespace std;
 
@@ -40,13 +44,63 @@ JellyfishReader::JellyfishReader (string readfile, size_t kmersize)
 	}
 }
 
+JellyfishReader::JellyfishReader (string readfile, size_t kmersize, const vector<uint64_t>& kmers, size_t nr_threads)
+	:JellyfishReader(readfile, kmersize)
+{
+	if (kmersize > 32) {
+		throw runtime_error("JellyfishReader::JellyfishReader: filtering kmers requires a kmer size of at most 32.");
+	}
+	this->table = unique_ptr<KmerCountTable>(new KmerCountTable(kmers));
+	this->fill_table(nr_threads);
+}
+
+void JellyfishReader::fill_table(size_t nr_threads) {
+	// records of binary jellyfish dumps consist of the kmer (2 bits per base, little endian words,
+	// last base in the lowest bits) followed by the count (little endian, counter_len bytes)
+	const size_t key_bytes = (this->header->key_len() + 7) / 8;
+	const size_t value_bytes = this->header->counter_len();
+	const size_t record_bytes = key_bytes + value_bytes;
+	const char* records = this->binary_map->base() + this->header->offset();
+	const size_t nr_records = (this->binary_map->length() - this->header->offset()) / record_bytes;
+	const size_t histogram_size = 65536;
+	nr_threads = max(nr_threads, (size_t) 1);
+
+	vector<vector<size_t>> histograms(nr_threads, vector<size_t>(histogram_size, 0));
+	size_t chunk_size = (nr_records + nr_threads - 1) / nr_threads;
+	{
+		ThreadPool threadPool (nr_threads);
+		for (size_t t = 0; t < nr_threads; ++t) {
+			vector<size_t>* histogram = &histograms[t];
+			KmerCountTable* table = this->table.get();
+			size_t start = min(t * chunk_size, nr_records);
+			size_t end = min(start + chunk_size, nr_records);
+			threadPool.submit([=](){
+				for (size_t r = start; r < end; ++r) {
+					const char* record = records + r * record_bytes;
+					uint64_t kmer = 0;
+					memcpy(&kmer, record, key_bytes);
+					uint64_t count = 0;
+					memcpy(&count, record + key_bytes, min(value_bytes, sizeof(uint64_t)));
+					(*histogram)[min(count, (uint64_t) histogram_size - 1)] += 1;
+					table->set_count(kmer, (uint32_t) min(count, (uint64_t) UINT32_MAX));
+				}
+			});
+		}
+	}
+	this->count_histogram.assign(histogram_size, 0);
+	for (auto& histogram : histograms) {
+		for (size_t i = 0; i < histogram_size; ++i) this->count_histogram[i] += histogram[i];
+	}
+	cerr << "Kept counts of " << this->table->size() << " kmers from " << nr_records << " kmers in " << this->filename << "." << endl;
+}
+
 size_t JellyfishReader::getKmerAbundance(string kmer){
 	jellyfish::mer_dna jelly_kmer(kmer);
-	jelly_kmer.canonicalize();
-	return this->db->check(jelly_kmer);
+	return this->getKmerAbundance(jelly_kmer);
 }
 
 size_t JellyfishReader::getKmerAbundance(jellyfish::mer_dna jelly_kmer){
+	if (this->table) return this->table->get_count(KmerProfile::encode_kmer(jelly_kmer));
 	jelly_kmer.canonicalize();
 	return this->db->check(jelly_kmer);
 }
@@ -72,8 +126,15 @@ size_t JellyfishReader::computeHistogram(size_t max_count, bool largest_peak, st
 	binary_reader reader (this->ifs, this->header.get());
 
 	Histogram histogram(max_count);
-	while (reader.next()) {
-		histogram.add_value(reader.val());
+	if (this->table) {
+		// counts have already been collected when filling the table
+		for (size_t i = 0; i < this->count_histogram.size(); ++i) {
+			if (this->count_histogram[i] > 0) histogram.add_value(i, this->count_histogram[i]);
+		}
+	} else {
+		while (reader.next()) {
+			histogram.add_value(reader.val());
+		}
 	}
 
 	// write histogram values to file
@@ -15,6 +15,7 @@
 #include <jellyfish/jellyfish.hpp>
 #include <memory>
 #include "kmercounter.hpp"
+#include "kmercounttable.hpp"
 
 /**
 * Reads a kmer counts from the provided Jellyfish .jf file
@@ -63,6 +64,15 @@ public:
 	* @param readfile name of the FASTQ-files containing reads
 	**/
 	JellyfishReader(std::string readfile, size_t kmersize);
+
+	/**
+	* Reads the database once (in parallel) and only keeps the counts of the given kmers
+	* in memory, which makes lookups much faster than searching the database. Requires kmersize <= 32.
+	* @param readfile name of the .jf file
+	* @param kmers kmers that will be queried (canonical, 2 bits per base, see KmerProfile::encode_kmer)
+	* @param nr_threads number of threads used to read the database
+	**/
+	JellyfishReader(std::string readfile, size_t kmersize, const std::vector<uint64_t>& kmers, size_t nr_threads = 1);
 	
 	/** get the abundance of given kmer (string) **/
 	size_t getKmerAbundance(std::string kmer);
@@ -89,6 +99,12 @@ private:
 	std::shared_ptr<binary_query> db;
 	/** infile **/
 	std::ifstream ifs;
+	/** counts of the queried kmers (if given) **/
+	std::unique_ptr<KmerCountTable> table;
+	/** histogram of all counts in the database, computed while filling the table **/
+	std::vector<size_t> count_histogram;
+	/** stream the database and fill table and histogram **/
+	void fill_table(size_t nr_threads);
 	
 };
 #endif // JELLYFISHREADER_HPP
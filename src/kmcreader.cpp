@@ -0,0 +1,347 @@
+#include "kmcreader.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <cstring>
+#include <algorithm>
+#include <math.h>
+#include "histogram.hpp"
+#include "kmerprofile.hpp"
+#include "threadpool.hpp"
+
+using namespace std;
+
+// KMC database versions
+const uint32_t KMC1_VERSION = 0;
+const uint32_t KMC2_VERSION = 0x200;
+// counts larger than this are collected in the last bin of the histogram
+const size_t HISTOGRAM_SIZE = 65536;
+
+static uint32_t read_uint32(const char* data) {
+	uint32_t result;
+	memcpy(&result, data, sizeof(uint32_t));
+	return result;
+}
+
+static uint64_t read_uint64(const char* data) {
+	uint64_t result;
+	memcpy(&result, data, sizeof(uint64_t));
+	return result;
+}
+
+KmcReader::KmcReader(string database, size_t kmersize)
+	:database(database),
+	 lut(nullptr),
+	 records(nullptr),
+	 histogram_computed(false)
+{
+	this->prefix_file = unique_ptr<MappedFile>(new MappedFile(database + ".kmc_pre"));
+	this->suffix_file = unique_ptr<MappedFile>(new MappedFile(database + ".kmc_suf"));
+	const char* pre = this->prefix_file->data();
+	size_t pre_size = this->prefix_file->size();
+	const char* suf = this->suffix_file->data();
+	size_t suf_size = this->suffix_file->size();
+
+	// both files start and end with a marker
+	if ((pre_size < 20) || (memcmp(pre, "KMCP", 4) != 0) || (memcmp(pre + pre_size - 4, "KMCP", 4) != 0)) {
+		throw runtime_error("KmcReader::KmcReader: " + database + ".kmc_pre is not a KMC prefix file.");
+	}
+	if ((suf_size < 8) || (memcmp(suf, "KMCS", 4) != 0) || (memcmp(suf + suf_size - 4, "KMCS", 4) != 0)) {
+		throw runtime_error("KmcReader::KmcReader: " + database + ".kmc_suf is not a KMC suffix file.");
+	}
+
+	// header is stored at the end of the prefix file, followed by its size and the marker
+	size_t header_size = read_uint32(pre + pre_size - 8);
+	if (header_size + 12 > pre_size) {
+		throw runtime_error("KmcReader::KmcReader: malformatted header in " + database + ".kmc_pre.");
+	}
+	const char* header = pre + pre_size - 8 - header_size;
+	this->version = read_uint32(pre + pre_size - 12);
+	if ((this->version != KMC1_VERSION) && (this->version != KMC2_VERSION)) {
+		ostringstream oss;
+		oss << "KmcReader::KmcReader: unsupported KMC database version " << this->version << "." << endl;
+		throw runtime_error(oss.str());
+	}
+	this->kmer_size = read_uint32(header);
+	uint32_t mode = read_uint32(header + 4);
+	this->counter_size = read_uint32(header + 8);
+	this->lut_prefix_length = read_uint32(header + 12);
+	size_t signature_length = 0;
+	size_t offset = 16;
+	if (this->version == KMC2_VERSION) {
+		signature_length = read_uint32(header + offset);
+		offset += 4;
+	}
+	// skip min and max count
+	offset += 8;
+	this->total_kmers = read_uint64(header + offset);
+	offset += 8;
+	// 0 means that kmers were counted on both strands
+	bool both_strands = (header[offset] == 0);
+
+	if (kmersize != this->kmer_size) {
+		ostringstream oss;
+		oss << "KmcReader::KmcReader: given kmer size (" << kmersize  << ") does not match database kmer size (" << this->kmer_size << ")." << endl;
+		throw runtime_error(oss.str());
+	}
+	if (this->kmer_size > 32) {
+		throw runtime_error("KmcReader::KmcReader: KMC databases can only be used for kmer sizes of at most 32.");
+	}
+	if (mode != 0) {
+		throw runtime_error("KmcReader::KmcReader: KMC databases with quality-aware counters are not supported.");
+	}
+	if (!both_strands) {
+		throw runtime_error("KmcReader::KmcReader: in order to use the KMC database, kmers must have been counted on both strands (canonical form).");
+	}
+	if ((this->counter_size > 8) || (this->lut_prefix_length > this->kmer_size) || ((this->kmer_size - this->lut_prefix_length) % 4 != 0)) {
+		throw runtime_error("KmcReader::KmcReader: malformatted header in " + database + ".kmc_pre.");
+	}
+
+	this->suffix_bytes = (this->kmer_size - this->lut_prefix_length) / 4;
+	this->record_bytes = this->suffix_bytes + this->counter_size;
+	if ((this->record_bytes == 0) || (suf_size - 8) / this->record_bytes < this->total_kmers) {
+		throw runtime_error("KmcReader::KmcReader: " + database + ".kmc_suf is truncated.");
+	}
+	this->records = suf + 4;
+
+	// LUTs (one per bin for KMC2) are stored after the marker, KMC2 additionally stores the signature map before the header
+	size_t lut_bytes = (header - pre) - 4;
+	if (this->version == KMC2_VERSION) {
+		size_t signature_map_bytes = ((((size_t) 1) << (2 * signature_length)) + 1) * sizeof(uint32_t);
+		if (signature_map_bytes > lut_bytes) {
+			throw runtime_error("KmcReader::KmcReader: malformatted header in " + database + ".kmc_pre.");
+		}
+		lut_bytes -= signature_map_bytes;
+	}
+	this->lut_size = ((size_t) 1) << (2 * this->lut_prefix_length);
+	size_t nr_bins = (lut_bytes / sizeof(uint64_t)) / this->lut_size;
+	if (nr_bins == 0) {
+		throw runtime_error("KmcReader::KmcReader: malformatted LUT in " + database + ".kmc_pre.");
+	}
+	this->nr_lut_entries = nr_bins * this->lut_size;
+	this->lut = pre + 4;
+}
+
+KmcReader::KmcReader(string database, size_t kmersize, const vector<uint64_t>& kmers, size_t nr_threads)
+	:KmcReader(database, kmersize)
+{
+	this->table = unique_ptr<KmerCountTable>(new KmerCountTable(kmers));
+	this->scan(this->table.get(), nr_threads);
+	cerr << "Kept counts of " << this->table->size() << " kmers from " << this->total_kmers << " kmers in " << this->database << "." << endl;
+}
+
+bool KmcReader::is_kmc_database(string filename) {
+	for (string ending : {".kmc_pre", ".kmc_suf"}) {
+		if ((filename.size() >= ending.size()) && (filename.compare(filename.size() - ending.size(), ending.size(), ending) == 0)) return true;
+	}
+	return false;
+}
+
+string KmcReader::database_name(string filename) {
+	if (is_kmc_database(filename)) return filename.substr(0, filename.size() - 8);
+	return filename;
+}
+
+uint64_t KmcReader::lut_entry(size_t index) const {
+	if (index >= this->nr_lut_entries) return this->total_kmers;
+	return read_uint64(this->lut + index * sizeof(uint64_t));
+}
+
+size_t KmcReader::find_lut_entry(uint64_t record) const {
+	// last entry starting at or before the record
+	size_t left = 0;
+	size_t right = this->nr_lut_entries;
+	while (right - left > 1) {
+		size_t middle = left + (right - left) / 2;
+		if (this->lut_entry(middle) <= record) {
+			left = middle;
+		} else {
+			right = middle;
+		}
+	}
+	return left;
+}
+
+uint64_t KmcReader::decode_kmer(uint64_t prefix, const char* record) const {
+	// suffix is stored with the first bases in the most significant bits
+	uint64_t kmer = prefix;
+	for (size_t i = 0; i < this->suffix_bytes; ++i) {
+		kmer = (kmer << 8) | (unsigned char) record[i];
+	}
+	return kmer;
+}
+
+size_t KmcReader::decode_count(const char* record) const {
+	// counters are stored in little endian
+	uint64_t count = 0;
+	memcpy(&count, record + this->suffix_bytes, this->counter_size);
+	return count;
+}
+
+void KmcReader::scan(KmerCountTable* table, size_t nr_threads) {
+	nr_threads = max(nr_threads, (size_t) 1);
+	vector<vector<size_t>> histograms(nr_threads, vector<size_t>(HISTOGRAM_SIZE, 0));
+	size_t chunk_size = (this->total_kmers + nr_threads - 1) / nr_threads;
+	{
+		ThreadPool threadPool (nr_threads);
+		for (size_t t = 0; t < nr_threads; ++t) {
+			vector<size_t>* histogram = &histograms[t];
+			const KmcReader* reader = this;
+			uint64_t start = min((uint64_t) t * chunk_size, this->total_kmers);
+			uint64_t end = min(start + chunk_size, this->total_kmers);
+			threadPool.submit([=](){
+				if (start >= end) return;
+				size_t entry = reader->find_lut_entry(start);
+				uint64_t next = reader->lut_entry(entry + 1);
+				for (uint64_t r = start; r < end; ++r) {
+					while (r >= next) {
+						entry += 1;
+						next = reader->lut_entry(entry + 1);
+					}
+					const char* record = reader->records + r * reader->record_bytes;
+					size_t count = reader->decode_count(record);
+					(*histogram)[min(count, HISTOGRAM_SIZE - 1)] += 1;
+					if (table != nullptr) {
+						table->set_count(reader->decode_kmer(entry % reader->lut_size, record), (uint32_t) min(count, (size_t) UINT32_MAX));
+					}
+				}
+			});
+		}
+	}
+	this->count_histogram.assign(HISTOGRAM_SIZE, 0);
+	for (auto& histogram : histograms) {
+		for (size_t i = 0; i < HISTOGRAM_SIZE; ++i) this->count_histogram[i] += histogram[i];
+	}
+	this->histogram_computed = true;
+}
+
+size_t KmcReader::lookup(uint64_t kmer) const {
+	if (this->version != KMC1_VERSION) {
+		throw runtime_error("KmcReader::lookup: random access is only supported for KMC1 databases. Give the kmers to be queried to the constructor instead.");
+	}
+	size_t suffix_bits = 8 * this->suffix_bytes;
+	uint64_t prefix = (suffix_bits < 64) ? (kmer >> suffix_bits) : 0;
+	uint64_t left = this->lut_entry(prefix);
+	uint64_t right = this->lut_entry(prefix + 1);
+	// records within a prefix are sorted by suffix
+	while (left < right) {
+		uint64_t middle = left + (right - left) / 2;
+		const char* record = this->records + middle * this->record_bytes;
+		uint64_t current = this->decode_kmer(prefix, record);
+		if (current == kmer) return this->decode_count(record);
+		if (current < kmer) {
+			left = middle + 1;
+		} else {
+			right = middle;
+		}
+	}
+	return 0;
+}
+
+size_t KmcReader::getKmerAbundance(string kmer) {
+	jellyfish::mer_dna jelly_kmer(kmer);
+	return this->getKmerAbundance(jelly_kmer);
+}
+
+size_t KmcReader::getKmerAbundance(jellyfish::mer_dna jelly_kmer) {
+	uint64_t code = KmerProfile::encode_kmer(jelly_kmer);
+	if (this->table) return this->table->get_count(code);
+	return this->lookup(code);
+}
+
+void KmcReader::getKmerAbundances(const vector<uint64_t>& kmers, vector<size_t>& counts, size_t nr_threads) {
+	counts.assign(kmers.size(), 0);
+	if (this->table) {
+		for (size_t i = 0; i < kmers.size(); ++i) counts[i] = this->table->get_count(kmers[i]);
+		return;
+	}
+	KmerCountTable batch(kmers);
+	this->scan(&batch, nr_threads);
+	for (size_t i = 0; i < kmers.size(); ++i) counts[i] = batch.get_count(kmers[i]);
+}
+
+size_t KmcReader::computeKmerCoverage(size_t genome_kmers) {
+	if (!this->histogram_computed) this->scan(nullptr, 1);
+	long double result = 0.0L;
+	for (size_t i = 0; i < this->count_histogram.size(); ++i) {
+		result += (1.0L * i * this->count_histogram[i]) / (1.0L * genome_kmers);
+	}
+	return (size_t) ceil(result);
+}
+
+size_t KmcReader::computeHistogram(size_t max_count, bool largest_peak, string filename) {
+	if (!this->histogram_computed) this->scan(nullptr, 1);
+	Histogram histogram(max_count);
+	for (size_t i = 0; i < this->count_histogram.size(); ++i) {
+		if (this->count_histogram[i] > 0) histogram.add_value(i, this->count_histogram[i]);
+	}
+
+	// write histogram values to file
+	if (filename != "") {
+		histogram.write_to_file(filename);
+	}
+	// smooth the histogram
+	histogram.smooth_histogram();
+	// find peaks
+	vector<size_t> peak_ids;
+	vector<size_t> peak_values;
+	histogram.find_peaks(peak_ids, peak_values);
+
+	// identify the largest and second largest (if it exists)
+	if (peak_ids.size() == 0) {
+		throw runtime_error("KmcReader::computeHistogram: no peak found in kmer-count histogram.");
+	}
+	size_t kmer_coverage_estimate = -1;
+	if (peak_ids.size() < 2) {
+		cerr << "Histogram peak: " << peak_ids[0] << " (" << peak_values[0] << ")" << endl;
+		kmer_coverage_estimate = peak_ids[0];
+	} else {
+		size_t largest, second, largest_id, second_id;
+		if (peak_values[0] < peak_values[1]){
+			largest = peak_values[1];
+			largest_id = peak_ids[1];
+			second = peak_values[0];
+			second_id = peak_ids[0];
+		} else {
+			largest = peak_values[0];
+			largest_id = peak_ids[0];
+			second = peak_values[1];
+			second_id = peak_ids[1];
+		}
+		for (size_t i = 0; i < peak_values.size(); ++i) {
+			if (peak_values[i] > largest) {
+				second = largest;
+				second_id = largest_id;
+				largest = peak_values[i];
+				largest_id = peak_ids[i];
+			} else if ((peak_values[i] > second) && (peak_values[i] != largest)) {
+				second = peak_values[i];
+				second_id = peak_ids[i];
+			}
+		}
+		cerr << "Histogram peaks: " << largest_id << " (" << largest << "), " << second_id << " (" << second << ")" << endl;
+		if (largest_peak) {
+			kmer_coverage_estimate = largest_id;
+		}else {
+			kmer_coverage_estimate = second_id;
+		}
+	}
+	// add expected abundance counts to end of hist file
+	if (filename != "") {
+		ofstream histofile;
+		histofile.open(filename, ios::app);
+		if (!histofile.good()) {
+			stringstream ss;
+			ss << "KmcReader::computeHistogram: File " << filename << " cannot be created. Note that the filename must not contain non-existing directories." << endl;
+			throw runtime_error(ss.str());
+		}
+		histofile << "parameters\t" << kmer_coverage_estimate/2.0 << '\t' << kmer_coverage_estimate << endl;
+		histofile.close();
+	}
+	return kmer_coverage_estimate;
+}
+
+size_t KmcReader::size() const {
+	return this->total_kmers;
+}
@@ -0,0 +1,93 @@
+#ifndef KMCREADER_HPP
+#define KMCREADER_HPP
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <stdint.h>
+#include <jellyfish/mer_dna.hpp>
+#include "kmercounter.hpp"
+#include "kmercounttable.hpp"
+#include "mappedfile.hpp"
+
+/**
+* Reads kmer counts from a KMC database (<name>.kmc_pre and <name>.kmc_suf, KMC1 and KMC2 format),
+* which must have been computed on both strands (canonical kmers) with kmer size at most 32.
+* Both files are memory mapped. Random access lookups are supported for KMC1 databases
+* (binary search within the prefix range). If the kmers to be queried are given, the database
+* is read once (in parallel) and only their counts are kept in memory, which works for both formats.
+**/
+
+class KmcReader : public KmerCounter {
+public:
+	/**
+	* @param database name of the database (without .kmc_pre/.kmc_suf)
+	* @param kmersize kmer size
+	**/
+	KmcReader(std::string database, size_t kmersize);
+
+	/**
+	* @param database name of the database (without .kmc_pre/.kmc_suf)
+	* @param kmersize kmer size
+	* @param kmers kmers that will be queried (canonical, 2 bits per base, see KmerProfile::encode_kmer)
+	* @param nr_threads number of threads used to read the database
+	**/
+	KmcReader(std::string database, size_t kmersize, const std::vector<uint64_t>& kmers, size_t nr_threads = 1);
+
+	/** check whether the file name refers to a KMC database (ends with .kmc_pre or .kmc_suf) **/
+	static bool is_kmc_database(std::string filename);
+	/** name of the database without .kmc_pre/.kmc_suf **/
+	static std::string database_name(std::string filename);
+
+	/** get the abundance of given kmer (string) **/
+	size_t getKmerAbundance(std::string kmer);
+
+	/** get the abundance of given kmer (jellyfish kmer) **/
+	size_t getKmerAbundance(jellyfish::mer_dna jelly_kmer);
+
+	/** get the abundances of many kmers (canonical, 2 bits per base) with a single pass over the database **/
+	void getKmerAbundances(const std::vector<uint64_t>& kmers, std::vector<size_t>& counts, size_t nr_threads = 1);
+
+	/** compute the kmer coverage relative to the number of kmers in the genome **/
+	size_t computeKmerCoverage(size_t genome_kmers);
+
+	/** computes kmer abundance histogram and returns the three highest peaks **/
+	size_t computeHistogram(size_t max_count, bool largest_peak, std::string filename = "");
+
+	/** number of kmers in the database **/
+	size_t size() const;
+
+private:
+	std::string database;
+	std::unique_ptr<MappedFile> prefix_file;
+	std::unique_ptr<MappedFile> suffix_file;
+	uint32_t version;
+	size_t kmer_size;
+	size_t lut_prefix_length;
+	size_t counter_size;
+	size_t suffix_bytes;
+	size_t record_bytes;
+	uint64_t total_kmers;
+	/** number of LUT entries per bin (4^lut_prefix_length) and in total **/
+	size_t lut_size;
+	size_t nr_lut_entries;
+	const char* lut;
+	const char* records;
+	/** counts of the queried kmers (if given) **/
+	std::unique_ptr<KmerCountTable> table;
+	/** histogram of all counts in the database **/
+	std::vector<size_t> count_histogram;
+	bool histogram_computed;
+
+	/** index of the first record with the given LUT entry **/
+	uint64_t lut_entry(size_t index) const;
+	/** LUT entry containing the given record **/
+	size_t find_lut_entry(uint64_t record) const;
+	uint64_t decode_kmer(uint64_t prefix, const char* record) const;
+	size_t decode_count(const char* record) const;
+	/** read all records once, store counts of kmers in the table (if given) and compute the histogram **/
+	void scan(KmerCountTable* table, size_t nr_threads);
+	/** binary search for the kmer (KMC1 only) **/
+	size_t lookup(uint64_t kmer) const;
+};
+#endif // KMCREADER_HPP
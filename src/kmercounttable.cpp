@@ -0,0 +1,64 @@
+#include "kmercounttable.hpp"
+
+using namespace std;
+
+// canonical kmers never consist of T's only, so this value cannot be a valid key
+const uint64_t EMPTY_SLOT = ~((uint64_t) 0);
+
+inline uint64_t hash_kmer(uint64_t x) {
+	// finalizer of MurmurHash3
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdULL;
+	x ^= x >> 33;
+	x *= 0xc4ceb9fe1a85ec53ULL;
+	x ^= x >> 33;
+	return x;
+}
+
+KmerCountTable::KmerCountTable(const vector<uint64_t>& kmers)
+	:nr_kmers(0)
+{
+	// keep load factor at most 0.5 so that probe sequences stay short
+	size_t capacity = 16;
+	while (capacity < 2 * kmers.size()) capacity *= 2;
+	this->mask = capacity - 1;
+	this->keys.assign(capacity, EMPTY_SLOT);
+	this->counts.assign(capacity, 0);
+	for (auto kmer : kmers) {
+		size_t slot = this->find_slot(kmer);
+		if (this->keys[slot] == EMPTY_SLOT) {
+			this->keys[slot] = kmer;
+			this->nr_kmers += 1;
+		}
+	}
+}
+
+size_t KmerCountTable::find_slot(uint64_t kmer) const {
+	// linear probing
+	size_t slot = hash_kmer(kmer) & this->mask;
+	while ((this->keys[slot] != kmer) && (this->keys[slot] != EMPTY_SLOT)) {
+		slot = (slot + 1) & this->mask;
+	}
+	return slot;
+}
+
+bool KmerCountTable::set_count(uint64_t kmer, uint32_t count) {
+	if (kmer == EMPTY_SLOT) return false;
+	size_t slot = this->find_slot(kmer);
+	if (this->keys[slot] != kmer) return false;
+	this->counts[slot] = count;
+	return true;
+}
+
+uint32_t KmerCountTable::get_count(uint64_t kmer) const {
+	size_t slot = this->find_slot(kmer);
+	return ((kmer != EMPTY_SLOT) && (this->keys[slot] == kmer)) ? this->counts[slot] : 0;
+}
+
+bool KmerCountTable::contains(uint64_t kmer) const {
+	return (kmer != EMPTY_SLOT) && (this->keys[this->find_slot(kmer)] == kmer);
+}
+
+size_t KmerCountTable::size() const {
+	return this->nr_kmers;
+}
@@ -0,0 +1,38 @@
+#ifndef KMERCOUNTTABLE_HPP
+#define KMERCOUNTTABLE_HPP
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+* Open addressing hash table storing counts for a fixed set of kmers
+* (canonical, 2 bits per base, see KmerProfile::encode_kmer). Kmers are inserted
+* once at construction, afterwards only their counts can be changed. Counts of
+* distinct kmers can be set concurrently.
+**/
+
+class KmerCountTable {
+public:
+	/**
+	* @param kmers kmers for which counts will be stored (duplicates allowed)
+	**/
+	KmerCountTable(const std::vector<uint64_t>& kmers);
+	/** set the count of a kmer. Returns false if the kmer is not contained in the table. **/
+	bool set_count(uint64_t kmer, uint32_t count);
+	/** count of the kmer (0 if it is not contained in the table) **/
+	uint32_t get_count(uint64_t kmer) const;
+	bool contains(uint64_t kmer) const;
+	/** number of distinct kmers stored **/
+	size_t size() const;
+
+private:
+	std::vector<uint64_t> keys;
+	std::vector<uint32_t> counts;
+	uint64_t mask;
+	size_t nr_kmers;
+	/** slot of the kmer, or of the empty slot where it would be inserted **/
+	size_t find_slot(uint64_t kmer) const;
+};
+
+#endif // KMERCOUNTTABLE_HPP
@@ -0,0 +1,293 @@
+#include "kmerprofile.hpp"
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include "threadpool.hpp"
+#include "mappedfile.hpp"
+
+using namespace std;
+
+const char PROFILE_MAGIC[8] = {'P', 'G', 'K', 'M', 'E', 'R', 'P', 'F'};
+const uint32_t PROFILE_VERSION = 2;
+
+struct ProfileHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t kmer_size;
+	uint64_t nr_kmers;
+	uint64_t kmer_abundance_peak;
+	uint64_t fingerprint;
+	uint32_t count_bytes;
+	uint32_t reserved;
+	uint64_t panel_fingerprint;
+};
+
+// the following loops are simple enough to be vectorized by the compiler (saturating adds)
+static void add_counts(uint32_t* __restrict sums, const uint16_t* __restrict counts, size_t length) {
+	for (size_t i = 0; i < length; ++i) {
+		uint32_t sum = sums[i] + counts[i];
+		sums[i] = (sum < sums[i]) ? UINT32_MAX : sum;
+	}
+}
+
+static void add_counts(uint32_t* __restrict sums, const uint32_t* __restrict counts, size_t length) {
+	for (size_t i = 0; i < length; ++i) {
+		uint32_t sum = sums[i] + counts[i];
+		sums[i] = (sum < sums[i]) ? UINT32_MAX : sum;
+	}
+}
+
+static void narrow_counts(uint16_t* __restrict result, const uint32_t* __restrict counts, size_t length) {
+	for (size_t i = 0; i < length; ++i) {
+		result[i] = (counts[i] > UINT16_MAX) ? UINT16_MAX : counts[i];
+	}
+}
+
+KmerProfile::KmerProfile(size_t kmer_size, vector<ProfileKmer>& kmers)
+	:kmer_size(kmer_size),
+	 kmer_abundance_peak(0),
+	 panel_fingerprint(0)
+{
+	if ((kmer_size == 0) || (kmer_size > 32)) {
+		throw runtime_error("KmerProfile::KmerProfile: kmer profiles require a kmer size between 1 and 32.");
+	}
+	sort(kmers.begin(), kmers.end());
+	kmers.erase(unique(kmers.begin(), kmers.end()), kmers.end());
+	this->kmers.reserve(kmers.size());
+	this->genomic_counts.reserve(kmers.size());
+	for (auto& k : kmers) {
+		this->kmers.push_back(k.kmer);
+		this->genomic_counts.push_back(k.genomic_count);
+	}
+	this->read_counts.assign(this->kmers.size(), 0);
+}
+
+KmerProfile::KmerProfile(string filename) {
+	ifstream file(filename, ios::in | ios::binary);
+	if (!file.good()) {
+		throw runtime_error("KmerProfile::KmerProfile: file " + filename + " cannot be opened.");
+	}
+	ProfileHeader header;
+	file.read((char*) &header, sizeof(header));
+	if (!file || (memcmp(header.magic, PROFILE_MAGIC, 8) != 0)) {
+		throw runtime_error("KmerProfile::KmerProfile: file " + filename + " is not a kmer profile.");
+	}
+	if (header.version != PROFILE_VERSION) {
+		throw runtime_error("KmerProfile::KmerProfile: file " + filename + " has unsupported version " + to_string(header.version) + ".");
+	}
+	if ((header.count_bytes != 2) && (header.count_bytes != 4)) {
+		throw runtime_error("KmerProfile::KmerProfile: file " + filename + " has unsupported count width.");
+	}
+	this->kmer_size = header.kmer_size;
+	this->kmer_abundance_peak = header.kmer_abundance_peak;
+	this->panel_fingerprint = header.panel_fingerprint;
+	this->kmers.resize(header.nr_kmers);
+	this->read_counts.resize(header.nr_kmers);
+	this->genomic_counts.resize(header.nr_kmers);
+	file.read((char*) this->kmers.data(), header.nr_kmers * sizeof(uint64_t));
+	if (header.count_bytes == 2) {
+		file.read((char*) this->read_counts.data(), header.nr_kmers * sizeof(uint16_t));
+	} else {
+		// 32 bit counts (merged profiles) are saturated, larger counts are never used for genotyping
+		vector<uint32_t> buffer(1 << 20);
+		for (size_t start = 0; start < header.nr_kmers; start += buffer.size()) {
+			size_t length = min(buffer.size(), (size_t) (header.nr_kmers - start));
+			file.read((char*) buffer.data(), length * sizeof(uint32_t));
+			narrow_counts(this->read_counts.data() + start, buffer.data(), length);
+		}
+	}
+	file.read((char*) this->genomic_counts.data(), header.nr_kmers);
+	if (!file) {
+		throw runtime_error("KmerProfile::KmerProfile: file " + filename + " is truncated.");
+	}
+	if (this->get_fingerprint() != header.fingerprint) {
+		throw runtime_error("KmerProfile::KmerProfile: file " + filename + " is corrupted (fingerprint mismatch).");
+	}
+}
+
+bool KmerProfile::is_profile(string filename) {
+	ifstream file(filename, ios::in | ios::binary);
+	char magic[8];
+	if (!file.read(magic, 8)) return false;
+	return memcmp(magic, PROFILE_MAGIC, 8) == 0;
+}
+
+uint64_t KmerProfile::encode_kmer(jellyfish::mer_dna kmer) {
+	kmer.canonicalize();
+	// first base is stored in the most significant bits, so that the order of the codes is the lexicographic one
+	return kmer.get_bits(0, 2 * jellyfish::mer_dna::k());
+}
+
+void KmerProfile::set_read_counts(KmerCounter* read_kmers, size_t nr_threads) {
+	// decode kmers back to sequence in order to query them
+	auto lookup = [this, read_kmers](size_t start, size_t end) {
+		string kmer(this->kmer_size, 'A');
+		const char bases[4] = {'A', 'C', 'G', 'T'};
+		for (size_t i = start; i < end; ++i) {
+			uint64_t code = this->kmers[i];
+			for (size_t j = 0; j < this->kmer_size; ++j) {
+				kmer[this->kmer_size - 1 - j] = bases[code & 3];
+				code >>= 2;
+			}
+			size_t count = read_kmers->getKmerAbundance(kmer);
+			this->read_counts[i] = (uint16_t) min(count, (size_t) UINT16_MAX);
+		}
+	};
+	size_t chunk_size = max((size_t) 1, (this->kmers.size() + nr_threads - 1) / max(nr_threads, (size_t) 1));
+	ThreadPool threadPool (max(nr_threads, (size_t) 1));
+	for (size_t start = 0; start < this->kmers.size(); start += chunk_size) {
+		size_t end = min(start + chunk_size, this->kmers.size());
+		threadPool.submit([lookup, start, end](){ lookup(start, end); });
+	}
+}
+
+void KmerProfile::set_kmer_abundance_peak(size_t peak) {
+	this->kmer_abundance_peak = peak;
+}
+
+void KmerProfile::set_panel_fingerprint(uint64_t fingerprint) {
+	this->panel_fingerprint = fingerprint;
+}
+
+void KmerProfile::write(string filename) const {
+	ofstream file(filename, ios::out | ios::binary);
+	if (!file.good()) {
+		throw runtime_error("KmerProfile::write: file " + filename + " cannot be created. Note that the filename must not contain non-existing directories.");
+	}
+	ProfileHeader header;
+	memcpy(header.magic, PROFILE_MAGIC, 8);
+	header.version = PROFILE_VERSION;
+	header.kmer_size = this->kmer_size;
+	header.nr_kmers = this->kmers.size();
+	header.kmer_abundance_peak = this->kmer_abundance_peak;
+	header.fingerprint = this->get_fingerprint();
+	header.count_bytes = sizeof(uint16_t);
+	header.reserved = 0;
+	header.panel_fingerprint = this->panel_fingerprint;
+	file.write((const char*) &header, sizeof(header));
+	file.write((const char*) this->kmers.data(), this->kmers.size() * sizeof(uint64_t));
+	file.write((const char*) this->read_counts.data(), this->read_counts.size() * sizeof(uint16_t));
+	file.write((const char*) this->genomic_counts.data(), this->genomic_counts.size());
+	if (!file) {
+		throw runtime_error("KmerProfile::write: failed to write file " + filename + ".");
+	}
+}
+
+void KmerProfile::merge(vector<string> filenames, string outfile, size_t count_bytes) {
+	if (filenames.empty()) {
+		throw runtime_error("KmerProfile::merge: no profiles given.");
+	}
+	if ((count_bytes != 2) && (count_bytes != 4)) {
+		throw runtime_error("KmerProfile::merge: counts must be stored in 16 or 32 bits.");
+	}
+	// map all inputs and make sure they were computed for the same kmers
+	vector<unique_ptr<MappedFile>> inputs;
+	vector<const ProfileHeader*> headers;
+	for (auto& filename : filenames) {
+		inputs.push_back(unique_ptr<MappedFile>(new MappedFile(filename, true)));
+		const MappedFile& input = *inputs.back();
+		const ProfileHeader* header = (const ProfileHeader*) input.data();
+		if ((input.size() < sizeof(ProfileHeader)) || (memcmp(header->magic, PROFILE_MAGIC, 8) != 0)) {
+			throw runtime_error("KmerProfile::merge: file " + filename + " is not a kmer profile.");
+		}
+		if ((header->version != PROFILE_VERSION) || ((header->count_bytes != 2) && (header->count_bytes != 4))) {
+			throw runtime_error("KmerProfile::merge: file " + filename + " has an unsupported version or count width.");
+		}
+		if (input.size() != sizeof(ProfileHeader) + header->nr_kmers * (sizeof(uint64_t) + header->count_bytes + 1)) {
+			throw runtime_error("KmerProfile::merge: file " + filename + " is truncated.");
+		}
+		if (!headers.empty() && ((header->kmer_size != headers[0]->kmer_size) || (header->nr_kmers != headers[0]->nr_kmers) || (header->fingerprint != headers[0]->fingerprint) || (header->panel_fingerprint != headers[0]->panel_fingerprint))) {
+			throw runtime_error("KmerProfile::merge: profiles " + filenames[0] + " and " + filename + " were computed for different sets of kmers.");
+		}
+		headers.push_back(header);
+	}
+
+	ofstream file(outfile, ios::out | ios::binary);
+	if (!file.good()) {
+		throw runtime_error("KmerProfile::merge: file " + outfile + " cannot be created. Note that the filename must not contain non-existing directories.");
+	}
+	size_t nr_kmers = headers[0]->nr_kmers;
+	ProfileHeader header = *headers[0];
+	// the abundance peak of the merged counts is unknown and recomputed when the profile is used
+	header.kmer_abundance_peak = 0;
+	header.count_bytes = count_bytes;
+	file.write((const char*) &header, sizeof(header));
+	const char* kmers_start = inputs[0]->data() + sizeof(ProfileHeader);
+	file.write(kmers_start, nr_kmers * sizeof(uint64_t));
+
+	// sum up the counts chunk-wise
+	vector<uint32_t> sums(1 << 20);
+	vector<uint16_t> narrowed(sums.size());
+	for (size_t start = 0; start < nr_kmers; start += sums.size()) {
+		size_t length = min(sums.size(), nr_kmers - start);
+		fill(sums.begin(), sums.begin() + length, 0);
+		for (size_t i = 0; i < inputs.size(); ++i) {
+			const char* counts = inputs[i]->data() + sizeof(ProfileHeader) + nr_kmers * sizeof(uint64_t);
+			if (headers[i]->count_bytes == 2) {
+				add_counts(sums.data(), ((const uint16_t*) counts) + start, length);
+			} else {
+				add_counts(sums.data(), ((const uint32_t*) counts) + start, length);
+			}
+		}
+		if (count_bytes == 2) {
+			narrow_counts(narrowed.data(), sums.data(), length);
+			file.write((const char*) narrowed.data(), length * sizeof(uint16_t));
+		} else {
+			file.write((const char*) sums.data(), length * sizeof(uint32_t));
+		}
+	}
+	const char* genomic_start = inputs[0]->data() + sizeof(ProfileHeader) + nr_kmers * (sizeof(uint64_t) + headers[0]->count_bytes);
+	file.write(genomic_start, nr_kmers);
+	if (!file) {
+		throw runtime_error("KmerProfile::merge: failed to write file " + outfile + ".");
+	}
+}
+
+size_t KmerProfile::size() const {
+	return this->kmers.size();
+}
+
+size_t KmerProfile::get_kmer_size() const {
+	return this->kmer_size;
+}
+
+size_t KmerProfile::get_kmer_abundance_peak() const {
+	return this->kmer_abundance_peak;
+}
+
+uint64_t KmerProfile::get_panel_fingerprint() const {
+	return this->panel_fingerprint;
+}
+
+uint64_t KmerProfile::get_fingerprint() const {
+	uint64_t fingerprint = 0xcbf29ce484222325ULL ^ this->kmer_size;
+	for (size_t i = 0; i < this->kmers.size(); ++i) {
+		fingerprint = (fingerprint ^ this->kmers[i]) * 0x100000001b3ULL;
+		fingerprint = (fingerprint ^ this->genomic_counts[i]) * 0x100000001b3ULL;
+		fingerprint ^= fingerprint >> 29;
+	}
+	return fingerprint;
+}
+
+size_t KmerProfile::find(uint64_t kmer) const {
+	auto it = lower_bound(this->kmers.begin(), this->kmers.end(), kmer);
+	if ((it == this->kmers.end()) || (*it != kmer)) return this->kmers.size();
+	return it - this->kmers.begin();
+}
+
+size_t KmerProfile::get_read_count(uint64_t kmer) const {
+	size_t index = this->find(kmer);
+	return (index < this->kmers.size()) ? this->read_counts[index] : 0;
+}
+
+size_t KmerProfile::get_genomic_count(uint64_t kmer) const {
+	size_t index = this->find(kmer);
+	return (index < this->kmers.size()) ? this->genomic_counts[index] : 0;
+}
+
+uint16_t KmerProfile::get_read_count_at(size_t index) const {
+	return this->read_counts.at(index);
+}
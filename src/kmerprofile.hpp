@@ -0,0 +1,78 @@
+#ifndef KMERPROFILE_HPP
+#define KMERPROFILE_HPP
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+#include <jellyfish/mer_dna.hpp>
+#include "kmercounter.hpp"
+
+/**
+* Kmer count profile of a sample. Stores read and genomic counts of all kmers
+* PanGenie queries during genotyping (kmers unique to variant alleles and kmers
+* used to compute the local coverage around variants), so that a sample can be
+* re-genotyped without counting its reads again.
+*
+* Binary format (little endian): header (magic, version, kmer size, number of kmers,
+* kmer abundance peak, fingerprint of the kmer set, bytes per read count, fingerprint of the panel), followed by
+* the sorted canonical kmers (2 bits per base), the read counts (16 or 32 bits) and the genomic counts.
+* Profiles computed from different subsets of the reads with the same index can be merged.
+* A profile can only be used with the panel it was computed for (see VariantReader::get_fingerprint).
+**/
+
+struct ProfileKmer {
+	uint64_t kmer;
+	unsigned char genomic_count;
+	bool operator<(const ProfileKmer& other) const { return this->kmer < other.kmer; }
+	bool operator==(const ProfileKmer& other) const { return this->kmer == other.kmer; }
+};
+
+class KmerProfile {
+public:
+	/**
+	* @param kmer_size kmer size (at most 32)
+	* @param kmers kmers to store counts for and their genomic counts (duplicates are removed)
+	**/
+	KmerProfile(size_t kmer_size, std::vector<ProfileKmer>& kmers);
+	/** read profile from file **/
+	KmerProfile(std::string filename);
+	/** check whether the given file is a kmer profile **/
+	static bool is_profile(std::string filename);
+	/** encode a kmer in its canonical form (2 bits per base) **/
+	static uint64_t encode_kmer(jellyfish::mer_dna kmer);
+	/** look up the read counts of all kmers in the given counter **/
+	void set_read_counts(KmerCounter* read_kmers, size_t nr_threads = 1);
+	void set_kmer_abundance_peak(size_t peak);
+	/** fingerprint of the panel the kmers were collected from (see VariantReader::get_fingerprint) **/
+	void set_panel_fingerprint(uint64_t fingerprint);
+	/** sum up the read counts of profiles computed for the same kmers (e.g. on different subsets of the reads).
+	* @param count_bytes number of bytes used to store each count in the result (2 or 4), counts are saturated
+	**/
+	static void merge(std::vector<std::string> filenames, std::string outfile, size_t count_bytes = 2);
+	/** write profile to file **/
+	void write(std::string filename) const;
+	size_t size() const;
+	size_t get_kmer_size() const;
+	size_t get_kmer_abundance_peak() const;
+	/** fingerprint of the kmer set (kmer size, kmers and genomic counts), identical for profiles computed from the same index **/
+	uint64_t get_fingerprint() const;
+	uint64_t get_panel_fingerprint() const;
+	/** read count of the kmer (0 if it is not part of the profile) **/
+	size_t get_read_count(uint64_t kmer) const;
+	/** genomic count of the kmer (0 if it is not part of the profile) **/
+	size_t get_genomic_count(uint64_t kmer) const;
+	/** read count of the kmer at the given position **/
+	uint16_t get_read_count_at(size_t index) const;
+
+private:
+	size_t kmer_size;
+	size_t kmer_abundance_peak;
+	uint64_t panel_fingerprint;
+	std::vector<uint64_t> kmers;
+	std::vector<uint16_t> read_counts;
+	std::vector<unsigned char> genomic_counts;
+	/** position of the kmer, or size() if it is not contained **/
+	size_t find(uint64_t kmer) const;
+};
+
+#endif // KMERPROFILE_HPP
@@ -0,0 +1,59 @@
+#include "mappedfile.hpp"
+#include <stdexcept>
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+MappedFile::MappedFile(string filename, bool sequential)
+	:filename(filename),
+	 mapped(nullptr),
+	 length(0)
+{
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw runtime_error("MappedFile::MappedFile: file " + filename + " cannot be opened.");
+	}
+	struct stat file_stat;
+	if (fstat(fd, &file_stat) != 0) {
+		close(fd);
+		throw runtime_error("MappedFile::MappedFile: cannot determine size of file " + filename + ".");
+	}
+	this->length = file_stat.st_size;
+	if (this->length > 0) {
+		void* result = mmap(nullptr, this->length, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (result == MAP_FAILED) {
+			close(fd);
+			throw runtime_error("MappedFile::MappedFile: file " + filename + " cannot be mapped into memory.");
+		}
+		this->mapped = (char*) result;
+		if (sequential) madvise(this->mapped, this->length, MADV_SEQUENTIAL);
+	}
+	close(fd);
+}
+
+MappedFile::~MappedFile() {
+	if (this->mapped != nullptr) {
+		munmap(this->mapped, this->length);
+	}
+}
+
+const char* MappedFile::data() const {
+	return this->mapped;
+}
+
+size_t MappedFile::size() const {
+	return this->length;
+}
+
+void MappedFile::release(size_t offset, size_t length) const {
+	if ((this->mapped == nullptr) || (offset >= this->length)) return;
+	// madvise requires a page-aligned address
+	size_t page_size = sysconf(_SC_PAGESIZE);
+	size_t start = (offset / page_size) * page_size;
+	size_t end = min(offset + length, this->length);
+	madvise(this->mapped + start, end - start, MADV_DONTNEED);
+}
@@ -0,0 +1,32 @@
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include <string>
+#include <stddef.h>
+
+/**
+* Read-only memory mapping of a file.
+**/
+
+class MappedFile {
+public:
+	/**
+	* @param filename name of the file to map
+	* @param sequential advise the kernel that the file will be read sequentially
+	**/
+	MappedFile(std::string filename, bool sequential = false);
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	const char* data() const;
+	size_t size() const;
+	/** tell the kernel that the given range is not needed anymore (pages are read again on access) **/
+	void release(size_t offset, size_t length) const;
+
+private:
+	std::string filename;
+	char* mapped;
+	size_t length;
+};
+
+#endif // MAPPEDFILE_HPP
@@ -0,0 +1,155 @@
+#include "metrics.hpp"
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <stdexcept>
+#include <time.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+using namespace std;
+
+/** quote and escape a string for JSON **/
+static string json_string(const string& s) {
+	string result = "\"";
+	for (char c : s) {
+		if ((c == '"') || (c == '\\')) {
+			result += '\\';
+			result += c;
+		} else if ((unsigned char) c < 0x20) {
+			char escaped[7];
+			snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned char) c);
+			result += escaped;
+		} else {
+			result += c;
+		}
+	}
+	return result + "\"";
+}
+
+Metrics::Metrics()
+	:stage_start(chrono::steady_clock::now()),
+	 stage_cpu_start(process_cpu_time())
+{}
+
+double Metrics::end_stage(string name) {
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+	double cpu_time = process_cpu_time();
+	double wall_time = chrono::duration_cast<chrono::nanoseconds>(now - this->stage_start).count() / 1000000000.0;
+	double stage_cpu_time = cpu_time - this->stage_cpu_start;
+	size_t memory = peak_memory();
+	add_stage(name, wall_time, stage_cpu_time, memory);
+	this->stage_start = now;
+	this->stage_cpu_start = cpu_time;
+	cerr << "#### " << name << ": " << wall_time << " sec wallclock, " << stage_cpu_time << " sec CPU, maximum memory usage until now: " << (memory / 1E9) << " GB ####" << endl;
+	return wall_time;
+}
+
+void Metrics::add_stage(string name, double wall_time, double cpu_time, size_t peak_memory) {
+	lock_guard<mutex> lock (this->metrics_mutex);
+	this->stages.push_back(Stage{name, wall_time, cpu_time, peak_memory});
+}
+
+void Metrics::add_to_chromosome(string chromosome, string name, double value) {
+	lock_guard<mutex> lock (this->metrics_mutex);
+	this->chromosomes[chromosome][name] += value;
+}
+
+void Metrics::set_for_chromosome(string chromosome, string name, double value) {
+	lock_guard<mutex> lock (this->metrics_mutex);
+	this->chromosomes[chromosome][name] = value;
+}
+
+void Metrics::add_run(const RunMetrics& run) {
+	lock_guard<mutex> lock (this->metrics_mutex);
+	this->runs.push_back(run);
+}
+
+void Metrics::set_value(string name, double value) {
+	lock_guard<mutex> lock (this->metrics_mutex);
+	this->values[name] = value;
+}
+
+void Metrics::add_to_value(string name, double value) {
+	lock_guard<mutex> lock (this->metrics_mutex);
+	this->values[name] += value;
+}
+
+double Metrics::get_value(string name) const {
+	lock_guard<mutex> lock (this->metrics_mutex);
+	auto it = this->values.find(name);
+	return (it != this->values.end()) ? it->second : 0.0;
+}
+
+void Metrics::write(string filename) const {
+	lock_guard<mutex> lock (this->metrics_mutex);
+	ofstream file(filename);
+	if (!file.good()) {
+		throw runtime_error("Metrics::write: file " + filename + " cannot be opened.");
+	}
+	// counts (e.g. bytes) are stored as doubles and should not be rounded
+	file << setprecision(15);
+	file << "{\n";
+	for (auto& value : this->values) {
+		file << "\t" << json_string(value.first) << ": " << value.second << ",\n";
+	}
+	file << "\t\"stages\": [";
+	for (size_t i = 0; i < this->stages.size(); ++i) {
+		const Stage& stage = this->stages[i];
+		file << ((i > 0) ? ",\n" : "\n") << "\t\t{\"name\": " << json_string(stage.name) << ", \"wall_time\": " << stage.wall_time << ", \"cpu_time\": " << stage.cpu_time << ", \"peak_memory\": " << stage.peak_memory << "}";
+	}
+	file << "\n\t],\n\t\"chromosomes\": {";
+	bool first = true;
+	for (auto& chromosome : this->chromosomes) {
+		file << (first ? "\n" : ",\n") << "\t\t" << json_string(chromosome.first) << ": {";
+		first = false;
+		bool first_value = true;
+		for (auto& value : chromosome.second) {
+			file << (first_value ? "" : ", ") << json_string(value.first) << ": " << value.second;
+			first_value = false;
+		}
+		file << "}";
+	}
+	// runs finish in any order
+	vector<RunMetrics> sorted_runs = this->runs;
+	sort(sorted_runs.begin(), sorted_runs.end(), [](const RunMetrics& a, const RunMetrics& b){
+		if (a.chromosome != b.chromosome) return a.chromosome < b.chromosome;
+		if (a.subset != b.subset) return a.subset < b.subset;
+		return a.window < b.window;
+	});
+	file << "\n\t},\n\t\"runs\": [";
+	for (size_t i = 0; i < sorted_runs.size(); ++i) {
+		const RunMetrics& run = sorted_runs[i];
+		file << ((i > 0) ? ",\n" : "\n") << "\t\t{\"chromosome\": " << json_string(run.chromosome) << ", \"type\": " << json_string(run.type) << ", \"subset\": " << run.subset << ", \"window\": " << run.window;
+		file << ", \"variants\": " << run.nr_variants << ", \"wall_time\": " << run.wall_time << ", \"cpu_time\": " << run.cpu_time << "}";
+	}
+	file << "\n\t]\n}\n";
+}
+
+double Metrics::process_cpu_time() {
+	struct rusage r_usage;
+	getrusage(RUSAGE_SELF, &r_usage);
+	return r_usage.ru_utime.tv_sec + r_usage.ru_stime.tv_sec + (r_usage.ru_utime.tv_usec + r_usage.ru_stime.tv_usec) / 1000000.0;
+}
+
+double Metrics::thread_cpu_time() {
+	struct timespec t;
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t) != 0) return 0.0;
+	return t.tv_sec + t.tv_nsec / 1000000000.0;
+}
+
+size_t Metrics::peak_memory() {
+	struct rusage r_usage;
+	getrusage(RUSAGE_SELF, &r_usage);
+	// kilobytes
+	return r_usage.ru_maxrss * 1024;
+}
+
+size_t Metrics::current_memory() {
+	// second field: resident pages
+	ifstream statm("/proc/self/statm");
+	size_t total_pages, resident_pages;
+	if (!(statm >> total_pages >> resident_pages)) return peak_memory();
+	return resident_pages * sysconf(_SC_PAGESIZE);
+}
@@ -0,0 +1,81 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <chrono>
+
+/**
+* Collects runtime and memory metrics of a run and writes them as JSON: wall time, CPU time and
+* peak memory of each stage, values per chromosome, one entry per HMM run and global values.
+* Values can be recorded from several threads.
+**/
+
+/** a genotyping or phasing run of the HMM **/
+struct RunMetrics {
+	std::string chromosome;
+	/** genotyping or phasing **/
+	std::string type;
+	/** index of the subset of paths (-1 for phasing) **/
+	long subset;
+	/** index of the window of the chromosome (see WindowSplitter) **/
+	size_t window;
+	size_t nr_variants;
+	double wall_time;
+	double cpu_time;
+};
+
+class Metrics {
+public:
+	/** the first stage starts here **/
+	Metrics();
+	/**
+	* end the current stage, which started at the end of the previous one (or on construction),
+	* record its wall and CPU time and the peak memory so far and print them.
+	* @returns wall time of the stage in seconds
+	**/
+	double end_stage(std::string name);
+	/** record a stage **/
+	void add_stage(std::string name, double wall_time, double cpu_time, size_t peak_memory);
+	/** add value to a value of a chromosome (values are 0 initially) **/
+	void add_to_chromosome(std::string chromosome, std::string name, double value);
+	/** set a value of a chromosome **/
+	void set_for_chromosome(std::string chromosome, std::string name, double value);
+	void add_run(const RunMetrics& run);
+	/** set a global value **/
+	void set_value(std::string name, double value);
+	/** add value to a global value (values are 0 initially) **/
+	void add_to_value(std::string name, double value);
+	/** get a global value (0 if not set) **/
+	double get_value(std::string name) const;
+	/** write all metrics to the given file **/
+	void write(std::string filename) const;
+
+	/** CPU time (user and system) used by the process so far, in seconds **/
+	static double process_cpu_time();
+	/** CPU time used by the calling thread so far, in seconds **/
+	static double thread_cpu_time();
+	/** peak resident memory of the process so far, in bytes **/
+	static size_t peak_memory();
+	/** resident memory of the process right now, in bytes (the peak if it cannot be determined) **/
+	static size_t current_memory();
+
+private:
+	struct Stage {
+		std::string name;
+		double wall_time;
+		double cpu_time;
+		size_t peak_memory;
+	};
+	mutable std::mutex metrics_mutex;
+	std::chrono::steady_clock::time_point stage_start;
+	double stage_cpu_start;
+	std::vector<Stage> stages;
+	std::map<std::string, std::map<std::string, double>> chromosomes;
+	std::vector<RunMetrics> runs;
+	std::map<std::string, double> values;
+};
+
+#endif // METRICS_HPP
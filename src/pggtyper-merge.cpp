@@ -0,0 +1,71 @@
+#include <iostream>
+#include <sstream>
+#include <sys/resource.h>
+#include <vector>
+#include <string>
+#include "kmerprofile.hpp"
+#include "commandlineparser.hpp"
+#include "timer.hpp"
+
+
+using namespace std;
+
+int main (int argc, char* argv[])
+{
+	Timer timer;
+
+	cerr << endl;
+	cerr << "program: PanGenie-merge - sum up kmer count profiles computed on subsets of the reads of a sample." << endl;
+	cerr << "author: Jana Ebler" << endl << endl;
+
+	string outname = "result";
+	size_t count_bits = 16;
+	vector<string> profiles;
+
+	// parse the command line arguments
+	CommandLineParser argument_parser;
+	argument_parser.add_command("PanGenie-merge [options] -i <partial1.profile,partial2.profile,...>");
+	argument_parser.add_mandatory_argument('i', "comma-separated list of kmer count profiles (written by PanGenie -P using the same index)");
+	argument_parser.add_optional_argument('o', "result", "prefix of the output file (<prefix>.profile)");
+	argument_parser.add_optional_argument('w', "16", "number of bits used per count in the merged profile (16 or 32). Counts are saturated.");
+
+	try {
+		argument_parser.parse(argc, argv);
+	} catch (const runtime_error& e) {
+		argument_parser.usage();
+		cerr << e.what() << endl;
+		return 1;
+	} catch (const exception& e) {
+		return 0;
+	}
+
+	stringstream ss(argument_parser.get_argument('i'));
+	string profile;
+	while (getline(ss, profile, ',')) {
+		if (!profile.empty()) profiles.push_back(profile);
+	}
+	outname = argument_parser.get_argument('o');
+	count_bits = stoi(argument_parser.get_argument('w'));
+	if ((count_bits != 16) && (count_bits != 32)) {
+		cerr << "Error: number of bits per count (-w) must be 16 or 32." << endl;
+		return 1;
+	}
+
+	// print info
+	cerr << "Files and parameters used:" << endl;
+	argument_parser.info();
+
+	cerr << "Merge " << profiles.size() << " profile(s) into " << outname << ".profile ..." << endl;
+	KmerProfile::merge(profiles, outname + ".profile", count_bits / 8);
+
+	cerr << endl << "###### Summary ######" << endl;
+	// output times
+	cerr << "total wallclock time: " << timer.get_total_time()  << " sec" << endl;
+
+	// memory usage
+	struct rusage r_usage;
+	getrusage(RUSAGE_SELF, &r_usage);
+	cerr << "Total maximum memory usage: " << (r_usage.ru_maxrss / 1E6) << " GB" << endl;
+
+	return 0;
+}
@@ -1,14 +1,18 @@
 #include <iostream>
 #include <sstream>
-#include <sys/resource.h>
 #include <sys/stat.h>
 #include <mutex>
+#include <condition_variable>
 #include <thread>
 #include <algorithm>
 #include <fstream>
 #include <stdexcept>
+#include <memory>
+#include <atomic>
+#include <cstdio>
 #include "kmercounter.hpp"
 #include "jellyfishreader.hpp"
+#include "kmcreader.hpp"
 #include "jellyfishcounter.hpp"
 #include "emissionprobabilitycomputer.hpp"
 #include "copynumber.hpp"
@@ -18,7 +22,14 @@
 #include "commandlineparser.hpp"
 #include "timer.hpp"
 #include "threadpool.hpp"
+#include "taskscheduler.hpp"
 #include "pathsampler.hpp"
+#include "hyperloglog.hpp"
+#include "readstreams.hpp"
+#include "kmerprofile.hpp"
+#include "profilekmercounter.hpp"
+#include "windowsplitter.hpp"
+#include "metrics.hpp"
 
 using namespace std;
 
@@ -31,7 +42,7 @@ bool ends_with (string const &filename, string const &ending) {
     }
 }
 
-void check_input_file(string &filename) {
+void check_input_file(string &filename, bool allow_compressed = false) {
 	// check if file exists and can be opened
 	ifstream file(filename);
 	if (!file.good()) {
@@ -40,13 +51,23 @@ void check_input_file(string &filename) {
 		throw runtime_error(ss.str());
 	}
 	// make sure file is not compressed
-	if (ends_with(filename, ".gz")) {
+	if (!allow_compressed && ends_with(filename, ".gz")) {
 		stringstream ss;
 		ss << "File " << filename << " seems to be gzip-compressed. PanGenie requires an uncompressed file." << endl;
 		throw runtime_error(ss.str());
 	}
 }
 
+vector<string> split_filenames(string filenames) {
+	vector<string> result;
+	stringstream ss(filenames);
+	string filename;
+	while (getline(ss, filename, ',')) {
+		if (!filename.empty()) result.push_back(filename);
+	}
+	return result;
+}
+
 struct UniqueKmersMap {
 	mutex kmers_mutex;
 	map<string, vector<UniqueKmers*>> unique_kmers;
@@ -57,13 +78,37 @@ struct Results {
 	mutex result_mutex;
 	map<string, vector<GenotypingResult>> result;
 	map<string, double> runtimes;
+	/** number of genotyping/phasing runs of each chromosome that have not finished yet **/
+	map<string, size_t> pending;
 };
 
-void prepare_unique_kmers(string chromosome, KmerCounter* genomic_kmer_counts, KmerCounter* read_kmer_counts, VariantReader* variant_reader, ProbabilityTable* probs, UniqueKmersMap* unique_kmers_map, size_t kmer_coverage) {
+/** formatted output of the chromosomes whose runs all finished, written in order by the main thread **/
+struct ChromosomeOutput {
+	VariantReader* variant_reader;
+	UniqueKmersMap* unique_kmers_map;
+	bool normalize;
+	bool ignore_imputed;
+	mutex output_mutex;
+	condition_variable output_changed;
+	map<string, VariantReader::FormattedResults> formatted;
+	map<string, exception_ptr> errors;
+	/** set once the output failed, tasks that did not start yet are skipped **/
+	atomic<bool> cancelled {false};
+};
+
+void prepare_unique_kmers(string chromosome, KmerCounter* genomic_kmer_counts, KmerCounter* read_kmer_counts, VariantReader* variant_reader, ProbabilityTable* probs, UniqueKmersMap* unique_kmers_map, size_t kmer_coverage, Metrics* metrics) {
 	Timer timer;
+	double cpu_start = Metrics::thread_cpu_time();
 	UniqueKmerComputer kmer_computer(genomic_kmer_counts, read_kmer_counts, variant_reader, chromosome, kmer_coverage);
 	std::vector<UniqueKmers*> unique_kmers;
     kmer_computer.compute_unique_kmers(&unique_kmers, probs);
+	metrics->set_for_chromosome(chromosome, "variants", unique_kmers.size());
+	metrics->set_for_chromosome(chromosome, "unique_kmers_wall_time", timer.get_total_time());
+	metrics->set_for_chromosome(chromosome, "unique_kmers_cpu_time", Metrics::thread_cpu_time() - cpu_start);
+	metrics->set_for_chromosome(chromosome, "kmers_looked_up", kmer_computer.get_nr_lookups());
+	metrics->add_to_value("kmers_looked_up", kmer_computer.get_nr_lookups());
+	metrics->add_to_value("copynumber_probabilities", kmer_computer.get_nr_probabilities());
+	metrics->add_to_value("copynumber_probabilities_precomputed", kmer_computer.get_nr_precomputed_probabilities());
 	// store the results
 	{
 		lock_guard<mutex> lock_kmers (unique_kmers_map->kmers_mutex);
@@ -74,35 +119,262 @@ void prepare_unique_kmers(string chromosome, KmerCounter* genomic_kmer_counts, K
 	unique_kmers_map->runtimes.insert(pair<string, double>(chromosome, timer.get_total_time()));
 }
 
-void run_genotyping(string chromosome, vector<UniqueKmers*>* unique_kmers, ProbabilityTable* probs, bool only_genotyping, bool only_phasing, long double effective_N, vector<unsigned short>* only_paths, Results* results) {
+void fail_chromosome(string chromosome, ChromosomeOutput* output, exception_ptr error) {
+	lock_guard<mutex> lock_output (output->output_mutex);
+	if (output->errors.find(chromosome) == output->errors.end()) output->errors[chromosome] = error;
+	output->output_changed.notify_all();
+}
+
+/** run a task of a chromosome, errors are reported to the output stage instead of being lost **/
+void run_guarded(function<void()> task, string chromosome, ChromosomeOutput* output) {
+	if (output->cancelled) return;
+	try {
+		task();
+	} catch (...) {
+		fail_chromosome(chromosome, output, current_exception());
+	}
+}
+
+void complete_chromosome(string chromosome, Results* results, ChromosomeOutput* output, Metrics* metrics) {
+	// no other run touches the results of this chromosome anymore
+	vector<GenotypingResult>* genotypes;
+	vector<UniqueKmers*>* unique_kmers;
+	{
+		lock_guard<mutex> lock_result (results->result_mutex);
+		genotypes = &results->result.at(chromosome);
+	}
+	{
+		lock_guard<mutex> lock_kmers (output->unique_kmers_map->kmers_mutex);
+		unique_kmers = &output->unique_kmers_map->unique_kmers.at(chromosome);
+	}
+	VariantReader::FormattedResults formatted;
+	exception_ptr error;
+	try {
+		// in case genotyping was run, normalize the combined likelihoods
+		if (output->normalize) {
+			for (size_t i = 0; i < genotypes->size(); ++i) {
+				genotypes->at(i).normalize();
+			}
+		}
+		output->variant_reader->format_results(chromosome, *genotypes, unique_kmers, output->ignore_imputed, formatted);
+	} catch (...) {
+		error = current_exception();
+	}
+	// the formatted records are all that is needed for writing
+	vector<GenotypingResult>().swap(*genotypes);
+	for (size_t i = 0; i < unique_kmers->size(); ++i) {
+		delete unique_kmers->at(i);
+	}
+	vector<UniqueKmers*>().swap(*unique_kmers);
+
+	if (error) {
+		fail_chromosome(chromosome, output, error);
+		return;
+	}
+	metrics->set_for_chromosome(chromosome, "peak_memory_when_done", Metrics::peak_memory());
+	lock_guard<mutex> lock_output (output->output_mutex);
+	output->formatted[chromosome] = move(formatted);
+	output->output_changed.notify_all();
+}
+
+void run_genotyping(string chromosome, vector<UniqueKmers*>* unique_kmers, GenotypingWindow window, ProbabilityTable* probs, bool only_genotyping, bool only_phasing, long double effective_N, vector<unsigned short>* only_paths, Results* results, ChromosomeOutput* output, RunMetrics run, Metrics* metrics) {
 	Timer timer;
+	double cpu_start = Metrics::thread_cpu_time();
+	bool whole_chromosome = (window.begin == 0) && (window.end == unique_kmers->size());
+	// the HMM of a window starts and ends within the chromosome, the burn-in variants on both sides are discarded below
+	vector<UniqueKmers*> window_kmers;
+	if (!whole_chromosome) window_kmers.assign(unique_kmers->begin() + window.begin, unique_kmers->begin() + window.end);
 	/* construct HMM and run genotyping/phasing. Genotyping is run without normalizing the final alpha*beta values.
 	These values are first added up across different subsets of paths, and the resulting probabilities are normalized
 	at the end. This is done so that genotyping runs on disjoint sets of paths are better comparable. */
-	HMM hmm(unique_kmers, probs, !only_phasing, !only_genotyping, 1.26, false, effective_N, only_paths, false);
+	HMM hmm(whole_chromosome ? unique_kmers : &window_kmers, probs, !only_phasing, !only_genotyping, 1.26, false, effective_N, only_paths, false);
 	// store the results
 	{
 		lock_guard<mutex> lock_result (results->result_mutex);
 		// combine the new results to the already existing ones (if present)
-		if (results->result.find(chromosome) == results->result.end()) {
+		if ((results->result.find(chromosome) == results->result.end()) && whole_chromosome) {
 			results->result.insert(pair<string, vector<GenotypingResult>> (chromosome, hmm.move_genotyping_result()));
 		} else {
+			if (results->result.find(chromosome) == results->result.end()) {
+				results->result.insert(pair<string, vector<GenotypingResult>> (chromosome, vector<GenotypingResult>(unique_kmers->size())));
+			}
 			// combine newly computed likelihoods with already exisiting ones
-			size_t index = 0;
 			vector<GenotypingResult> genotypes = hmm.move_genotyping_result();
-			for (auto likelihoods : genotypes) {
-				results->result.at(chromosome).at(index).combine(likelihoods);
-				index += 1;
+			for (size_t index = window.core_begin; index < window.core_end; ++index) {
+				GenotypingResult& likelihoods = genotypes.at(index - window.begin);
+				GenotypingResult& combined = results->result.at(chromosome).at(index);
+				combined.combine(likelihoods);
+				// haplotypes are only computed by the phasing run, which need not be the first one to finish
+				if (only_phasing) {
+					pair<unsigned char, unsigned char> haplotype = likelihoods.get_haplotype();
+					combined.add_first_haplotype_allele(haplotype.first);
+					combined.add_second_haplotype_allele(haplotype.second);
+				}
 			}
 		}
 	}
 	// store runtime
-	lock_guard<mutex> lock_result (results->result_mutex);
-	if (results->runtimes.find(chromosome) == results->runtimes.end()) {
-		results->runtimes.insert(pair<string,double>(chromosome, timer.get_total_time()));
-	} else {
-		results->runtimes[chromosome] += timer.get_total_time();
+	run.nr_variants = window.end - window.begin;
+	run.wall_time = timer.get_total_time();
+	run.cpu_time = Metrics::thread_cpu_time() - cpu_start;
+	metrics->add_run(run);
+	metrics->add_to_chromosome(chromosome, run.type + "_wall_time", run.wall_time);
+	metrics->add_to_chromosome(chromosome, run.type + "_cpu_time", run.cpu_time);
+	bool completed;
+	{
+		lock_guard<mutex> lock_result (results->result_mutex);
+		if (results->runtimes.find(chromosome) == results->runtimes.end()) {
+			results->runtimes.insert(pair<string,double>(chromosome, timer.get_total_time()));
+		} else {
+			results->runtimes[chromosome] += timer.get_total_time();
+		}
+		completed = (--results->pending.at(chromosome) == 0);
+	}
+	// the last run of a chromosome prepares its output
+	if (completed) complete_chromosome(chromosome, results, output, metrics);
+}
+
+/** state shared by the tasks processing the chromosomes (see run_chromosome) **/
+struct ChromosomeStage {
+	TaskScheduler* scheduler;
+	VariantReader* variant_reader;
+	KmerCounter* genomic_kmer_counts;
+	KmerCounter* read_kmer_counts;
+	size_t kmer_coverage;
+	ProbabilityTable* probs;
+	/** subsets of paths used for genotyping (nullptr: only phasing) **/
+	vector<vector<unsigned short>>* subsets;
+	/** paths used for phasing (nullptr: only genotyping) **/
+	vector<unsigned short>* phasing_paths;
+	long double effective_N;
+	/** splits chromosomes into windows genotyped separately **/
+	WindowSplitter* window_splitter;
+	UniqueKmersMap* unique_kmers_map;
+	Results* results;
+	ChromosomeOutput* output;
+	Metrics* metrics;
+	/** chromosomes whose unique kmers are not yet determined. The last one calls release_counts. **/
+	atomic<size_t> pending_unique_kmers;
+	function<void()> release_counts;
+};
+
+/**
+* determine the unique kmers of a chromosome and spawn its genotyping/phasing runs as child tasks,
+* the last of which prepares the output of the chromosome (see complete_chromosome). Genotyping runs
+* one task per subset and window, phasing always runs on the whole chromosome.
+**/
+void run_chromosome(string chromosome, ChromosomeStage* stage) {
+	prepare_unique_kmers(chromosome, stage->genomic_kmer_counts, stage->read_kmer_counts, stage->variant_reader, stage->probs, stage->unique_kmers_map, stage->kmer_coverage, stage->metrics);
+	if (--stage->pending_unique_kmers == 0) stage->release_counts();
+	vector<UniqueKmers*>* unique_kmers;
+	{
+		lock_guard<mutex> lock_kmers (stage->unique_kmers_map->kmers_mutex);
+		unique_kmers = &stage->unique_kmers_map->unique_kmers.at(chromosome);
+	}
+	GenotypingWindow whole_chromosome = {0, unique_kmers->size(), 0, unique_kmers->size()};
+	vector<GenotypingWindow> windows;
+	if (stage->subsets != nullptr) {
+		vector<size_t> positions;
+		for (size_t i = 0; i < unique_kmers->size(); ++i) {
+			positions.push_back(unique_kmers->at(i)->get_variant_position());
+		}
+		stage->window_splitter->split(positions, windows);
+		// one run per subset was expected, register the additional windows before any run can finish
+		lock_guard<mutex> lock_result (stage->results->result_mutex);
+		stage->results->pending.at(chromosome) += stage->subsets->size() * (windows.size() - 1);
+	}
+	// if requested, run phasing first
+	if (stage->phasing_paths != nullptr) {
+		RunMetrics run = {chromosome, "phasing", -1, 0, 0, 0.0, 0.0};
+		function<void()> f_genotyping = bind(run_genotyping, chromosome, unique_kmers, whole_chromosome, stage->probs, false, true, stage->effective_N, stage->phasing_paths, stage->results, stage->output, run, stage->metrics);
+		stage->scheduler->submit(bind(run_guarded, f_genotyping, chromosome, stage->output));
+	}
+	if (stage->subsets != nullptr) {
+		for (size_t s = 0; s < stage->subsets->size(); ++s) {
+			vector<unsigned short>* only_paths = &stage->subsets->at(s);
+			for (size_t w = 0; w < windows.size(); ++w) {
+				RunMetrics run = {chromosome, "genotyping", (long) s, w, 0, 0.0, 0.0};
+				function<void()> f_genotyping = bind(run_genotyping, chromosome, unique_kmers, windows[w], stage->probs, true, false, stage->effective_N, only_paths, stage->results, stage->output, run, stage->metrics);
+				stage->scheduler->submit(bind(run_guarded, f_genotyping, chromosome, stage->output));
+			}
+		}
+	}
+}
+
+/**
+* estimate the memory used while a chromosome is processed: its unique kmers, the combined genotyping results,
+* the HMM runs active at the same time (each with its own results) and the formatted output.
+* @param nr_runs number of HMM runs of the chromosome that can be active at the same time
+* @param run_variants largest number of variants a run covers (see -w)
+**/
+size_t estimate_chromosome_memory(const VariantReader& variant_reader, string chromosome, size_t nr_paths, size_t nr_hmm_paths, size_t nr_runs, size_t run_variants) {
+	size_t nr_variants = variant_reader.size_of(chromosome);
+	size_t memory = 0;
+	size_t results_memory = 0;
+	for (size_t i = 0; i < nr_variants; ++i) {
+		const Variant& variant = variant_reader.get_variant(chromosome, i);
+		size_t nr_alleles = variant.nr_of_alleles();
+		memory += UniqueKmers::estimate_memory(nr_paths, nr_alleles);
+		results_memory += GenotypingResult::estimate_memory(nr_alleles);
+		// roughly one VCF record per allele (combined variants are written separately) plus the allele sequences
+		memory += 200 * nr_alleles + 2 * (variant.get_end_position() - variant.get_start_position());
+	}
+	if (nr_variants == 0) return memory;
+	run_variants = min(run_variants, nr_variants);
+	memory += results_memory + nr_runs * (HMM::estimate_memory(run_variants, nr_hmm_paths) + results_memory / nr_variants * run_variants);
+	return memory;
+}
+
+uint64_t hash_size_for(size_t distinct_kmers) {
+	// leave some headroom so that jellyfish does not need to grow the hash
+	uint64_t hash_size = distinct_kmers + distinct_kmers / 4;
+	return max(hash_size, (uint64_t) 1000000);
+}
+
+void estimate_hash_sizes(string segment_file, vector<string> readfiles, size_t kmer_size, bool count_only_graph, uint64_t& read_hash_size, uint64_t& genomic_hash_size) {
+	HyperLogLog genomic_sketch;
+	genomic_sketch.add_file(segment_file, kmer_size);
+	size_t genomic_kmers = genomic_sketch.estimate();
+	cerr << "Estimated number of distinct kmers in genome: " << genomic_kmers << endl;
+	genomic_hash_size = hash_size_for(genomic_kmers);
+	if (count_only_graph) {
+		// only kmers located in the graph are inserted into the read hash
+		read_hash_size = genomic_hash_size;
+		return;
 	}
+	for (auto& readfile : readfiles) {
+		if (ReadStreams::is_stream(readfile)) {
+			cerr << "Warning: cannot sample reads streamed from stdin or a named pipe, using default hash size for reads." << endl;
+			return;
+		}
+	}
+	if (ReadStreams::get_compression(readfiles[0]) == Compression::ZSTD) {
+		cerr << "Warning: cannot sample zstd-compressed reads, using default hash size for reads." << endl;
+		return;
+	}
+	// read kmers not present in the genome (mostly sequencing errors) grow linearly with the number of reads.
+	// Estimate their rate on a sample of the first read file and extrapolate it to all files.
+	HyperLogLog read_sketch;
+	double fraction = read_sketch.add_file(readfiles[0], kmer_size, 1000000);
+	double size_factor = 1.0;
+	struct stat file_stat;
+	if ((stat(readfiles[0].c_str(), &file_stat) == 0) && (file_stat.st_size > 0)) {
+		double first_size = file_stat.st_size;
+		double total_size = 0.0;
+		for (auto& readfile : readfiles) {
+			if (stat(readfile.c_str(), &file_stat) == 0) total_size += file_stat.st_size;
+		}
+		size_factor = total_size / first_size;
+	}
+	size_t sampled_kmers = read_sketch.get_total_kmers();
+	read_sketch.merge(genomic_sketch);
+	size_t combined_kmers = read_sketch.estimate();
+	size_t novel_kmers = (combined_kmers > genomic_kmers) ? (combined_kmers - genomic_kmers) : 0;
+	double novel_rate = (sampled_kmers > 0) ? ((double) novel_kmers / sampled_kmers) : 0.0;
+	double total_read_kmers = ((fraction > 0.0) ? (sampled_kmers / fraction) : sampled_kmers) * size_factor;
+	size_t read_kmers = genomic_kmers + (size_t) (novel_rate * total_read_kmers);
+	cerr << "Estimated number of distinct kmers in reads: " << read_kmers << endl;
+	read_hash_size = hash_size_for(read_kmers);
 }
 
 bool ends_with (string const &full_string, string const ending) {
@@ -113,20 +385,54 @@ bool ends_with (string const &full_string, string const ending) {
 	}
 }
 
+void collect_profile_kmers(const vector<string>& chromosomes, VariantReader* variant_reader, KmerCounter* genomic_kmer_counts, size_t nr_threads, vector<ProfileKmer>* result) {
+	// collect the kmers queried during genotyping (only depends on the genomic counts)
+	vector<vector<ProfileKmer>> chromosome_kmers(chromosomes.size());
+	{
+		ThreadPool threadPool (max(nr_threads, (size_t) 1));
+		for (size_t c = 0; c < chromosomes.size(); ++c) {
+			vector<ProfileKmer>* kmers = &chromosome_kmers[c];
+			string chromosome = chromosomes[c];
+			threadPool.submit([=](){
+				UniqueKmerComputer kmer_computer(genomic_kmer_counts, nullptr, variant_reader, chromosome, 0);
+				kmer_computer.compute_profile_kmers(kmers);
+			});
+		}
+	}
+	for (auto& kmers : chromosome_kmers) {
+		result->insert(result->end(), kmers.begin(), kmers.end());
+		vector<ProfileKmer>().swap(kmers);
+	}
+}
+
+void write_metrics(Metrics* metrics, double time_total, double time_writing, string outname) {
+	// runtime and memory metrics
+	metrics->set_value("total_wall_time", time_total);
+	metrics->set_value("total_cpu_time", Metrics::process_cpu_time());
+	metrics->set_value("peak_memory", Metrics::peak_memory());
+	metrics->set_value("writing_time", time_writing);
+	double nr_probabilities = metrics->get_value("copynumber_probabilities");
+	metrics->set_value("copynumber_probabilities_precomputed_rate", (nr_probabilities > 0) ? metrics->get_value("copynumber_probabilities_precomputed") / nr_probabilities : 0.0);
+	cerr << "Write runtime and memory metrics to " << outname << "_metrics.json ..." << endl;
+	metrics->write(outname + "_metrics.json");
+}
+
 int main (int argc, char* argv[])
 {
 	Timer timer;
-	double time_preprocessing;
-	double time_kmer_counting;
-	double time_unique_kmers;
-	double time_path_sampling;
-	double time_writing;
-	double time_total;
+	Metrics metrics;
+	double time_preprocessing = 0.0;
+	double time_kmer_counting = 0.0;
+	double time_genotyping = 0.0;
+	double time_path_sampling = 0.0;
+	double time_writing = 0.0;
+	double time_total = 0.0;
 
 	cerr << endl;
 	cerr << "program: PanGenie - genotyping and phasing based on kmer-counting and known haplotype sequences." << endl;
 	cerr << "author: Jana Ebler" << endl << endl;
 	string readfile = "";
+	vector<string> readfiles;
 	string reffile = "";
 	string vcffile = "";
     size_t kmersize = 31;
@@ -141,22 +447,33 @@ int main (int argc, char* argv[])
 	bool count_only_graph = true;
 	bool ignore_imputed = false;
 	bool add_reference = true;
-	string index_path = "";
+	string build_index_prefix = "";
+	string index_prefix = "";
+	vector<string> selected_chromosomes;
     size_t sampling_size = 0;
 	uint64_t hash_size = 3000000000;
+	bool estimate_hash_size = false;
+	double max_memory = 0.0;
+	bool write_profile = false;
+	string output_format = "vcf";
+	string biallelic_callset = "";
+	size_t window_size = 0;
+	size_t window_overlap = 100;
 
 	// parse the command line arguments
 	CommandLineParser argument_parser;
-	argument_parser.add_command("PanGenie [options] -i <reads.fa/fq> -r <reference.fa> -v <variants.vcf>");
-	argument_parser.add_mandatory_argument('i', "sequencing reads in FASTA/FASTQ format or Jellyfish database in jf format. NOTE: INPUT FASTA/Q FILE MUST NOT BE COMPRESSED.");
-	argument_parser.add_mandatory_argument('r', "reference genome in FASTA format. NOTE: INPUT FASTA FILE MUST NOT BE COMPRESSED.");
-	argument_parser.add_mandatory_argument('v', "variants in VCF format. NOTE: INPUT VCF FILE MUST NOT BE COMPRESSED.");
+	argument_parser.add_command("PanGenie [options] -i <reads.fa/fq[,reads2.fa/fq,...]> -r <reference.fa> -v <variants.vcf>");
+	argument_parser.add_optional_argument('i', "", "comma-separated list of files with sequencing reads in FASTA/FASTQ format (uncompressed, gzip, bgzip or zstd), Jellyfish database in jf format, KMC database (.kmc_pre/.kmc_suf, k <= 32) or kmer count profile (see -P). Use - to read from stdin.");
+	argument_parser.add_optional_argument('r', "", "reference genome in FASTA format (uncompressed, or bgzipped and indexed with samtools faidx). Not needed when genotyping with a prebuilt index (-I), which stores the reference sequences around the variants.");
+	argument_parser.add_mandatory_argument('v', "variants in VCF format (uncompressed or compressed with bgzip and indexed with tabix, .tbi or .csi).");
 	argument_parser.add_optional_argument('o', "result", "prefix of the output files. NOTE: the given path must not include non-existent folders.");
 	argument_parser.add_optional_argument('k', "31", "kmer size");
 	argument_parser.add_optional_argument('s', "sample", "name of the sample (will be used in the output VCFs)");
 	argument_parser.add_optional_argument('j', "1", "number of threads to use for kmer-counting");
-	argument_parser.add_optional_argument('t', "1", "number of threads to use for core algorithm. Largest number of threads possible is the number of chromosomes given in the VCF");
-    argument_parser.add_optional_argument('B',"","Build index but don't run PanGenie");
+	argument_parser.add_optional_argument('t', "1", "number of threads to use for core algorithm. Largest number of threads possible is the number of chromosomes given in the VCF (times the number of windows, see -w)");
+	argument_parser.add_optional_argument('B', "", "build the index from -v and -r, write it to <prefix>.index and <prefix>_path_segments.fasta and stop.");
+	argument_parser.add_optional_argument('I', "", "genotype using the index written by -B <prefix>. The reference (-r) is not needed, -v must be the VCF the index was built from.");
+	argument_parser.add_optional_argument('C', "", "comma-separated list of chromosomes to genotype (requires -I). Only the index shards of these chromosomes are loaded.");
 //	argument_parser.add_optional_argument('n', "0.00001", "effective population size");
 	argument_parser.add_flag_argument('g', "run genotyping (Forward backward algorithm, default behaviour).");
 	argument_parser.add_flag_argument('p', "run phasing (Viterbi algorithm). Experimental feature.");
@@ -165,7 +482,13 @@ int main (int argc, char* argv[])
 	argument_parser.add_flag_argument('u', "output genotype ./. for variants not covered by any unique kmers.");
 	argument_parser.add_flag_argument('d', "do not add reference as additional path.");
 	argument_parser.add_optional_argument('a', "0", "sample subsets of paths of this size.");
-	argument_parser.add_optional_argument('e', "3000000000", "size of hash used by jellyfish.");
+	argument_parser.add_optional_argument('e', "3000000000", "size of hash used by jellyfish, or \"auto\" to estimate it from the data.");
+	argument_parser.add_optional_argument('m', "0", "maximum memory (in GB) to use. PanGenie stops before counting if the jellyfish hashes would exceed it, and genotypes only as many chromosomes at a time as fit into it (0: no limit).");
+	argument_parser.add_flag_argument('P', "write counts of the kmers needed for genotyping to <prefix>.profile and stop. The profile can be given to -i to re-genotype without counting again.");
+	argument_parser.add_optional_argument('O', "vcf", "output format: vcf (uncompressed), vcf.gz (compressed with bgzip using -t threads, with tabix index) or bcf (with CSI index).");
+	argument_parser.add_optional_argument('b', "", "VCF (uncompressed or bgzipped) with the biallelic variants whose IDs the alleles in -v carry (INFO field ID). Genotypes are additionally written per variant ID to <prefix>_genotyping_biallelic.<format>.");
+	argument_parser.add_optional_argument('w', "0", "genotype chromosomes in windows of about this many variants (at least 2) in parallel, cut where neighboring variants are furthest apart (0: whole chromosomes). Results can differ slightly from genotyping whole chromosomes.");
+	argument_parser.add_optional_argument('W', "100", "number of variants added to both sides of each window (-w) as burn-in.");
     argument_parser.add_flag_argument('D', "debug");
 
 	try {
@@ -184,7 +507,9 @@ int main (int argc, char* argv[])
 	sample_name = argument_parser.get_argument('s');
 	nr_jellyfish_threads = stoi(argument_parser.get_argument('j'));
 	nr_core_threads = stoi(argument_parser.get_argument('t'));
-    index_path = argument_parser.get_flag('B');
+	build_index_prefix = argument_parser.get_argument('B');
+	index_prefix = argument_parser.get_argument('I');
+	selected_chromosomes = split_filenames(argument_parser.get_argument('C'));
 	
 	bool genotyping_flag = argument_parser.get_flag('g');
 	bool phasing_flag = argument_parser.get_flag('p');
@@ -204,143 +529,119 @@ int main (int argc, char* argv[])
 	ignore_imputed = argument_parser.get_flag('u');
 	add_reference = !argument_parser.get_flag('d');
 	sampling_size = stoi(argument_parser.get_argument('a'));
-	istringstream iss(argument_parser.get_argument('e'));
-	iss >> hash_size;
+	if (argument_parser.get_argument('e') == "auto") {
+		estimate_hash_size = true;
+	} else {
+		istringstream iss(argument_parser.get_argument('e'));
+		iss >> hash_size;
+	}
+	max_memory = stod(argument_parser.get_argument('m'));
+	write_profile = argument_parser.get_flag('P');
+	output_format = argument_parser.get_argument('O');
+	if ((output_format != "vcf") && (output_format != "vcf.gz") && (output_format != "bcf")) {
+		argument_parser.usage();
+		cerr << "Error: unknown output format " << output_format << " (-O)." << endl;
+		return 1;
+	}
+	biallelic_callset = argument_parser.get_argument('b');
+	window_size = stoi(argument_parser.get_argument('w'));
+	window_overlap = stoi(argument_parser.get_argument('W'));
+	if (window_size == 1) {
+		cerr << "Error: windows (-w) must contain at least 2 variants (0: whole chromosomes)." << endl;
+		return 1;
+	}
+	if (!biallelic_callset.empty() && only_phasing) {
+		cerr << "Error: biallelic output (-b) requires genotyping (-g)." << endl;
+		return 1;
+	}
 
 	// print info
 	cerr << "Files and parameters used:" << endl;
 	argument_parser.info();
-    VariantReader variant_reader;
-    vector<string> chromosomes;
-
-    //string segment_file = "pangenie.debug.fasta"; //"pangenie."+REF_VCF_HASH_NAME + ".path_segments.fasta";
-    string segment_file = index_path;//"pangenie."+REF_VCF_HASH_NAME + ".path_segments.fasta";
-    //string segment_file = outname + "_path_segments.fasta";
-    
-    check_input_file(vcffile);
-    check_input_file(reffile);
-
-    if (!index_path.empty()) {
-    // check if input files exist and are uncompressed
-
-	// read allele sequences and unitigs inbetween, write them into file
-	cerr << "Determine allele sequences ..." << endl;
-	VariantReader variant_reader2(vcffile, reffile, kmersize, add_reference, sample_name);
-	
-	// TODO: only for analysis
-	struct rusage r_usage00;
-	getrusage(RUSAGE_SELF, &r_usage00);
-	cerr << "#### Memory usage until now: " << (r_usage00.ru_maxrss / 1E6) << " GB ####" << endl;
-	
-	cerr << "Write path segments to file: " << segment_file << " ..." << endl;
-	variant_reader2.write_path_segments(segment_file);
-	// determine chromosomes present in VCF
-	variant_reader2.get_chromosomes(&chromosomes);
-	cerr << "Found " << chromosomes.size() << " chromosome(s) in the VCF." << endl;
-
-	// TODO: only for analysis
-	struct rusage r_usage0;
-	getrusage(RUSAGE_SELF, &r_usage0);
-	cerr << "#### Memory usage until now: " << (r_usage0.ru_maxrss / 1E6) << " GB ####" << endl;
-
-	time_preprocessing = timer.get_interval_time();
-    variant_reader2.Store();
-    std::cout << "stored" <<std::endl;
-    return 0;
-    }
-
-    else {
-    if (!argument_parser.get_flag('D')) {
-    readfile = argument_parser.get_argument('i');
-    check_input_file(readfile);
-    std::cout << "LOADING previous" <<std::endl;
-   
-    variant_reader.Load(vcffile);
-    variant_reader.fasta_reader.parse_file(reffile);
-    variant_reader.get_chromosomes(&chromosomes);
-    variant_reader.sample = sample_name;
-    }
-    }
-    
-
-	// UniqueKmers for each chromosome
-	UniqueKmersMap unique_kmers_list;
-	ProbabilityTable probabilities;
+	vector<string> chromosomes;
+	check_input_file(vcffile, true);
+	if (!biallelic_callset.empty()) check_input_file(biallelic_callset, true);
+	if (!index_prefix.empty() && !build_index_prefix.empty()) {
+		cerr << "Error: options -B and -I cannot be combined." << endl;
+		return 1;
+	}
+	if (!selected_chromosomes.empty() && index_prefix.empty()) {
+		cerr << "Error: chromosomes (-C) can only be selected when genotyping with a prebuilt index (-I)." << endl;
+		return 1;
+	}
 
-	{
-		KmerCounter* read_kmer_counts = nullptr;
-		// determine kmer copynumbers in reads
-		if (readfile.substr(std::max(3, (int) readfile.size())-3) == std::string(".jf")) {
-			cerr << "Read pre-computed read kmer counts ..." << endl;
-			jellyfish::mer_dna::k(kmersize);
-			read_kmer_counts = new JellyfishReader(readfile, kmersize);
-		} else {
-			cerr << "Count kmers in reads ..." << endl;
-			if (count_only_graph) {
-				read_kmer_counts = new JellyfishCounter(readfile, segment_file, kmersize, nr_jellyfish_threads, hash_size);
-            } else {
-				read_kmer_counts = new JellyfishCounter(readfile, kmersize, nr_jellyfish_threads, hash_size);
-			}
+	// path segments are stored next to the index. Without an index, they are generated from the
+	// panel whenever they are needed (see segment_path below) instead of being written to disk.
+	string segment_file = "";
+	if (!index_prefix.empty()) segment_file = index_prefix + "_path_segments.fasta";
+	if (!build_index_prefix.empty()) segment_file = build_index_prefix + "_path_segments.fasta";
+
+	unique_ptr<VariantReader> panel;
+	if (index_prefix.empty()) {
+		if (reffile.empty()) {
+			cerr << "Error: a reference genome (-r) is required unless a prebuilt index is given (-I)." << endl;
+			return 1;
 		}
-
-		size_t kmer_abundance_peak = read_kmer_counts->computeHistogram(10000, count_only_graph, outname + "_histogram.histo");
-		cerr << "Computed kmer abundance peak: " << kmer_abundance_peak << endl;
-
-		// count kmers in allele + reference sequence
-		cerr << "Count kmers in genome ..." << endl;
-		JellyfishCounter genomic_kmer_counts (segment_file, kmersize, nr_jellyfish_threads, hash_size);
-
-		// TODO: only for analysis
-		struct rusage r_usage1;
-		getrusage(RUSAGE_SELF, &r_usage1);
-		cerr << "#### Memory usage until now: " << (r_usage1.ru_maxrss / 1E6) << " GB ####" << endl;
-		
-        // prepare output files
-		if (! only_phasing) variant_reader.open_genotyping_outfile(outname + "_genotyping.vcf");
-		if (! only_genotyping) variant_reader.open_phasing_outfile(outname + "_phasing.vcf");
-
-		time_kmer_counting = timer.get_interval_time();
-        
-		cerr << "Determine unique kmers ..." << endl;
-		// determine number of cores to use
-		size_t available_threads_uk = min(thread::hardware_concurrency(), (unsigned int) chromosomes.size());
-		size_t nr_cores_uk = min(nr_core_threads, available_threads_uk);
-		if (nr_cores_uk < nr_core_threads) {
-			cerr << "Warning: using " << nr_cores_uk << " cores for determining unique kmers." << endl;
+		check_input_file(reffile, true);
+
+		// read allele sequences and unitigs inbetween, write them into file
+		cerr << "Determine allele sequences ..." << endl;
+		panel = unique_ptr<VariantReader>(new VariantReader(vcffile, reffile, kmersize, add_reference, sample_name, max(nr_core_threads, nr_jellyfish_threads)));
+
+		if (!build_index_prefix.empty()) {
+			cerr << "Write path segments to file: " << segment_file << " ..." << endl;
+			panel->write_path_segments(segment_file);
+			string index_file = build_index_prefix + ".index";
+			cerr << "Write index to file: " << index_file << " ..." << endl;
+			panel->Store(index_file, vcffile, reffile, max(nr_core_threads, nr_jellyfish_threads));
+			time_preprocessing = metrics.end_stage("building index");
+			cerr << "time spent building the index:\t" << time_preprocessing << " sec" << endl;
+			write_metrics(&metrics, timer.get_total_time(), time_writing, outname);
+			return 0;
 		}
-
-		// precompute probabilities
-		probabilities = ProbabilityTable(kmer_abundance_peak / 4, kmer_abundance_peak*4, 2*kmer_abundance_peak, regularization);
-
-		{
-			// create thread pool with at most nr_chromosomes threads
-			ThreadPool threadPool (nr_cores_uk);
-			for (auto chromosome : chromosomes) {
-				VariantReader* variants = &variant_reader;
-				UniqueKmersMap* result = &unique_kmers_list;
-				KmerCounter* genomic_counts = &genomic_kmer_counts;
-				ProbabilityTable* probs = &probabilities;
-				function<void()> f_unique_kmers = bind(prepare_unique_kmers, chromosome, genomic_counts, read_kmer_counts, variants, probs, result, kmer_abundance_peak);
-				threadPool.submit(f_unique_kmers);
-			}
+	} else {
+		string index_file = index_prefix + ".index";
+		check_input_file(index_file);
+		check_input_file(segment_file);
+		cerr << "Read index " << index_file << " ..." << endl;
+		panel = unique_ptr<VariantReader>(new VariantReader());
+		try {
+			panel->Load(index_file, kmersize, add_reference, vcffile, reffile, selected_chromosomes, nr_core_threads);
+		} catch (const runtime_error& e) {
+			cerr << "Error: " << e.what() << endl;
+			return 1;
 		}
+		panel->sample = sample_name;
+	}
+	VariantReader& variant_reader = *panel;
+	// each call returns a path from which the path segments can be read once
+	ReadStreams segment_streams({});
+	auto segment_path = [&segment_file, &segment_streams, &variant_reader]() -> string {
+		if (!segment_file.empty()) return segment_file;
+		return segment_streams.add_generator([&variant_reader](const function<void(const char*, size_t)>& write) {
+			variant_reader.write_path_segments(write);
+		});
+	};
+	// determine chromosomes present in VCF
+	variant_reader.get_chromosomes(&chromosomes);
+	cerr << "Found " << chromosomes.size() << " chromosome(s) in the VCF." << endl;
 
-		// TODO: only for analysis
-		struct rusage r_usage2;
-		getrusage(RUSAGE_SELF, &r_usage2);
-		cerr << "#### Memory usage until now: " << (r_usage2.ru_maxrss / 1E6) << " GB ####" << endl;
-
-		delete read_kmer_counts;
-		read_kmer_counts = nullptr;
-		time_unique_kmers = timer.get_interval_time();
+	if (!argument_parser.get_flag('D')) {
+		readfile = argument_parser.get_argument('i');
+		readfiles = split_filenames(readfile);
+		if (readfiles.empty()) {
+			cerr << "Error: no read files given (-i)." << endl;
+			return 1;
+		}
+		for (auto& f : readfiles) {
+			// stdin and named pipes can only be read once, so they are not opened here
+			if (!ReadStreams::is_stream(f)) check_input_file(f, true);
+		}
 	}
+	// reading the VCF and reference, or the index
+	time_preprocessing = metrics.end_stage("reading input");
 
-	// TODO: only for analysis
-	struct rusage r_usage3;
-	getrusage(RUSAGE_SELF, &r_usage3);
-	cerr << "#### Memory usage until now: " << (r_usage3.ru_maxrss / 1E6) << " GB ####" << endl;
-	
-    // prepare subsets of paths to run on
+	// prepare subsets of paths to run on
 	unsigned short nr_paths = variant_reader.nr_of_paths();
 	// TODO: for too large panels, print waring
 	if (nr_paths > 200) cerr << "Warning: panel is large and PanGenie might take a long time genotyping. Try reducing the panel size prior to genotyping." << endl;
@@ -372,80 +673,309 @@ int main (int argc, char* argv[])
 	unsigned short nr_phasing_paths = min((unsigned short) nr_paths, (unsigned short) 30);
 	path_sampler.select_single_subset(phasing_paths, nr_phasing_paths);
 	if (!only_genotyping) cerr << "Sampled " << phasing_paths.size() << " paths to be used for phasing." << endl;
-	time_path_sampling = timer.get_interval_time();
-	
-	// TODO: only for analysis
-	struct rusage r_usage30;
-	getrusage(RUSAGE_SELF, &r_usage30);
-	cerr << "#### Memory usage until now: " << (r_usage30.ru_maxrss / 1E6) << " GB ####" << endl;
-
-	cerr << "Construct HMM and run core algorithm ..." << endl;
+	time_path_sampling = metrics.end_stage("selecting paths");
 
-	// determine max number of available threads for genotyping (at most one thread per chromosome and subsample possible)
-	size_t available_threads = min(thread::hardware_concurrency(), (unsigned int) chromosomes.size() * (unsigned int) subsets.size());
-	if (nr_core_threads > available_threads) {
-		cerr << "Warning: using " << available_threads << " for genotyping." << endl;
-		nr_core_threads = available_threads;
-	}
-
-	// run genotyping
+	// UniqueKmers for each chromosome
+	UniqueKmersMap unique_kmers_list;
+	ProbabilityTable probabilities;
 	Results results;
+	ChromosomeOutput output;
+	vector<string> output_files;
+	string output_error;
+
 	{
-		// create thread pool
-		ThreadPool threadPool (nr_core_threads);
-		for (auto chromosome : chromosomes) {
-			vector<UniqueKmers*>* unique_kmers = &unique_kmers_list.unique_kmers[chromosome];
-			ProbabilityTable* probs = &probabilities;
-			Results* r = &results;
-			// if requested, run phasing first
-			if (!only_genotyping) {
-				vector<unsigned short>* only_paths = &phasing_paths;
-				function<void()> f_genotyping = bind(run_genotyping, chromosome, unique_kmers, probs, false, true, effective_N, only_paths, r);
-				threadPool.submit(f_genotyping);
-			}
+		bool profile_input = (readfiles.size() == 1) && !ReadStreams::is_stream(readfile) && KmerProfile::is_profile(readfile);
+		bool kmc_counts = (readfiles.size() == 1) && KmcReader::is_kmc_database(readfile);
+		bool precomputed_counts = kmc_counts || ((readfiles.size() == 1) && (readfile.substr(std::max(3, (int) readfile.size())-3) == std::string(".jf")));
+		if (kmc_counts && (kmersize > 32)) {
+			cerr << "Error: KMC databases can only be used for kmer sizes of at most 32." << endl;
+			return 1;
+		}
+		uint64_t read_hash_size = hash_size;
+		uint64_t genomic_hash_size = hash_size;
+		if (estimate_hash_size && !profile_input) {
+			cerr << "Estimate jellyfish hash sizes ..." << endl;
+			estimate_hash_sizes(segment_path(), readfiles, kmersize, count_only_graph || precomputed_counts, read_hash_size, genomic_hash_size);
+			cerr << "Using hash sizes: " << read_hash_size << " (reads), " << genomic_hash_size << " (genome)" << endl;
+		}
 
-			if (!only_phasing) {
-				// if requested, run genotying
-				for (size_t s = 0; s < subsets.size(); ++s){
-					vector<unsigned short>* only_paths = &subsets[s];
-					function<void()> f_genotyping = bind(run_genotyping, chromosome, unique_kmers, probs, true, false, effective_N, only_paths, r);
-					threadPool.submit(f_genotyping);
-				}
+		// make sure the hashes fit into the given memory limit before starting to count
+		size_t hash_memory = 0;
+		if (!profile_input) hash_memory += JellyfishCounter::estimate_memory(genomic_hash_size, kmersize);
+		if (!profile_input && !precomputed_counts) hash_memory += JellyfishCounter::estimate_memory(read_hash_size, kmersize);
+		if ((max_memory > 0.0) && (hash_memory > max_memory * 1E9)) {
+			cerr << "Error: jellyfish hashes would require about " << (hash_memory / 1E9) << " GB, which exceeds the memory limit of " << max_memory << " GB given by -m. Use a smaller hash size (-e) or increase the limit." << endl;
+			return 1;
+		}
+
+		KmerCounter* read_kmer_counts = nullptr;
+		KmerCounter* genomic_kmer_counts = nullptr;
+		KmerProfile* profile = nullptr;
+		// kmers queried during genotyping
+		vector<ProfileKmer> profile_kmers;
+		// determine kmer copynumbers in reads
+		if (profile_input) {
+			cerr << "Read kmer counts from profile ..." << endl;
+			profile = new KmerProfile(readfile);
+			if (profile->get_kmer_size() != kmersize) {
+				cerr << "Error: kmer size of profile (" << profile->get_kmer_size() << ") does not match the given kmer size (" << kmersize << ")." << endl;
+				return 1;
+			}
+			// counts of kmers that are not in the profile would silently be 0
+			if (profile->get_panel_fingerprint() != variant_reader.get_fingerprint(chromosomes, nr_core_threads)) {
+				cerr << "Error: profile " << readfile << " was computed for a different panel (VCF/index, reference or chromosomes) than the one given." << endl;
+				return 1;
+			}
+			jellyfish::mer_dna::k(kmersize);
+			read_kmer_counts = new ProfileKmerCounter(profile, false);
+			genomic_kmer_counts = new ProfileKmerCounter(profile, true);
+		} else if (precomputed_counts && (kmersize <= 32)) {
+			// only keep the counts of kmers that are queried later, so that lookups do not need to search the database
+			cerr << "Count kmers in genome ..." << endl;
+			genomic_kmer_counts = new JellyfishCounter(segment_path(), kmersize, nr_jellyfish_threads, genomic_hash_size);
+			collect_profile_kmers(chromosomes, &variant_reader, genomic_kmer_counts, nr_core_threads, &profile_kmers);
+			vector<uint64_t> kmers;
+			kmers.reserve(profile_kmers.size());
+			for (auto& kmer : profile_kmers) kmers.push_back(kmer.kmer);
+			cerr << "Read pre-computed read kmer counts ..." << endl;
+			jellyfish::mer_dna::k(kmersize);
+			if (kmc_counts) {
+				read_kmer_counts = new KmcReader(KmcReader::database_name(readfile), kmersize, kmers, nr_jellyfish_threads);
+			} else {
+				read_kmer_counts = new JellyfishReader(readfile, kmersize, kmers, nr_jellyfish_threads);
+			}
+		} else if (precomputed_counts) {
+			cerr << "Read pre-computed read kmer counts ..." << endl;
+			jellyfish::mer_dna::k(kmersize);
+			read_kmer_counts = new JellyfishReader(readfile, kmersize);
+		} else {
+			cerr << "Count kmers in reads ..." << endl;
+			if (count_only_graph) {
+				read_kmer_counts = new JellyfishCounter(readfiles, segment_path(), kmersize, nr_jellyfish_threads, read_hash_size);
+            } else {
+				read_kmer_counts = new JellyfishCounter(readfiles, kmersize, nr_jellyfish_threads, read_hash_size);
 			}
 		}
-	}
 
-	// in case genotyping was run, normalize the combined likelihoods
-	if (!only_phasing){
+		size_t kmer_abundance_peak = read_kmer_counts->computeHistogram(10000, count_only_graph, outname + "_histogram.histo");
+		cerr << "Computed kmer abundance peak: " << kmer_abundance_peak << endl;
+
+		// count kmers in allele + reference sequence (contained in the profile if one is given)
+		if (genomic_kmer_counts == nullptr) {
+			cerr << "Count kmers in genome ..." << endl;
+			genomic_kmer_counts = new JellyfishCounter(segment_path(), kmersize, nr_jellyfish_threads, genomic_hash_size);
+		}
+		// rethrow errors that occurred while generating the path segments
+		segment_streams.finish();
+
+		if (write_profile) {
+			// collect the kmers needed for genotyping and store their counts
+			cerr << "Write kmer count profile to " << outname << ".profile ..." << endl;
+			if (profile_kmers.empty()) collect_profile_kmers(chromosomes, &variant_reader, genomic_kmer_counts, nr_core_threads, &profile_kmers);
+			KmerProfile result_profile(kmersize, profile_kmers);
+			result_profile.set_read_counts(read_kmer_counts, nr_jellyfish_threads);
+			result_profile.set_kmer_abundance_peak(kmer_abundance_peak);
+			result_profile.set_panel_fingerprint(variant_reader.get_fingerprint(chromosomes, nr_core_threads));
+			result_profile.write(outname + ".profile");
+			cerr << "Wrote counts of " << result_profile.size() << " kmers." << endl;
+			delete read_kmer_counts;
+			delete genomic_kmer_counts;
+			delete profile;
+			write_metrics(&metrics, timer.get_total_time(), time_writing, outname);
+			return 0;
+		}
+
+        // prepare output files
+		if (! only_phasing) output_files.push_back(outname + "_genotyping." + output_format);
+		if (! only_genotyping) output_files.push_back(outname + "_phasing." + output_format);
+		if (! biallelic_callset.empty()) output_files.push_back(outname + "_genotyping_biallelic." + output_format);
+		if (! only_phasing) variant_reader.open_genotyping_outfile(outname + "_genotyping." + output_format, nr_core_threads);
+		if (! only_genotyping) variant_reader.open_phasing_outfile(outname + "_phasing." + output_format, nr_core_threads);
+		if (! biallelic_callset.empty()) variant_reader.open_biallelic_outfile(outname + "_genotyping_biallelic." + output_format, biallelic_callset, nr_core_threads);
+
+		time_kmer_counting = metrics.end_stage("counting kmers");
+		metrics.set_value("kmer_abundance_peak", kmer_abundance_peak);
+
+		// precompute probabilities
+		probabilities = ProbabilityTable(kmer_abundance_peak / 4, kmer_abundance_peak*4, 2*kmer_abundance_peak, regularization);
+
+		cerr << "Determine unique kmers, construct HMM and run core algorithm ..." << endl;
+
+		// determine max number of available threads for genotyping (at most one thread per chromosome, window and subsample possible)
+		WindowSplitter window_splitter (window_size, window_overlap);
+		map<string, size_t> windows_per_chromosome;
+		size_t nr_windows = 0;
 		for (auto chromosome : chromosomes) {
-			for (size_t i = 0; i < results.result.at(chromosome).size(); ++i) {
-				results.result.at(chromosome).at(i).normalize();
+			vector<size_t> positions;
+			for (size_t i = 0; i < variant_reader.size_of(chromosome); ++i) {
+				positions.push_back(variant_reader.get_variant(chromosome, i).get_start_position());
 			}
+			windows_per_chromosome[chromosome] = window_splitter.nr_windows(positions);
+			nr_windows += windows_per_chromosome[chromosome];
+		}
+		size_t available_threads = min((size_t) thread::hardware_concurrency(), nr_windows * subsets.size());
+		if (nr_core_threads > available_threads) {
+			cerr << "Warning: using " << available_threads << " for genotyping." << endl;
+			nr_core_threads = available_threads;
 		}
-	}
-
-	timer.get_interval_time();
 
-	// output VCF
-	cerr << "Write results to VCF ..." << endl;
-	if (!(only_genotyping && only_phasing)) assert (results.result.size() == chromosomes.size());
-	// write VCF
-	for (auto it = results.result.begin(); it != results.result.end(); ++it) {
-		if (!only_phasing) {
-			// output genotyping results
-			
-			variant_reader.write_genotypes_of(it->first, it->second, &unique_kmers_list.unique_kmers[it->first], ignore_imputed);
+		// Unique kmers and genotyping run as one task graph: the unique kmers of a chromosome feed its
+		// genotyping/phasing runs, the last of which prepares the chromosome's output (see run_chromosome).
+		// Small chromosomes are thus genotyped and written while large ones are still being processed.
+		for (auto chromosome : chromosomes) {
+			results.pending[chromosome] = (only_genotyping ? 0 : 1) + (only_phasing ? 0 : subsets.size());
 		}
-		if (!only_genotyping) {
-			// output phasing results
-			variant_reader.write_phasing_of(it->first, it->second, &unique_kmers_list.unique_kmers[it->first], ignore_imputed);
+		output.variant_reader = &variant_reader;
+		output.unique_kmers_map = &unique_kmers_list;
+		output.normalize = !only_phasing;
+		output.ignore_imputed = ignore_imputed;
+		ChromosomeStage stage;
+		stage.metrics = &metrics;
+		stage.variant_reader = &variant_reader;
+		stage.genomic_kmer_counts = genomic_kmer_counts;
+		stage.read_kmer_counts = read_kmer_counts;
+		stage.kmer_coverage = kmer_abundance_peak;
+		stage.probs = &probabilities;
+		stage.subsets = only_phasing ? nullptr : &subsets;
+		stage.phasing_paths = only_genotyping ? nullptr : &phasing_paths;
+		stage.effective_N = effective_N;
+		stage.window_splitter = &window_splitter;
+		stage.unique_kmers_map = &unique_kmers_list;
+		stage.results = &results;
+		stage.output = &output;
+		stage.pending_unique_kmers = chromosomes.size();
+		// chromosomes are written in the order of their names
+		vector<string> output_chromosomes = chromosomes;
+		sort(output_chromosomes.begin(), output_chromosomes.end());
+
+		// with a memory limit, chromosomes are admitted in output order while their estimated memory fits into
+		// what is left of the limit, and their memory counts as released once they are written. The memory of
+		// the kmer counts is added to what is left once they are released. At least one chromosome is always
+		// being processed, and no chromosome waits for the output of one not yet admitted.
+		vector<size_t> chromosome_memory(output_chromosomes.size(), 0);
+		size_t memory_budget = 0;
+		if (max_memory > 0.0) {
+			size_t memory_used = Metrics::current_memory();
+			memory_budget = (max_memory * 1E9 > memory_used) ? (size_t) (max_memory * 1E9) - memory_used : 0;
+			size_t nr_hmm_paths = only_phasing ? phasing_paths.size() : max((size_t) sampling_size, only_genotyping ? 0 : phasing_paths.size());
+			size_t total_memory = 0;
+			for (size_t c = 0; c < output_chromosomes.size(); ++c) {
+				size_t nr_variants = variant_reader.size_of(output_chromosomes[c]);
+				size_t nr_runs = (only_genotyping ? 0 : 1) + (only_phasing ? 0 : subsets.size() * windows_per_chromosome.at(output_chromosomes[c]));
+				size_t run_variants = window_splitter.max_window_variants(nr_variants);
+				chromosome_memory[c] = estimate_chromosome_memory(variant_reader, output_chromosomes[c], nr_paths, nr_hmm_paths, min(nr_runs, nr_core_threads), run_variants);
+				total_memory += chromosome_memory[c];
+			}
+			cerr << "Estimated memory needed to genotype all chromosomes at once: " << (total_memory / 1E9) << " GB, available within the memory limit: " << (memory_budget / 1E9) << " GB." << endl;
 		}
+		time_writing = 0.0;
+		{
+			// the most expensive chromosomes are started first (longest job first), so that the tail is short
+			TaskScheduler scheduler (nr_core_threads);
+			stage.scheduler = &scheduler;
+			// admission is triggered by the main thread (a chromosome was written) and by the task releasing the kmer counts
+			mutex admission_mutex;
+			size_t nr_admitted = 0;
+			size_t admitted_memory = 0;
+			auto admit_chromosomes = [&]() {
+				lock_guard<mutex> lock (admission_mutex);
+				// no further chromosomes are admitted once the output failed
+				if (output.cancelled) return;
+				while (nr_admitted < output_chromosomes.size()) {
+					size_t memory = chromosome_memory[nr_admitted];
+					if ((admitted_memory > 0) && (admitted_memory + memory > memory_budget)) break;
+					string chromosome = output_chromosomes[nr_admitted];
+					// the HMM is quadratic in the number of paths
+					double cost = (double) variant_reader.size_of(chromosome) * sampling_size * sampling_size * subsets.size();
+					ChromosomeStage* s = &stage;
+					function<void()> f_chromosome = bind(run_chromosome, chromosome, s);
+					scheduler.submit(bind(run_guarded, f_chromosome, chromosome, &output), cost);
+					admitted_memory += memory;
+					nr_admitted += 1;
+				}
+			};
+			// the kmer counts are no longer needed once the unique kmers of all chromosomes are known
+			stage.release_counts = [&]() {
+				delete read_kmer_counts;
+				read_kmer_counts = nullptr;
+				delete genomic_kmer_counts;
+				genomic_kmer_counts = nullptr;
+				delete profile;
+				profile = nullptr;
+				if (max_memory > 0.0) {
+					{
+						lock_guard<mutex> lock (admission_mutex);
+						memory_budget += hash_memory;
+					}
+					admit_chromosomes();
+				}
+			};
+			admit_chromosomes();
+
+			// output VCF
+			cerr << "Write results to VCF as chromosomes complete ..." << endl;
+			try {
+				for (size_t c = 0; c < output_chromosomes.size(); ++c) {
+					string chromosome = output_chromosomes[c];
+					VariantReader::FormattedResults formatted;
+					{
+						unique_lock<mutex> lock (output.output_mutex);
+						output.output_changed.wait(lock, [&output, &chromosome](){ return (output.formatted.find(chromosome) != output.formatted.end()) || (output.errors.find(chromosome) != output.errors.end()); });
+						if (output.errors.find(chromosome) != output.errors.end()) rethrow_exception(output.errors.at(chromosome));
+						formatted = move(output.formatted.at(chromosome));
+						output.formatted.erase(chromosome);
+					}
+					Timer write_timer;
+					variant_reader.write_formatted(formatted);
+					time_writing += write_timer.get_total_time();
+					// the chromosome is done, make room for the next ones
+					{
+						lock_guard<mutex> lock (admission_mutex);
+						admitted_memory -= chromosome_memory[c];
+					}
+					admit_chromosomes();
+				}
+			} catch (const exception& e) {
+				// no further chromosomes are admitted, tasks not yet started are skipped
+				output.cancelled = true;
+				output_error = e.what();
+			} catch (...) {
+				output.cancelled = true;
+				output_error = "unknown error while genotyping.";
+			}
+			// the last tasks may still be finishing
+			scheduler.wait();
+			metrics.set_value("threads", scheduler.nr_of_threads());
+			metrics.set_value("thread_busy_time", scheduler.busy_time());
+		}
+		if (output.cancelled) {
+			delete read_kmer_counts;
+			delete genomic_kmer_counts;
+			delete profile;
+			cerr << "Error: " << output_error << endl;
+			// do not leave incomplete output files behind
+			if (! only_phasing) variant_reader.close_genotyping_outfile();
+			if (! only_genotyping) variant_reader.close_phasing_outfile();
+			if (! biallelic_callset.empty()) variant_reader.close_biallelic_outfile();
+			for (auto filename : output_files) {
+				remove(filename.c_str());
+				remove((filename + ".tbi").c_str());
+				remove((filename + ".csi").c_str());
+			}
+			return 1;
+		}
+		time_genotyping = metrics.end_stage("unique kmers and genotyping");
+		metrics.set_value("thread_utilization", metrics.get_value("thread_busy_time") / (metrics.get_value("threads") * max(time_genotyping, 1E-9)));
+		delete read_kmer_counts;
+		delete genomic_kmer_counts;
+		delete profile;
 	}
 
 	if (! only_phasing) variant_reader.close_genotyping_outfile();
 	if (! only_genotyping) variant_reader.close_phasing_outfile();
+	if (! biallelic_callset.empty()) variant_reader.close_biallelic_outfile();
 
-	time_writing = timer.get_interval_time();
+	time_writing += metrics.end_stage("closing output files");
 	time_total = timer.get_total_time();
 
 	cerr << endl << "###### Summary ######" << endl;
@@ -453,21 +983,21 @@ int main (int argc, char* argv[])
 	cerr << "time spent reading input files:\t" << time_preprocessing << " sec" << endl;
 	cerr << "time spent counting kmers: \t" << time_kmer_counting << " sec" << endl;
 	cerr << "time spent selecting paths: \t" << time_path_sampling << " sec" << endl;
-	cerr << "time spent determining unique kmers: \t" << time_unique_kmers << " sec" << endl; 
+	cerr << "time spent determining unique kmers and genotyping (overlapping): \t" << time_genotyping << " sec" << endl;
 	// output per chromosome time
-	double time_hmm = time_writing;
+	double time_hmm = 0.0;
 	for (auto chromosome : chromosomes) {
 		double time_chrom = results.runtimes[chromosome] + unique_kmers_list.runtimes[chromosome];
 		cerr << "time spent genotyping chromosome " << chromosome << ":\t" << time_chrom << endl;
 		time_hmm += time_chrom;
 	}
-	cerr << "total running time:\t" << time_preprocessing + time_kmer_counting + time_path_sampling + time_unique_kmers +  time_hmm + time_writing << " sec"<< endl;
+	cerr << "total running time:\t" << time_preprocessing + time_kmer_counting + time_path_sampling + time_hmm + time_writing << " sec"<< endl;
 	cerr << "total wallclock time: " << time_total  << " sec" << endl;
 
 	// memory usage
-	struct rusage r_usage;
-	getrusage(RUSAGE_SELF, &r_usage);
-	cerr << "Total maximum memory usage: " << (r_usage.ru_maxrss / 1E6) << " GB" << endl;
+	cerr << "Total maximum memory usage: " << (Metrics::peak_memory() / 1E9) << " GB" << endl;
+
+	write_metrics(&metrics, time_total, time_writing, outname);
 
 	// destroy UniqueKmers
 	for (auto it = unique_kmers_list.unique_kmers.begin(); it != unique_kmers_list.unique_kmers.end(); ++it){
@@ -44,8 +44,12 @@ ProbabilityTable::ProbabilityTable(unsigned short cov_min, unsigned short cov_ma
 	}
 }
 
+bool ProbabilityTable::contains (unsigned short kmer_coverage, unsigned short read_kmer_count) const {
+	return (kmer_coverage >= this->cov_min) && (kmer_coverage < this->cov_max) && (read_kmer_count < this->count_max);
+}
+
 CopyNumber ProbabilityTable::get_probability (unsigned short kmer_coverage, unsigned short read_kmer_count) const {
-	if ((kmer_coverage >= this->cov_min) && (kmer_coverage < this->cov_max) && (read_kmer_count < this->count_max)) {
+	if (contains(kmer_coverage, read_kmer_count)) {
 		return this->probabilities.at(read_kmer_count).at(kmer_coverage - this->cov_min);
 	} else {
 		return compute_probability(kmer_coverage, read_kmer_count);
@@ -14,6 +14,8 @@ public:
 	ProbabilityTable();
 	ProbabilityTable(unsigned short cov_min, unsigned short cov_max, unsigned short count_max, long double regularization_const);
 	CopyNumber get_probability (unsigned short kmer_coverage, unsigned short read_kmer_count) const;
+	/** true if the probability is pre-computed, false if get_probability computes it on the fly **/
+	bool contains (unsigned short kmer_coverage, unsigned short read_kmer_count) const;
 	/** function can be used to modify probabilities stored in the table. Mainly used for testing purposes. **/
 	void modify_probability(unsigned short kmer_coverage, unsigned short read_kmer_count, CopyNumber prob);
 	friend std::ostream& operator<<(std::ostream& os, const ProbabilityTable& table);
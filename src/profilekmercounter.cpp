@@ -0,0 +1,76 @@
+#include "profilekmercounter.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <math.h>
+#include "histogram.hpp"
+
+using namespace std;
+
+ProfileKmerCounter::ProfileKmerCounter(const KmerProfile* profile, bool genomic)
+	:profile(profile),
+	 genomic(genomic)
+{}
+
+size_t ProfileKmerCounter::getKmerAbundance(string kmer) {
+	jellyfish::mer_dna jelly_kmer(kmer);
+	return this->getKmerAbundance(jelly_kmer);
+}
+
+size_t ProfileKmerCounter::getKmerAbundance(jellyfish::mer_dna jelly_kmer) {
+	uint64_t code = KmerProfile::encode_kmer(jelly_kmer);
+	if (this->genomic) return this->profile->get_genomic_count(code);
+	return this->profile->get_read_count(code);
+}
+
+size_t ProfileKmerCounter::computeKmerCoverage(size_t genome_kmers) {
+	long double result = 0.0L;
+	for (size_t i = 0; i < this->profile->size(); ++i) {
+		result += (1.0L * this->profile->get_read_count_at(i)) / (1.0L * genome_kmers);
+	}
+	return (size_t) ceil(result);
+}
+
+size_t ProfileKmerCounter::computeHistogram(size_t max_count, [[maybe_unused]] bool largest_peak, string filename) {
+	size_t peak = this->profile->get_kmer_abundance_peak();
+	if (peak > 0) {
+		cerr << "Kmer abundance peak stored in profile: " << peak << endl;
+		return peak;
+	}
+	// no peak stored (e.g. merged profile), use the histogram of the profile kmers
+	Histogram histogram(max_count);
+	for (size_t i = 0; i < this->profile->size(); ++i) {
+		size_t count = this->profile->get_read_count_at(i);
+		if (count > 0) histogram.add_value(count);
+	}
+	if (filename != "") {
+		histogram.write_to_file(filename);
+	}
+	histogram.smooth_histogram();
+	vector<size_t> peak_ids;
+	vector<size_t> peak_values;
+	histogram.find_peaks(peak_ids, peak_values);
+	if (peak_ids.size() == 0) {
+		throw runtime_error("ProfileKmerCounter::computeHistogram: no peak found in kmer-count histogram.");
+	}
+	// profile kmers are mostly unique in the genome, the largest peak corresponds to the kmer coverage
+	size_t largest = 0;
+	for (size_t i = 0; i < peak_ids.size(); ++i) {
+		if (peak_values[i] > peak_values[largest]) largest = i;
+	}
+	cerr << "Histogram peak: " << peak_ids[largest] << " (" << peak_values[largest] << ")" << endl;
+	peak = peak_ids[largest];
+	if (filename != "") {
+		ofstream histofile;
+		histofile.open(filename, ios::app);
+		if (!histofile.good()) {
+			stringstream ss;
+			ss << "ProfileKmerCounter::computeHistogram: File " << filename << " cannot be created. Note that the filename must not contain non-existing directories." << endl;
+			throw runtime_error(ss.str());
+		}
+		histofile << "parameters\t" << peak/2.0 << '\t' << peak << endl;
+		histofile.close();
+	}
+	return peak;
+}
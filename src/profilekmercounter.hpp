@@ -0,0 +1,42 @@
+#ifndef PROFILEKMERCOUNTER_HPP
+#define PROFILEKMERCOUNTER_HPP
+
+#include <string>
+#include <jellyfish/mer_dna.hpp>
+#include "kmercounter.hpp"
+#include "kmerprofile.hpp"
+
+/**
+* Provides the read or genomic kmer counts stored in a KmerProfile.
+**/
+
+class ProfileKmerCounter : public KmerCounter {
+public:
+	/**
+	* @param profile kmer profile
+	* @param genomic if true, provide genomic counts instead of read counts
+	**/
+	ProfileKmerCounter(const KmerProfile* profile, bool genomic);
+
+	/** get the abundance of given kmer (string) **/
+	size_t getKmerAbundance(std::string kmer);
+
+	/** get the abundance of given kmer (jellyfish kmer) **/
+	size_t getKmerAbundance(jellyfish::mer_dna jelly_kmer);
+
+	/** compute the kmer coverage relative to the number of kmers in the genome **/
+	size_t computeKmerCoverage(size_t genome_kmers);
+
+	/**
+	* returns the kmer abundance peak stored in the profile. If there is none, it is computed from the counts of the profile kmers.
+	* largest_peak (set by -c) is ignored: the stored peak was determined from the histogram of all counted kmers with the
+	* setting used when the profile was written, and profile kmers are graph kmers, whose largest peak is the coverage.
+	**/
+	size_t computeHistogram(size_t max_count, bool largest_peak, std::string filename = "");
+
+private:
+	const KmerProfile* profile;
+	bool genomic;
+};
+
+#endif // PROFILEKMERCOUNTER_HPP
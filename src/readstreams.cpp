@@ -0,0 +1,390 @@
+#include "readstreams.hpp"
+#include <fstream>
+#include <stdexcept>
+#include <chrono>
+#include <algorithm>
+#include <memory>
+#include <exception>
+#include <condition_variable>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+#ifdef PANGENIE_ZSTD
+#include <zstd.h>
+#endif
+#include "bgzfreader.hpp"
+#include "threadpool.hpp"
+
+using namespace std;
+
+static void write_all(int fd, const char* data, size_t size) {
+	while (size > 0) {
+		ssize_t written = write(fd, data, size);
+		if (written < 0) {
+			if (errno == EINTR) continue;
+			throw runtime_error("ReadStreams: stream was closed before all data was written (" + string(strerror(errno)) + ").");
+		}
+		data += written;
+		size -= written;
+	}
+}
+
+ReadStreams::ReadStreams(vector<string> filenames, size_t nr_threads)
+	:nr_threads(max(nr_threads, (size_t) 1)),
+	 cancelled(false)
+{
+	vector<Compression> compressions;
+	size_t nr_stdin = 0;
+	for (auto& filename : filenames) {
+		if (is_stream(filename)) {
+			// streams cannot be inspected without consuming them. zlib passes
+			// uncompressed data through, so they are read like gzip files.
+			if (filename == "-") nr_stdin += 1;
+			compressions.push_back(Compression::GZIP);
+			continue;
+		}
+		Compression compression = get_compression(filename);
+#ifndef PANGENIE_ZSTD
+		if (compression == Compression::ZSTD) {
+			throw runtime_error("ReadStreams::ReadStreams: file " + filename + " is zstd-compressed, but PanGenie was compiled without zstd support.");
+		}
+#endif
+		compressions.push_back(compression);
+	}
+	if (nr_stdin > 1) {
+		throw runtime_error("ReadStreams::ReadStreams: stdin (-) can only be given once.");
+	}
+
+	// create a named pipe for each compressed file
+	for (size_t i = 0; i < filenames.size(); ++i) {
+		if (compressions[i] == Compression::NONE) {
+			this->paths.push_back(filenames[i]);
+			continue;
+		}
+		try {
+			this->paths.push_back(create_fifo("input_" + to_string(i)));
+		} catch (const runtime_error&) {
+			// the destructor is not run if the constructor fails
+			for (auto& f : this->fifos) unlink(f.c_str());
+			rmdir(this->fifo_directory.c_str());
+			throw;
+		}
+	}
+
+	// start one decompressor thread per compressed file
+	size_t fifo_index = 0;
+	for (size_t i = 0; i < filenames.size(); ++i) {
+		if (compressions[i] == Compression::NONE) continue;
+		this->threads.push_back(thread(&ReadStreams::decompress, this, filenames[i], this->fifos[fifo_index], compressions[i]));
+		fifo_index += 1;
+	}
+}
+
+string ReadStreams::create_fifo(string name) {
+	if (this->fifo_directory.empty()) {
+		const char* tmp = getenv("TMPDIR");
+		string directory = string((tmp != nullptr) ? tmp : "/tmp") + "/pangenie-XXXXXX";
+		vector<char> directory_name(directory.begin(), directory.end());
+		directory_name.push_back('\0');
+		if (mkdtemp(directory_name.data()) == nullptr) {
+			throw runtime_error("ReadStreams::create_fifo: cannot create temporary directory " + directory + ".");
+		}
+		this->fifo_directory = string(directory_name.data());
+		// writing to a pipe whose reader is gone must not terminate the program
+		signal(SIGPIPE, SIG_IGN);
+	}
+	string fifo = this->fifo_directory + "/" + name;
+	if (mkfifo(fifo.c_str(), 0600) != 0) {
+		throw runtime_error("ReadStreams::create_fifo: cannot create named pipe " + fifo + ".");
+	}
+	this->fifos.push_back(fifo);
+	return fifo;
+}
+
+string ReadStreams::add_generator(StreamGenerator generator) {
+	string fifo = create_fifo("generated_" + to_string(this->threads.size()));
+	this->threads.push_back(thread(&ReadStreams::generate, this, generator, fifo));
+	return fifo;
+}
+
+void ReadStreams::generate(StreamGenerator generator, string fifo) {
+	int fd = -1;
+	try {
+		fd = this->open_fifo(fifo);
+		if (fd >= 0) {
+			// collect small pieces, so that the pipe is written in large chunks
+			vector<char> buffer;
+			size_t buffer_size = 1 << 20;
+			buffer.reserve(buffer_size);
+			generator([&buffer, buffer_size, fd](const char* data, size_t size) {
+				if (buffer.size() + size > buffer_size) {
+					write_all(fd, buffer.data(), buffer.size());
+					buffer.clear();
+				}
+				if (size > buffer_size) {
+					write_all(fd, data, size);
+				} else {
+					buffer.insert(buffer.end(), data, data + size);
+				}
+			});
+			write_all(fd, buffer.data(), buffer.size());
+		}
+	} catch (const exception& e) {
+		// errors caused by closing the streams early are expected
+		if (!this->cancelled) {
+			lock_guard<mutex> lock (this->error_mutex);
+			if (this->error_message.empty()) this->error_message = string("Error while generating stream: ") + e.what();
+		}
+	}
+	if (fd >= 0) close(fd);
+}
+
+ReadStreams::~ReadStreams() {
+	this->cancelled = true;
+	this->join_threads();
+	for (auto& fifo : this->fifos) {
+		unlink(fifo.c_str());
+	}
+	if (!this->fifo_directory.empty()) {
+		rmdir(this->fifo_directory.c_str());
+	}
+}
+
+vector<string> ReadStreams::get_paths() const {
+	return this->paths;
+}
+
+void ReadStreams::finish() {
+	this->join_threads();
+	lock_guard<mutex> lock (this->error_mutex);
+	if (!this->error_message.empty()) {
+		throw runtime_error(this->error_message);
+	}
+}
+
+Compression ReadStreams::get_compression(string filename) {
+	ifstream file(filename, ios::in | ios::binary);
+	if (!file.good()) {
+		throw runtime_error("ReadStreams::get_compression: file " + filename + " cannot be opened.");
+	}
+	unsigned char magic[4] = {0, 0, 0, 0};
+	file.read((char*) magic, 4);
+	if ((file.gcount() >= 2) && (magic[0] == 0x1f) && (magic[1] == 0x8b)) {
+		return BgzfReader::is_bgzf(filename) ? Compression::BGZF : Compression::GZIP;
+	}
+	if ((file.gcount() == 4) && (magic[0] == 0x28) && (magic[1] == 0xb5) && (magic[2] == 0x2f) && (magic[3] == 0xfd)) {
+		return Compression::ZSTD;
+	}
+	return Compression::NONE;
+}
+
+bool ReadStreams::is_stream(string filename) {
+	if (filename == "-") return true;
+	struct stat file_stat;
+	if (stat(filename.c_str(), &file_stat) != 0) return false;
+	return S_ISFIFO(file_stat.st_mode);
+}
+
+int ReadStreams::open_fifo(string fifo) {
+	// a blocking open would wait forever if the reader never opens the pipe,
+	// therefore poll until the reader is there or the streams are closed.
+	while (true) {
+		int fd = open(fifo.c_str(), O_WRONLY | O_NONBLOCK);
+		if (fd >= 0) {
+			int flags = fcntl(fd, F_GETFL);
+			fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
+			return fd;
+		}
+		if (errno != ENXIO) {
+			throw runtime_error("ReadStreams::open_fifo: cannot open named pipe " + fifo + ".");
+		}
+		if (this->cancelled) return -1;
+		this_thread::sleep_for(chrono::milliseconds(10));
+	}
+}
+
+void ReadStreams::decompress(string filename, string fifo, Compression compression) {
+	int fd = -1;
+	try {
+		fd = this->open_fifo(fifo);
+		if (fd >= 0) {
+			switch (compression) {
+				case Compression::GZIP: this->decompress_gzip(filename, fd); break;
+				case Compression::BGZF: this->decompress_bgzf(filename, fd); break;
+				case Compression::ZSTD: this->decompress_zstd(filename, fd); break;
+				default: break;
+			}
+		}
+	} catch (const exception& e) {
+		// errors caused by closing the streams early are expected
+		if (!this->cancelled) {
+			lock_guard<mutex> lock (this->error_mutex);
+			if (this->error_message.empty()) this->error_message = "Error while decompressing " + filename + ": " + e.what();
+		}
+	}
+	if (fd >= 0) close(fd);
+}
+
+void ReadStreams::decompress_gzip(string filename, int fd) {
+	gzFile file = NULL;
+	if (filename == "-") {
+		int stdin_fd = dup(STDIN_FILENO);
+		if (stdin_fd >= 0) file = gzdopen(stdin_fd, "rb");
+	} else {
+		file = gzopen(filename.c_str(), "rb");
+	}
+	if (file == NULL) {
+		throw runtime_error("ReadStreams::decompress_gzip: file " + filename + " cannot be opened.");
+	}
+	unique_ptr<gzFile_s, int(*)(gzFile)> guard(file, gzclose);
+	gzbuffer(file, 1 << 18);
+	vector<char> buffer(1 << 20);
+	while (!this->cancelled) {
+		int bytes = gzread(file, buffer.data(), buffer.size());
+		if (bytes < 0) {
+			int error;
+			throw runtime_error("ReadStreams::decompress_gzip: " + string(gzerror(file, &error)));
+		}
+		if (bytes == 0) break;
+		write_all(fd, buffer.data(), bytes);
+	}
+}
+
+void ReadStreams::decompress_bgzf(string filename, int fd) {
+	// pipeline: this thread reads the compressed blocks, a persistent thread pool inflates them and
+	// a writer thread writes them in the original order. Blocks are kept in a ring of slots, so that
+	// reading stops as long as the writer is nr_slots blocks behind.
+	BgzfReader reader(filename);
+	size_t nr_slots = 16 * this->nr_threads;
+	vector<vector<char>> blocks(nr_slots);
+	vector<string> results(nr_slots);
+	vector<exception_ptr> block_errors(nr_slots);
+	vector<bool> inflated(nr_slots, false);
+	size_t nr_read = 0;
+	size_t nr_written = 0;
+	bool reading_done = false;
+	bool writing_failed = false;
+	exception_ptr read_error;
+	exception_ptr write_error;
+	mutex pipeline_mutex;
+	condition_variable pipeline_changed;
+
+	thread writer([&](){
+		try {
+			while (true) {
+				size_t slot = nr_written % nr_slots;
+				{
+					unique_lock<mutex> lock (pipeline_mutex);
+					pipeline_changed.wait(lock, [&](){
+						return ((nr_written < nr_read) && inflated[slot]) || (reading_done && (nr_written == nr_read));
+					});
+					if (nr_written == nr_read) break;
+				}
+				if (block_errors[slot]) rethrow_exception(block_errors[slot]);
+				write_all(fd, results[slot].data(), results[slot].size());
+				{
+					lock_guard<mutex> lock (pipeline_mutex);
+					inflated[slot] = false;
+					nr_written += 1;
+				}
+				pipeline_changed.notify_all();
+			}
+		} catch (...) {
+			write_error = current_exception();
+			{
+				lock_guard<mutex> lock (pipeline_mutex);
+				writing_failed = true;
+			}
+			pipeline_changed.notify_all();
+		}
+	});
+
+	{
+		// the pool is destroyed (and waits for the remaining blocks) before the slots
+		ThreadPool threadPool (this->nr_threads);
+		try {
+			while (!this->cancelled) {
+				size_t slot;
+				{
+					unique_lock<mutex> lock (pipeline_mutex);
+					pipeline_changed.wait(lock, [&](){ return writing_failed || (nr_read - nr_written < nr_slots); });
+					if (writing_failed) break;
+					slot = nr_read % nr_slots;
+				}
+				// the slot is free, it is only used again once the block has been written
+				if (!reader.read_block(blocks[slot])) break;
+				threadPool.submit([&, slot](){
+					try {
+						BgzfReader::decompress_block(blocks[slot], results[slot]);
+					} catch (...) {
+						block_errors[slot] = current_exception();
+					}
+					{
+						lock_guard<mutex> lock (pipeline_mutex);
+						inflated[slot] = true;
+					}
+					pipeline_changed.notify_all();
+				});
+				{
+					lock_guard<mutex> lock (pipeline_mutex);
+					nr_read += 1;
+				}
+				pipeline_changed.notify_all();
+			}
+		} catch (...) {
+			read_error = current_exception();
+		}
+		{
+			lock_guard<mutex> lock (pipeline_mutex);
+			reading_done = true;
+		}
+		pipeline_changed.notify_all();
+		writer.join();
+	}
+	if (read_error) rethrow_exception(read_error);
+	if (write_error) rethrow_exception(write_error);
+}
+
+void ReadStreams::decompress_zstd([[maybe_unused]] string filename, [[maybe_unused]] int fd) {
+#ifdef PANGENIE_ZSTD
+	ifstream file(filename, ios::in | ios::binary);
+	if (!file.good()) {
+		throw runtime_error("ReadStreams::decompress_zstd: file " + filename + " cannot be opened.");
+	}
+	unique_ptr<ZSTD_DStream, size_t(*)(ZSTD_DStream*)> stream(ZSTD_createDStream(), ZSTD_freeDStream);
+	ZSTD_initDStream(stream.get());
+	vector<char> in_buffer(ZSTD_DStreamInSize());
+	vector<char> out_buffer(ZSTD_DStreamOutSize());
+	size_t status = 0;
+	while (!this->cancelled) {
+		file.read(in_buffer.data(), in_buffer.size());
+		size_t bytes = file.gcount();
+		if (bytes == 0) break;
+		ZSTD_inBuffer input = {in_buffer.data(), bytes, 0};
+		while (input.pos < input.size) {
+			ZSTD_outBuffer output = {out_buffer.data(), out_buffer.size(), 0};
+			status = ZSTD_decompressStream(stream.get(), &output, &input);
+			if (ZSTD_isError(status)) {
+				throw runtime_error("ReadStreams::decompress_zstd: " + string(ZSTD_getErrorName(status)));
+			}
+			write_all(fd, out_buffer.data(), output.pos);
+		}
+	}
+	if ((status != 0) && !this->cancelled) {
+		throw runtime_error("ReadStreams::decompress_zstd: file " + filename + " is truncated.");
+	}
+#else
+	throw runtime_error("ReadStreams::decompress_zstd: PanGenie was compiled without zstd support.");
+#endif
+}
+
+void ReadStreams::join_threads() {
+	for (auto& t : this->threads) {
+		if (t.joinable()) t.join();
+	}
+}
@@ -0,0 +1,68 @@
+#ifndef READSTREAMS_HPP
+#define READSTREAMS_HPP
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+
+/**
+* Makes (possibly compressed) FASTA/FASTQ files available as uncompressed streams,
+* e.g. for the jellyfish stream_manager. Uncompressed files are read directly. Each compressed
+* file is decompressed by a separate thread which writes into a named pipe, so that no
+* decompressed copy needs to be written to disk. BGZF blocks are decompressed in parallel
+* while the next blocks are read and the previous ones written.
+* Reads can also be streamed from stdin ("-") or a named pipe, uncompressed or gzip-compressed.
+* Additionally, data generated in memory can be made available through a named pipe (see add_generator).
+**/
+
+enum class Compression { NONE, GZIP, BGZF, ZSTD };
+
+/** produces the content of a stream by passing it to the given function in chunks **/
+typedef std::function<void(const std::function<void(const char*, size_t)>&)> StreamGenerator;
+
+class ReadStreams {
+public:
+	/**
+	* @param filenames names of the input files (uncompressed, gzip, bgzip or zstd)
+	* @param nr_threads number of threads used to decompress blocks of BGZF files
+	**/
+	ReadStreams(std::vector<std::string> filenames, size_t nr_threads = 1);
+	~ReadStreams();
+	/** paths to read the uncompressed data from (in the order of the input files) **/
+	std::vector<std::string> get_paths() const;
+	/**
+	* run the given generator in a separate thread which writes its output into a named pipe.
+	* Returns the path of the pipe, which can be read once.
+	**/
+	std::string add_generator(StreamGenerator generator);
+	/** wait for all decompression threads and rethrow errors that occurred in them **/
+	void finish();
+	/** determine the compression format of a file from its first bytes **/
+	static Compression get_compression(std::string filename);
+	/** check whether the given path refers to stdin ("-") or a named pipe, which can only be read once **/
+	static bool is_stream(std::string filename);
+
+private:
+	std::vector<std::string> paths;
+	std::vector<std::string> fifos;
+	std::vector<std::thread> threads;
+	std::string fifo_directory;
+	size_t nr_threads;
+	std::atomic<bool> cancelled;
+	std::mutex error_mutex;
+	std::string error_message;
+	void decompress(std::string filename, std::string fifo, Compression compression);
+	void decompress_gzip(std::string filename, int fd);
+	void decompress_bgzf(std::string filename, int fd);
+	void decompress_zstd(std::string filename, int fd);
+	void generate(StreamGenerator generator, std::string fifo);
+	/** create a named pipe in the temporary directory (created on first use) **/
+	std::string create_fifo(std::string name);
+	int open_fifo(std::string fifo);
+	void join_threads();
+};
+
+#endif // READSTREAMS_HPP
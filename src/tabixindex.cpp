@@ -0,0 +1,138 @@
+#include "tabixindex.hpp"
+#include <stdexcept>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include "bgzfreader.hpp"
+
+using namespace std;
+
+/** reads little endian values from the decompressed index **/
+class IndexCursor {
+public:
+	IndexCursor(const string& data, string filename) :data(data), filename(filename), position(0) {}
+	template<class T>
+	T read() {
+		T result;
+		memcpy(&result, this->get(sizeof(T)), sizeof(T));
+		return result;
+	}
+	const char* get(size_t length) {
+		if ((this->position + length) > this->data.size()) {
+			throw runtime_error("TabixIndex::TabixIndex: index file " + this->filename + " is truncated.");
+		}
+		const char* result = this->data.data() + this->position;
+		this->position += length;
+		return result;
+	}
+private:
+	const string& data;
+	string filename;
+	size_t position;
+};
+
+/** names are stored as concatenated null-terminated strings **/
+static void read_names(IndexCursor& cursor, vector<string>& names) {
+	int32_t length = cursor.read<int32_t>();
+	if (length < 0) throw runtime_error("TabixIndex::TabixIndex: malformed index.");
+	const char* data = cursor.get(length);
+	size_t start = 0;
+	for (size_t i = 0; i < (size_t) length; ++i) {
+		if (data[i] == '\0') {
+			names.push_back(string(data + start, i - start));
+			start = i + 1;
+		}
+	}
+}
+
+TabixIndex::TabixIndex(string filename) {
+	// index files are BGZF-compressed themselves
+	string data;
+	{
+		BgzfReader reader(filename);
+		vector<char> block;
+		string decompressed;
+		while (reader.read_block(block)) {
+			BgzfReader::decompress_block(block, decompressed);
+			data += decompressed;
+		}
+	}
+	IndexCursor cursor(data, filename);
+	string magic(cursor.get(4), 4);
+	bool csi = (magic == string("CSI\1", 4));
+	if (!csi && (magic != string("TBI\1", 4))) {
+		throw runtime_error("TabixIndex::TabixIndex: " + filename + " is not a tabix (.tbi) or CSI (.csi) index.");
+	}
+
+	int32_t n_ref = 0;
+	uint32_t meta_bin = 37450;
+	if (csi) {
+		cursor.read<int32_t>();
+		int32_t depth = cursor.read<int32_t>();
+		int32_t l_aux = cursor.read<int32_t>();
+		if ((l_aux < 28) || (depth < 0) || (depth > 9)) {
+			throw runtime_error("TabixIndex::TabixIndex: CSI index " + filename + " does not contain sequence names (only indices of bgzipped VCFs are supported).");
+		}
+		meta_bin = ((1u << ((depth + 1) * 3)) - 1) / 7 + 1;
+		// auxiliary data contains the tabix header: format, columns, meta character, skipped lines and names
+		string aux(cursor.get(l_aux), l_aux);
+		IndexCursor aux_cursor(aux, filename);
+		aux_cursor.get(6 * sizeof(int32_t));
+		read_names(aux_cursor, this->sequence_names);
+		n_ref = cursor.read<int32_t>();
+	} else {
+		n_ref = cursor.read<int32_t>();
+		cursor.get(6 * sizeof(int32_t));
+		read_names(cursor, this->sequence_names);
+	}
+	if ((n_ref < 0) || ((size_t) n_ref != this->sequence_names.size())) {
+		throw runtime_error("TabixIndex::TabixIndex: malformed index " + filename + ".");
+	}
+
+	for (int32_t r = 0; r < n_ref; ++r) {
+		uint64_t begin = UINT64_MAX;
+		uint64_t end = 0;
+		int32_t n_bin = cursor.read<int32_t>();
+		for (int32_t b = 0; b < n_bin; ++b) {
+			uint32_t bin = cursor.read<uint32_t>();
+			if (csi) cursor.read<uint64_t>();
+			int32_t n_chunk = cursor.read<int32_t>();
+			if (n_chunk < 0) throw runtime_error("TabixIndex::TabixIndex: malformed index " + filename + ".");
+			for (int32_t c = 0; c < n_chunk; ++c) {
+				uint64_t chunk_begin = cursor.read<uint64_t>();
+				uint64_t chunk_end = cursor.read<uint64_t>();
+				// the pseudo bin stores statistics instead of chunks
+				if (bin == meta_bin) continue;
+				begin = min(begin, chunk_begin);
+				end = max(end, chunk_end);
+			}
+		}
+		if (!csi) {
+			// skip linear index
+			int32_t n_intv = cursor.read<int32_t>();
+			if (n_intv < 0) throw runtime_error("TabixIndex::TabixIndex: malformed index " + filename + ".");
+			cursor.get(n_intv * sizeof(uint64_t));
+		}
+		if (begin < end) this->ranges[this->sequence_names[r]] = make_pair(begin, end);
+	}
+}
+
+string TabixIndex::find_index(string filename) {
+	for (string ending : {".tbi", ".csi"}) {
+		ifstream file(filename + ending);
+		if (file.good()) return filename + ending;
+	}
+	return "";
+}
+
+const vector<string>& TabixIndex::get_sequence_names() const {
+	return this->sequence_names;
+}
+
+bool TabixIndex::get_range(string name, uint64_t& begin, uint64_t& end) const {
+	auto it = this->ranges.find(name);
+	if (it == this->ranges.end()) return false;
+	begin = it->second.first;
+	end = it->second.second;
+	return true;
+}
@@ -0,0 +1,33 @@
+#ifndef TABIXINDEX_HPP
+#define TABIXINDEX_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <stdint.h>
+
+/**
+* Reads the index (.tbi or .csi) of a bgzipped VCF file and provides the range of
+* virtual file offsets (compressed block offset << 16 | offset within block) covering
+* all records of each chromosome.
+**/
+
+class TabixIndex {
+public:
+	/**
+	* @param filename name of the index file (.tbi or .csi)
+	**/
+	TabixIndex(std::string filename);
+	/** name of the index belonging to the given bgzipped file (<file>.tbi or <file>.csi), empty if none exists **/
+	static std::string find_index(std::string filename);
+	/** names of the chromosomes contained in the index (in the order of the file) **/
+	const std::vector<std::string>& get_sequence_names() const;
+	/** virtual offsets of the first record and behind the last record of the chromosome. Returns false if the chromosome has no records. **/
+	bool get_range(std::string name, uint64_t& begin, uint64_t& end) const;
+
+private:
+	std::vector<std::string> sequence_names;
+	std::map<std::string, std::pair<uint64_t,uint64_t>> ranges;
+};
+
+#endif // TABIXINDEX_HPP
@@ -0,0 +1,224 @@
+#include "taskscheduler.hpp"
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+using namespace std;
+
+// scheduler and worker index of the calling thread
+static thread_local const TaskScheduler* current_scheduler = nullptr;
+static thread_local long current_index = -1;
+
+TaskGroup::TaskGroup()
+	:pending(0)
+{}
+
+bool TaskGroup::done() const {
+	lock_guard<mutex> lock (this->group_mutex);
+	return this->pending == 0;
+}
+
+TaskScheduler::TaskScheduler(size_t nr_threads)
+	:nr_submitted(0),
+	 nr_queued(0),
+	 nr_unfinished(0),
+	 finished(false)
+{
+	nr_threads = max(nr_threads, (size_t) 1);
+	for (size_t i = 0; i < nr_threads; ++i) {
+		this->workers.emplace_back(new Worker());
+	}
+	for (size_t i = 0; i < nr_threads; ++i) {
+		this->threads.emplace_back([this, i](){ run_worker(i); });
+	}
+}
+
+TaskScheduler::~TaskScheduler() {
+	wait_all();
+	{
+		lock_guard<mutex> lock (this->idle_mutex);
+		this->finished = true;
+	}
+	this->idle.notify_all();
+	for (auto& t : this->threads) {
+		t.join();
+	}
+}
+
+size_t TaskScheduler::nr_of_threads() const {
+	return this->threads.size();
+}
+
+double TaskScheduler::busy_time() const {
+	uint64_t busy_nanoseconds = 0;
+	for (auto& worker : this->workers) {
+		busy_nanoseconds += worker->busy_nanoseconds;
+	}
+	return busy_nanoseconds / 1000000000.0;
+}
+
+bool TaskScheduler::has_precedence(const Entry& a, const Entry& b) {
+	if (a.priority != b.priority) return a.priority < b.priority;
+	return a.sequence > b.sequence;
+}
+
+long TaskScheduler::current_worker() const {
+	return (current_scheduler == this) ? current_index : -1;
+}
+
+void TaskScheduler::submit(Task task, double priority, TaskGroup* group) {
+	if (group != nullptr) {
+		lock_guard<mutex> lock (group->group_mutex);
+		group->pending += 1;
+	}
+	this->nr_unfinished += 1;
+	// count the task before publishing it, a worker taking it right away must not decrement nr_queued below zero
+	this->nr_queued += 1;
+	long index = current_worker();
+	if ((index >= 0) && (group != nullptr) && (priority == 0.0)) {
+		// part of the work of a running task, which waits for its group
+		Worker& worker = *this->workers[index];
+		lock_guard<mutex> lock (worker.worker_mutex);
+		worker.tasks.push_back(Entry{move(task), group, priority, 0});
+	} else {
+		lock_guard<mutex> lock (this->shared_mutex);
+		this->shared_tasks.push_back(Entry{move(task), group, priority, this->nr_submitted++});
+		push_heap(this->shared_tasks.begin(), this->shared_tasks.end(), has_precedence);
+	}
+	// synchronize with workers about to go to sleep, so that the notification is not lost
+	{
+		lock_guard<mutex> lock (this->idle_mutex);
+	}
+	this->idle.notify_one();
+}
+
+bool TaskScheduler::take_task(long index, Entry& entry) {
+	bool found = false;
+	if (index >= 0) {
+		Worker& worker = *this->workers[index];
+		lock_guard<mutex> lock (worker.worker_mutex);
+		if (!worker.tasks.empty()) {
+			entry = move(worker.tasks.back());
+			worker.tasks.pop_back();
+			found = true;
+		}
+	}
+	if (!found) {
+		lock_guard<mutex> lock (this->shared_mutex);
+		if (!this->shared_tasks.empty()) {
+			pop_heap(this->shared_tasks.begin(), this->shared_tasks.end(), has_precedence);
+			entry = move(this->shared_tasks.back());
+			this->shared_tasks.pop_back();
+			found = true;
+		}
+	}
+	// steal the oldest task of another worker
+	size_t nr_workers = this->workers.size();
+	for (size_t i = 1; !found && (i <= nr_workers); ++i) {
+		Worker& victim = *this->workers[(index + i) % nr_workers];
+		lock_guard<mutex> lock (victim.worker_mutex);
+		if (!victim.tasks.empty()) {
+			entry = move(victim.tasks.front());
+			victim.tasks.pop_front();
+			found = true;
+		}
+	}
+	if (found) this->nr_queued -= 1;
+	return found;
+}
+
+void TaskScheduler::run_task(Entry& entry) {
+	exception_ptr task_error;
+	try {
+		entry.task();
+	} catch (...) {
+		task_error = current_exception();
+	}
+	// release the resources held by the task before reporting it as finished
+	entry.task = nullptr;
+	if (entry.group != nullptr) {
+		TaskGroup& group = *entry.group;
+		bool group_done = false;
+		{
+			lock_guard<mutex> lock (group.group_mutex);
+			if (task_error && !group.error) group.error = task_error;
+			group.pending -= 1;
+			group_done = (group.pending == 0);
+			if (group_done) group.group_finished.notify_all();
+		}
+		// wake workers waiting for the group (see wait), the group must not be accessed anymore
+		if (group_done) {
+			lock_guard<mutex> lock (this->idle_mutex);
+			this->idle.notify_all();
+		}
+	} else if (task_error) {
+		lock_guard<mutex> lock (this->idle_mutex);
+		if (!this->error) this->error = task_error;
+	}
+	if (--this->nr_unfinished == 0) {
+		lock_guard<mutex> lock (this->idle_mutex);
+		this->all_finished.notify_all();
+	}
+}
+
+void TaskScheduler::run_worker(size_t index) {
+	current_scheduler = this;
+	current_index = index;
+	for (;;) {
+		Entry entry;
+		if (take_task(index, entry)) {
+			// tasks run while waiting for a group (see wait) are part of the waiting task's time
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			run_task(entry);
+			this->workers[index]->busy_nanoseconds += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+			continue;
+		}
+		unique_lock<mutex> lock (this->idle_mutex);
+		this->idle.wait(lock, [this](){ return (this->nr_queued > 0) || this->finished; });
+		if (this->finished && (this->nr_queued == 0)) break;
+	}
+}
+
+void TaskScheduler::wait(TaskGroup& group) {
+	long index = current_worker();
+	if (index >= 0) {
+		// help with the queued tasks instead of blocking the worker
+		while (!group.done()) {
+			Entry entry;
+			if (take_task(index, entry)) {
+				run_task(entry);
+			} else {
+				// sleep until a task is queued or the group finished
+				unique_lock<mutex> lock (this->idle_mutex);
+				this->idle.wait(lock, [this, &group](){ return (this->nr_queued > 0) || group.done(); });
+			}
+		}
+	} else {
+		unique_lock<mutex> lock (group.group_mutex);
+		group.group_finished.wait(lock, [&group](){ return group.pending == 0; });
+	}
+	lock_guard<mutex> lock (group.group_mutex);
+	if (group.error) {
+		exception_ptr group_error = group.error;
+		group.error = nullptr;
+		rethrow_exception(group_error);
+	}
+}
+
+void TaskScheduler::wait_all() {
+	unique_lock<mutex> lock (this->idle_mutex);
+	this->all_finished.wait(lock, [this](){ return this->nr_unfinished == 0; });
+}
+
+void TaskScheduler::wait() {
+	if (current_worker() >= 0) {
+		throw runtime_error("TaskScheduler::wait: a task cannot wait for all tasks (including itself).");
+	}
+	wait_all();
+	lock_guard<mutex> lock (this->idle_mutex);
+	if (this->error) {
+		exception_ptr task_error = this->error;
+		this->error = nullptr;
+		rethrow_exception(task_error);
+	}
+}
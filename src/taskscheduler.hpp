@@ -0,0 +1,101 @@
+#ifndef TASKSCHEDULER_HPP
+#define TASKSCHEDULER_HPP
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <cstdint>
+
+/**
+* Work-stealing task scheduler. Tasks submitted from outside are kept in a shared queue ordered by
+* priority (largest first, e.g. an estimate of their cost so that long tasks start early and the tail
+* is short; FIFO for equal priorities). Tasks a running task submits to a group without priority go
+* to the deque of its worker, which runs them last-in first-out, while idle workers steal them from the
+* other end. All other tasks go to the shared queue, no matter who submits them.
+* Tasks can be collected in TaskGroups and waited for.
+**/
+
+class TaskScheduler;
+
+/** a set of tasks that can be waited for (see TaskScheduler::wait) **/
+class TaskGroup {
+public:
+	TaskGroup();
+	/** true if all tasks added to the group finished **/
+	bool done() const;
+private:
+	friend class TaskScheduler;
+	size_t pending;
+	/** first exception thrown by a task of the group **/
+	std::exception_ptr error;
+	mutable std::mutex group_mutex;
+	std::condition_variable group_finished;
+};
+
+class TaskScheduler {
+public:
+	using Task = std::function<void()>;
+	TaskScheduler(size_t nr_threads);
+	/** waits for all tasks to finish **/
+	~TaskScheduler();
+	/**
+	* submit a task.
+	* @param priority tasks with larger priority are started first (tasks with a priority always go to the shared queue)
+	* @param group the task is added to this group (optional)
+	**/
+	void submit(Task task, double priority = 0.0, TaskGroup* group = nullptr);
+	/**
+	* wait for all tasks of the group and rethrow the first exception thrown by one of them.
+	* If called by a task, the worker runs other tasks in the meantime.
+	**/
+	void wait(TaskGroup& group);
+	/** wait for all tasks and rethrow the first exception thrown by a task that is not in a group (must not be called by a task) **/
+	void wait();
+	size_t nr_of_threads() const;
+	/** total time (in seconds) the workers spent running tasks, including the time tasks spent waiting for their groups **/
+	double busy_time() const;
+
+private:
+	struct Entry {
+		Task task;
+		TaskGroup* group;
+		double priority;
+		size_t sequence;
+	};
+	struct Worker {
+		std::mutex worker_mutex;
+		std::deque<Entry> tasks;
+		std::atomic<uint64_t> busy_nanoseconds{0};
+	};
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::vector<std::thread> threads;
+	/** heap of the tasks submitted from outside (see has_precedence) **/
+	std::mutex shared_mutex;
+	std::vector<Entry> shared_tasks;
+	size_t nr_submitted;
+	/** number of tasks queued (not yet started) and not yet finished **/
+	std::atomic<size_t> nr_queued;
+	std::atomic<size_t> nr_unfinished;
+	std::mutex idle_mutex;
+	std::condition_variable idle;
+	std::condition_variable all_finished;
+	bool finished;
+	std::exception_ptr error;
+	/** heap order: true if b is run before a **/
+	static bool has_precedence(const Entry& a, const Entry& b);
+	void run_worker(size_t index);
+	/** take the next task: own deque, shared queue, then steal from the other workers (index: worker, or -1 if not a worker) **/
+	bool take_task(long index, Entry& entry);
+	void run_task(Entry& entry);
+	void wait_all();
+	/** index of the worker of this scheduler executing the caller (-1 if none) **/
+	long current_worker() const;
+};
+
+#endif // TASKSCHEDULER_HPP
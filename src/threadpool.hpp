@@ -1,14 +1,10 @@
 #ifndef THREADPOOL_HPP
 #define THREADPOOL_HPP
 
-#include <vector>
-#include <thread>
-#include <mutex>
-#include <condition_variable>
 #include <functional>
-#include <list>
+#include "taskscheduler.hpp"
 
-/** Code take from: http://www.mathematik.uni-ulm.de/numerik/pp/ss17/pp-folien-2017-05-18.pdf **/
+/** Runs the submitted jobs on nr_threads threads, the destructor waits until all of them finished (see TaskScheduler). **/
 
 class ThreadPool {
 public:
@@ -17,13 +13,7 @@ public:
 	~ThreadPool ();
 	void submit(Job job);
 private:
-	size_t nr_threads;
-	bool finished;
-	std::vector<std::thread> threads;
-	std::mutex m;
-	std::condition_variable cv;
-	std::list<Job> jobs;
-	void process_jobs ();
+	TaskScheduler scheduler;
 };
 
 #endif //THREADPOOL_HPP
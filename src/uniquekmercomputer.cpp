@@ -3,21 +3,23 @@
 #include <iostream>
 #include <cassert>
 #include <map>
+#include "sequenceutils.hpp"
 
 using namespace std;
 
-void unique_kmers(DnaSequence& allele, unsigned char index, size_t kmer_size, map<jellyfish::mer_dna, vector<unsigned char>>& occurences) {
+void unique_kmers(DnaSequenceView allele, unsigned char index, size_t kmer_size, map<jellyfish::mer_dna, vector<unsigned char>>& occurences) {
 	//enumerate kmers
 	map<jellyfish::mer_dna, size_t> counts;
 	size_t extra_shifts = kmer_size;
 	jellyfish::mer_dna::k(kmer_size);
 	jellyfish::mer_dna current_kmer("");
 	for (size_t i = 0; i < allele.size(); ++i) {
-		char current_base = allele[i];
+		unsigned char number = allele.encoded_at(i);
+		char current_base = decode(number);
 		if (extra_shifts == 0) {
 			counts[current_kmer] += 1;
 		}
-		if (  ( current_base != 'A') && (current_base != 'C') && (current_base != 'G') && (current_base != 'T') ) {
+		if (number > 3) {
 			extra_shifts = kmer_size + 1;
 		}
 		current_kmer.shift_left(current_base);
@@ -36,7 +38,10 @@ UniqueKmerComputer::UniqueKmerComputer (KmerCounter* genomic_kmers, KmerCounter*
 	 read_kmers(read_kmers),
 	 variants(variants),
 	 chromosome(chromosome),
-	 kmer_coverage(kmer_coverage)
+	 kmer_coverage(kmer_coverage),
+	 nr_lookups(0),
+	 nr_probabilities(0),
+	 nr_precomputed_probabilities(0)
 {
 	jellyfish::mer_dna::k(this->variants->get_kmer_size());
 }
@@ -82,11 +87,13 @@ void UniqueKmerComputer::compute_unique_kmers(vector<UniqueKmers*>* result, Prob
 
 			size_t genomic_count = this->genomic_kmers->getKmerAbundance(kmer.first);
 			size_t local_count = kmer.second.size();
+			this->nr_lookups += 1;
 
 			if ( (genomic_count - local_count) == 0 ) {
 				// kmer unique to this region
 				// determine read kmercount for this kmer
 				size_t read_kmercount = this->read_kmers->getKmerAbundance(kmer.first);
+				this->nr_lookups += 1;
 
 				// determine on which paths kmer occurs
 				vector<size_t> paths;
@@ -112,6 +119,8 @@ void UniqueKmerComputer::compute_unique_kmers(vector<UniqueKmers*>* result, Prob
 
 				// determine probabilities
 				CopyNumber cn = probabilities->get_probability(kmer_coverage, read_kmercount);
+				this->nr_probabilities += 1;
+				if (probabilities->contains(kmer_coverage, read_kmercount)) this->nr_precomputed_probabilities += 1;
 				long double p_cn0 = cn.get_probability_of(0);
 				long double p_cn1 = cn.get_probability_of(1);
 				long double p_cn2 = cn.get_probability_of(2);
@@ -142,14 +151,46 @@ void UniqueKmerComputer::compute_empty(vector<UniqueKmers*>* result) const {
 	}
 }
 
+void UniqueKmerComputer::compute_profile_kmers(vector<ProfileKmer>* result) {
+	size_t kmer_size = this->variants->get_kmer_size();
+	size_t nr_variants = this->variants->size_of(this->chromosome);
+	for (size_t v = 0; v < nr_variants; ++v) {
+		const Variant& variant = this->variants->get_variant(this->chromosome, v);
+
+		// kmers unique to alleles (same checks as in compute_unique_kmers)
+		map <jellyfish::mer_dna, vector<unsigned char>> occurences;
+		for (unsigned char a = 0; a < variant.nr_of_alleles(); ++a) {
+			if (variant.is_undefined_allele(a)) continue;
+			DnaSequence allele = variant.get_allele_sequence(a);
+			unique_kmers(allele, a, kmer_size, occurences);
+		}
+		for (auto& kmer : occurences) {
+			size_t genomic_count = this->genomic_kmers->getKmerAbundance(kmer.first);
+			if (genomic_count == kmer.second.size()) {
+				result->push_back({KmerProfile::encode_kmer(kmer.first), (unsigned char) genomic_count});
+			}
+		}
+
+		// kmers used to compute the local coverage (same checks as in compute_local_coverage)
+		DnaSequenceView left_overhang = this->variants->get_left_overhang(this->chromosome, v, 2*kmer_size);
+		DnaSequenceView right_overhang = this->variants->get_right_overhang(this->chromosome, v, 2*kmer_size);
+		map <jellyfish::mer_dna, vector<unsigned char>> overhang_occurences;
+		unique_kmers(left_overhang, 0, kmer_size, overhang_occurences);
+		unique_kmers(right_overhang, 1, kmer_size, overhang_occurences);
+		for (auto& kmer : overhang_occurences) {
+			if (this->genomic_kmers->getKmerAbundance(kmer.first) == 1) {
+				result->push_back({KmerProfile::encode_kmer(kmer.first), 1});
+			}
+		}
+	}
+}
+
 unsigned short UniqueKmerComputer::compute_local_coverage(string chromosome, size_t var_index, size_t length) {
-	DnaSequence left_overhang;
-	DnaSequence right_overhang;
 	size_t total_coverage = 0;
 	size_t total_kmers = 0;
 
-	this->variants->get_left_overhang(chromosome, var_index, length, left_overhang);
-	this->variants->get_right_overhang(chromosome, var_index, length, right_overhang);
+	DnaSequenceView left_overhang = this->variants->get_left_overhang(chromosome, var_index, length);
+	DnaSequenceView right_overhang = this->variants->get_right_overhang(chromosome, var_index, length);
 
 	size_t kmer_size = this->variants->get_kmer_size();
 	map <jellyfish::mer_dna, vector<unsigned char>> occurences;
@@ -158,8 +199,10 @@ unsigned short UniqueKmerComputer::compute_local_coverage(string chromosome, siz
 
 	for (auto& kmer : occurences) {
 		size_t genomic_count = this->genomic_kmers->getKmerAbundance(kmer.first);
+		this->nr_lookups += 1;
 		if (genomic_count == 1) {
 			size_t read_count = this->read_kmers->getKmerAbundance(kmer.first);
+			this->nr_lookups += 1;
 			// ignore too extreme counts
 			if ( (read_count < (this->kmer_coverage/4)) || (read_count > (this->kmer_coverage*4)) ) continue;
 			total_coverage += read_count;
@@ -173,3 +216,15 @@ unsigned short UniqueKmerComputer::compute_local_coverage(string chromosome, siz
 		return this->kmer_coverage;
 	}
 }
+
+size_t UniqueKmerComputer::get_nr_lookups() const {
+	return this->nr_lookups;
+}
+
+size_t UniqueKmerComputer::get_nr_probabilities() const {
+	return this->nr_probabilities;
+}
+
+size_t UniqueKmerComputer::get_nr_precomputed_probabilities() const {
+	return this->nr_precomputed_probabilities;
+}
@@ -7,6 +7,7 @@
 #include "variantreader.hpp"
 #include "uniquekmers.hpp"
 #include "probabilitytable.hpp"
+#include "kmerprofile.hpp"
 
 class UniqueKmerComputer {
 public:
@@ -21,6 +22,14 @@ public:
 	void compute_unique_kmers(std::vector<UniqueKmers*>* result, ProbabilityTable* probabilities);
 	/** generates empty UniwueKmers objects for each position (no kmers, only paths). Ownership of vector is transferred to caller. **/
 	void compute_empty(std::vector<UniqueKmers*>* result) const;
+	/** collects all kmers whose read counts might be needed by compute_unique_kmers, together with their genomic counts.
+	* Kmers that can never pass the genomic uniqueness checks are left out. **/
+	void compute_profile_kmers(std::vector<ProfileKmer>* result);
+	/** number of kmers looked up in the genomic and read kmer counts so far **/
+	size_t get_nr_lookups() const;
+	/** number of copy number probabilities requested by compute_unique_kmers, and how many of them were pre-computed in the ProbabilityTable **/
+	size_t get_nr_probabilities() const;
+	size_t get_nr_precomputed_probabilities() const;
 
 private:
 	KmerCounter* genomic_kmers;
@@ -28,6 +37,9 @@ private:
 	VariantReader* variants;
 	std::string chromosome;
 	size_t kmer_coverage;
+	size_t nr_lookups;
+	size_t nr_probabilities;
+	size_t nr_precomputed_probabilities;
 	/** compute local coverage in given interval based on unique kmers 
 	* @param chromosome chromosome
 	* @param var_index variant index
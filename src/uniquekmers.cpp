@@ -147,3 +147,14 @@ void UniqueKmers::set_undefined_allele (unsigned char allele_id) {
 	}
 	this->alleles[allele_id].second = true;
 }
+
+size_t UniqueKmers::estimate_memory(size_t nr_paths, size_t nr_alleles) {
+	// at most 301 kmers are used per variant (see UniqueKmerComputer), allocations are assumed to carry 16 bytes of overhead
+	const size_t max_kmers = 301;
+	size_t memory = sizeof(UniqueKmers) + 16 + (nr_paths + 16) + (max_kmers * sizeof(unsigned short) + 16);
+	// one map node per allele (including the tree pointers), holding a bit vector grown by doubling
+	size_t blocks = 1;
+	while (blocks * 32 < max_kmers) blocks *= 2;
+	memory += nr_alleles * (sizeof(pair<const unsigned char, pair<KmerPath, bool>>) + 32 + 16 + (blocks * sizeof(uint32_t) + 16));
+	return memory;
+}
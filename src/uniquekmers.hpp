@@ -51,6 +51,8 @@ public:
 	bool is_undefined_allele (unsigned char allele_id) const;
 	/** set allele to undefined **/
 	void set_undefined_allele (unsigned char allele_id);
+	/** estimate the number of bytes allocated for a variant with the given number of paths and alleles (assuming the maximum number of kmers) **/
+	static size_t estimate_memory(size_t nr_paths, size_t nr_alleles);
 
 private:
 	size_t variant_pos;
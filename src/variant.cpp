@@ -8,51 +8,8 @@
 
 using namespace std;
 
-DnaSequence construct_left_flank(vector<DnaSequence>& alleles, size_t position, size_t length) {
-	if ((alleles.size()-1) < position) {
-		throw runtime_error("Variant::construct_left_flank: position too large.");
-	}
-	DnaSequence flank;
-	for (int i = position-1; i >= 0; --i) {
-		DnaSequence sequence = alleles.at(i);
-		for (int j = sequence.size()-1; j >= 0; --j) {
-			flank.append(sequence.base_at(j));
-			if (flank.size() == length) break;
-		}
-		if (flank.size() == length) {
-			break;
-		}
-	}
-	flank.reverse();
-	return flank;
-}
-
-DnaSequence construct_right_flank(vector<DnaSequence>& alleles, size_t position, size_t length) {
-	if ((alleles.size()-1) < position) {
-		throw runtime_error("Variant::construct_right_flank: position too large.");
-	}
-	DnaSequence flank;
-	for (size_t i = position+1; i < alleles.size(); ++i) {
-		DnaSequence sequence = alleles.at(i);
-		for (size_t j = 0; j < sequence.size(); ++j) {
-			flank.append(sequence.base_at(j));
-			if (flank.size() == length) break;
-		}
-		if (flank.size() == length) {
-			break;
-		}
-	}
-
-	if (flank.size() != length) {
-		throw runtime_error("Variant::construct_right_flank: not enough bases given at right side.");
-	}
-	return flank;
-}
-
 Variant::Variant(string left_flank, string right_flank, string chromosome, size_t start_position, size_t end_position, vector<string> alleles, vector<unsigned char> paths, string variant_id)
-	:left_flank(left_flank),
-	 right_flank(right_flank),
-	 chromosome(chromosome),
+	:chromosome(chromosome),
 	 start_position(start_position),
 	 variant_ids({variant_id}),
 	 paths(paths),
@@ -67,19 +24,17 @@ Variant::Variant(string left_flank, string right_flank, string chromosome, size_
 		throw runtime_error("Variant::Variant: number of paths exceeds 256. Current implementation does not support higher numbers.");
 	}
 
-	this->allele_sequences.push_back(vector<DnaSequence>());
-	for (unsigned char i = 0; i < alleles.size(); ++i) {
-		this->allele_sequences[0].push_back(DnaSequence(alleles[i]));
-		this->allele_combinations.push_back({i});
+	vector<DnaSequence> allele_sequences;
+	for (auto& allele : alleles) {
+		allele_sequences.push_back(DnaSequence(allele));
 	}
+	this->set_sequences(DnaSequence(left_flank), DnaSequence(right_flank), allele_sequences);
 
 	this->set_values(end_position);
 }
 
 Variant::Variant(DnaSequence& left_flank, DnaSequence& right_flank, string chromosome, size_t start_position, size_t end_position, vector<DnaSequence>& alleles, vector<unsigned char>& paths, string variant_id)
-	:left_flank(left_flank),
-	 right_flank(right_flank),
-	 chromosome(chromosome),
+	:chromosome(chromosome),
 	 start_position(start_position),
 	 variant_ids({variant_id}),
 	 paths(paths),
@@ -93,20 +48,89 @@ Variant::Variant(DnaSequence& left_flank, DnaSequence& right_flank, string chrom
 		throw runtime_error("Variant::Variant: number of paths exceeds 256. Current implementation does not support higher numbers.");
 	}
 
-	this->allele_sequences.push_back(vector<DnaSequence>());
+	this->set_sequences(left_flank, right_flank, alleles);
+
+	this->set_values(end_position);
+}
+
+void Variant::set_sequences(const DnaSequence& left_flank, const DnaSequence& right_flank, const vector<DnaSequence>& alleles) {
+	this->left_flank = this->add_segment(left_flank);
+	this->right_flank = this->add_segment(right_flank);
+	this->allele_offsets = {0};
 	for (unsigned char i = 0; i < alleles.size(); ++i) {
-		this->allele_sequences[0].push_back(alleles[i]);
-		this->allele_combinations.push_back({i});
+		this->allele_segments.push_back(this->add_segment(alleles[i]));
+		this->allele_combinations.push_back(i);
 	}
+	this->allele_offsets.push_back(this->allele_segments.size());
+}
 
-	this->set_values(end_position);
+uint32_t Variant::add_segment(const DnaSequenceView& sequence) {
+	if (this->segment_index.empty()) {
+		for (uint32_t i = 0; i < this->segments.size(); ++i) {
+			DnaSequence stored;
+			stored.append(this->get_segment(i));
+			this->segment_index.emplace(move(stored), i);
+		}
+	}
+	DnaSequence key;
+	key.append(sequence);
+	auto it = this->segment_index.find(key);
+	if (it != this->segment_index.end()) return it->second;
+	uint32_t index = this->segments.size();
+	this->segments.push_back(make_pair((uint32_t) this->sequences.size(), (uint32_t) key.size()));
+	this->sequences.append(key);
+	this->segment_index.emplace(move(key), index);
+	return index;
+}
+
+DnaSequenceView Variant::get_segment(uint32_t index) const {
+	const pair<uint32_t,uint32_t>& segment = this->segments[index];
+	return this->sequences.view(segment.first, segment.first + segment.second);
+}
+
+void Variant::compact() {
+	Variant compacted;
+	compacted.left_flank = compacted.add_segment(this->get_segment(this->left_flank));
+	compacted.right_flank = compacted.add_segment(this->get_segment(this->right_flank));
+	for (auto& flank : this->inner_flanks) {
+		flank = compacted.add_segment(this->get_segment(flank));
+	}
+	for (auto& allele : this->allele_segments) {
+		allele = compacted.add_segment(this->get_segment(allele));
+	}
+	this->left_flank = compacted.left_flank;
+	this->right_flank = compacted.right_flank;
+	this->sequences = move(compacted.sequences);
+	this->segments = move(compacted.segments);
+	// the lookup table is only needed while sequences are added
+	this->segment_index = unordered_map<DnaSequence, uint32_t, DnaSequenceHash>();
+}
+
+size_t Variant::nr_of_variants() const {
+	return this->allele_offsets.size() - 1;
+}
+
+DnaSequenceView Variant::get_single_allele(size_t variant_index, unsigned char allele_id) const {
+	return this->get_segment(this->allele_segments[this->allele_offsets[variant_index] + allele_id]);
+}
+
+void Variant::get_allele_parts(size_t index, vector<DnaSequenceView>& result) const {
+	size_t nr_variants = this->nr_of_variants();
+	if (this->flanks_added) result.push_back(this->get_segment(this->left_flank));
+	for (size_t i = 0; i < nr_variants; ++i) {
+		result.push_back(this->get_single_allele(i, this->allele_combinations[index * nr_variants + i]));
+		if (i < (nr_variants - 1)) {
+			result.push_back(this->get_segment(this->inner_flanks[i]));
+		}
+	}
+	if (this->flanks_added) result.push_back(this->get_segment(this->right_flank));
 }
 
 void Variant::set_values(size_t end_position) {
 	// find out which alleles are not covered by any paths
 	vector<unsigned char> uncovered;
-	assert(allele_sequences.size() < 256);
-	for (unsigned char i = 0; i < this->allele_sequences[0].size(); ++i) {
+	size_t nr_alleles = this->allele_offsets[1] - this->allele_offsets[0];
+	for (unsigned char i = 0; i < nr_alleles; ++i) {
 		if (find(this->paths.begin(), this->paths.end(), i) == this->paths.end()) {
 			// allele not covered
 			uncovered.push_back(i);
@@ -116,7 +140,7 @@ void Variant::set_values(size_t end_position) {
 	this->uncovered_alleles.push_back(uncovered);
 
 	// check if flanks have same length
-	if (this->left_flank.size() != this->right_flank.size()){
+	if (this->get_segment(this->left_flank).size() != this->get_segment(this->right_flank).size()){
 		throw runtime_error("Variant::Variant: left and right flanks have different sizes.");
 	}
 
@@ -126,13 +150,12 @@ void Variant::set_values(size_t end_position) {
 	}
 
 	// check if length of ref allele matches end position
-	size_t ref_len = this->allele_sequences[0][0].size();
+	size_t ref_len = this->get_single_allele(0, 0).size();
 	if (ref_len != (end_position - this->start_position)) {
 		throw runtime_error("Variant::Variant: end position does not match length of reference allele.");
 	}
 
 	// check if paths are valid
-	size_t nr_alleles = this->allele_sequences[0].size();
 	for (auto p : this->paths) {
 		if (p >= nr_alleles) {
 			throw runtime_error("Variant::Variant: allele ids given in paths are invalid. "+std::to_string(p) + " "+std::to_string(nr_alleles)+ " "+std::to_string(this->start_position));
@@ -149,7 +172,7 @@ void Variant::remove_flanking_sequence() {
 }
 
 size_t Variant::nr_of_alleles() const {
-	return this->allele_combinations.size();
+	return this->allele_combinations.size() / this->nr_of_variants();
 }
 
 size_t Variant::nr_of_paths() const {
@@ -157,42 +180,26 @@ size_t Variant::nr_of_paths() const {
 }
 
 string Variant::get_allele_string(size_t index) const {
-	if (index < this->allele_combinations.size()) {
-		DnaSequence result;
-		if (this->flanks_added) {
-			result = this->left_flank;
-		}
-		size_t nr_alleles = this->allele_combinations.at(index).size();
-		for (size_t i = 0; i < nr_alleles; ++i) {
-			result.append(this->allele_sequences[i][this->allele_combinations[index][i]]);
-			if (i < (nr_alleles - 1)) {
-				result.append(this->inner_flanks[i]);
-			}
-		}
-		if (this->flanks_added) {
-			result.append(this->right_flank);
+	if (index < this->nr_of_alleles()) {
+		vector<DnaSequenceView> parts;
+		this->get_allele_parts(index, parts);
+		string result;
+		for (auto& part : parts) {
+			result += part.to_string();
 		}
-		return result.to_string();
+		return result;
 	} else {
 		throw runtime_error("Variant::get_allele_string: Index out of bounds.");
 	}
 }
 
 DnaSequence Variant::get_allele_sequence(size_t index) const {
-	if (index < this->allele_combinations.size()) {
+	if (index < this->nr_of_alleles()) {
+		vector<DnaSequenceView> parts;
+		this->get_allele_parts(index, parts);
 		DnaSequence result;
-		if (this->flanks_added) {
-			result = this->left_flank;
-		}
-		size_t nr_alleles = this->allele_combinations.at(index).size();
-		for (size_t i = 0; i < nr_alleles; ++i) {
-			result.append(this->allele_sequences[i][this->allele_combinations[index][i]]);
-			if (i < (nr_alleles - 1)) {
-				result.append(this->inner_flanks[i]);
-			}
-		}
-		if (this->flanks_added) {
-			result.append(this->right_flank);
+		for (auto& part : parts) {
+			result.append(part);
 		}
 		return result;
 	} else {
@@ -206,10 +213,11 @@ size_t Variant::get_start_position() const {
 
 size_t Variant::get_end_position() const {
 	size_t end_position = this->start_position;
-	for (size_t i = 0; i < this->allele_sequences.size(); ++i) {
-		end_position += this->allele_sequences.at(i).at(0).size();
-		if (i < (this->allele_sequences.size()-1)) {
-			end_position += this->inner_flanks.at(i).size();
+	size_t nr_variants = this->nr_of_variants();
+	for (size_t i = 0; i < nr_variants; ++i) {
+		end_position += this->get_single_allele(i, 0).size();
+		if (i < (nr_variants-1)) {
+			end_position += this->get_segment(this->inner_flanks.at(i)).size();
 		}
 	}
 	return end_position;
@@ -243,8 +251,8 @@ void Variant::combine_variants (Variant const &v2){
 	if (this->flanks_added || v2.flanks_added){
 		throw runtime_error("Variant::combine_variants: Variant objects can only be combined if no flanks where added.");
 	}
-	size_t kmersize_v1 = this->left_flank.size();
-	size_t kmersize_v2 = v2.left_flank.size();
+	size_t kmersize_v1 = this->get_segment(this->left_flank).size();
+	size_t kmersize_v2 = v2.get_segment(v2.left_flank).size();
 	if (kmersize_v1 != kmersize_v2) {
 		throw runtime_error("Variant::combine_variants: kmersizes are not the same.");
 	}
@@ -273,7 +281,9 @@ void Variant::combine_variants (Variant const &v2){
 		path_to_index[ref_path] = {};
 	}
 	vector<unsigned char> new_paths(this->paths.size());
-	vector<vector<unsigned char>> new_alleles;
+	vector<unsigned char> new_alleles;
+	size_t nr_variants_v1 = this->nr_of_variants();
+	size_t nr_variants_v2 = v2.nr_of_variants();
 	unsigned char allele_index = 0;
 	
 	assert (path_to_index.size() < 256);
@@ -283,112 +293,134 @@ void Variant::combine_variants (Variant const &v2){
 		for (auto e : it->second) {
 			new_paths[e] = allele_index;
 		}
-		vector<unsigned char> left_allele = this->allele_combinations.at(it->first.first);
-		vector<unsigned char> right_allele = v2.allele_combinations.at(it->first.second);
-		left_allele.insert(left_allele.end(), right_allele.begin(), right_allele.end());
-		new_alleles.push_back(left_allele);
+		auto left_allele = this->allele_combinations.begin() + it->first.first * nr_variants_v1;
+		auto right_allele = v2.allele_combinations.begin() + it->first.second * nr_variants_v2;
+		new_alleles.insert(new_alleles.end(), left_allele, left_allele + nr_variants_v1);
+		new_alleles.insert(new_alleles.end(), right_allele, right_allele + nr_variants_v2);
 		allele_index += 1;
 	}
 
 	// construct sequence between variants
+	const pair<uint32_t,uint32_t>& right = this->segments[this->right_flank];
 	DnaSequence flank;
-	this->right_flank.substr(0, v2.get_start_position() - end_position, flank);
-	this->inner_flanks.push_back(flank);
-	this->inner_flanks.insert(this->inner_flanks.end(), v2.inner_flanks.begin(), v2.inner_flanks.end());
+	this->sequences.substr(right.first, right.first + (v2.get_start_position() - end_position), flank);
+	this->inner_flanks.push_back(this->add_segment(flank));
+	for (auto inner : v2.inner_flanks) {
+		this->inner_flanks.push_back(this->add_segment(v2.get_segment(inner)));
+	}
 
 	// update variant
-	this->right_flank = v2.right_flank;
+	this->right_flank = this->add_segment(v2.get_segment(v2.right_flank));
 	this->allele_combinations = new_alleles;
-	this->allele_sequences.insert(this->allele_sequences.end(), v2.allele_sequences.begin(), v2.allele_sequences.end());
+	size_t offset = this->allele_segments.size();
+	for (auto allele : v2.allele_segments) {
+		this->allele_segments.push_back(this->add_segment(v2.get_segment(allele)));
+	}
+	for (size_t i = 1; i < v2.allele_offsets.size(); ++i) {
+		this->allele_offsets.push_back(offset + v2.allele_offsets[i]);
+	}
 	this->uncovered_alleles.insert(this->uncovered_alleles.end(), v2.uncovered_alleles.begin(), v2.uncovered_alleles.end());
 	this->paths = new_paths;
 	this->variant_ids.insert(this->variant_ids.end(), v2.variant_ids.begin(), v2.variant_ids.end());
 }
 
 void Variant::separate_variants (vector<Variant>* resulting_variants, const GenotypingResult* input_genotyping, vector<GenotypingResult>* resulting_genotyping) const {
-	size_t nr_variants = this->allele_sequences.size();
-	assert (this->uncovered_alleles.size() == nr_variants);
-
-	// construct paths
-	vector<vector<unsigned char>> paths_per_variant (nr_variants);
-	for (size_t i = 0; i < this->paths.size(); ++i) {
-		unsigned char a = this->get_allele_on_path(i);
-		vector<unsigned char> allele = this->allele_combinations.at(a);
-		assert (allele.size() == nr_variants);
-		for (size_t v = 0; v < nr_variants; v++) {
-			// get allele at this position
-			unsigned char allele_id = allele.at(v);
-			paths_per_variant.at(v).push_back(allele_id);
-		}
-	}
+	size_t nr_variants = this->nr_of_variants();
+	vector<SingleVariant> single_variants;
+	this->get_single_variants(single_variants);
 
 	// use reference allele to construct flanking sequences for each variant
-	vector<DnaSequence> reference_allele;
+	size_t flank_size = this->get_segment(this->left_flank).size();
+	DnaSequence reference_allele;
+	reference_allele.append(this->get_segment(this->left_flank));
+	vector<size_t> reference_starts;
 	for (size_t i = 0; i < nr_variants; ++i) {
-		unsigned char allele_id = this->allele_combinations.at(0).at(i);
-		reference_allele.push_back(this->allele_sequences.at(i).at(allele_id));
+		reference_starts.push_back(reference_allele.size());
+		reference_allele.append(this->get_single_allele(i, this->allele_combinations[i]));
 		if (i < (nr_variants - 1)) {
-			reference_allele.push_back(this->inner_flanks[i]);
+			reference_allele.append(this->get_segment(this->inner_flanks[i]));
 		}
 	}
+	reference_allele.append(this->get_segment(this->right_flank));
 
-	reference_allele.insert(reference_allele.begin(), this->left_flank);
-	reference_allele.push_back(this->right_flank);
+	for (size_t i = 0; i < nr_variants; ++i) {
+		const SingleVariant& single = single_variants[i];
+		size_t reference_end = reference_starts[i] + single.alleles[0].size();
+		DnaSequence left;
+		DnaSequence right;
+		reference_allele.substr(reference_starts[i] - flank_size, reference_starts[i], left);
+		reference_allele.substr(reference_end, reference_end + flank_size, right);
+		vector<DnaSequence> alleles(single.alleles.size());
+		for (size_t a = 0; a < alleles.size(); ++a) {
+			alleles[a].append(single.alleles[a]);
+		}
+		vector<unsigned char> paths = single.paths;
+		// construct new variant object
+		resulting_variants->push_back(Variant(left, right, this->chromosome, single.start_position, single.start_position + alleles[0].size(), alleles, paths, string(single.id)));
+	}
+	if (input_genotyping != nullptr) this->separate_genotyping(*input_genotyping, *resulting_genotyping);
+}
 
+void Variant::get_single_variants (vector<SingleVariant>& result) const {
+	size_t nr_variants = this->nr_of_variants();
+	assert (this->uncovered_alleles.size() == nr_variants);
 	size_t current_start = this->start_position;
-
 	for (size_t i = 0; i < nr_variants; ++i) {
-		DnaSequence left = construct_left_flank(reference_allele, i*2 + 1, this->left_flank.size());
-		DnaSequence right = construct_right_flank(reference_allele, i*2 + 1, this->right_flank.size());
-		vector<DnaSequence> alleles = this->allele_sequences.at(i);
-		size_t current_end = current_start + alleles[0].size();
-
-		// construct new variant object
-		Variant v(left, right, this->chromosome, current_start, current_end, alleles, paths_per_variant.at(i), this->variant_ids.at(i));
-
-		resulting_variants->push_back(v);
-		if (input_genotyping != nullptr) {
-			// construct GenotypingResult
-			GenotypingResult g;
-			// precompute alleles
-			vector<unsigned char> precomputed_ids (this->nr_of_alleles());
-			for (size_t a0 = 0; a0 < this->nr_of_alleles(); ++a0) {
-				unsigned char single_allele0 = this->allele_combinations[a0][i];
-				precomputed_ids[a0] = single_allele0;
-			}
-			// iterate through all genotypes and determine the genotype likelihoods for single variant
-			for (size_t a0 = 0; a0 < this->nr_of_alleles(); ++a0) {
-				// determine allele a0 genotype corresponds to
-				unsigned char single_allele0 = precomputed_ids[a0];
-				for (size_t a1 = a0; a1 < this->nr_of_alleles(); ++a1) {
-					// determine allele a1 genotype corresponds to
-					unsigned char single_allele1 = precomputed_ids[a1];
-					// update genotype likelihood
-					long double combined_likelihood = input_genotyping->get_genotype_likelihood(a0, a1);
-					g.add_to_likelihood(single_allele0, single_allele1, combined_likelihood);
-				}
-			}
-			// get the haplotype alleles of the combined variant
-			pair<unsigned char,unsigned char> haplotype = input_genotyping->get_haplotype();
-			// get corresponding alleles for current variant
-			unsigned char single_haplotype0 = precomputed_ids[haplotype.first];
-			unsigned char single_haplotype1 = precomputed_ids[haplotype.second];
-			// update result
-			g.add_first_haplotype_allele(single_haplotype0);
-			g.add_second_haplotype_allele(single_haplotype1);
-			resulting_genotyping->push_back(g);
+		SingleVariant& single = result.emplace_back();
+		single.start_position = current_start;
+		single.id = this->variant_ids.at(i);
+		for (size_t a = 0; a < this->allele_offsets[i+1] - this->allele_offsets[i]; ++a) {
+			single.alleles.push_back(this->get_single_allele(i, a));
+		}
+		// allele of the individual variant on each path
+		for (auto a : this->paths) {
+			single.paths.push_back(this->allele_combinations[a * nr_variants + i]);
 		}
 		// update start position
-		current_start = current_end;
+		current_start += single.alleles[0].size();
 		if (i < (nr_variants-1)) {
-			current_start += this->inner_flanks[i].size();
+			current_start += this->get_segment(this->inner_flanks[i]).size();
 		}
 	}
 }
 
+void Variant::separate_genotyping (const GenotypingResult& input_genotyping, vector<GenotypingResult>& result) const {
+	size_t nr_variants = this->nr_of_variants();
+	for (size_t i = 0; i < nr_variants; ++i) {
+		// construct GenotypingResult
+		GenotypingResult g;
+		// precompute alleles
+		vector<unsigned char> precomputed_ids (this->nr_of_alleles());
+		for (size_t a0 = 0; a0 < this->nr_of_alleles(); ++a0) {
+			unsigned char single_allele0 = this->allele_combinations[a0 * nr_variants + i];
+			precomputed_ids[a0] = single_allele0;
+		}
+		// iterate through all genotypes and determine the genotype likelihoods for single variant
+		for (size_t a0 = 0; a0 < this->nr_of_alleles(); ++a0) {
+			// determine allele a0 genotype corresponds to
+			unsigned char single_allele0 = precomputed_ids[a0];
+			for (size_t a1 = a0; a1 < this->nr_of_alleles(); ++a1) {
+				// determine allele a1 genotype corresponds to
+				unsigned char single_allele1 = precomputed_ids[a1];
+				// update genotype likelihood
+				long double combined_likelihood = input_genotyping.get_genotype_likelihood(a0, a1);
+				g.add_to_likelihood(single_allele0, single_allele1, combined_likelihood);
+			}
+		}
+		// get the haplotype alleles of the combined variant
+		pair<unsigned char,unsigned char> haplotype = input_genotyping.get_haplotype();
+		// get corresponding alleles for current variant
+		unsigned char single_haplotype0 = precomputed_ids[haplotype.first];
+		unsigned char single_haplotype1 = precomputed_ids[haplotype.second];
+		// update result
+		g.add_first_haplotype_allele(single_haplotype0);
+		g.add_second_haplotype_allele(single_haplotype1);
+		result.push_back(g);
+	}
+}
 
 void Variant::variant_statistics (UniqueKmers* unique_kmers, vector<VariantStats>& result) const {
-	size_t nr_variants = this->allele_sequences.size();
+	size_t nr_variants = this->nr_of_variants();
 	assert (this->uncovered_alleles.size() == nr_variants);
 
 	for (size_t i = 0; i < nr_variants; ++i) {
@@ -397,7 +429,7 @@ void Variant::variant_statistics (UniqueKmers* unique_kmers, vector<VariantStats
 		map<unsigned char, int> new_kmer_counts;
 		vector<unsigned char> precomputed_ids (this->nr_of_alleles());
 		for (size_t a0 = 0; a0 < this->nr_of_alleles(); ++a0) {
-			unsigned char single_allele0 = this->allele_combinations[a0][i];
+			unsigned char single_allele0 = this->allele_combinations[a0 * nr_variants + i];
 			precomputed_ids[a0] = single_allele0;
 		}
 		// iterate through all alleles and determine number of unique kmers
@@ -424,15 +456,15 @@ void Variant::variant_statistics (UniqueKmers* unique_kmers, vector<VariantStats
 
 
 bool Variant::is_combined() const {
-	return (this->allele_sequences.size() > 1);
+	return (this->nr_of_variants() > 1);
 }
 
 ostream& operator<<(ostream& os, const Variant& var) {
-	os << "left flank:\t" << var.left_flank.to_string() << endl;
-	os << "right flank:\t" << var.right_flank.to_string() << endl;	
+	os << "left flank:\t" << var.get_segment(var.left_flank).to_string() << endl;
+	os << "right flank:\t" << var.get_segment(var.right_flank).to_string() << endl;	
 	os << "position:\t" << var.chromosome << ":" << var.start_position << "-" << var.get_end_position() << endl;
 	os << "alleles:" << endl;
-	for (size_t i = 0; i < var.allele_combinations.size(); ++i) {
+	for (size_t i = 0; i < var.nr_of_alleles(); ++i) {
 		os << i << ":\t";
 		os << var.get_allele_string(i);
 		os << endl;
@@ -443,7 +475,7 @@ ostream& operator<<(ostream& os, const Variant& var) {
 		for (size_t j = 0; j < var.uncovered_alleles[i].size(); ++j) {
 			if (j > 0) os << ",";
 			unsigned char id = var.uncovered_alleles[i][j];
-			os << var.allele_sequences[i][id].to_string();
+			os << var.get_single_allele(i, id).to_string();
 		}
 		os << "}" << endl;
 	}
@@ -454,15 +486,15 @@ ostream& operator<<(ostream& os, const Variant& var) {
 	
 	os << "inner flanks:" << endl;
 	for (auto s : var.inner_flanks) {
-		os << s.to_string() << endl;
+		os << var.get_segment(s).to_string() << endl;
 	}
 	return os;
 }
 
 bool operator==(const Variant& v1, const Variant& v2) {
 	// check flanks
-	if (v1.left_flank != v2.left_flank) return false;
-	if (v1.right_flank != v2.right_flank) return false;
+	if (v1.get_segment(v1.left_flank) != v2.get_segment(v2.left_flank)) return false;
+	if (v1.get_segment(v1.right_flank) != v2.get_segment(v2.right_flank)) return false;
 
 	// check chromosome
 	if (v1.chromosome != v2.chromosome) return false;
@@ -472,9 +504,15 @@ bool operator==(const Variant& v1, const Variant& v2) {
 	if (v1.get_end_position() != v2.get_end_position()) return false;
 
 	// check alleles
-	if (v1.allele_sequences != v2.allele_sequences) return false;
+	if (v1.allele_offsets != v2.allele_offsets) return false;
+	for (size_t i = 0; i < v1.allele_segments.size(); ++i) {
+		if (v1.get_segment(v1.allele_segments[i]) != v2.get_segment(v2.allele_segments[i])) return false;
+	}
 	if (v1.allele_combinations != v2.allele_combinations) return false;
-	if (v1.inner_flanks != v2.inner_flanks) return false;
+	if (v1.inner_flanks.size() != v2.inner_flanks.size()) return false;
+	for (size_t i = 0; i < v1.inner_flanks.size(); ++i) {
+		if (v1.get_segment(v1.inner_flanks[i]) != v2.get_segment(v2.inner_flanks[i])) return false;
+	}
 
 	// check uncovered alleles
 	if (v1.uncovered_alleles != v2.uncovered_alleles) return false;
@@ -509,6 +547,26 @@ float Variant::allele_frequency(unsigned char allele_index, bool ignore_ref_path
 	return freq / size;
 }
 
+/** frequencies of the alleles on the given paths **/
+static void path_allele_frequencies(const vector<unsigned char>& paths, size_t nr_alleles, bool ignore_ref_path, vector<float>& result) {
+	result.assign(nr_alleles, 0.0);
+	if (paths.size() == 0) return;
+	for (auto a : paths) {
+		result.at(a) += 1;
+	}
+	unsigned int size = paths.size();
+	if (ignore_ref_path) {
+		size -= 1;
+		assert(result[0] >= 1.0);
+		result[0] -= 1.0;
+	}
+	for (auto& freq : result) freq = freq / size;
+}
+
+void Variant::allele_frequencies(bool ignore_ref_path, vector<float>& result) const {
+	path_allele_frequencies(this->paths, nr_of_alleles(), ignore_ref_path, result);
+}
+
 string Variant::get_id() const {
 	string result = "";
 	for (size_t i = 0; i < this->variant_ids.size(); ++i) {
@@ -519,19 +577,43 @@ string Variant::get_id() const {
 }
 
 bool Variant::is_undefined_allele(size_t allele_id) const {
-	DnaSequence allele_without_flanks;
-	for (size_t i = 0; i < this->allele_combinations.at(allele_id).size(); ++i) {
-		unsigned char allele = this->allele_combinations.at(allele_id).at(i);
-		allele_without_flanks.append(this->allele_sequences.at(i).at(allele));
+	if (allele_id >= this->nr_of_alleles()) {
+		throw runtime_error("Variant::is_undefined_allele: Index out of bounds.");
+	}
+	size_t nr_variants = this->nr_of_variants();
+	for (size_t i = 0; i < nr_variants; ++i) {
+		if (this->get_single_allele(i, this->allele_combinations[allele_id * nr_variants + i]).contains_undefined()) return true;
 	}
-	return allele_without_flanks.contains_undefined();
+	return false;
 }
 
 size_t Variant::nr_missing_alleles() const {
 	size_t missing = 0;
 	for (auto path : this->paths) {
-		DnaSequence allele = this->get_allele_sequence(path);
-		if (allele.contains_undefined()) missing += 1;
+		vector<DnaSequenceView> parts;
+		this->get_allele_parts(path, parts);
+		for (auto& part : parts) {
+			if (part.contains_undefined()) {
+				missing += 1;
+				break;
+			}
+		}
+	}
+	return missing;
+}
+
+bool SingleVariant::is_undefined_allele(size_t allele_id) const {
+	return this->alleles.at(allele_id).contains_undefined();
+}
+
+size_t SingleVariant::nr_missing_alleles() const {
+	size_t missing = 0;
+	for (auto path : this->paths) {
+		if (this->alleles[path].contains_undefined()) missing += 1;
 	}
 	return missing;
 }
+
+void SingleVariant::allele_frequencies(bool ignore_ref_path, vector<float>& result) const {
+	path_allele_frequencies(this->paths, this->alleles.size(), ignore_ref_path, result);
+}
@@ -3,11 +3,13 @@
 
 #include <vector>
 #include <string>
+#include <string_view>
 #include <iostream>
+#include <stdint.h>
+#include <unordered_map>
 #include "genotypingresult.hpp"
 #include "dnasequence.hpp"
 #include "uniquekmers.hpp"
-#include "cereal/access.hpp"
 /** 
 * Represents a variant.
 **/
@@ -18,6 +20,22 @@ struct VariantStats {
 	unsigned short coverage;
 };
 
+/** individual variant of a (combined) variant, refers to the sequences of the latter (see Variant::get_single_variants) **/
+struct SingleVariant {
+	size_t start_position;
+	std::string_view id;
+	/** allele sequences (first one is the reference allele) **/
+	std::vector<DnaSequenceView> alleles;
+	/** allele each path covers **/
+	std::vector<unsigned char> paths;
+	/** check whether the given allele is undefined **/
+	bool is_undefined_allele(size_t allele_id) const;
+	/** return number of paths with missing alleles **/
+	size_t nr_missing_alleles() const;
+	/** compute the allele frequencies of all alleles **/
+	void allele_frequencies(bool ignore_ref_path, std::vector<float>& result) const;
+};
+
 class Variant {
 public:
 	/** 
@@ -42,6 +60,10 @@ public:
 	void combine_variants (Variant const &v2);
 	/** separate variants that have been combined **/
 	void separate_variants (std::vector<Variant>* resulting_variants, const GenotypingResult* input_genotyping = nullptr, std::vector<GenotypingResult>* resulting_genotyping = nullptr) const;
+	/** views of the individual variants, valid as long as this variant is neither modified nor destroyed **/
+	void get_single_variants (std::vector<SingleVariant>& result) const;
+	/** genotyping results of the individual variants **/
+	void separate_genotyping (const GenotypingResult& input_genotyping, std::vector<GenotypingResult>& result) const;
 	/** total number of alleles of the variant **/
 	size_t nr_of_alleles() const;
 	/** total number of paths covering the variant **/
@@ -64,11 +86,15 @@ public:
 	void get_paths_of_allele(unsigned char allele_index, std::vector<size_t>& result) const;
 	/** check if this is a combined variant **/
 	bool is_combined() const;
+	/** remove sequences that are no longer used (combine_variants leaves them behind) **/
+	void compact();
 	friend std::ostream& operator<<(std::ostream& os, const Variant& var);
 	friend bool operator==(const Variant& v1, const Variant& v2);
 	friend bool operator!=(const Variant& v1, const Variant& v2);
 	/** compute allele frequency of the given allele **/
 	float allele_frequency(unsigned char allele_index, bool ignore_ref_path = false) const;
+	/** compute the allele frequencies of all alleles at once **/
+	void allele_frequencies(bool ignore_ref_path, std::vector<float>& result) const;
 	/** return variant ID **/
 	std::string get_id() const;
 	/** check whether the given allele is undefined **/
@@ -79,32 +105,49 @@ public:
 	void variant_statistics (UniqueKmers* unique_kmers, std::vector<VariantStats>& result) const;
     template<class Archive>
     void serialize(Archive& archive) {  // NOLINT
-      archive(left_flank, right_flank, inner_flanks, chromosome, start_position, variant_ids, allele_sequences, allele_combinations, uncovered_alleles, paths, flanks_added);
+      archive(sequences, segments, left_flank, right_flank, inner_flanks, chromosome, start_position, variant_ids, allele_segments, allele_offsets, allele_combinations, uncovered_alleles, paths, flanks_added);
     }
 
 private:
-    friend cereal::access;
-	// flanking sequence at left end
-	DnaSequence left_flank;
-	// flanking sequence at right end
-	DnaSequence right_flank;
-	// sequences between two combined alleles
-	std::vector<DnaSequence> inner_flanks;
+	// all distinct sequences of the variant (flanks, sequences between combined variants, alleles) concatenated
+	DnaSequence sequences;
+	// start and length of each sequence stored in sequences
+	std::vector<std::pair<uint32_t,uint32_t>> segments;
+	// flanking sequence at left end (index of segment)
+	uint32_t left_flank;
+	// flanking sequence at right end (index of segment)
+	uint32_t right_flank;
+	// sequences between two combined alleles (indices of segments)
+	std::vector<uint32_t> inner_flanks;
 	// chromosome
 	std::string chromosome;
 	// starting position of variant
 	size_t start_position;
 	// IDs of individual variants
 	std::vector<std::string> variant_ids;
-	// allele sequences of individual variants
-	std::vector<std::vector<DnaSequence>> allele_sequences;
-	// combined alleles
-	std::vector<std::vector<unsigned char>> allele_combinations;
+	// allele sequences of all individual variants (indices of segments)
+	std::vector<uint32_t> allele_segments;
+	// index of the first allele of each individual variant in allele_segments (one additional entry at the end)
+	std::vector<uint32_t> allele_offsets;
+	// combined alleles, one row of nr_of_variants() alleles per combined allele
+	std::vector<unsigned char> allele_combinations;
 	// alleles not covered by any path
 	std::vector<std::vector<unsigned char>> uncovered_alleles;
 	std::vector<unsigned char> paths;
 	bool flanks_added;
+	// segment of each stored sequence, used to find identical sequences. Not serialized, rebuilt on demand and released by compact()
+	std::unordered_map<DnaSequence, uint32_t, DnaSequenceHash> segment_index;
 	void set_values(size_t end_position);
+	void set_sequences(const DnaSequence& left_flank, const DnaSequence& right_flank, const std::vector<DnaSequence>& alleles);
+	/** store a sequence (unless an identical one is already stored) and return the index of its segment **/
+	uint32_t add_segment(const DnaSequenceView& sequence);
+	DnaSequenceView get_segment(uint32_t index) const;
+	/** number of individual variants **/
+	size_t nr_of_variants() const;
+	/** sequence of allele allele_id of the individual variant variant_index **/
+	DnaSequenceView get_single_allele(size_t variant_index, unsigned char allele_id) const;
+	/** sequences making up the given (combined) allele **/
+	void get_allele_parts(size_t index, std::vector<DnaSequenceView>& result) const;
 };
 
 #endif //VARIANT_HPP
@@ -2,52 +2,134 @@
 #include <iostream>
 #include <iomanip>
 #include <math.h>
-#include <regex>
+#include <charconv>
 #include "variantreader.hpp"
-#include "cereal/archives/binary.hpp"
+#include "vcfparser.hpp"
+#include "bgzfreader.hpp"
+#include "tabixindex.hpp"
+#include "threadpool.hpp"
 
 using namespace std;
 
-//std::string hash_filenames(std::string reference, std::string vcf) {
-//    return std::to_string(std::hash<std::string>{}(std::string(std::filesystem::canonical(reference)) + std::string(std::filesystem::canonical(vcf))));
-//}
+string VariantReader::shard_filename(string filename, size_t index) {
+	return filename + "." + to_string(index);
+}
 
-void parse_line(vector<DnaSequence>& result, string line, char sep) {
-	string token;
-	istringstream iss (line);
-	while (getline(iss, token, sep)) {
-		result.push_back(DnaSequence(token));
+void VariantReader::Store(string filename, string vcf_filename, string reference_filename, size_t nr_threads) const {
+	IndexHeader header = {};
+	header.kmer_size = this->kmer_size;
+	header.add_reference = this->add_reference;
+	header.vcf = file_stamp(vcf_filename);
+	header.reference = file_stamp(reference_filename);
+	vector<string> chromosomes;
+	get_chromosomes(&chromosomes);
+
+	// one shard per chromosome, written in parallel
+	vector<exception_ptr> errors(chromosomes.size());
+	{
+		ThreadPool threadPool (max(min(nr_threads, chromosomes.size()), (size_t) 1));
+		for (size_t c = 0; c < chromosomes.size(); ++c) {
+			string chromosome = chromosomes[c];
+			string shard = shard_filename(filename, c);
+			exception_ptr* error = &errors[c];
+			threadPool.submit([this, chromosome, shard, header, error](){
+				try {
+					IndexWriter writer(shard, header);
+					writer.begin_section("chromosome:" + chromosome);
+					writer(this->variants_per_chromosome.at(chromosome), this->variant_ids.at(chromosome), this->left_overhangs.at(chromosome), this->right_overhangs.at(chromosome));
+					writer.close();
+				} catch (...) {
+					*error = current_exception();
+				}
+			});
+		}
+	}
+	for (auto& error : errors) {
+		if (error) rethrow_exception(error);
 	}
+
+	// manifest listing the chromosomes, the shard of a chromosome is named after its position in the list
+	vector<size_t> variants_per_shard;
+	for (auto& chromosome : chromosomes) variants_per_shard.push_back(this->variants_per_chromosome.at(chromosome).size());
+	IndexWriter writer(filename, header);
+	writer.begin_section("panel");
+	writer(this->nr_paths, this->sample, this->nr_genomic_kmers, chromosomes, variants_per_shard);
+	writer.close();
 }
 
-void parse_line(vector<string>& result, string line, char sep) {
-	string token;
-	istringstream iss (line);
-	while (getline(iss, token, sep)) {
-		result.push_back(token);
+void VariantReader::Load(string filename, size_t kmer_size, bool add_reference, string vcf_filename, string reference_filename, const vector<string>& chromosomes, size_t nr_threads) {
+	IndexReader reader(filename);
+	const IndexHeader header = reader.get_header();
+	if (header.kmer_size != kmer_size) {
+		throw runtime_error("VariantReader::Load: index " + filename + " was built for kmer size " + to_string(header.kmer_size) + ", but kmer size " + to_string(kmer_size) + " is used.");
+	}
+	if ((header.add_reference != 0) != add_reference) {
+		throw runtime_error("VariantReader::Load: index " + filename + " was built " + (header.add_reference ? "with" : "without") + " the reference as additional path (option -d).");
+	}
+	if (!vcf_filename.empty() && !file_matches_stamp(vcf_filename, header.vcf)) {
+		throw runtime_error("VariantReader::Load: index " + filename + " was not built from VCF " + vcf_filename + " (or the VCF has changed since). Please rebuild the index.");
+	}
+	if (!reference_filename.empty() && !file_matches_stamp(reference_filename, header.reference)) {
+		throw runtime_error("VariantReader::Load: index " + filename + " was not built from reference " + reference_filename + " (or the reference has changed since). Please rebuild the index.");
+	}
+	this->kmer_size = kmer_size;
+	this->add_reference = add_reference;
+	vector<string> stored_chromosomes;
+	vector<size_t> variants_per_shard;
+	reader.seek_section("panel");
+	reader(this->nr_paths, this->sample, this->nr_genomic_kmers, stored_chromosomes, variants_per_shard);
+
+	// determine the shards to be read (all if no chromosomes are given)
+	vector<size_t> shards;
+	for (size_t c = 0; c < stored_chromosomes.size(); ++c) {
+		if (chromosomes.empty() || (find(chromosomes.begin(), chromosomes.end(), stored_chromosomes[c]) != chromosomes.end())) shards.push_back(c);
+	}
+	for (auto& chromosome : chromosomes) {
+		if (find(stored_chromosomes.begin(), stored_chromosomes.end(), chromosome) == stored_chromosomes.end()) {
+			throw runtime_error("VariantReader::Load: chromosome " + chromosome + " is not present in index " + filename + ".");
+		}
 	}
-}
 
-void VariantReader::Store() const {
-  std::ofstream os("pangenie."+this->REF_VCF_HASH_NAME + ".cereal");
-  try {
-    cereal::BinaryOutputArchive archive(os);
-    archive(*this);
-  } catch (std::exception&) {
-    throw std::logic_error(
-        "[raven::Graph::Store] error: unable to store archive");
-  }
-}
-void VariantReader::Load(std::string name) {
-  std::cout<< "attempting to read name: " << "pangenie."+name+".cereal" << std::endl;
-  std::ifstream is("pangenie."+name+".cereal");
-  try {
-    cereal::BinaryInputArchive archive(is);
-    archive(*this);
-  } catch (std::exception&) {
-    throw std::logic_error(
-        "[raven::Graph::Load] error: unable to load archive");
-  }
+	// entries are created beforehand, so that threads only access existing map elements
+	this->variants_per_chromosome.clear();
+	this->variant_ids.clear();
+	this->left_overhangs.clear();
+	this->right_overhangs.clear();
+	this->nr_variants = 0;
+	for (size_t shard : shards) {
+		string& chromosome = stored_chromosomes[shard];
+		this->variants_per_chromosome[chromosome];
+		this->variant_ids[chromosome];
+		this->left_overhangs[chromosome];
+		this->right_overhangs[chromosome];
+		this->nr_variants += variants_per_shard[shard];
+	}
+	vector<exception_ptr> errors(shards.size());
+	{
+		ThreadPool threadPool (max(min(nr_threads, shards.size()), (size_t) 1));
+		for (size_t s = 0; s < shards.size(); ++s) {
+			string chromosome = stored_chromosomes[shards[s]];
+			string shard = shard_filename(filename, shards[s]);
+			exception_ptr* error = &errors[s];
+			threadPool.submit([this, chromosome, shard, header, error](){
+				try {
+					IndexReader shard_reader(shard);
+					const IndexHeader& shard_header = shard_reader.get_header();
+					// make sure the shard belongs to the same index
+					if ((shard_header.kmer_size != header.kmer_size) || (shard_header.add_reference != header.add_reference) || (shard_header.vcf.fingerprint != header.vcf.fingerprint) || (shard_header.reference.fingerprint != header.reference.fingerprint)) {
+						throw runtime_error("VariantReader::Load: shard " + shard + " does not belong to this index. Please rebuild the index.");
+					}
+					shard_reader.seek_section("chromosome:" + chromosome);
+					shard_reader(this->variants_per_chromosome.at(chromosome), this->variant_ids.at(chromosome), this->left_overhangs.at(chromosome), this->right_overhangs.at(chromosome));
+				} catch (...) {
+					*error = current_exception();
+				}
+			});
+		}
+	}
+	for (auto& error : errors) {
+		if (error) rethrow_exception(error);
+	}
 }
 
 void VariantReader::insert_ids(string& chromosome, vector<DnaSequence>& alleles, vector<string>& variant_ids, bool reference_added) {
@@ -58,10 +140,10 @@ void VariantReader::insert_ids(string& chromosome, vector<DnaSequence>& alleles,
 	for (auto id : index) {
 		sorted_ids.push_back(variant_ids[id]);
 	}
-	this->variant_ids[chromosome].push_back(sorted_ids);
+	this->variant_ids.at(chromosome).push_back(sorted_ids);
 }
 
-string VariantReader::get_ids(string chromosome, vector<string>& alleles, size_t variant_index, bool reference_added) {
+string VariantReader::get_ids(string chromosome, vector<string>& alleles, size_t variant_index, bool reference_added) const {
 	vector<unsigned char> index = construct_index(alleles, reference_added);
 	assert(index.size() < 256);
 	vector<string> sorted_ids(index.size());
@@ -77,205 +159,324 @@ string VariantReader::get_ids(string chromosome, vector<string>& alleles, size_t
 	return result;
 }
 
-bool matches_pattern(string& sequence, regex& r) {
-	size_t total_length = sequence.size();
-	string control = "";
-	auto begin = sequence.begin();
-	size_t length = 1000;
-	size_t letters_seen = 0;
-	while (begin + letters_seen != sequence.end()) {
-		size_t next_interval = min(length, total_length - letters_seen);
-		if (!regex_match(begin + letters_seen, begin + letters_seen + next_interval, r)) {
-			return false;
-		}
-		control += string(begin + letters_seen, begin + letters_seen + next_interval);
-		letters_seen += next_interval;
-	}
-	assert(control == sequence);
-	return true;
-}
-
-void parse_info_fields(vector<string>& result, string line) {
-	vector<string> fields;
-	parse_line(fields, line, ';');
-	for (auto s : fields) {
-		if (s.rfind("ID=", 0) == 0) {
-			// ID field present
-			parse_line(result, s.substr (3), ',');
-		}
-	}
-}
-
-VariantReader::VariantReader(string filename, string reference_filename, size_t kmer_size, bool add_reference, string sample)
+VariantReader::VariantReader(string filename, string reference_filename, size_t kmer_size, bool add_reference, string sample, size_t nr_threads)
 	:fasta_reader(reference_filename),
 	 kmer_size(kmer_size),
 	 nr_variants(0),
 	 add_reference(add_reference),
 	 sample(sample),
-	 genotyping_outfile_open(false),
-	 phasing_outfile_open(false)
+	 nr_genomic_kmers(0)
 {
-	if (filename.substr(filename.size()-3,3).compare(".gz") == 0) {
-		throw runtime_error("VariantReader::VariantReader: Uncompressed VCF-file is required.");
-	}
 	ifstream file(filename);
 	if (!file.good()) {
 		throw runtime_error("VariantReader::VariantReader: input VCF file cannot be opened.");
 	}
-    //
-    //REF_VCF_HASH_NAME = hash_filenames(reference_filename,filename);
+	file.close();
 
-	string line;
-    string previous_chrom("");
+	if (filename.substr(filename.size()-3,3).compare(".gz") == 0) {
+		if (!BgzfReader::is_bgzf(filename)) {
+			throw runtime_error("VariantReader::VariantReader: compressed VCF-files must be compressed with bgzip.");
+		}
+		read_bgzf_vcf(filename, nr_threads);
+	} else {
+		read_vcf(filename, nr_threads);
+	}
+	// count variants
+	this->nr_variants = 0;
+	for (auto& chromosome : this->variants_per_chromosome) {
+		this->nr_variants += chromosome.second.size();
+	}
+	cerr << "Identified " << this->nr_variants << " variants in total from VCF-file." << endl;
+	this->nr_genomic_kmers = this->fasta_reader.get_total_kmers(this->kmer_size);
+	store_overhangs(nr_threads);
+}
+
+void VariantReader::store_overhangs(size_t nr_threads) {
+	size_t length = 2 * this->kmer_size;
+	// entries are created beforehand, so that threads only access existing map elements
+	for (auto& chromosome : this->variants_per_chromosome) {
+		this->left_overhangs[chromosome.first].resize(chromosome.second.size());
+		this->right_overhangs[chromosome.first].resize(chromosome.second.size());
+	}
+	vector<exception_ptr> errors(this->variants_per_chromosome.size());
+	{
+		ThreadPool threadPool (max(min(nr_threads, this->variants_per_chromosome.size()), (size_t) 1));
+		size_t c = 0;
+		for (auto& chromosome : this->variants_per_chromosome) {
+			string name = chromosome.first;
+			exception_ptr* error = &errors[c++];
+			threadPool.submit([this, name, length, error](){
+				try {
+					vector<DnaSequence>& left = this->left_overhangs.at(name);
+					vector<DnaSequence>& right = this->right_overhangs.at(name);
+					for (size_t i = 0; i < left.size(); ++i) {
+						read_left_overhang(name, i, length, left[i]);
+						read_right_overhang(name, i, length, right[i]);
+					}
+				} catch (...) {
+					*error = current_exception();
+				}
+			});
+		}
+	}
+	for (auto& error : errors) {
+		if (error) rethrow_exception(error);
+	}
+}
+
+void VariantReader::set_nr_paths(size_t nr_samples) {
+	this->nr_paths = nr_samples*2;
+	// add one for reference path
+	if (this->add_reference) this->nr_paths += 1;
+}
+
+void VariantReader::read_vcf(string filename, size_t nr_threads) {
+	// records are tokenized in parallel, variants are clustered sequentially in file order
+	VcfParser parser(filename, nr_threads);
+	set_nr_paths(parser.get_samples().size());
+
+	string previous_chrom("");
 	size_t previous_end_pos = 0;
-	map<unsigned int, string> fields = { {0, "#CHROM"}, {1, "POS"}, {2, "ID"}, {3, "REF"}, {4, "ALT"}, {5, "QUAL"}, {6, "FILTER"}, {7, "INFO"}, {8, "FORMAT"} };
 	vector<Variant> variant_cluster;
-	// read VCF-file line by line
-	while (getline(file, line)) {
-		if (line.size() == 0) continue;
-		vector<string> tokens;
-		parse_line(tokens, line, '\t');
-		// header lines?
-		if (tokens[0].substr(0,2) == "##") continue;
-		if (tokens[0].at(0) == '#') {
-			// check number of samples/paths given
-			if (tokens.size() < 9) {
-				throw runtime_error("VariantReader::VariantReader: not a proper VCF-file.");
+	vector<VcfRecord> records;
+	string current_chrom("");
+	while (parser.next_batch(records)) {
+		for (const VcfRecord& record : records) {
+			// add_record only accesses existing map elements, create them for each new chromosome
+			if (record.chromosome != current_chrom) {
+				current_chrom = string(record.chromosome);
+				this->variants_per_chromosome[current_chrom];
+				this->variant_ids[current_chrom];
 			}
-			if (tokens.size() < 10) {
-				throw runtime_error("VariantReader::VariantReader: no haplotype paths given.");
-			}
-			// validate header line
-			for (unsigned int i = 0; i < 9; ++i) {
-				if (tokens[i] != fields[i]) {
-					throw runtime_error("VariantReader::VariantReader: VCF header line is malformed.");
-				}
-			}
-			this->nr_paths = (tokens.size() - 9)*2;
-			// add one for reference path
-			if (add_reference) this->nr_paths += 1;
-			continue;
+			add_record(record, previous_chrom, previous_end_pos, variant_cluster);
 		}
-		if (tokens.size() < 10) {
-			throw runtime_error("VariantReader::VariantReader: malformed VCF-file, or no haplotype paths given in VCF.");
-		}
-		// get chromosome
-		string current_chrom = tokens[0];
-		// get position
-		size_t current_start_pos;
-		stringstream sstream(tokens[1]);
-		sstream >> current_start_pos;
-		// VCF positions are 1-based
-		current_start_pos -= 1;
-		// if variant is contained in previous one, skip it
-		if ((previous_chrom == current_chrom) && (current_start_pos < previous_end_pos)) {
-			cerr << "VariantReader: skip variant at " << current_chrom << ":" << current_start_pos << " since it is contained in a previous one."  << endl;
-			continue;
-		}
-		// if distance to next variant is larger than kmer_size, start a new cluster
-		if ( (previous_chrom != current_chrom) || (current_start_pos - previous_end_pos) >= (kmer_size-1) ) {
-			// merge all variants currently in cluster and store them
-			add_variant_cluster(previous_chrom, &variant_cluster);
-			variant_cluster.clear();
-		}
-		// get REF allele
-		DnaSequence ref(tokens[3]);
-		DnaSequence observed_allele;
-		this->fasta_reader.get_subsequence(current_chrom, current_start_pos, current_start_pos + ref.size(), observed_allele);
-		if (ref != observed_allele) {
-			throw runtime_error("VariantReader::VariantReader: reference allele given in VCF does not match allele in reference fasta file at that position.");
-		}
-		size_t current_end_pos = current_start_pos + ref.size();
-		// get ALT alleles
-		vector<DnaSequence> alleles = {ref};
-		// make sure alt alleles are given explicitly
-		regex r("^[CAGTcagt,]+$");
-		if (!matches_pattern(tokens[4], r)) {
-//		if (!regex_match(tokens[4], r)) {
-			// skip this position
-			cerr << "VariantReader: skip variant at " << current_chrom << ":" << current_start_pos << " since alleles contain undefined nucleotides: " << tokens[4] << endl;
-			continue;
+	}
+	// add last cluster to list
+	add_variant_cluster(previous_chrom, &variant_cluster);
+
+	// remove chromosomes without variants
+	for (auto it = this->variants_per_chromosome.begin(); it != this->variants_per_chromosome.end(); ) {
+		if (it->second.empty()) {
+			this->variant_ids.erase(it->first);
+			it = this->variants_per_chromosome.erase(it);
+		} else {
+			++it;
 		}
-		parse_line(alleles, tokens[4], ',');
+	}
+}
 
-		// currently, number of alleles is limited to 256
-		if (alleles.size() > 255) {
-			throw runtime_error("VariantReader: number of alternative alleles is limited to 254 in current implementation. Make sure the VCF contains only alternative alleles covered by at least one of the haplotypes.");
+void VariantReader::read_bgzf_vcf(string filename, size_t nr_threads) {
+	string index_file = TabixIndex::find_index(filename);
+	if (index_file.empty()) {
+		throw runtime_error("VariantReader::read_bgzf_vcf: index (.tbi or .csi) of " + filename + " not found. Create it using tabix -p vcf.");
+	}
+	TabixIndex index(index_file);
+
+	// read header
+	{
+		BgzfReader reader(filename);
+		vector<char> block;
+		string header;
+		string decompressed;
+		while (reader.read_block(block)) {
+			BgzfReader::decompress_block(block, decompressed);
+			header += decompressed;
+			// stop once the header line is complete
+			size_t header_line = header.find("#CHROM");
+			if ((header_line != string::npos) && (header.find('\n', header_line) != string::npos)) break;
 		}
+		vector<string> samples;
+		VcfParser::parse_header(header.data(), header.data() + header.size(), samples);
+		set_nr_paths(samples.size());
+	}
 
-		// TODO: handle cases where variant is less than kmersize from start or end of the chromosome
-		if ( (current_start_pos < (kmer_size*2) ) || ( (current_end_pos + (kmer_size*2)) > this->fasta_reader.get_size_of(current_chrom)) ) {
-			cerr << "VariantReader: skip variant at " << current_chrom << ":" << current_start_pos << " since variant is less than 2 * kmer size from start or end of chromosome. " << endl;
-			continue;
+	// each chromosome is read and clustered independently. Entries are created beforehand,
+	// so that threads only access existing map elements.
+	vector<pair<uint64_t,string>> chromosomes;
+	for (auto& name : index.get_sequence_names()) {
+		uint64_t begin, end;
+		if (!index.get_range(name, begin, end)) continue;
+		this->variants_per_chromosome[name];
+		this->variant_ids[name];
+		// process large chromosomes first
+		chromosomes.push_back(make_pair((end >> 16) - (begin >> 16), name));
+	}
+	sort(chromosomes.rbegin(), chromosomes.rend());
+
+	vector<exception_ptr> errors(chromosomes.size());
+	{
+		ThreadPool threadPool (max(min(nr_threads, chromosomes.size()), (size_t) 1));
+		for (size_t c = 0; c < chromosomes.size(); ++c) {
+			string name = chromosomes[c].second;
+			exception_ptr* error = &errors[c];
+			uint64_t begin, end;
+			index.get_range(name, begin, end);
+			threadPool.submit([this, filename, name, begin, end, error](){
+				try {
+					this->read_bgzf_chromosome(filename, name, begin, end);
+				} catch (...) {
+					*error = current_exception();
+				}
+			});
 		}
+	}
+	for (auto& error : errors) {
+		if (error) rethrow_exception(error);
+	}
 
-		// store mapping of alleles to variant ids
-		vector<string> var_ids;
-		parse_info_fields(var_ids, tokens[7]);
-		if (!var_ids.empty()) {
-			insert_ids(current_chrom, alleles, var_ids, true);
-		} else {
-			this->variant_ids[current_chrom].push_back(vector<string>());
+	// remove chromosomes without variants
+	for (auto& c : chromosomes) {
+		if (this->variants_per_chromosome.at(c.second).empty()) {
+			this->variants_per_chromosome.erase(c.second);
+			this->variant_ids.erase(c.second);
 		}
+	}
+}
+
+void VariantReader::read_bgzf_chromosome(string filename, string chromosome, uint64_t begin, uint64_t end) {
+	// virtual offsets: offset of the compressed block << 16 | offset within the decompressed block
+	BgzfReader reader(filename);
+	reader.seek(begin >> 16);
+	uint64_t last_block = end >> 16;
+	size_t skip = begin & 0xffff;
+	size_t batch_size = 1 << 24;
 
-		// make sure that there are at most 255 paths (including reference path in case it is requested)
-		if (this->nr_paths > 255) {
-			throw runtime_error("VariantReader: number of paths is limited to 254 in current implementation.");
+	string previous_chrom("");
+	size_t previous_end_pos = 0;
+	vector<Variant> variant_cluster;
+	vector<VcfRecord> records;
+	vector<char> block;
+	string decompressed;
+	string text;
+	uint64_t block_offset;
+	bool done = false;
+	while (!done) {
+		bool has_block = reader.read_block(block, &block_offset);
+		done = !has_block || (block_offset >= last_block);
+		if (has_block && (block_offset <= last_block)) {
+			BgzfReader::decompress_block(block, decompressed);
+			size_t to = (block_offset == last_block) ? min((size_t) (end & 0xffff), decompressed.size()) : decompressed.size();
+			if (to > skip) text.append(decompressed, skip, to - skip);
+			skip = 0;
 		}
+		if ((text.size() < batch_size) && !done) continue;
+		// parse all complete lines
+		size_t length = done ? text.size() : text.rfind('\n') + 1;
+		records.clear();
+		VcfParser::parse_lines(text.data(), text.data() + length, &records);
+		for (const VcfRecord& record : records) {
+			if (record.chromosome != chromosome) continue;
+			add_record(record, previous_chrom, previous_end_pos, variant_cluster);
+		}
+		records.clear();
+		text.erase(0, length);
+	}
+	// add last cluster to list
+	add_variant_cluster(previous_chrom, &variant_cluster);
+}
 
+void VariantReader::add_record(const VcfRecord& record, string& previous_chrom, size_t& previous_end_pos, vector<Variant>& variant_cluster) {
+	if (record.nr_columns < 10) {
+		throw runtime_error("VariantReader::add_record: malformed VCF-file, or no haplotype paths given in VCF.");
+	}
+	// get chromosome
+	string current_chrom(record.chromosome);
+	// get position
+	size_t current_start_pos = record.position;
+	// if variant is contained in previous one, skip it
+	if ((previous_chrom == current_chrom) && (current_start_pos < previous_end_pos)) {
+		cerr << "VariantReader: skip variant at " << current_chrom << ":" << current_start_pos << " since it is contained in a previous one."  << endl;
+		return;
+	}
+	// if distance to next variant is larger than kmer_size, start a new cluster
+	if ( (previous_chrom != current_chrom) || (current_start_pos - previous_end_pos) >= (kmer_size-1) ) {
+		// merge all variants currently in cluster and store them
+		add_variant_cluster(previous_chrom, &variant_cluster);
+		variant_cluster.clear();
+	}
+	// get REF allele
+	string ref_allele(record.ref);
+	DnaSequence ref(ref_allele);
+	DnaSequence observed_allele;
+	this->fasta_reader.get_subsequence(current_chrom, current_start_pos, current_start_pos + ref.size(), observed_allele);
+	if (ref != observed_allele) {
+		throw runtime_error("VariantReader::add_record: reference allele given in VCF does not match allele in reference fasta file at that position.");
+	}
+	size_t current_end_pos = current_start_pos + ref.size();
+	// make sure alt alleles are given explicitly
+	if (!record.alt_defined) {
+		// skip this position
+		cerr << "VariantReader: skip variant at " << current_chrom << ":" << current_start_pos << " since alleles contain undefined nucleotides: " << record.alt << endl;
+		return;
+	}
+	// get ALT alleles
+	vector<DnaSequence> alleles = {ref};
+	vector<string_view> alt_alleles;
+	VcfParser::split(record.alt, ',', alt_alleles);
+	for (string_view a : alt_alleles) {
+		string allele(a);
+		alleles.push_back(DnaSequence(allele));
+	}
 
-		// construct paths
-		vector<unsigned char> paths = {};
-		if (add_reference) paths.push_back((unsigned char) 0);
-		unsigned char undefined_index = alleles.size();
-		string undefined_allele = "N";
+	// currently, number of alleles is limited to 256
+	if (alleles.size() > 255) {
+		throw runtime_error("VariantReader: number of alternative alleles is limited to 254 in current implementation. Make sure the VCF contains only alternative alleles covered by at least one of the haplotypes.");
+	}
 
-		for (size_t i = 9; i < tokens.size(); ++i) {
-			// make sure all genotypes are phased
-			if (tokens[i].find('/') != string::npos) {
-				throw runtime_error("VariantReader::VariantReader: Found unphased genotype.");
-			}
-			vector<string> p ;
-			parse_line(p, tokens[i], '|');
-			if (p.size() != 2) {
-				throw runtime_error("VariantReader::VariantReader: Found invalid genotype. Genotypes must be diploid (.|. if missing).");
-			}
-			for (string& s : p){
-				// handle unknown genotypes '.'
-				if (s == ".") {
-					// add "NNN" allele to the list of alleles
-					parse_line(alleles, undefined_allele, ',');
-					paths.push_back(undefined_index);
-					assert(undefined_index < 255);
-					undefined_index += 1;
-					undefined_allele += "N";
-				} else {
-					unsigned int p_index = atoi(s.c_str());
-					if (p_index >= alleles.size()) {
-						throw runtime_error("VariantReader::VariantReader: invalid genotype in VCF.");
-					}
-					assert(p_index < 255);
-					paths.push_back( (unsigned char) p_index);
-				}
-			}
-		}
+	// TODO: handle cases where variant is less than kmersize from start or end of the chromosome
+	if ( (current_start_pos < (kmer_size*2) ) || ( (current_end_pos + (kmer_size*2)) > this->fasta_reader.get_size_of(current_chrom)) ) {
+		cerr << "VariantReader: skip variant at " << current_chrom << ":" << current_start_pos << " since variant is less than 2 * kmer size from start or end of chromosome. " << endl;
+		return;
+	}
 
+	// store mapping of alleles to variant ids
+	if (!record.ids.empty()) {
+		vector<string> var_ids(record.ids.begin(), record.ids.end());
+		insert_ids(current_chrom, alleles, var_ids, true);
+	} else {
+		this->variant_ids.at(current_chrom).push_back(vector<string>());
+	}
 
-		// determine left and right flanks
-		DnaSequence left_flank;
-		this->fasta_reader.get_subsequence(current_chrom, current_start_pos - kmer_size + 1, current_start_pos, left_flank);
-		DnaSequence right_flank;
-		this->fasta_reader.get_subsequence(current_chrom, current_end_pos, current_end_pos + kmer_size - 1, right_flank);
-		// add Variant to variant_cluster
-		Variant variant (left_flank, right_flank, current_chrom, current_start_pos, current_end_pos, alleles, paths);
-		variant_cluster.push_back(variant);
-		previous_chrom = current_chrom;
-		previous_end_pos = current_end_pos;
+	// make sure that there are at most 255 paths (including reference path in case it is requested)
+	if (this->nr_paths > 255) {
+		throw runtime_error("VariantReader: number of paths is limited to 254 in current implementation.");
+	}
 
+	// construct paths
+	if (record.genotype_error != nullptr) {
+		throw runtime_error(string("VariantReader::add_record: ") + record.genotype_error);
 	}
-	// add last cluster to list
-	add_variant_cluster(previous_chrom, &variant_cluster);
-	cerr << "Identified " << this->nr_variants << " variants in total from VCF-file." << endl;
+	vector<unsigned char> paths = {};
+	if (add_reference) paths.push_back((unsigned char) 0);
+	unsigned char nr_defined_alleles = alleles.size();
+	unsigned char undefined_index = alleles.size();
+	string undefined_allele = "N";
+	for (unsigned char p_index : record.paths) {
+		if (p_index == VcfParser::UNDEFINED_ALLELE) {
+			// add "NNN" allele to the list of alleles
+			alleles.push_back(DnaSequence(undefined_allele));
+			paths.push_back(undefined_index);
+			assert(undefined_index < 255);
+			undefined_index += 1;
+			undefined_allele += "N";
+		} else {
+			if (p_index >= nr_defined_alleles) {
+				throw runtime_error("VariantReader::add_record: invalid genotype in VCF.");
+			}
+			paths.push_back(p_index);
+		}
+	}
+
+	// determine left and right flanks
+	DnaSequence left_flank;
+	this->fasta_reader.get_subsequence(current_chrom, current_start_pos - kmer_size + 1, current_start_pos, left_flank);
+	DnaSequence right_flank;
+	this->fasta_reader.get_subsequence(current_chrom, current_end_pos, current_end_pos + kmer_size - 1, right_flank);
+	// add Variant to variant_cluster
+	Variant variant (left_flank, right_flank, current_chrom, current_start_pos, current_end_pos, alleles, paths);
+	variant_cluster.push_back(variant);
+	previous_chrom = current_chrom;
+	previous_end_pos = current_end_pos;
 }
 
 size_t VariantReader::get_kmer_size() const {
@@ -290,39 +491,55 @@ void VariantReader::write_path_segments(std::string filename) const {
 		ss << "VariantReader::write_path_segments: File " << filename << " cannot be created. Note that the filename must not contain non-existing directories." << endl;
 		throw runtime_error(ss.str());
 	}
+	write_path_segments([&outfile](const char* data, size_t size) { outfile.write(data, size); });
+	outfile.close();
+	if (outfile.fail()) {
+		throw runtime_error("VariantReader::write_path_segments: File " + filename + " could not be written.");
+	}
+}
+
+void VariantReader::write_path_segments(const function<void(const char*, size_t)>& write) const {
+	// records are collected and passed on in large chunks
+	string buffer;
+	size_t buffer_size = 1 << 20;
+	auto add_record = [&](const string& name, const string& sequence) {
+		buffer += '>';
+		buffer += name;
+		buffer += '\n';
+		buffer += sequence;
+		buffer += '\n';
+		if (buffer.size() >= buffer_size) {
+			write(buffer.data(), buffer.size());
+			buffer.clear();
+		}
+	};
 	// make sure to capture all chromosomes in the reference (including such for which no variants are given)
 	vector<string> chromosome_names;
 	this->fasta_reader.get_sequence_names(chromosome_names);
-    
-
-    for (auto element : chromosome_names) {
+	string segment;
+	for (auto& element : chromosome_names) {
 		size_t prev_end = 0;
 		// check if chromosome was present in VCF and write allele sequences in this case
 		auto it = this->variants_per_chromosome.find(element);
 		if (it != this->variants_per_chromosome.end()) {
-			for (auto variant : this->variants_per_chromosome.at(element)) {
-				// generate reference unitig and write to file
+			for (const Variant& variant : it->second) {
+				// generate reference unitig
 				size_t start_pos = variant.get_start_position();
-				outfile << ">" << element << "_reference_" << start_pos << endl;
-				string ref_segment;
-				this->fasta_reader.get_subsequence(element, prev_end, start_pos, ref_segment);
-				outfile << ref_segment << endl;
+				this->fasta_reader.get_subsequence(element, prev_end, start_pos, segment);
+				add_record(element + "_reference_" + to_string(start_pos), segment);
 				for (size_t allele = 0; allele < variant.nr_of_alleles(); ++allele) {
-					// sequence name
-					outfile << ">" << element << "_" << start_pos << "_" << allele << endl;
-					outfile << variant.get_allele_string(allele) << endl;
+					add_record(element + "_" + to_string(start_pos) + "_" + to_string(allele), variant.get_allele_string(allele));
 				}
 				prev_end = variant.get_end_position();
 			}
 		}
 		// output reference sequence after last position on chromosome
-		outfile << ">" << element << "_reference_end" << endl;
 		size_t chr_len = this->fasta_reader.get_size_of(element);
-		string ref_segment;
-		this->fasta_reader.get_subsequence(element, prev_end, chr_len, ref_segment);
-        outfile << ref_segment << endl;
+		this->fasta_reader.get_subsequence(element, prev_end, chr_len, segment);
+		add_record(element + "_reference_end", segment);
+		this->fasta_reader.release(element);
 	}
-	outfile.close();
+	if (!buffer.empty()) write(buffer.data(), buffer.size());
 }
 
 void VariantReader::get_chromosomes(vector<string>* result) const {
@@ -363,9 +580,10 @@ void VariantReader::add_variant_cluster(string& chromosome, vector<Variant>* clu
 		for (size_t v = 1; v < cluster->size(); ++v) {
 			combined.combine_variants(cluster->at(v));
 		}
+		// drop the flanks replaced during merging
+		combined.compact();
 		combined.add_flanking_sequence();
-		this->variants_per_chromosome[chromosome].push_back(combined);
-		this->nr_variants += 1;
+		this->variants_per_chromosome.at(chromosome).push_back(move(combined));
 	}
 }
 
@@ -385,290 +603,533 @@ string get_date() {
 	return string(oss.str());
 }
 
-void VariantReader::open_genotyping_outfile(string filename) {
-	this->genotyping_outfile.open(filename);
-	if (! this->genotyping_outfile.is_open()) {
-		throw runtime_error("VariantReader::open_genotyping_outfile: genotyping output file cannot be opened. Note that the filename must not contain non-existing directories.");
-	}
+void VariantReader::open_genotyping_outfile(string filename, size_t nr_threads) {
+	this->genotyping_outfile = unique_ptr<VcfWriter>(new VcfWriter(filename, nr_threads));
 
-	this->genotyping_outfile_open = true;
-	
 	// write VCF header lines
-	this->genotyping_outfile << "##fileformat=VCFv4.2" << endl;
-	this->genotyping_outfile << "##fileDate=" << get_date() << endl;
+	string header = "##fileformat=VCFv4.2\n";
+	header += "##fileDate=" + get_date() + "\n";
+	if (VcfWriter::is_bcf(filename)) header += bcf_header_lines();
 	// TODO output command line
-	this->genotyping_outfile << "##INFO=<ID=AF,Number=A,Type=Float,Description=\"Allele Frequency\">" << endl;
-	this->genotyping_outfile << "##INFO=<ID=UK,Number=1,Type=Integer,Description=\"Total number of unique kmers.\">" << endl;
-	this->genotyping_outfile << "##INFO=<ID=AK,Number=R,Type=Integer,Description=\"Number of unique kmers per allele. Will be -1 for alleles not covered by any input haplotype path\">" << endl;
-	this->genotyping_outfile << "##INFO=<ID=MA,Number=1,Type=Integer,Description=\"Number of alleles missing in panel haplotypes.\">" << endl;
-	this->genotyping_outfile << "##INFO=<ID=ID,Number=A,Type=String,Description=\"Variant IDs.\">" << endl;
-	this->genotyping_outfile << "##FORMAT=<ID=GT,Number=1,Type=String,Description=\"Genotype\">" << endl;
-	this->genotyping_outfile << "##FORMAT=<ID=GQ,Number=1,Type=Integer,Description=\"Genotype quality: phred scaled probability that the genotype is wrong.\">" << endl;
-	this->genotyping_outfile << "##FORMAT=<ID=GL,Number=G,Type=Float,Description=\"Comma-separated log10-scaled genotype likelihoods for absent, heterozygous, homozygous.\">" << endl;
-	this->genotyping_outfile << "##FORMAT=<ID=KC,Number=1,Type=Float,Description=\"Local kmer coverage.\">" << endl;
-	this->genotyping_outfile << "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\tFORMAT\t" << this->sample << endl; 
+	header += "##INFO=<ID=AF,Number=A,Type=Float,Description=\"Allele Frequency\">\n";
+	header += "##INFO=<ID=UK,Number=1,Type=Integer,Description=\"Total number of unique kmers.\">\n";
+	header += "##INFO=<ID=AK,Number=R,Type=Integer,Description=\"Number of unique kmers per allele. Will be -1 for alleles not covered by any input haplotype path\">\n";
+	header += "##INFO=<ID=MA,Number=1,Type=Integer,Description=\"Number of alleles missing in panel haplotypes.\">\n";
+	header += "##INFO=<ID=ID,Number=A,Type=String,Description=\"Variant IDs.\">\n";
+	header += "##FORMAT=<ID=GT,Number=1,Type=String,Description=\"Genotype\">\n";
+	header += "##FORMAT=<ID=GQ,Number=1,Type=Integer,Description=\"Genotype quality: phred scaled probability that the genotype is wrong.\">\n";
+	header += "##FORMAT=<ID=GL,Number=G,Type=Float,Description=\"Comma-separated log10-scaled genotype likelihoods for absent, heterozygous, homozygous.\">\n";
+	header += "##FORMAT=<ID=KC,Number=1,Type=Float,Description=\"Local kmer coverage.\">\n";
+	header += "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\tFORMAT\t" + this->sample + "\n";
+	this->genotyping_outfile->write_header(header);
 }
 
-void VariantReader::open_phasing_outfile(string filename) { 
-	this->phasing_outfile.open(filename);
-	if (! this->phasing_outfile.is_open()) {
-		throw runtime_error("VariantReader::open_phasing_outfile: phasing output file cannot be opened.");
-	}
-
-	this->phasing_outfile_open = true;
+void VariantReader::open_phasing_outfile(string filename, size_t nr_threads) {
+	this->phasing_outfile = unique_ptr<VcfWriter>(new VcfWriter(filename, nr_threads));
 
 	// write VCF header lines
-	this->phasing_outfile << "##fileformat=VCFv4.2" << endl;
-	this->phasing_outfile << "##fileDate=" << get_date() << endl;
+	string header = "##fileformat=VCFv4.2\n";
+	header += "##fileDate=" + get_date() + "\n";
+	if (VcfWriter::is_bcf(filename)) header += bcf_header_lines();
 	// TODO output command line
-	this->phasing_outfile << "##INFO=<ID=AF,Number=A,Type=Float,Description=\"Allele Frequency\">" << endl;
-	this->phasing_outfile << "##INFO=<ID=UK,Number=1,Type=Integer,Description=\"Total number of unique kmers.\">" << endl;
-	this->phasing_outfile << "##INFO=<ID=AK,Number=R,Type=Integer,Description=\"Number of unique kmers per allele. Will be -1 for alleles not covered by any input haplotype path.\">" << endl;
-	this->phasing_outfile << "##INFO=<ID=MA,Number=1,Type=Integer,Description=\"Number of alleles missing in panel haplotypes.\">" << endl;
-	this->phasing_outfile << "##INFO=<ID=ID,Number=A,Type=String,Description=\"Variant IDs.\">" << endl;
-	this->phasing_outfile << "##FORMAT=<ID=GT,Number=1,Type=String,Description=\"Genotype\">" << endl;
-	this->phasing_outfile << "##FORMAT=<ID=KC,Number=1,Type=Float,Description=\"Local kmer coverage.\">" << endl;
-	this->phasing_outfile << "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\tFORMAT\t" << this->sample << endl;
+	header += "##INFO=<ID=AF,Number=A,Type=Float,Description=\"Allele Frequency\">\n";
+	header += "##INFO=<ID=UK,Number=1,Type=Integer,Description=\"Total number of unique kmers.\">\n";
+	header += "##INFO=<ID=AK,Number=R,Type=Integer,Description=\"Number of unique kmers per allele. Will be -1 for alleles not covered by any input haplotype path.\">\n";
+	header += "##INFO=<ID=MA,Number=1,Type=Integer,Description=\"Number of alleles missing in panel haplotypes.\">\n";
+	header += "##INFO=<ID=ID,Number=A,Type=String,Description=\"Variant IDs.\">\n";
+	header += "##FORMAT=<ID=GT,Number=1,Type=String,Description=\"Genotype\">\n";
+	header += "##FORMAT=<ID=KC,Number=1,Type=Float,Description=\"Local kmer coverage.\">\n";
+	header += "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\tFORMAT\t" + this->sample + "\n";
+	this->phasing_outfile->write_header(header);
 }
 
-void VariantReader::write_genotypes_of(string chromosome, const vector<GenotypingResult>& genotyping_result, vector<UniqueKmers*>* unique_kmers, bool ignore_imputed) {
-	// outfile needs to be open
-	if (!this->genotyping_outfile_open) {
-		throw runtime_error("VariantReader::write_genotypes_of: output file needs to be opened before writing.");
-	}
+void VariantReader::open_biallelic_outfile(string filename, string callset_filename, size_t nr_threads) {
+	read_biallelic_variants(callset_filename);
+	this->biallelic_outfile = unique_ptr<VcfWriter>(new VcfWriter(filename, nr_threads));
+
+	// write VCF header lines, only fields that can be given per variant ID are kept
+	string header = "##fileformat=VCFv4.2\n";
+	header += "##fileDate=" + get_date() + "\n";
+	if (VcfWriter::is_bcf(filename)) header += bcf_header_lines();
+	header += "##INFO=<ID=UK,Number=1,Type=Integer,Description=\"Total number of unique kmers.\">\n";
+	header += "##INFO=<ID=MA,Number=1,Type=Integer,Description=\"Number of alleles missing in panel haplotypes.\">\n";
+	header += "##INFO=<ID=ID,Number=A,Type=String,Description=\"Variant IDs.\">\n";
+	header += "##FORMAT=<ID=GT,Number=1,Type=String,Description=\"Genotype\">\n";
+	header += "##FORMAT=<ID=GQ,Number=1,Type=Integer,Description=\"Genotype quality: phred scaled probability that the genotype is wrong.\">\n";
+	header += "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\tFORMAT\t" + this->sample + "\n";
+	this->biallelic_outfile->write_header(header);
+}
 
-	if (this->variants_per_chromosome.find(chromosome) == this->variants_per_chromosome.end()) {
-		cerr << "VariantReader::write_genotypes_of: no variants for given chromosome were written." << endl;
-		return;
+void VariantReader::read_biallelic_variants(string filename) {
+	this->biallelic_variants.clear();
+	vector<string_view> fields;
+	vector<string_view> info;
+	vector<string_view> ids;
+	vector<string_view> alleles;
+	auto add_line = [&](string_view line) {
+		if (line.empty() || (line[0] == '#')) return;
+		fields.clear();
+		VcfParser::split(line, '\t', fields);
+		if (fields.size() < 8) {
+			throw runtime_error("VariantReader::read_biallelic_variants: VCF " + filename + " is malformed.");
+		}
+		// only chromosomes that are genotyped are needed
+		auto chromosome = this->variants_per_chromosome.find(string(fields[0]));
+		if (chromosome == this->variants_per_chromosome.end()) return;
+		info.clear();
+		ids.clear();
+		VcfParser::split(fields[7], ';', info);
+		for (string_view entry : info) {
+			if (entry.substr(0, 3) == "ID=") VcfParser::split(entry.substr(3), ',', ids);
+		}
+		alleles.clear();
+		VcfParser::split(fields[4], ',', alleles);
+		if (ids.size() != alleles.size()) {
+			throw runtime_error("VariantReader::read_biallelic_variants: VCF " + filename + " does not give an ID (INFO field ID) for each ALT allele at " + string(fields[0]) + ":" + string(fields[1]) + ".");
+		}
+		unordered_map<string, BiallelicVariant>& variants = this->biallelic_variants[chromosome->first];
+		for (size_t a = 0; a < ids.size(); ++a) {
+			variants[string(ids[a])] = BiallelicVariant{(size_t) stoull(string(fields[1])), string(fields[3]), string(alleles[a])};
+		}
+	};
+
+	if (BgzfReader::is_bgzf(filename)) {
+		BgzfReader reader(filename);
+		vector<char> block;
+		string decompressed;
+		string text;
+		while (reader.read_block(block)) {
+			BgzfReader::decompress_block(block, decompressed);
+			text += decompressed;
+			// process all complete lines
+			size_t start = 0;
+			size_t end;
+			while ((end = text.find('\n', start)) != string::npos) {
+				add_line(string_view(text.data() + start, end - start));
+				start = end + 1;
+			}
+			text.erase(0, start);
+		}
+		if (!text.empty()) add_line(text);
+	} else {
+		ifstream file(filename);
+		if (!file.good()) {
+			throw runtime_error("VariantReader::read_biallelic_variants: VCF " + filename + " cannot be opened.");
+		}
+		string line;
+		while (getline(file, line)) add_line(line);
 	}
+}
 
-	if (genotyping_result.size() != size_of(chromosome)) {
-		throw runtime_error("VariantReader::write_genotypes_of: number of variants and number of computed genotypes differ.");
+string VariantReader::bcf_header_lines() const {
+	// BCF refers to the filter and the chromosomes by their index in the header
+	string result = "##FILTER=<ID=PASS,Description=\"All filters passed\">\n";
+	for (auto& chromosome : this->variants_per_chromosome) {
+		result += "##contig=<ID=" + chromosome.first + ">\n";
 	}
+	return result;
+}
 
-	size_t counter = 0;
-	for (size_t i = 0; i < size_of(chromosome); ++i) {
-		Variant variant = this->variants_per_chromosome.at(chromosome)[i];
+/** append the decimal representation of an integer **/
+template<class T>
+static void append_number(string& buffer, T value) {
+	char digits[24];
+	to_chars_result result = to_chars(digits, digits + sizeof(digits), value);
+	buffer.append(digits, result.ptr);
+}
 
-		// separate (possibly combined) variant into single variants and print a line for each
-		vector<Variant> singleton_variants;
-		vector<GenotypingResult> singleton_likelihoods;
-		vector<VariantStats> singleton_stats;
-		variant.separate_variants(&singleton_variants, &genotyping_result.at(i), &singleton_likelihoods);
-		variant.variant_statistics(unique_kmers->at(i), singleton_stats);
+/** append a floating point number in the format an ostream uses with the given precision **/
+template<class T>
+static void append_float(string& buffer, T value, int precision) {
+	char digits[64];
+	to_chars_result result = to_chars(digits, digits + sizeof(digits), value, chars_format::general, precision);
+	buffer.append(digits, result.ptr);
+}
 
-		for (size_t j = 0; j < singleton_variants.size(); ++j) {
-			Variant v = singleton_variants[j];
-			v.remove_flanking_sequence();
-			this->genotyping_outfile << v.get_chromosome() << "\t"; // CHROM
-			this->genotyping_outfile << (v.get_start_position() + 1) << "\t"; // POS
-			this->genotyping_outfile << v.get_id() << "\t"; // ID
-			this->genotyping_outfile << v.get_allele_string(0) << "\t"; // REF
-
-			// get alternative allele
-			size_t nr_alleles = v.nr_of_alleles();
-			if (nr_alleles < 2) {
-				ostringstream oss;
-				oss << "VariantReader::write_genotypes_of: less than 2 alleles given for variant at position " << v.get_start_position() << endl;
-				throw runtime_error(oss.str());
-			}
+/** determine the alternative alleles that are defined **/
+static void get_defined_alleles(const SingleVariant& v, vector<string>& alt_alleles, vector<unsigned char>& defined_alleles) {
+	defined_alleles = {0};
+	for (size_t i = 1; i < v.alleles.size(); ++i) {
+		// skip alleles that are undefined
+		if (!v.is_undefined_allele(i)) {
+			alt_alleles.push_back(v.alleles[i].to_string());
+			defined_alleles.push_back(i);
+		}
+	}
+}
 
-			vector<string> alt_alleles;
-			vector<unsigned char> defined_alleles = {0};
-			for (size_t i = 1; i < nr_alleles; ++i) {
-				DnaSequence allele = v.get_allele_sequence(i);
-				// skip alleles that are undefined
-				if (!v.is_undefined_allele(i)) {
-					alt_alleles.push_back(allele.to_string());
-					defined_alleles.push_back(i);
-				}
-			}
+void VariantReader::append_vcf_record(const OutputRecord& record, bool genotyping, string& buffer) const {
+	buffer += record.chromosome; // CHROM
+	buffer += '\t';
+	append_number(buffer, record.start_position + 1); // POS
+	buffer += '\t';
+	buffer += record.id; // ID
+	buffer += '\t';
+	buffer += record.reference; // REF
+	buffer += '\t';
+	for (size_t a = 0; a < record.alt_alleles.size(); ++a) {
+		if (a > 0) buffer += ',';
+		buffer += record.alt_alleles[a];
+	}
+	buffer += "\t.\tPASS\t"; // ALT, QUAL, FILTER
 
-			string alt_string = "";
-			for (unsigned char a = 0; a < alt_alleles.size(); ++a) {
-				if (a > 0) alt_string += ',';
-				alt_string += alt_alleles[a];
-			}
+	// output allele frequencies of all alleles
+	buffer += "AF="; // AF
+	for (size_t a = 0; a < record.allele_frequencies.size(); ++a) {
+		if (a > 0) buffer += ',';
+		append_float(buffer, record.allele_frequencies[a], 6);
+	}
+	buffer += ";UK="; // UK
+	append_number(buffer, record.nr_unique_kmers);
+	buffer += ";AK="; // AK
+	for (size_t a = 0; a < record.kmer_counts.size(); ++a) {
+		if (a > 0) buffer += ',';
+		append_number(buffer, record.kmer_counts[a]);
+	}
+	buffer += ";MA="; // MA
+	append_number(buffer, record.nr_missing);
+	// if IDs were given in input, write them to output as well
+	if (!record.ids.empty()) {
+		buffer += ";ID=";
+		buffer += record.ids;
+	}
+	buffer += '\t'; // INFO
+
+	bool missing = (record.genotype.first == -1) || (record.genotype.second == -1);
+	if (genotyping) {
+		buffer += "GT:GQ:GL:KC\t"; // FORMAT
+		if (!missing) {
+			append_number(buffer, record.genotype.first); // GT
+			buffer += '/';
+			append_number(buffer, record.genotype.second);
+			buffer += ':';
+			append_number(buffer, record.genotype_quality); // GQ
+			buffer += ':';
+		} else {
+			// genotype could not be determined
+			buffer += "./.:.:"; // GT:GQ
+		}
+		append_float(buffer, log10(record.likelihoods[0]), 6); // GL
+		for (size_t l = 1; l < record.likelihoods.size(); ++l) {
+			buffer += ',';
+			append_float(buffer, log10(record.likelihoods[l]), 4);
+		}
+	} else {
+		buffer += "GT:KC\t"; // FORMAT
+		if (!missing) {
+			append_number(buffer, record.genotype.first); // GT (phased)
+			buffer += '|';
+			append_number(buffer, record.genotype.second);
+		} else {
+			buffer += "./.";
+		}
+	}
+	buffer += ':';
+	append_number(buffer, record.coverage); // KC
+	buffer += '\n';
+}
 
-			this->genotyping_outfile << alt_string << "\t"; // ALT
-			this->genotyping_outfile << ".\t"; // QUAL
-			this->genotyping_outfile << "PASS" << "\t"; // FILTER
-			// output allele frequencies of all alleles
-			ostringstream info;
-			info << "AF="; // AF
-			for (unsigned int a = 1; a < defined_alleles.size(); ++a) {
-				if (a > 1) info << ",";
-				info << setprecision(6) << v.allele_frequency(defined_alleles[a], this->add_reference);				
-			}
+void VariantReader::append_bcf_record(const OutputRecord& record, bool genotyping, const BcfEncoder& encoder, string& buffer) const {
+	string shared;
+	BcfEncoder::encode_site(shared, encoder.contig_index(string(record.chromosome)), record.start_position, record.reference.size(), record.ids.empty() ? 4 : 5, record.alt_alleles.size() + 1, genotyping ? 4 : 2, 1);
+	BcfEncoder::encode_string(shared, (record.id == ".") ? string_view() : record.id); // ID
+	BcfEncoder::encode_string(shared, record.reference); // REF
+	for (auto& allele : record.alt_alleles) {
+		BcfEncoder::encode_string(shared, allele); // ALT
+	}
+	BcfEncoder::encode_ints(shared, {encoder.key_index("PASS")}); // FILTER
+
+	BcfEncoder::encode_int(shared, encoder.key_index("AF"));
+	BcfEncoder::encode_floats(shared, record.allele_frequencies);
+	BcfEncoder::encode_int(shared, encoder.key_index("UK"));
+	BcfEncoder::encode_int(shared, min(record.nr_unique_kmers, (size_t) INT32_MAX));
+	BcfEncoder::encode_int(shared, encoder.key_index("AK"));
+	BcfEncoder::encode_ints(shared, vector<int32_t>(record.kmer_counts.begin(), record.kmer_counts.end()));
+	BcfEncoder::encode_int(shared, encoder.key_index("MA"));
+	BcfEncoder::encode_int(shared, record.nr_missing);
+	if (!record.ids.empty()) {
+		BcfEncoder::encode_int(shared, encoder.key_index("ID"));
+		BcfEncoder::encode_string(shared, record.ids);
+	}
 
-			// keep only likelihoods for genotypes with defined alleles
-			size_t nr_missing = v.nr_missing_alleles();
-			GenotypingResult genotype_likelihoods = singleton_likelihoods.at(j);
-			if (nr_missing > 0) genotype_likelihoods = singleton_likelihoods.at(j).get_specific_likelihoods(defined_alleles);
-			nr_alleles = defined_alleles.size();
-
-			info << ";UK=" << singleton_stats.at(j).nr_unique_kmers; // UK
-			info << ";AK="; // AK
-			for (unsigned int a = 0; a < nr_alleles; ++a) {
-				if (a > 0) info << ",";
-				info << singleton_stats.at(j).kmer_counts[a];
-			}
-			info << ";MA=" << nr_missing;
-	
-			// if IDs were given in input, write them to output as well
-			if (!this->variant_ids[v.get_chromosome()][counter].empty()) info << ";ID=" << get_ids(v.get_chromosome(), alt_alleles, counter, false);
-			this->genotyping_outfile << info.str() << "\t"; // INFO
-			this->genotyping_outfile << "GT:GQ:GL:KC" << "\t"; // FORMAT
-
-			// determine computed genotype
-			pair<int,int> genotype = genotype_likelihoods.get_likeliest_genotype();
-			if (ignore_imputed && (singleton_stats.at(j).nr_unique_kmers == 0)) genotype = {-1,-1};
-			if ( (genotype.first != -1) && (genotype.second != -1)) {
+	// FORMAT fields of the single sample
+	string individual;
+	bool phased = !genotyping && (record.genotype.first != -1) && (record.genotype.second != -1);
+	BcfEncoder::encode_int(individual, encoder.key_index("GT"));
+	BcfEncoder::encode_ints(individual, {BcfEncoder::encode_allele(record.genotype.first, false), BcfEncoder::encode_allele(record.genotype.second, phased)});
+	if (genotyping) {
+		bool missing = (record.genotype.first == -1) || (record.genotype.second == -1);
+		BcfEncoder::encode_int(individual, encoder.key_index("GQ"));
+		BcfEncoder::encode_int(individual, missing ? BcfEncoder::INT_MISSING : (int32_t) min(record.genotype_quality, (size_t) INT32_MAX));
+		vector<float> likelihoods;
+		for (long double likelihood : record.likelihoods) {
+			likelihoods.push_back(log10(likelihood));
+		}
+		BcfEncoder::encode_int(individual, encoder.key_index("GL"));
+		BcfEncoder::encode_floats(individual, likelihoods);
+	}
+	BcfEncoder::encode_int(individual, encoder.key_index("KC"));
+	BcfEncoder::encode_floats(individual, {(float) record.coverage});
+	BcfEncoder::append_record(buffer, shared, individual);
+}
 
-				// unique maximum and therefore a likeliest genotype exists
-				this->genotyping_outfile << genotype.first << "/" << genotype.second << ":"; // GT
+void VariantReader::append_biallelic_records(const OutputRecord& record, const BcfEncoder* encoder, string& buffer) const {
+	if (record.ids.empty()) {
+		throw runtime_error("VariantReader::append_biallelic_records: biallelic output requires variant IDs (INFO field ID) in the input VCF.");
+	}
+	string chromosome (record.chromosome);
+	auto variants = this->biallelic_variants.find(chromosome);
+	if (variants == this->biallelic_variants.end()) {
+		throw runtime_error("VariantReader::append_biallelic_records: no variant IDs given for chromosome " + chromosome + ".");
+	}
 
-				// output genotype quality
-				this->genotyping_outfile << genotype_likelihoods.get_genotype_quality(genotype.first, genotype.second) << ":"; // GQ
-			} else {
-				// genotype could not be determined 
-				this->genotyping_outfile << "./.:.:"; // GT:GQ
-			}
+	// IDs carried by each allele (none for the reference allele)
+	vector<vector<string_view>> allele_ids(1);
+	vector<string_view> per_allele;
+	VcfParser::split(record.ids, ',', per_allele);
+	for (string_view ids : per_allele) {
+		VcfParser::split(ids, ':', allele_ids.emplace_back());
+	}
 
-			// output genotype likelihoods
-			vector<long double> likelihoods = genotype_likelihoods.get_all_likelihoods(nr_alleles);
-			if (likelihoods.size() < 3) {
-				ostringstream oss;
-				oss << "VariantReader::write_genotypes_of: too few likelihoods (" << likelihoods.size() << ") computed for variant at position " << v.get_start_position() << endl;
-				throw runtime_error(oss.str());
+	// one record per ID, sorted by position (IDs at the same position in order of appearance)
+	vector<pair<const BiallelicVariant*, string_view>> biallelic;
+	for (size_t a = 1; a < allele_ids.size(); ++a) {
+		for (string_view id : allele_ids[a]) {
+			bool seen = false;
+			for (auto& b : biallelic) seen = seen || (b.second == id);
+			if (seen) continue;
+			auto it = variants->second.find(string(id));
+			if (it == variants->second.end()) {
+				throw runtime_error("VariantReader::append_biallelic_records: variant ID " + string(id) + " is not given in the biallelic VCF.");
 			}
-
-			ostringstream oss;
-			oss << log10(likelihoods[0]);
-			for (size_t j = 1; j < likelihoods.size(); ++j) {
-				oss << "," << setprecision(4) << log10(likelihoods[j]);
+			biallelic.push_back(make_pair(&it->second, id));
+		}
+	}
+	stable_sort(biallelic.begin(), biallelic.end(), [](const pair<const BiallelicVariant*, string_view>& a, const pair<const BiallelicVariant*, string_view>& b) { return a.first->position < b.first->position; });
+
+	bool missing = (record.genotype.first == -1) || (record.genotype.second == -1);
+	for (auto& b : biallelic) {
+		// allele of the biallelic record on each haplotype
+		int alleles[2] = {-1, -1};
+		if (!missing) {
+			int genotype[2] = {record.genotype.first, record.genotype.second};
+			for (size_t h = 0; h < 2; ++h) {
+				const vector<string_view>& ids = allele_ids.at(genotype[h]);
+				alleles[h] = (find(ids.begin(), ids.end(), b.second) != ids.end()) ? 1 : 0;
 			}
-			this->genotyping_outfile << oss.str(); // GL
-			this->genotyping_outfile << ":" << singleton_stats[j].coverage << endl; // KC
-			counter += 1;
 		}
+		if (encoder != nullptr) {
+			string shared;
+			BcfEncoder::encode_site(shared, encoder->contig_index(chromosome), b.first->position - 1, b.first->reference.size(), 3, 2, 2, 1);
+			BcfEncoder::encode_string(shared, (record.id == ".") ? string_view() : record.id); // ID
+			BcfEncoder::encode_string(shared, b.first->reference); // REF
+			BcfEncoder::encode_string(shared, b.first->alternative); // ALT
+			BcfEncoder::encode_ints(shared, {encoder->key_index("PASS")}); // FILTER
+			BcfEncoder::encode_int(shared, encoder->key_index("ID"));
+			BcfEncoder::encode_string(shared, b.second);
+			BcfEncoder::encode_int(shared, encoder->key_index("UK"));
+			BcfEncoder::encode_int(shared, min(record.nr_unique_kmers, (size_t) INT32_MAX));
+			BcfEncoder::encode_int(shared, encoder->key_index("MA"));
+			BcfEncoder::encode_int(shared, record.nr_missing);
+			string individual;
+			BcfEncoder::encode_int(individual, encoder->key_index("GT"));
+			BcfEncoder::encode_ints(individual, {BcfEncoder::encode_allele(alleles[0], false), BcfEncoder::encode_allele(alleles[1], false)});
+			BcfEncoder::encode_int(individual, encoder->key_index("GQ"));
+			BcfEncoder::encode_int(individual, missing ? BcfEncoder::INT_MISSING : (int32_t) min(record.genotype_quality, (size_t) INT32_MAX));
+			BcfEncoder::append_record(buffer, shared, individual);
+			continue;
+		}
+		buffer += record.chromosome; // CHROM
+		buffer += '\t';
+		append_number(buffer, b.first->position); // POS
+		buffer += '\t';
+		buffer += record.id; // ID
+		buffer += '\t';
+		buffer += b.first->reference; // REF
+		buffer += '\t';
+		buffer += b.first->alternative; // ALT
+		buffer += "\t.\tPASS\tID="; // QUAL, FILTER, INFO
+		buffer += b.second;
+		buffer += ";UK=";
+		append_number(buffer, record.nr_unique_kmers);
+		buffer += ";MA=";
+		append_number(buffer, record.nr_missing);
+		buffer += "\tGT:GQ\t"; // FORMAT
+		if (missing) {
+			buffer += "./.:.";
+		} else {
+			append_number(buffer, alleles[0]);
+			buffer += '/';
+			append_number(buffer, alleles[1]);
+			buffer += ':';
+			append_number(buffer, record.genotype_quality);
+		}
+		buffer += '\n';
 	}
 }
 
-void VariantReader::write_phasing_of(string chromosome, const vector<GenotypingResult>& genotyping_result, vector<UniqueKmers*>* unique_kmers, bool ignore_imputed) {
-	// outfile needs to be open
-	if (! this->phasing_outfile_open) {
-		throw runtime_error("VariantReader::write_phasing_of: output file needs to be opened before writing.");
+void VariantReader::format_records(string chromosome, const vector<GenotypingResult>& genotyping_result, const vector<UniqueKmers*>* unique_kmers, bool ignore_imputed, bool genotyping, const BcfEncoder* encoder, string& buffer, string* biallelic_buffer, const BcfEncoder* biallelic_encoder) const {
+	string function_name = genotyping ? "VariantReader::write_genotypes_of" : "VariantReader::write_phasing_of";
+	if (genotyping && (this->variants_per_chromosome.find(chromosome) == this->variants_per_chromosome.end())) {
+		cerr << function_name << ": no variants for given chromosome were written." << endl;
+		return;
 	}
+
 	if (genotyping_result.size() != size_of(chromosome)) {
-		throw runtime_error("VariantReader::write_phasing_of: number of variants and number of computed phasings differ.");
+		throw runtime_error(function_name + ": number of variants and number of computed " + (genotyping ? "genotypes" : "phasings") + " differ.");
 	}
 
 	size_t counter = 0;
+	// reused for all variants of the chromosome
+	vector<SingleVariant> singleton_variants;
+	vector<GenotypingResult> singleton_likelihoods;
+	vector<VariantStats> singleton_stats;
+	vector<float> frequencies;
 	for (size_t i = 0; i < size_of(chromosome); ++i) {
-		Variant variant = this->variants_per_chromosome.at(chromosome)[i];
+		const Variant& variant = this->variants_per_chromosome.at(chromosome)[i];
 
 		// separate (possibly combined) variant into single variants and print a line for each
-		vector<Variant> singleton_variants;
-		vector<GenotypingResult> singleton_likelihoods;
-		variant.separate_variants(&singleton_variants, &genotyping_result.at(i), &singleton_likelihoods);
-		vector<VariantStats> singleton_stats;
+		singleton_variants.clear();
+		singleton_likelihoods.clear();
+		singleton_stats.clear();
+		variant.get_single_variants(singleton_variants);
+		variant.separate_genotyping(genotyping_result.at(i), singleton_likelihoods);
 		variant.variant_statistics(unique_kmers->at(i), singleton_stats);
 
 		for (size_t j = 0; j < singleton_variants.size(); ++j) {
-			Variant v = singleton_variants[j];
-			v.remove_flanking_sequence();
-			this->phasing_outfile << v.get_chromosome() << "\t"; // CHROM
-			this->phasing_outfile << (v.get_start_position() + 1) << "\t"; // POS
-			this->phasing_outfile << v.get_id() << "\t"; // ID
-			this->phasing_outfile << v.get_allele_string(0) << "\t"; // REF
-
-			// get alternative alleles
-			size_t nr_alleles = v.nr_of_alleles();
-			if (nr_alleles < 2) {
-				ostringstream oss;
-				oss << "VariantReader::write_phasing_of: less than 2 alleles given for variant at position " << v.get_start_position() << endl;
-				throw runtime_error(oss.str());
+			const SingleVariant& v = singleton_variants[j];
+			const VariantStats& stats = singleton_stats.at(j);
+			if (v.alleles.size() < 2) {
+				throw runtime_error(function_name + ": less than 2 alleles given for variant at position " + to_string(v.start_position));
 			}
 
-			vector<string> alt_alleles;
-			vector<unsigned char> defined_alleles = {0};
-			for (size_t i = 1; i < nr_alleles; ++i) {
-				DnaSequence allele = v.get_allele_sequence(i);
-				// skip alleles that are undefined
-				if (! v.is_undefined_allele(i)) {
-					alt_alleles.push_back(allele.to_string());
-					defined_alleles.push_back(i);
+			OutputRecord record;
+			record.chromosome = chromosome;
+			record.start_position = v.start_position;
+			record.id = v.id;
+			record.reference = v.alleles[0].to_string();
+			get_defined_alleles(v, record.alt_alleles, record.defined_alleles);
+			v.allele_frequencies(this->add_reference, frequencies);
+			for (size_t a = 1; a < record.defined_alleles.size(); ++a) {
+				record.allele_frequencies.push_back(frequencies[record.defined_alleles[a]]);
+			}
+			record.nr_unique_kmers = stats.nr_unique_kmers;
+			// genotyping output lists the counts of the defined alleles, phasing output those of all alleles
+			size_t nr_counts = genotyping ? record.defined_alleles.size() : v.alleles.size();
+			for (size_t a = 0; a < nr_counts; ++a) {
+				auto it = stats.kmer_counts.find(a);
+				record.kmer_counts.push_back((it != stats.kmer_counts.end()) ? it->second : 0);
+			}
+			record.nr_missing = v.nr_missing_alleles();
+			if (!this->variant_ids.at(chromosome).at(counter).empty()) {
+				vector<string> alleles = record.alt_alleles;
+				record.ids = get_ids(chromosome, alleles, counter, false);
+			}
+			record.coverage = stats.coverage;
+
+			if (genotyping) {
+				// keep only likelihoods for genotypes with defined alleles
+				GenotypingResult genotype_likelihoods = singleton_likelihoods.at(j);
+				if (record.nr_missing > 0) genotype_likelihoods = singleton_likelihoods.at(j).get_specific_likelihoods(record.defined_alleles);
+				// determine computed genotype
+				record.genotype = genotype_likelihoods.get_likeliest_genotype();
+				if (ignore_imputed && (stats.nr_unique_kmers == 0)) record.genotype = {-1,-1};
+				// unique maximum and therefore a likeliest genotype exists
+				if ((record.genotype.first != -1) && (record.genotype.second != -1)) {
+					record.genotype_quality = genotype_likelihoods.get_genotype_quality(record.genotype.first, record.genotype.second);
+				}
+				record.likelihoods = genotype_likelihoods.get_all_likelihoods(record.defined_alleles.size());
+				if (record.likelihoods.size() < 3) {
+					throw runtime_error(function_name + ": too few likelihoods (" + to_string(record.likelihoods.size()) + ") computed for variant at position " + to_string(v.start_position));
 				}
+			} else if (ignore_imputed && (stats.nr_unique_kmers == 0)) {
+				record.genotype = {-1,-1};
+			} else {
+				pair<unsigned char,unsigned char> haplotype = singleton_likelihoods.at(j).get_haplotype();
+				record.genotype = {haplotype.first, haplotype.second};
 			}
 
-			string alt_string = "";
-			for (unsigned char a = 0; a < alt_alleles.size(); ++a) {
-				if (a > 0) alt_string += ',';
-				alt_string += alt_alleles[a];
+			if (encoder != nullptr) {
+				append_bcf_record(record, genotyping, *encoder, buffer);
+			} else {
+				append_vcf_record(record, genotyping, buffer);
 			}
+			if (biallelic_buffer != nullptr) append_biallelic_records(record, biallelic_encoder, *biallelic_buffer);
+			counter += 1;
+		}
+	}
+}
 
-			size_t nr_missing = v.nr_missing_alleles();
-			GenotypingResult genotype_likelihoods = singleton_likelihoods.at(j);
-			if (nr_missing > 0) genotype_likelihoods = singleton_likelihoods.at(j).get_specific_likelihoods(defined_alleles);
-
-			this->phasing_outfile << alt_string << "\t"; // ALT
-			this->phasing_outfile << ".\t"; // QUAL
-			this->phasing_outfile << "PASS" << "\t"; // FILTER
-			// output allele frequencies of all alleles
-			ostringstream info;
-			info << "AF=";
-			for (unsigned int a = 1; a < defined_alleles.size(); ++a) {
-				if (a > 1) info << ",";
-				info << setprecision(6) << v.allele_frequency(defined_alleles[a], this->add_reference);				
-			}
-			info << ";UK=" << singleton_stats.at(j).nr_unique_kmers; // UK
-			info << ";AK="; // AK
-			for (unsigned int a = 0; a < nr_alleles; ++a) {
-				if (a > 0) info << ",";
-				info << singleton_stats.at(j).kmer_counts[a];
-			}
+void VariantReader::format_genotypes_of(string chromosome, const vector<GenotypingResult>& genotyping_result, const vector<UniqueKmers*>* unique_kmers, bool ignore_imputed, string& buffer, const BcfEncoder* encoder, string* biallelic_buffer, const BcfEncoder* biallelic_encoder) const {
+	format_records(chromosome, genotyping_result, unique_kmers, ignore_imputed, true, encoder, buffer, biallelic_buffer, biallelic_encoder);
+}
 
-			info << ";MA=" << nr_missing;
+void VariantReader::format_phasing_of(string chromosome, const vector<GenotypingResult>& genotyping_result, const vector<UniqueKmers*>* unique_kmers, bool ignore_imputed, string& buffer, const BcfEncoder* encoder) const {
+	format_records(chromosome, genotyping_result, unique_kmers, ignore_imputed, false, encoder, buffer);
+}
 
-			// if IDs were given in input, write them to output as well
-			if (!this->variant_ids[v.get_chromosome()][counter].empty()) info << ";ID=" << get_ids(v.get_chromosome(), alt_alleles, counter, false);
+void VariantReader::write_genotypes_of(string chromosome, const vector<GenotypingResult>& genotyping_result, vector<UniqueKmers*>* unique_kmers, bool ignore_imputed) {
+	// outfile needs to be open
+	if (!this->genotyping_outfile) {
+		throw runtime_error("VariantReader::write_genotypes_of: output file needs to be opened before writing.");
+	}
+	string buffer;
+	string biallelic_buffer;
+	if (this->biallelic_outfile) {
+		format_genotypes_of(chromosome, genotyping_result, unique_kmers, ignore_imputed, buffer, this->genotyping_outfile->get_bcf_encoder(), &biallelic_buffer, this->biallelic_outfile->get_bcf_encoder());
+	} else {
+		format_genotypes_of(chromosome, genotyping_result, unique_kmers, ignore_imputed, buffer, this->genotyping_outfile->get_bcf_encoder());
+	}
+	this->genotyping_outfile->write_records(buffer);
+	if (this->biallelic_outfile) this->biallelic_outfile->write_records(biallelic_buffer);
+}
 
-			this->phasing_outfile << info.str() << "\t"; // INFO
-			this->phasing_outfile << "GT:KC" << "\t"; // FORMAT
+void VariantReader::write_phasing_of(string chromosome, const vector<GenotypingResult>& genotyping_result, vector<UniqueKmers*>* unique_kmers, bool ignore_imputed) {
+	// outfile needs to be open
+	if (!this->phasing_outfile) {
+		throw runtime_error("VariantReader::write_phasing_of: output file needs to be opened before writing.");
+	}
+	string buffer;
+	format_phasing_of(chromosome, genotyping_result, unique_kmers, ignore_imputed, buffer, this->phasing_outfile->get_bcf_encoder());
+	this->phasing_outfile->write_records(buffer);
+}
 
-			// determine phasing
-			if (ignore_imputed && (singleton_stats.at(j).nr_unique_kmers == 0)){
-				this->phasing_outfile << "./."; // GT (phased)
-			} else {
-				pair<unsigned char,unsigned char> haplotype = singleton_likelihoods.at(j).get_haplotype();
-				// check if the haplotype allele is undefined
-				bool hap1_undefined = v.is_undefined_allele(haplotype.first);
-				bool hap2_undefined = v.is_undefined_allele(haplotype.second);
-				string hap1 (1, haplotype.first);
-				string hap2 (1, haplotype.second);
-				if (hap1_undefined) hap1 = ".";
-				if (hap2_undefined) hap2 = ".";
-				this->phasing_outfile << (unsigned int) haplotype.first << "|" << (unsigned int) haplotype.second; // GT (phased)
-			}
-			this->phasing_outfile << ":" << singleton_stats[j].coverage << endl; // KC
-			counter += 1;
+void VariantReader::format_results(string chromosome, const vector<GenotypingResult>& genotyping_result, const vector<UniqueKmers*>* unique_kmers, bool ignore_imputed, FormattedResults& result) const {
+	if (this->biallelic_outfile) {
+		if (!this->genotyping_outfile) {
+			throw runtime_error("VariantReader::format_results: biallelic output requires the genotyping output file to be open.");
 		}
+		format_genotypes_of(chromosome, genotyping_result, unique_kmers, ignore_imputed, result.genotyping, this->genotyping_outfile->get_bcf_encoder(), &result.biallelic, this->biallelic_outfile->get_bcf_encoder());
+	} else if (this->genotyping_outfile) {
+		format_genotypes_of(chromosome, genotyping_result, unique_kmers, ignore_imputed, result.genotyping, this->genotyping_outfile->get_bcf_encoder());
 	}
+	if (this->phasing_outfile) format_phasing_of(chromosome, genotyping_result, unique_kmers, ignore_imputed, result.phasing, this->phasing_outfile->get_bcf_encoder());
+}
+
+void VariantReader::write_formatted(const FormattedResults& records) {
+	if (this->genotyping_outfile) this->genotyping_outfile->write_records(records.genotyping);
+	if (this->phasing_outfile) this->phasing_outfile->write_records(records.phasing);
+	if (this->biallelic_outfile) this->biallelic_outfile->write_records(records.biallelic);
 }
 
 void VariantReader::close_genotyping_outfile() {
-	this->genotyping_outfile.close();
-	this->genotyping_outfile_open = false;
+	if (this->genotyping_outfile) this->genotyping_outfile->close();
+	this->genotyping_outfile.reset();
 }
 
 void VariantReader::close_phasing_outfile() {
-	this->phasing_outfile.close();
-	this->phasing_outfile_open = false;
+	if (this->phasing_outfile) this->phasing_outfile->close();
+	this->phasing_outfile.reset();
+}
+
+void VariantReader::close_biallelic_outfile() {
+	if (this->biallelic_outfile) this->biallelic_outfile->close();
+	this->biallelic_outfile.reset();
+	this->biallelic_variants.clear();
 }
 
 size_t VariantReader::nr_of_genomic_kmers() const {
-	return this->fasta_reader.get_total_kmers(this->kmer_size);
+	return this->nr_genomic_kmers;
 }
 
 size_t VariantReader::nr_of_paths() const {
@@ -676,6 +1137,85 @@ size_t VariantReader::nr_of_paths() const {
 }
 
 void VariantReader::get_left_overhang(std::string chromosome, size_t index, size_t length, DnaSequence& result) const {
+	auto it = this->left_overhangs.find(chromosome);
+	if ((it != this->left_overhangs.end()) && (length <= 2 * this->kmer_size)) {
+		// stored overhangs are clipped at the previous variant as well, so shorter ones are suffixes
+		const DnaSequence& overhang = it->second.at(index);
+		size_t size = overhang.size();
+		overhang.substr(size - min(length, size), size, result);
+		return;
+	}
+	read_left_overhang(chromosome, index, length, result);
+}
+
+void VariantReader::get_right_overhang(std::string chromosome, size_t index, size_t length, DnaSequence& result) const {
+	auto it = this->right_overhangs.find(chromosome);
+	if ((it != this->right_overhangs.end()) && (length <= 2 * this->kmer_size)) {
+		const DnaSequence& overhang = it->second.at(index);
+		overhang.substr(0, min(length, overhang.size()), result);
+		return;
+	}
+	read_right_overhang(chromosome, index, length, result);
+}
+
+DnaSequenceView VariantReader::get_left_overhang(std::string chromosome, size_t index, size_t length) const {
+	auto it = this->left_overhangs.find(chromosome);
+	if ((it == this->left_overhangs.end()) || (length > 2 * this->kmer_size)) {
+		throw runtime_error("VariantReader::get_left_overhang: overhang of length " + to_string(length) + " is not stored for chromosome " + chromosome + ".");
+	}
+	const DnaSequence& overhang = it->second.at(index);
+	size_t size = overhang.size();
+	return overhang.view(size - min(length, size), size);
+}
+
+DnaSequenceView VariantReader::get_right_overhang(std::string chromosome, size_t index, size_t length) const {
+	auto it = this->right_overhangs.find(chromosome);
+	if ((it == this->right_overhangs.end()) || (length > 2 * this->kmer_size)) {
+		throw runtime_error("VariantReader::get_right_overhang: overhang of length " + to_string(length) + " is not stored for chromosome " + chromosome + ".");
+	}
+	const DnaSequence& overhang = it->second.at(index);
+	return overhang.view(0, min(length, overhang.size()));
+}
+
+static uint64_t add_to_fingerprint(uint64_t fingerprint, const string& data) {
+	// FNV-1a, the length separates consecutive strings
+	for (unsigned char c : data) fingerprint = (fingerprint ^ c) * 0x100000001b3ULL;
+	return (fingerprint ^ data.size()) * 0x100000001b3ULL;
+}
+
+uint64_t VariantReader::get_fingerprint(const vector<string>& chromosomes, size_t nr_threads) const {
+	size_t length = 2 * this->kmer_size;
+	vector<uint64_t> chromosome_fingerprints(chromosomes.size(), 0xcbf29ce484222325ULL);
+	{
+		ThreadPool threadPool (max(min(nr_threads, chromosomes.size()), (size_t) 1));
+		for (size_t c = 0; c < chromosomes.size(); ++c) {
+			threadPool.submit([this, c, length, &chromosomes, &chromosome_fingerprints](){
+				const string& chromosome = chromosomes[c];
+				uint64_t fingerprint = add_to_fingerprint(chromosome_fingerprints[c], chromosome);
+				for (size_t i = 0; i < size_of(chromosome); ++i) {
+					const Variant& variant = this->variants_per_chromosome.at(chromosome)[i];
+					fingerprint = add_to_fingerprint(fingerprint, to_string(variant.get_start_position()) + ":" + to_string(variant.get_end_position()));
+					for (size_t a = 0; a < variant.nr_of_alleles(); ++a) {
+						fingerprint = add_to_fingerprint(fingerprint, variant.get_allele_string(a));
+					}
+					fingerprint = add_to_fingerprint(fingerprint, get_left_overhang(chromosome, i, length).to_string());
+					fingerprint = add_to_fingerprint(fingerprint, get_right_overhang(chromosome, i, length).to_string());
+				}
+				chromosome_fingerprints[c] = fingerprint;
+			});
+		}
+	}
+	// independent of the order the chromosomes are given in
+	sort(chromosome_fingerprints.begin(), chromosome_fingerprints.end());
+	uint64_t fingerprint = (0xcbf29ce484222325ULL ^ this->kmer_size) * 0x100000001b3ULL;
+	for (auto f : chromosome_fingerprints) {
+		fingerprint = (fingerprint ^ f) * 0x100000001b3ULL;
+		fingerprint ^= fingerprint >> 29;
+	}
+	return fingerprint;
+}
+
+void VariantReader::read_left_overhang(std::string chromosome, size_t index, size_t length, DnaSequence& result) const {
 	size_t cur_start = this->variants_per_chromosome.at(chromosome).at(index).get_start_position();
 	size_t prev_end = 0;
 	if (index > 0) prev_end = this->variants_per_chromosome.at(chromosome).at(index-1).get_end_position();
@@ -685,7 +1225,7 @@ void VariantReader::get_left_overhang(std::string chromosome, size_t index, size
 	this->fasta_reader.get_subsequence(chromosome, overhang_start, overhang_end, result);
 }
 
-void VariantReader::get_right_overhang(std::string chromosome, size_t index, size_t length, DnaSequence& result) const {
+void VariantReader::read_right_overhang(std::string chromosome, size_t index, size_t length, DnaSequence& result) const {
 	size_t cur_end = this->variants_per_chromosome.at(chromosome).at(index).get_end_position();
 	size_t next_start = this->fasta_reader.get_size_of(chromosome);
 	if (index < (this->variants_per_chromosome.at(chromosome).size() - 1)) next_start = this->variants_per_chromosome.at(chromosome).at(index+1).get_start_position();
@@ -2,7 +2,9 @@
 #define VARIANT_READER_HPP
 
 #include <string>
+#include <string_view>
 #include <map>
+#include <unordered_map>
 #include <vector>
 #include <fstream>
 #include <numeric>
@@ -12,14 +14,12 @@
 #include "variant.hpp"
 #include "genotypingresult.hpp"
 #include "uniquekmers.hpp"
+#include "vcfparser.hpp"
 #include <functional>
 #include <filesystem>
 
-#include "cereal/access.hpp"
-#include "cereal/types/memory.hpp"
-#include "cereal/types/string.hpp"
-#include "cereal/types/vector.hpp"
-#include "cereal/types/map.hpp"
+#include "indexfile.hpp"
+#include "vcfwriter.hpp"
 
 //std::vector<unsigned char> construct_index(std::vector<DnaSequence>& alleles, bool reference_added);
 //std::vector<unsigned char> construct_index(std::vector<std::string>& alleles, bool reference_added);
@@ -39,58 +39,156 @@ std::vector<unsigned char> construct_index(std::vector<T>& alleles, bool referen
 	return index;
 }
 
-//std::string hash_filenames(std::string reference, std::string vcf);
-
 class VariantReader {
 public:
     VariantReader() = default;
-	VariantReader (std::string filename, std::string reference_filename, size_t kmer_size, bool add_reference, std::string sample = "sample");
-	/**  writes all path segments (allele sequences + reference sequences in between)
-	*    to the given file.
+	/**
+	* @param filename VCF file, uncompressed or compressed with bgzip (requires an index: .tbi or .csi)
+	* @param nr_threads number of threads used to parse the VCF
 	**/
+	VariantReader (std::string filename, std::string reference_filename, size_t kmer_size, bool add_reference, std::string sample = "sample", size_t nr_threads = 1);
     FastaReader fasta_reader;
 	size_t get_kmer_size() const;
+	/**  writes all path segments (allele sequences + reference sequences in between)
+	*    to the given file.
+	**/
 	void write_path_segments(std::string filename) const;
+	/** generates the path segments in FASTA format and passes them to the given function in chunks (requires the reference) **/
+	void write_path_segments(const std::function<void(const char*, size_t)>& write) const;
 	void get_chromosomes(std::vector<std::string>* result) const;
 	size_t size_of(std::string chromosome) const;
 	const Variant& get_variant(std::string chromosome, size_t index) const;
 	const std::vector<Variant>& get_variants_on_chromosome(std::string chromosome) const;
-	void open_genotyping_outfile(std::string outfile_name);
-	void open_phasing_outfile(std::string outfile_name);
+	/** open the output files, they are compressed with bgzip (and indexed) if the name ends with ".gz", and written as BCF if it ends with ".bcf" (see VcfWriter) **/
+	void open_genotyping_outfile(std::string outfile_name, size_t nr_threads = 1);
+	void open_phasing_outfile(std::string outfile_name, size_t nr_threads = 1);
+	/**
+	* open an additional output file for the genotypes in biallelic representation: one record per variant ID,
+	* with REF/ALT as given for the ID (INFO field ID) in callset_filename (VCF, uncompressed or bgzipped).
+	* The input VCF must carry the IDs of the alleles.
+	**/
+	void open_biallelic_outfile(std::string outfile_name, std::string callset_filename, size_t nr_threads = 1);
 	void write_genotypes_of(std::string chromosome, const std::vector<GenotypingResult>& genotyping_result, std::vector<UniqueKmers*>* unique_kmers, bool ignore_imputed = false);
 	void write_phasing_of(std::string chromosome, const std::vector<GenotypingResult>& genotyping_result, std::vector<UniqueKmers*>* unique_kmers, bool ignore_imputed = false);
+	/**
+	* append the VCF records of a chromosome to buffer, encoded as BCF if an encoder is given (used by write_genotypes_of/write_phasing_of, thread safe).
+	* If biallelic_buffer is given, the biallelic records (see open_biallelic_outfile) are appended to it.
+	**/
+	void format_genotypes_of(std::string chromosome, const std::vector<GenotypingResult>& genotyping_result, const std::vector<UniqueKmers*>* unique_kmers, bool ignore_imputed, std::string& buffer, const BcfEncoder* encoder = nullptr, std::string* biallelic_buffer = nullptr, const BcfEncoder* biallelic_encoder = nullptr) const;
+	void format_phasing_of(std::string chromosome, const std::vector<GenotypingResult>& genotyping_result, const std::vector<UniqueKmers*>* unique_kmers, bool ignore_imputed, std::string& buffer, const BcfEncoder* encoder = nullptr) const;
+	/** records of a chromosome, formatted for each open output file **/
+	struct FormattedResults {
+		std::string genotyping;
+		std::string phasing;
+		std::string biallelic;
+	};
+	/** format the records of a chromosome for all open output files (thread safe) **/
+	void format_results(std::string chromosome, const std::vector<GenotypingResult>& genotyping_result, const std::vector<UniqueKmers*>* unique_kmers, bool ignore_imputed, FormattedResults& result) const;
+	/** write formatted records to the open output files, chromosomes must be written one after the other **/
+	void write_formatted(const FormattedResults& records);
 	void close_genotyping_outfile();
 	void close_phasing_outfile();
+	void close_biallelic_outfile();
 	size_t nr_of_genomic_kmers() const;
 	size_t nr_of_paths() const;
 	void get_left_overhang(std::string chromosome, size_t index, size_t length, DnaSequence& result) const;
 	void get_right_overhang(std::string chromosome, size_t index, size_t length, DnaSequence& result) const;
-    void Store() const;
-    void Load(std::string name);
+	/** views of the overhangs stored in the index (length must not exceed 2*kmer_size) **/
+	DnaSequenceView get_left_overhang(std::string chromosome, size_t index, size_t length) const;
+	DnaSequenceView get_right_overhang(std::string chromosome, size_t index, size_t length) const;
+	/**
+	* fingerprint of the variants on the given chromosomes (kmer size, positions, allele and overhang sequences),
+	* which determine the kmers PanGenie queries. Identical for a panel read from the VCF or from its index.
+	**/
+	uint64_t get_fingerprint(const std::vector<std::string>& chromosomes, size_t nr_threads = 1) const;
+	/**
+	* write the panel to a binary index (see IndexWriter), the VCF and reference it was built from are fingerprinted.
+	* filename is a manifest listing the chromosomes, the data of each chromosome is written to its own shard
+	* (see shard_filename) in parallel.
+	**/
+	void Store(std::string filename, std::string vcf_filename, std::string reference_filename, size_t nr_threads = 1) const;
+	/**
+	* read a panel from an index written by Store. Throws if it was built with a different kmer size or add_reference setting,
+	* or from a different VCF (or reference, if given).
+	* @param chromosomes only the shards of these chromosomes are read (all if empty)
+	* @param nr_threads number of shards read in parallel
+	**/
+	void Load(std::string filename, size_t kmer_size, bool add_reference, std::string vcf_filename, std::string reference_filename = "", const std::vector<std::string>& chromosomes = {}, size_t nr_threads = 1);
+	/** name of the file storing the shard with the given index **/
+	static std::string shard_filename(std::string filename, size_t index);
     std::string sample;
 
 private:
-    friend cereal::access;
-    template<class Archive>
-    void serialize(Archive & archive)
-    {
-    archive(kmer_size, nr_paths, nr_variants, add_reference, sample, variants_per_chromosome, variant_ids); 
-    }
-    std::string REF_VCF_HASH_NAME;
 	size_t kmer_size;
 	size_t nr_paths;
 	size_t nr_variants;
 	bool add_reference;
 	//std::string sample;
-	std::ofstream genotyping_outfile;
-	std::ofstream phasing_outfile;
-	bool genotyping_outfile_open;
-	bool phasing_outfile_open;
+	std::unique_ptr<VcfWriter> genotyping_outfile;
+	std::unique_ptr<VcfWriter> phasing_outfile;
+	std::unique_ptr<VcfWriter> biallelic_outfile;
+	/** a biallelic variant of the callset **/
+	struct BiallelicVariant {
+		size_t position;
+		std::string reference;
+		std::string alternative;
+	};
+	/** biallelic variants by ID, for each chromosome of the panel **/
+	std::map<std::string, std::unordered_map<std::string, BiallelicVariant>> biallelic_variants;
 	std::map< std::string, std::vector<Variant> > variants_per_chromosome;
 	std::map< std::string, std::vector<std::vector<std::string>>> variant_ids;
+	size_t nr_genomic_kmers;
+	/** reference sequence (of length at most 2*kmer_size) left and right of each variant, stored in the index so that genotyping does not need the reference **/
+	std::map< std::string, std::vector<DnaSequence>> left_overhangs;
+	std::map< std::string, std::vector<DnaSequence>> right_overhangs;
+	/** extract the overhangs of all variants from the reference, chromosomes are processed in parallel **/
+	void store_overhangs(size_t nr_threads);
+	void read_left_overhang(std::string chromosome, size_t index, size_t length, DnaSequence& result) const;
+	void read_right_overhang(std::string chromosome, size_t index, size_t length, DnaSequence& result) const;
 	void add_variant_cluster(std::string& chromosome, std::vector<Variant>* cluster);
+	void set_nr_paths(size_t nr_samples);
+	/** read uncompressed VCF **/
+	void read_vcf(std::string filename, size_t nr_threads);
+	/** read bgzipped VCF with index, chromosomes are processed in parallel **/
+	void read_bgzf_vcf(std::string filename, size_t nr_threads);
+	/** read and cluster the records between the given virtual offsets **/
+	void read_bgzf_chromosome(std::string filename, std::string chromosome, uint64_t begin, uint64_t end);
+	/** add a record to the current cluster (or start a new one) **/
+	void add_record(const VcfRecord& record, std::string& previous_chrom, size_t& previous_end_pos, std::vector<Variant>& variant_cluster);
 	void insert_ids(std::string& chromosome, std::vector<DnaSequence>& alleles, std::vector<std::string>& variant_ids, bool reference_added);
-	std::string get_ids(std::string chromosome, std::vector<std::string>& alleles, size_t variant_index, bool reference_added);
+	std::string get_ids(std::string chromosome, std::vector<std::string>& alleles, size_t variant_index, bool reference_added) const;
+	/** values of an output record, written as VCF text or BCF **/
+	struct OutputRecord {
+		std::string_view chromosome;
+		/** 0-based position of the reference allele **/
+		size_t start_position;
+		std::string_view id;
+		std::string reference;
+		std::vector<std::string> alt_alleles;
+		std::vector<unsigned char> defined_alleles;
+		/** frequencies of the defined alternative alleles **/
+		std::vector<float> allele_frequencies;
+		size_t nr_unique_kmers;
+		std::vector<int> kmer_counts;
+		size_t nr_missing;
+		/** empty if no IDs were given in the input **/
+		std::string ids;
+		/** -1 for missing alleles **/
+		std::pair<int,int> genotype;
+		size_t genotype_quality = 0;
+		/** genotype likelihoods (genotyping only) **/
+		std::vector<long double> likelihoods;
+		unsigned short coverage;
+	};
+	void format_records(std::string chromosome, const std::vector<GenotypingResult>& genotyping_result, const std::vector<UniqueKmers*>* unique_kmers, bool ignore_imputed, bool genotyping, const BcfEncoder* encoder, std::string& buffer, std::string* biallelic_buffer = nullptr, const BcfEncoder* biallelic_encoder = nullptr) const;
+	void append_vcf_record(const OutputRecord& record, bool genotyping, std::string& buffer) const;
+	void append_bcf_record(const OutputRecord& record, bool genotyping, const BcfEncoder& encoder, std::string& buffer) const;
+	/** append one biallelic record per variant ID of the record (sorted by position) **/
+	void append_biallelic_records(const OutputRecord& record, const BcfEncoder* encoder, std::string& buffer) const;
+	/** read REF/ALT of each variant ID from a VCF **/
+	void read_biallelic_variants(std::string filename);
+	/** header lines declaring the filter and the contigs, required for BCF output **/
+	std::string bcf_header_lines() const;
 };
 
 #endif // VARIANT_READER_HPP
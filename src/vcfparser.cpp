@@ -0,0 +1,236 @@
+#include "vcfparser.hpp"
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+#include "threadpool.hpp"
+
+using namespace std;
+
+const unsigned char VcfParser::UNDEFINED_ALLELE;
+
+/** characters allowed in ALT alleles **/
+struct AltAlphabet {
+	bool allowed[256];
+	AltAlphabet() {
+		memset(allowed, 0, sizeof(allowed));
+		for (unsigned char c : string("ACGTacgt,")) allowed[c] = true;
+	}
+};
+
+const AltAlphabet ALT_ALPHABET;
+
+/** end of the field starting at begin (next separator or end) **/
+inline const char* field_end(const char* begin, const char* end, char sep) {
+	const char* result = (const char*) memchr(begin, sep, end - begin);
+	return (result == nullptr) ? end : result;
+}
+
+inline size_t parse_number(string_view s) {
+	size_t result = 0;
+	for (char c : s) {
+		if ((c < '0') || (c > '9')) break;
+		result = result * 10 + (c - '0');
+	}
+	return result;
+}
+
+inline const char* parse_allele(string_view allele, vector<unsigned char>& paths) {
+	// handle unknown genotypes '.'
+	if (allele == ".") {
+		paths.push_back(VcfParser::UNDEFINED_ALLELE);
+		return nullptr;
+	}
+	size_t index = parse_number(allele);
+	if (index >= VcfParser::UNDEFINED_ALLELE) {
+		return "invalid genotype in VCF.";
+	}
+	paths.push_back((unsigned char) index);
+	return nullptr;
+}
+
+/** parses "a|b" (possibly followed by other FORMAT fields) into two alleles, returns an error message or nullptr **/
+inline const char* parse_genotype(const char* begin, const char* end, vector<unsigned char>& paths) {
+	if (memchr(begin, '/', end - begin) != nullptr) {
+		return "Found unphased genotype.";
+	}
+	const char* separator = field_end(begin, end, '|');
+	const char* second_end = (separator < end) ? field_end(separator + 1, end, '|') : end;
+	bool diploid = (separator < end) && (second_end > separator + 1) && ((second_end == end) || (second_end + 1 == end));
+	if (!diploid) {
+		return "Found invalid genotype. Genotypes must be diploid (.|. if missing).";
+	}
+	const char* error = parse_allele(string_view(begin, separator - begin), paths);
+	if (error != nullptr) return error;
+	return parse_allele(string_view(separator + 1, second_end - separator - 1), paths);
+}
+
+void VcfParser::split(string_view line, char sep, vector<string_view>& result) {
+	const char* begin = line.data();
+	const char* end = begin + line.size();
+	while (begin < end) {
+		const char* next = field_end(begin, end, sep);
+		result.push_back(string_view(begin, next - begin));
+		begin = next + 1;
+	}
+}
+
+VcfParser::VcfParser(string filename, size_t nr_threads, size_t chunk_size)
+	:file(filename, true),
+	 nr_threads(max(nr_threads, (size_t) 1)),
+	 chunk_size(max(chunk_size, (size_t) 1)),
+	 offset(0)
+{
+	this->offset = parse_header(this->file.data(), this->file.data() + this->file.size(), this->samples);
+}
+
+size_t VcfParser::parse_header(const char* begin, const char* end, vector<string>& samples) {
+	vector<string> fields = {"#CHROM", "POS", "ID", "REF", "ALT", "QUAL", "FILTER", "INFO", "FORMAT"};
+	const char* line = begin;
+	while (line < end) {
+		const char* line_end = field_end(line, end, '\n');
+		if ((line_end > line) && (line[0] != '#')) break;
+		const char* next_line = min(line_end + 1, end);
+		if ((line_end - line < 2) || (line[1] == '#')) {
+			line = next_line;
+			continue;
+		}
+		vector<string_view> tokens;
+		split(string_view(line, line_end - line), '\t', tokens);
+		// check number of samples/paths given
+		if (tokens.size() < 9) {
+			throw runtime_error("VcfParser::parse_header: not a proper VCF-file.");
+		}
+		if (tokens.size() < 10) {
+			throw runtime_error("VcfParser::parse_header: no haplotype paths given.");
+		}
+		// validate header line
+		for (unsigned int i = 0; i < 9; ++i) {
+			if (tokens[i] != fields[i]) {
+				throw runtime_error("VcfParser::parse_header: VCF header line is malformed.");
+			}
+		}
+		for (size_t i = 9; i < tokens.size(); ++i) {
+			samples.push_back(string(tokens[i]));
+		}
+		return next_line - begin;
+	}
+	throw runtime_error("VcfParser::parse_header: not a proper VCF-file (header line is missing).");
+}
+
+const vector<string>& VcfParser::get_samples() const {
+	return this->samples;
+}
+
+bool VcfParser::next_batch(vector<VcfRecord>& records) {
+	records.clear();
+	const char* data = this->file.data();
+	size_t size = this->file.size();
+	if (this->offset >= size) return false;
+
+	// split the next part of the file into chunks that end at line boundaries
+	vector<pair<size_t,size_t>> chunks;
+	while ((chunks.size() < this->nr_threads) && (this->offset < size)) {
+		size_t start = this->offset;
+		size_t end = min(start + this->chunk_size, size);
+		if (end < size) {
+			end = (field_end(data + end - 1, data + size, '\n') - data) + 1;
+			end = min(end, size);
+		}
+		chunks.push_back(make_pair(start, end));
+		this->offset = end;
+	}
+
+	vector<vector<VcfRecord>> results(chunks.size());
+	if (chunks.size() == 1) {
+		parse_lines(data + chunks[0].first, data + chunks[0].second, &results[0]);
+	} else {
+		ThreadPool threadPool (chunks.size());
+		for (size_t i = 0; i < chunks.size(); ++i) {
+			vector<VcfRecord>* result = &results[i];
+			const char* start = data + chunks[i].first;
+			const char* end = data + chunks[i].second;
+			threadPool.submit([=](){ parse_lines(start, end, result); });
+		}
+	}
+
+	// reassemble in file order
+	size_t total = 0;
+	for (auto& r : results) total += r.size();
+	records.reserve(total);
+	for (auto& r : results) {
+		move(r.begin(), r.end(), back_inserter(records));
+	}
+	return true;
+}
+
+void VcfParser::parse_lines(const char* begin, const char* chunk_end, vector<VcfRecord>* records) {
+	const char* line = begin;
+	while (line < chunk_end) {
+		const char* line_end = field_end(line, chunk_end, '\n');
+		const char* next_line = line_end + 1;
+		// skip empty lines and header lines
+		if ((line_end == line) || (line[0] == '#')) {
+			line = next_line;
+			continue;
+		}
+		VcfRecord record;
+		record.position = 0;
+		record.alt_defined = false;
+		record.nr_columns = 0;
+		record.genotype_error = nullptr;
+
+		// tokenize the first nine columns
+		string_view columns[9];
+		const char* field = line;
+		while ((record.nr_columns < 9) && (field <= line_end)) {
+			const char* next = field_end(field, line_end, '\t');
+			columns[record.nr_columns] = string_view(field, next - field);
+			record.nr_columns += 1;
+			field = next + 1;
+		}
+		// count the genotype columns
+		const char* genotypes = field;
+		size_t nr_genotypes = 0;
+		if (genotypes <= line_end) {
+			nr_genotypes = 1 + count(genotypes, line_end, '\t');
+		}
+		record.nr_columns += nr_genotypes;
+		if (record.nr_columns < 10) {
+			records->push_back(record);
+			line = next_line;
+			continue;
+		}
+
+		record.chromosome = columns[0];
+		// VCF positions are 1-based
+		record.position = parse_number(columns[1]) - 1;
+		record.ref = columns[3];
+		record.alt = columns[4];
+		record.alt_defined = !record.alt.empty();
+		for (unsigned char c : record.alt) {
+			if (!ALT_ALPHABET.allowed[c]) {
+				record.alt_defined = false;
+				break;
+			}
+		}
+
+		// variant IDs
+		vector<string_view> info_fields;
+		split(columns[7], ';', info_fields);
+		for (string_view info : info_fields) {
+			if (info.substr(0, 3) == "ID=") split(info.substr(3), ',', record.ids);
+		}
+
+		// genotypes
+		record.paths.reserve(2 * nr_genotypes);
+		field = genotypes;
+		while (field <= line_end) {
+			const char* next = field_end(field, line_end, '\t');
+			record.genotype_error = parse_genotype(field, next, record.paths);
+			if (record.genotype_error != nullptr) break;
+			field = next + 1;
+		}
+		records->push_back(move(record));
+		line = next_line;
+	}
+}
@@ -0,0 +1,68 @@
+#ifndef VCFPARSER_HPP
+#define VCFPARSER_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include "mappedfile.hpp"
+
+/**
+* Fields of a VCF record needed to construct variants. Strings point into
+* the memory mapped VCF file and stay valid as long as the VcfParser exists.
+**/
+
+struct VcfRecord {
+	std::string_view chromosome;
+	/** 0-based position **/
+	size_t position;
+	std::string_view ref;
+	/** complete ALT column **/
+	std::string_view alt;
+	/** true if ALT only consists of nucleotides (ACGTacgt) and commas **/
+	bool alt_defined;
+	/** variant IDs given in the ID field of the INFO column **/
+	std::vector<std::string_view> ids;
+	/** number of tab-separated columns **/
+	size_t nr_columns;
+	/** allele carried by each haplotype (two per sample), VcfParser::UNDEFINED_ALLELE for missing alleles **/
+	std::vector<unsigned char> paths;
+	/** first problem found in the genotype columns (nullptr if there is none) **/
+	const char* genotype_error;
+};
+
+/**
+* Reads an uncompressed VCF file with phased haplotypes. The file is memory mapped and split into
+* chunks at line boundaries, which are parsed in parallel. Records are returned in
+* file order in batches, so that only a part of the file is held in memory at once.
+**/
+
+class VcfParser {
+public:
+	static const unsigned char UNDEFINED_ALLELE = 255;
+	/**
+	* @param filename uncompressed VCF file
+	* @param nr_threads number of threads used for parsing
+	* @param chunk_size approximate number of bytes parsed by a thread per batch
+	**/
+	VcfParser(std::string filename, size_t nr_threads = 1, size_t chunk_size = 1 << 24);
+	/** sample names given in the header line **/
+	const std::vector<std::string>& get_samples() const;
+	/** parse the next records (in file order) into the given vector. Returns false if all records have been read. **/
+	bool next_batch(std::vector<VcfRecord>& records);
+	/** parse all records in the given lines (e.g. decompressed from a bgzipped VCF) **/
+	static void parse_lines(const char* begin, const char* end, std::vector<VcfRecord>* records);
+	/** parse the header lines and return the number of bytes up to the first record **/
+	static size_t parse_header(const char* begin, const char* end, std::vector<std::string>& samples);
+	/** split at the separator (a trailing empty field is omitted) **/
+	static void split(std::string_view line, char sep, std::vector<std::string_view>& result);
+
+private:
+	MappedFile file;
+	size_t nr_threads;
+	size_t chunk_size;
+	/** offset of the first unread byte **/
+	size_t offset;
+	std::vector<std::string> samples;
+};
+
+#endif // VCFPARSER_HPP
@@ -0,0 +1,301 @@
+#include "vcfwriter.hpp"
+#include <stdexcept>
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+
+using namespace std;
+
+// tabix binning scheme (also used for CSI): 16kb windows for the linear index, bins of 5 levels
+static const int TBI_MIN_SHIFT = 14;
+static const int TBI_DEPTH = 5;
+static const uint32_t TBI_PSEUDO_BIN = 37450;
+static const uint64_t UNSET_OFFSET = UINT64_MAX;
+
+/** bin of the smallest level containing the interval [begin, end) (from the SAM specification) **/
+static uint32_t region_to_bin(uint64_t begin, uint64_t end) {
+	--end;
+	if ((begin >> 14) == (end >> 14)) return ((1 << 15) - 1) / 7 + (begin >> 14);
+	if ((begin >> 17) == (end >> 17)) return ((1 << 12) - 1) / 7 + (begin >> 17);
+	if ((begin >> 20) == (end >> 20)) return ((1 << 9) - 1) / 7 + (begin >> 20);
+	if ((begin >> 23) == (end >> 23)) return ((1 << 6) - 1) / 7 + (begin >> 23);
+	if ((begin >> 26) == (end >> 26)) return ((1 << 3) - 1) / 7 + (begin >> 26);
+	return 0;
+}
+
+template<class T>
+static void append_value(string& buffer, T value) {
+	buffer.append((const char*) &value, sizeof(T));
+}
+
+VcfWriter::VcfWriter(string filename, size_t nr_threads)
+	:filename(filename),
+	 bcf(is_bcf(filename)),
+	 records_written(false),
+	 closed(false)
+{
+	if (is_compressed(filename) || this->bcf) {
+		this->compressed_file = unique_ptr<BgzfWriter>(new BgzfWriter(filename, nr_threads));
+	} else {
+		this->plain_file.open(filename, ios::out | ios::binary | ios::trunc);
+		if (!this->plain_file.good()) {
+			throw runtime_error("VcfWriter::VcfWriter: output file " + filename + " cannot be opened. Note that the filename must not contain non-existing directories.");
+		}
+	}
+}
+
+VcfWriter::~VcfWriter() {
+	if (!this->closed) {
+		try {
+			close();
+		} catch (const exception& e) {
+			cerr << e.what() << endl;
+		}
+	}
+}
+
+bool VcfWriter::is_compressed(string filename) {
+	return (filename.size() > 3) && (filename.substr(filename.size() - 3) == ".gz");
+}
+
+bool VcfWriter::is_bcf(string filename) {
+	return (filename.size() > 4) && (filename.substr(filename.size() - 4) == ".bcf");
+}
+
+const BcfEncoder* VcfWriter::get_bcf_encoder() const {
+	return this->bcf_encoder.get();
+}
+
+void VcfWriter::write_header(const string& header) {
+	if (this->records_written) {
+		throw runtime_error("VcfWriter::write_header: header must be written before the records.");
+	}
+	if (this->bcf) {
+		if (this->bcf_encoder) {
+			throw runtime_error("VcfWriter::write_header: the header of a BCF file can only be written once.");
+		}
+		this->bcf_encoder = unique_ptr<BcfEncoder>(new BcfEncoder(header));
+		// magic, length of the (null-terminated) header text
+		uint32_t length = header.size() + 1;
+		this->compressed_file->write("BCF\2\2", 5);
+		this->compressed_file->write((const char*) &length, sizeof(uint32_t));
+		this->compressed_file->write(header.c_str(), length);
+		// records start in a new block
+		this->compressed_file->flush();
+	} else if (this->compressed_file) {
+		this->compressed_file->write(header);
+	} else {
+		this->plain_file.write(header.data(), header.size());
+	}
+}
+
+void VcfWriter::write_records(const string& records) {
+	if (this->closed) {
+		throw runtime_error("VcfWriter::write_records: file " + this->filename + " is already closed.");
+	}
+	if (this->bcf && !this->bcf_encoder) {
+		throw runtime_error("VcfWriter::write_records: header must be written before the records.");
+	}
+	this->records_written = true;
+	if (!this->compressed_file) {
+		this->plain_file.write(records.data(), records.size());
+		return;
+	}
+	uint64_t offset = this->compressed_file->tell();
+	size_t start = 0;
+	while (start < records.size()) {
+		size_t length = 0;
+		if (this->bcf) {
+			// record: length of the shared and the individual part, followed by both parts
+			if (records.size() - start < 2 * sizeof(uint32_t)) {
+				throw runtime_error("VcfWriter::write_records: incomplete BCF record.");
+			}
+			uint32_t shared_length, individual_length;
+			memcpy(&shared_length, records.data() + start, sizeof(uint32_t));
+			memcpy(&individual_length, records.data() + start + sizeof(uint32_t), sizeof(uint32_t));
+			length = 2 * sizeof(uint32_t) + (size_t) shared_length + individual_length;
+			if (length > records.size() - start) {
+				throw runtime_error("VcfWriter::write_records: incomplete BCF record.");
+			}
+			index_bcf_record(records.data() + start, length, offset + start);
+		} else {
+			const char* end = (const char*) memchr(records.data() + start, '\n', records.size() - start);
+			length = (end == nullptr) ? records.size() - start : (end - records.data()) - start + 1;
+			index_vcf_line(records.data() + start, length, offset + start);
+		}
+		start += length;
+	}
+	this->compressed_file->write(records);
+}
+
+void VcfWriter::index_vcf_line(const char* line, size_t length, uint64_t offset) {
+	// CHROM, POS and REF determine the interval covered by the record
+	const char* line_end = line + length;
+	const char* fields[5];
+	fields[0] = line;
+	size_t nr_fields = 1;
+	for (const char* c = line; (c < line_end) && (nr_fields < 5); ++c) {
+		if (*c == '\t') fields[nr_fields++] = c + 1;
+	}
+	if (nr_fields < 5) {
+		throw runtime_error("VcfWriter::index_vcf_line: malformed VCF record.");
+	}
+	string chromosome(fields[0], fields[1] - fields[0] - 1);
+	uint64_t begin = strtoull(fields[1], nullptr, 10) - 1;
+	uint64_t end = begin + max((size_t) 1, (size_t) (fields[4] - fields[3] - 1));
+	add_to_index(chromosome, begin, end, offset, length);
+}
+
+void VcfWriter::index_bcf_record(const char* record, size_t length, uint64_t offset) {
+	// CHROM, POS and rlen follow the two length fields
+	int32_t fields[3];
+	if (length < 2 * sizeof(uint32_t) + sizeof(fields)) {
+		throw runtime_error("VcfWriter::index_bcf_record: malformed BCF record.");
+	}
+	memcpy(fields, record + 2 * sizeof(uint32_t), sizeof(fields));
+	const vector<string>& contigs = this->bcf_encoder->get_contigs();
+	if ((fields[0] < 0) || ((size_t) fields[0] >= contigs.size()) || (fields[1] < 0)) {
+		throw runtime_error("VcfWriter::index_bcf_record: malformed BCF record.");
+	}
+	uint64_t begin = fields[1];
+	add_to_index(contigs[fields[0]], begin, begin + max(fields[2], 1), offset, length);
+}
+
+void VcfWriter::add_to_index(const string& chromosome, uint64_t begin, uint64_t end, uint64_t offset, size_t length) {
+	if (this->chromosome_names.empty() || (this->chromosome_names.back() != chromosome)) {
+		if (find(this->chromosome_names.begin(), this->chromosome_names.end(), chromosome) != this->chromosome_names.end()) {
+			throw runtime_error("VcfWriter::add_to_index: records of chromosome " + chromosome + " are not contiguous.");
+		}
+		this->chromosome_names.push_back(chromosome);
+		this->index.push_back(ChromosomeIndex{{}, {}, offset, offset, 0});
+	}
+	ChromosomeIndex& chromosome_index = this->index.back();
+	uint64_t offset_end = offset + length;
+
+	// consecutive records in the same bin share a chunk
+	vector<pair<uint64_t,uint64_t>>& chunks = chromosome_index.bins[region_to_bin(begin, end)];
+	if (!chunks.empty() && (chunks.back().second == offset)) {
+		chunks.back().second = offset_end;
+	} else {
+		chunks.push_back(make_pair(offset, offset_end));
+	}
+	// linear index: offset of the first record overlapping each window
+	uint64_t last_window = (end - 1) >> TBI_MIN_SHIFT;
+	if (chromosome_index.linear.size() <= last_window) chromosome_index.linear.resize(last_window + 1, UNSET_OFFSET);
+	for (uint64_t window = begin >> TBI_MIN_SHIFT; window <= last_window; ++window) {
+		if (chromosome_index.linear[window] == UNSET_OFFSET) chromosome_index.linear[window] = offset;
+	}
+	chromosome_index.last_offset = offset_end;
+	chromosome_index.nr_records += 1;
+}
+
+void VcfWriter::close() {
+	if (this->closed) return;
+	this->closed = true;
+	if (this->compressed_file) {
+		this->compressed_file->close();
+		if (this->bcf) {
+			write_csi_index();
+		} else {
+			write_tabix_index();
+		}
+	} else {
+		this->plain_file.close();
+		if (this->plain_file.fail()) {
+			throw runtime_error("VcfWriter::close: output file " + this->filename + " could not be written.");
+		}
+	}
+}
+
+void VcfWriter::write_index_bins(const ChromosomeIndex& chromosome_index, bool csi, string& result) const {
+	const BgzfWriter& file = *this->compressed_file;
+	// windows not overlapped by any record get the offset of the previous one
+	vector<uint64_t> linear;
+	uint64_t previous = 0;
+	for (uint64_t offset : chromosome_index.linear) {
+		if (offset != UNSET_OFFSET) previous = file.virtual_offset(offset);
+		linear.push_back(previous);
+	}
+
+	append_value<int32_t>(result, chromosome_index.bins.size() + 1);
+	for (auto& bin : chromosome_index.bins) {
+		append_value<uint32_t>(result, bin.first);
+		if (csi) {
+			// CSI has no linear index, each bin stores the smallest offset of records overlapping its first window
+			int level = 0;
+			while ((level < TBI_DEPTH) && (bin.first >= ((1u << (3 * (level + 1))) - 1) / 7)) ++level;
+			uint64_t first_position = (uint64_t) (bin.first - ((1u << (3 * level)) - 1) / 7) << (TBI_MIN_SHIFT + 3 * (TBI_DEPTH - level));
+			uint64_t window = first_position >> TBI_MIN_SHIFT;
+			append_value<uint64_t>(result, (window < linear.size()) ? linear[window] : 0);
+		}
+		append_value<int32_t>(result, bin.second.size());
+		for (auto& chunk : bin.second) {
+			append_value<uint64_t>(result, file.virtual_offset(chunk.first));
+			append_value<uint64_t>(result, file.virtual_offset(chunk.second));
+		}
+	}
+	// pseudo bin with the offsets of the chromosome and the number of records
+	append_value<uint32_t>(result, TBI_PSEUDO_BIN);
+	if (csi) append_value<uint64_t>(result, 0);
+	append_value<int32_t>(result, 2);
+	append_value<uint64_t>(result, file.virtual_offset(chromosome_index.first_offset));
+	append_value<uint64_t>(result, file.virtual_offset(chromosome_index.last_offset));
+	append_value<uint64_t>(result, chromosome_index.nr_records);
+	append_value<uint64_t>(result, 0);
+	if (!csi) {
+		append_value<int32_t>(result, linear.size());
+		for (uint64_t offset : linear) append_value<uint64_t>(result, offset);
+	}
+}
+
+void VcfWriter::write_tabix_index() {
+	string result = "TBI\1";
+	append_value<int32_t>(result, this->chromosome_names.size());
+	// VCF preset: format, sequence, begin and end column, comment character, lines to skip
+	append_value<int32_t>(result, 2);
+	append_value<int32_t>(result, 1);
+	append_value<int32_t>(result, 2);
+	append_value<int32_t>(result, 0);
+	append_value<int32_t>(result, '#');
+	append_value<int32_t>(result, 0);
+	string names = "";
+	for (auto& name : this->chromosome_names) {
+		names += name;
+		names += '\0';
+	}
+	append_value<int32_t>(result, names.size());
+	result += names;
+	for (auto& chromosome_index : this->index) {
+		write_index_bins(chromosome_index, false, result);
+	}
+	// number of records without coordinates
+	append_value<uint64_t>(result, 0);
+
+	BgzfWriter index_file(this->filename + ".tbi");
+	index_file.write(result);
+	index_file.close();
+}
+
+void VcfWriter::write_csi_index() {
+	string result = "CSI\1";
+	append_value<int32_t>(result, TBI_MIN_SHIFT);
+	append_value<int32_t>(result, TBI_DEPTH);
+	// no auxiliary data, references are the contigs of the BCF header
+	append_value<int32_t>(result, 0);
+	const vector<string>& contigs = this->bcf_encoder->get_contigs();
+	append_value<int32_t>(result, contigs.size());
+	for (auto& contig : contigs) {
+		auto it = find(this->chromosome_names.begin(), this->chromosome_names.end(), contig);
+		if (it == this->chromosome_names.end()) {
+			append_value<int32_t>(result, 0);
+		} else {
+			write_index_bins(this->index[it - this->chromosome_names.begin()], true, result);
+		}
+	}
+	append_value<uint64_t>(result, 0);
+
+	BgzfWriter index_file(this->filename + ".csi");
+	index_file.write(result);
+	index_file.close();
+}
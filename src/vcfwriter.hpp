@@ -0,0 +1,73 @@
+#ifndef VCFWRITER_HPP
+#define VCFWRITER_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <fstream>
+#include <stdint.h>
+#include "bgzfwriter.hpp"
+#include "bcfencoder.hpp"
+
+/**
+* Writes a VCF file, either uncompressed or, if the filename ends with ".gz", compressed with
+* bgzip. For compressed output a tabix index (<filename>.tbi) is written along with the file.
+* Records are passed in as blocks of complete lines which have been formatted beforehand.
+* If the filename ends with ".bcf", a BCF file is written instead, records then have to be
+* encoded with the encoder of the writer (see get_bcf_encoder) and a CSI index (<filename>.csi)
+* is written.
+**/
+
+class VcfWriter {
+public:
+	/**
+	* @param filename name of the output file
+	* @param nr_threads number of threads used for compression
+	**/
+	VcfWriter(std::string filename, size_t nr_threads = 1);
+	~VcfWriter();
+	VcfWriter(const VcfWriter&) = delete;
+	VcfWriter& operator=(const VcfWriter&) = delete;
+	/** check whether output to the given file will be compressed **/
+	static bool is_compressed(std::string filename);
+	/** check whether output to the given file will be BCF **/
+	static bool is_bcf(std::string filename);
+	/** write header lines (must be given before any record). For BCF, they must declare all contigs. **/
+	void write_header(const std::string& header);
+	/** write complete records, records of a chromosome must be given sorted and without records of other chromosomes in between **/
+	void write_records(const std::string& records);
+	/** finish the file (and write the index) **/
+	void close();
+	/** encoder for the records of a BCF file (available after write_header), nullptr for VCF **/
+	const BcfEncoder* get_bcf_encoder() const;
+
+private:
+	/** index data of one chromosome, using positions in the uncompressed file **/
+	struct ChromosomeIndex {
+		std::map<uint32_t, std::vector<std::pair<uint64_t,uint64_t>>> bins;
+		std::vector<uint64_t> linear;
+		uint64_t first_offset;
+		uint64_t last_offset;
+		uint64_t nr_records;
+	};
+	std::string filename;
+	std::ofstream plain_file;
+	std::unique_ptr<BgzfWriter> compressed_file;
+	std::unique_ptr<BcfEncoder> bcf_encoder;
+	bool bcf;
+	std::vector<std::string> chromosome_names;
+	std::vector<ChromosomeIndex> index;
+	bool records_written;
+	bool closed;
+	/** add a record covering [begin, end) that is stored at offset (and the following length bytes) **/
+	void add_to_index(const std::string& chromosome, uint64_t begin, uint64_t end, uint64_t offset, size_t length);
+	void index_vcf_line(const char* line, size_t length, uint64_t offset);
+	void index_bcf_record(const char* record, size_t length, uint64_t offset);
+	/** bins (of the tabix/CSI binning scheme) and linear index, offsets translated to virtual offsets **/
+	void write_index_bins(const ChromosomeIndex& chromosome_index, bool csi, std::string& result) const;
+	void write_tabix_index();
+	void write_csi_index();
+};
+
+#endif // VCFWRITER_HPP
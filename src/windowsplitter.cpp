@@ -0,0 +1,60 @@
+#include "windowsplitter.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+WindowSplitter::WindowSplitter(size_t window_size, size_t overlap)
+	:window_size(window_size),
+	 overlap(overlap)
+{
+	// a window of a single variant leaves no room for choosing where to cut
+	if (window_size == 1) {
+		throw runtime_error("WindowSplitter::WindowSplitter: windows must contain at least 2 variants.");
+	}
+}
+
+void WindowSplitter::split(const vector<size_t>& positions, vector<GenotypingWindow>& result) const {
+	size_t nr_variants = positions.size();
+	// window cores, each given by the index of its first variant
+	vector<size_t> starts = {0};
+	if (this->window_size > 0) {
+		size_t half = this->window_size / 2;
+		size_t start = 0;
+		while (nr_variants - start > this->window_size + half) {
+			// cut in front of the variant with the largest distance to its predecessor
+			size_t cut = start + half;
+			size_t largest = 0;
+			for (size_t i = start + half; i <= start + this->window_size + half; ++i) {
+				size_t distance = (positions[i] > positions[i-1]) ? (positions[i] - positions[i-1]) : 0;
+				if (distance > largest) {
+					largest = distance;
+					cut = i;
+				}
+			}
+			starts.push_back(cut);
+			start = cut;
+		}
+	}
+	for (size_t w = 0; w < starts.size(); ++w) {
+		GenotypingWindow window;
+		window.core_begin = starts[w];
+		window.core_end = (w + 1 < starts.size()) ? starts[w+1] : nr_variants;
+		window.begin = (window.core_begin > this->overlap) ? (window.core_begin - this->overlap) : 0;
+		window.end = min(window.core_end + this->overlap, nr_variants);
+		result.push_back(window);
+	}
+}
+
+size_t WindowSplitter::nr_windows(const vector<size_t>& positions) const {
+	// cores contain between half and one and a half window sizes, so the number depends on where the cuts are
+	vector<GenotypingWindow> windows;
+	split(positions, windows);
+	return windows.size();
+}
+
+size_t WindowSplitter::max_window_variants(size_t nr_variants) const {
+	if (this->window_size == 0) return nr_variants;
+	// cores contain at most one and a half window sizes
+	return min(this->window_size + this->window_size / 2 + 2 * this->overlap, nr_variants);
+}
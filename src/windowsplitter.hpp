@@ -0,0 +1,42 @@
+#ifndef WINDOW_SPLITTER_HPP
+#define WINDOW_SPLITTER_HPP
+
+#include <vector>
+#include <cstddef>
+
+/** a range of variants of a chromosome that is genotyped by a separate HMM run **/
+struct GenotypingWindow {
+	/** variants given to the HMM, including the burn-in on both sides **/
+	size_t begin;
+	size_t end;
+	/** variants whose results are taken from this window **/
+	size_t core_begin;
+	size_t core_end;
+};
+
+/**
+* Splits the variants of a chromosome into windows that can be genotyped independently.
+* Windows are cut at the largest distance between neighboring variants within half a
+* window size of the target size, where the transition probabilities are closest to mixing.
+* Each window is extended by overlap variants on both sides, the results of which are discarded.
+**/
+
+class WindowSplitter {
+public:
+	/**
+	* @param window_size approximate number of variants per window, at least 2 (0: one window per chromosome)
+	* @param overlap number of variants added to both sides of a window as burn-in
+	**/
+	WindowSplitter(size_t window_size, size_t overlap);
+	/** split the variants at the given positions (in ascending order). Windows are returned in order and their cores partition all variants. **/
+	void split(const std::vector<size_t>& positions, std::vector<GenotypingWindow>& result) const;
+	/** number of windows the variants at the given positions are split into (see split) **/
+	size_t nr_windows(const std::vector<size_t>& positions) const;
+	/** largest number of variants (including overlaps) given to a single window of such a chromosome **/
+	size_t max_window_variants(size_t nr_variants) const;
+private:
+	size_t window_size;
+	size_t overlap;
+};
+
+#endif // WINDOW_SPLITTER_HPP
@@ -0,0 +1,87 @@
+#include "catch.hpp"
+#include "../src/bcfencoder.hpp"
+#include <vector>
+#include <string>
+
+using namespace std;
+
+TEST_CASE("BcfEncoder dictionaries", "[BcfEncoder dictionaries]") {
+	string header = "##fileformat=VCFv4.2\n";
+	header += "##INFO=<ID=AF,Number=A,Type=Float,Description=\"Allele Frequency\">\n";
+	header += "##contig=<ID=chrB,length=100>\n";
+	header += "##FORMAT=<ID=GT,Number=1,Type=String,Description=\"Genotype\">\n";
+	header += "##FILTER=<ID=PASS,Description=\"All filters passed\">\n";
+	header += "##FORMAT=<ID=AF,Number=1,Type=Float,Description=\"Same name as INFO field\">\n";
+	header += "##contig=<ID=chrA>\n";
+	header += "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\tFORMAT\tsample\n";
+
+	BcfEncoder encoder(header);
+	REQUIRE(encoder.key_index("PASS") == 0);
+	REQUIRE(encoder.key_index("AF") == 1);
+	REQUIRE(encoder.key_index("GT") == 2);
+	CHECK_THROWS(encoder.key_index("GQ"));
+	vector<string> expected = {"chrB", "chrA"};
+	REQUIRE(encoder.get_contigs() == expected);
+	REQUIRE(encoder.contig_index("chrB") == 0);
+	REQUIRE(encoder.contig_index("chrA") == 1);
+	CHECK_THROWS(encoder.contig_index("chrC"));
+
+	CHECK_THROWS(BcfEncoder("##contig=<ID=chrA>\n##contig=<ID=chrA>\n"));
+}
+
+TEST_CASE("BcfEncoder typed values", "[BcfEncoder typed values]") {
+	string buffer;
+	BcfEncoder::encode_int(buffer, 5);
+	REQUIRE(buffer == string("\x11\x05", 2));
+
+	// smallest type holding all values
+	buffer.clear();
+	BcfEncoder::encode_ints(buffer, {-120, 127});
+	REQUIRE(buffer == string("\x21\x88\x7f", 3));
+	buffer.clear();
+	BcfEncoder::encode_ints(buffer, {-121, 1000});
+	REQUIRE(buffer == string("\x22\x87\xff\xe8\x03", 5));
+	buffer.clear();
+	BcfEncoder::encode_ints(buffer, {70000});
+	REQUIRE(buffer == string("\x13\x70\x11\x01\x00", 5));
+
+	// missing values
+	buffer.clear();
+	BcfEncoder::encode_int(buffer, BcfEncoder::INT_MISSING);
+	REQUIRE(buffer == string("\x11\x80", 2));
+	buffer.clear();
+	BcfEncoder::encode_ints(buffer, {BcfEncoder::INT_MISSING, 1000});
+	REQUIRE(buffer == string("\x22\x00\x80\xe8\x03", 5));
+
+	// strings, the empty string is missing
+	buffer.clear();
+	BcfEncoder::encode_string(buffer, "ACT");
+	REQUIRE(buffer == string("\x37" "ACT", 4));
+	buffer.clear();
+	BcfEncoder::encode_string(buffer, "");
+	REQUIRE(buffer == string("\x07", 1));
+
+	// long vectors store their length as typed integer
+	buffer.clear();
+	BcfEncoder::encode_floats(buffer, vector<float>(20, 1.0));
+	REQUIRE(buffer.size() == 3 + 20 * sizeof(float));
+	REQUIRE(buffer.substr(0, 3) == string("\xf5\x11\x14", 3));
+	REQUIRE(buffer.substr(3, 4) == string("\x00\x00\x80\x3f", 4));
+
+	// genotypes
+	REQUIRE(BcfEncoder::encode_allele(0, false) == 2);
+	REQUIRE(BcfEncoder::encode_allele(1, true) == 5);
+	REQUIRE(BcfEncoder::encode_allele(-1, false) == 0);
+}
+
+TEST_CASE("BcfEncoder record", "[BcfEncoder record]") {
+	string shared;
+	BcfEncoder::encode_site(shared, 1, 99, 3, 2, 2, 1, 1);
+	REQUIRE(shared.size() == 24);
+	string expected_site = string("\x01\x00\x00\x00" "\x63\x00\x00\x00" "\x03\x00\x00\x00" "\x01\x00\x80\x7f" "\x02\x00\x02\x00" "\x01\x00\x00\x01", 24);
+	REQUIRE(shared == expected_site);
+
+	string buffer;
+	BcfEncoder::append_record(buffer, shared, "ab");
+	REQUIRE(buffer == string("\x18\x00\x00\x00\x02\x00\x00\x00", 8) + expected_site + "ab");
+}
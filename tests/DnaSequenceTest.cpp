@@ -3,6 +3,8 @@
 #include "../src/dnasequence.hpp"
 #include <string>
 #include <iostream>
+#include <vector>
+#include <random>
 
 using namespace std;
 
@@ -203,3 +205,81 @@ TEST_CASE("DnaSequence base_at", "[DnaSequence base_at]") {
 	REQUIRE(base.to_string() == "T");
 	REQUIRE(base.size() == 1);
 }
+
+TEST_CASE("DnaSequence packed", "[DnaSequence packed]") {
+	// compare all operations against plain strings for different lengths and offsets
+	string bases = "ACGTNacgtn";
+	std::mt19937 generator(13);
+	for (size_t length = 0; length < 70; ++length) {
+		string seq = "";
+		for (size_t i = 0; i < length; ++i) {
+			// mostly defined bases with some runs of Ns
+			size_t index = generator() % 12;
+			seq += (index < bases.size()) ? bases[index] : 'N';
+		}
+		string expected = seq;
+		for (auto& c : expected) {
+			c = toupper(c);
+			if ((c != 'A') && (c != 'C') && (c != 'G') && (c != 'T')) c = 'N';
+		}
+		DnaSequence d(seq);
+		REQUIRE(d.size() == length);
+		REQUIRE(d.to_string() == expected);
+		REQUIRE(d.contains_undefined() == (expected.find('N') != string::npos));
+		for (size_t i = 0; i < length; ++i) {
+			REQUIRE(d[i] == expected[i]);
+			REQUIRE(d.encoded_at(i) == ((expected[i] == 'N') ? 4 : string("ACGT").find(expected[i])));
+		}
+
+		for (size_t start = 0; start <= length; start += 3) {
+			for (size_t end = start; end <= length; end += 5) {
+				DnaSequence substring;
+				d.substr(start, end, substring);
+				REQUIRE(substring.to_string() == expected.substr(start, end - start));
+				REQUIRE(d.view(start, end).to_string() == expected.substr(start, end - start));
+				// appending at unaligned positions
+				DnaSequence appended(string("ACG"));
+				appended.append(substring);
+				REQUIRE(appended.to_string() == "ACG" + expected.substr(start, end - start));
+				REQUIRE(appended == DnaSequence("ACG" + expected.substr(start, end - start)));
+			}
+		}
+
+		DnaSequence reversed(seq);
+		reversed.reverse();
+		REQUIRE(reversed.to_string() == string(expected.rbegin(), expected.rend()));
+		DnaSequence reverse_complement(seq);
+		reverse_complement.reverse_complement();
+		string expected_reverse_complement = "";
+		for (auto it = expected.rbegin(); it != expected.rend(); ++it) {
+			expected_reverse_complement += string("TGCAN")[string("ACGTN").find(*it)];
+		}
+		REQUIRE(reverse_complement.to_string() == expected_reverse_complement);
+		REQUIRE(reverse_complement == DnaSequence(expected_reverse_complement));
+	}
+}
+
+TEST_CASE("DnaSequence operator<", "[DnaSequence operator<]") {
+	// same order as the corresponding strings
+	vector<string> sequences = {"A", "AA", "AAAAC", "AAAAA", "CGT", "CGTA", "TTTTTTTTG", "TTTTTTTTT", "", "GANT", "GAAT", "GATT", "ACGTACGTACGT", "ACGTACGTACGA"};
+	for (auto& a : sequences) {
+		for (auto& b : sequences) {
+			REQUIRE((DnaSequence(a) < DnaSequence(b)) == (a < b));
+		}
+	}
+}
+
+TEST_CASE("DnaSequenceView", "[DnaSequenceView]") {
+	DnaSequence d(string("ACGTTGCANNA"));
+	DnaSequenceView all(d);
+	REQUIRE(all.size() == 11);
+	REQUIRE(all.to_string() == "ACGTTGCANNA");
+	DnaSequenceView part = d.view(3, 10);
+	REQUIRE(part.size() == 7);
+	REQUIRE(part.to_string() == "TTGCANN");
+	REQUIRE(part[0] == 'T');
+	REQUIRE(part.encoded_at(3) == 1);
+	REQUIRE(part.encoded_at(6) == 4);
+	REQUIRE_THROWS(part[7]);
+	REQUIRE_THROWS(d.view(5, 12));
+}
@@ -46,3 +46,51 @@ TEST_CASE("FastaReader get_subsequence", "[FastaReader get_subsequence]") {
 TEST_CASE("FastaReader invalid", "[FastaReader invalid]") {
 	REQUIRE_THROWS(FastaReader("../tests/data/broken-fasta.fa"));
 }
+
+TEST_CASE("FastaReader indexed", "[FastaReader indexed]") {
+	vector<string> filenames = {"../tests/data/simple-fasta-indexed.fa", "../tests/data/simple-fasta-indexed.fa.gz"};
+	for (auto filename : filenames) {
+		FastaReader f(filename);
+		REQUIRE(f.contains_name("chr01"));
+		REQUIRE(f.contains_name("chr02"));
+		REQUIRE(!f.contains_name("chr03"));
+		REQUIRE(f.get_size_of("chr01") == 1688);
+		REQUIRE(f.get_size_of("chr02") == 2135);
+		REQUIRE_THROWS(f.get_size_of("chrNone"));
+		REQUIRE(f.get_total_kmers(20) == 3785);
+
+		vector<string> names;
+		f.get_sequence_names(names);
+		REQUIRE(names == vector<string>({"chr01", "chr02"}));
+
+		string sequence;
+		f.get_subsequence("chr01", 0, 10, sequence);
+		REQUIRE(sequence == "CATTTTAAAG");
+		f.get_subsequence("chr01", 21, 40, sequence);
+		REQUIRE(sequence == "CCCAGAGCAGGCAAAACCC");
+		f.get_subsequence("chr02", 1, 12, sequence);
+		REQUIRE(sequence == "CCAACAATTTA");
+		f.get_subsequence("chr02", 71, 81, sequence);
+		REQUIRE(sequence == "TCAAATCACA");
+		REQUIRE_THROWS(f.get_subsequence("chrNone", 71, 80, sequence));
+		REQUIRE_THROWS(f.get_subsequence("chr01", 1680, 1690, sequence));
+
+		// sequences spanning lines (and BGZF blocks) must match the non-indexed file
+		FastaReader expected("../tests/data/simple-fasta.fa");
+		for (string name : {"chr01", "chr02"}) {
+			string full_expected;
+			expected.get_subsequence(name, 0, expected.get_size_of(name), full_expected);
+			f.get_subsequence(name, 0, f.get_size_of(name), sequence);
+			REQUIRE(sequence == full_expected);
+			f.get_subsequence(name, 55, 1250, sequence);
+			REQUIRE(sequence == full_expected.substr(55, 1195));
+			DnaSequence dna;
+			f.get_subsequence(name, 100, 170, dna);
+			REQUIRE(dna.to_string() == full_expected.substr(100, 70));
+			// released sequences are read again on access
+			f.release(name);
+			f.get_subsequence(name, 1000, 1010, sequence);
+			REQUIRE(sequence == full_expected.substr(1000, 10));
+		}
+	}
+}
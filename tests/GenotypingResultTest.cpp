@@ -253,3 +253,18 @@ TEST_CASE("GenotypingResult normalize", "[GenotypingResult normalize]") {
 	REQUIRE(doubles_equal(g.get_genotype_likelihood(0,1), 0.2));
 	REQUIRE(doubles_equal(g.get_genotype_likelihood(0,0), 0.4));
 }
+
+TEST_CASE("GenotypingResult estimate_memory", "[GenotypingResult estimate_memory]") {
+	// one entry per unordered genotype
+	size_t two_alleles = GenotypingResult::estimate_memory(2);
+	size_t three_alleles = GenotypingResult::estimate_memory(3);
+	REQUIRE(GenotypingResult::estimate_memory(1) < two_alleles);
+	REQUIRE((three_alleles - two_alleles) == (two_alleles - GenotypingResult::estimate_memory(1)) * 3 / 2);
+
+	// the estimate is at least as large as what a result actually stores
+	GenotypingResult r;
+	r.add_to_likelihood(0, 0, 0.1);
+	r.add_to_likelihood(0, 1, 0.2);
+	r.add_to_likelihood(1, 1, 0.7);
+	REQUIRE(two_alleles >= sizeof(r) + 3 * (sizeof(pair<unsigned char, unsigned char>) + sizeof(long double)));
+}
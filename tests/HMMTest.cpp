@@ -710,4 +710,16 @@ TEST_CASE("HMM no_only_paths2", "[HMM only_paths2]") {
 	}
 
 	REQUIRE( compare_vectors(computed_likelihoods, expected_likelihoods) );
-}
\ No newline at end of file
+}
+
+TEST_CASE("HMM estimate_memory", "[HMM estimate_memory]") {
+	// at least one column of states
+	REQUIRE(HMM::estimate_memory(1, 10) >= 100 * sizeof(long double));
+	// sparse tables grow with the square root of the number of variants
+	size_t small = HMM::estimate_memory(100, 10);
+	size_t large = HMM::estimate_memory(10000, 10);
+	REQUIRE(small < large);
+	REQUIRE(large < 100 * small);
+	// the columns are quadratic in the number of paths
+	REQUIRE(HMM::estimate_memory(100, 40) > 10 * HMM::estimate_memory(100, 10));
+}
@@ -0,0 +1,73 @@
+#include "catch.hpp"
+#include "utils.hpp"
+#include "../src/hyperloglog.hpp"
+#include <vector>
+#include <string>
+#include <random>
+
+using namespace std;
+
+string random_sequence(size_t length, unsigned int seed) {
+	mt19937 generator(seed);
+	uniform_int_distribution<int> distribution(0, 3);
+	string bases = "ACGT";
+	string result;
+	for (size_t i = 0; i < length; ++i) {
+		result += bases[distribution(generator)];
+	}
+	return result;
+}
+
+TEST_CASE("HyperLogLog small", "[HyperLogLog small]") {
+	HyperLogLog hll;
+	// kmers ACGTA, CGTAC and GTACG, the latter two are reverse complements of each other
+	hll.add_sequence("ACGTACG", 5);
+	REQUIRE(hll.estimate() == 2);
+	REQUIRE(hll.get_total_kmers() == 3);
+	// reverse complement does not add new kmers
+	hll.add_sequence("CGTACGT", 5);
+	REQUIRE(hll.estimate() == 2);
+	// kmers containing undefined bases are skipped
+	hll.add_sequence("ACNGTAC", 5);
+	REQUIRE(hll.estimate() == 2);
+	REQUIRE(hll.get_total_kmers() == 6);
+}
+
+TEST_CASE("HyperLogLog estimate", "[HyperLogLog estimate]") {
+	string sequence = random_sequence(200000, 1);
+	HyperLogLog hll;
+	hll.add_sequence(sequence, 31);
+	double estimate = hll.estimate();
+	double expected = sequence.size() - 30;
+	REQUIRE(estimate > 0.95 * expected);
+	REQUIRE(estimate < 1.05 * expected);
+
+	// adding the same sequence again does not change the estimate
+	hll.add_sequence(sequence, 31);
+	REQUIRE(hll.estimate() == (size_t) estimate);
+}
+
+TEST_CASE("HyperLogLog merge", "[HyperLogLog merge]") {
+	string sequence1 = random_sequence(100000, 2);
+	string sequence2 = random_sequence(100000, 3);
+	HyperLogLog hll1;
+	HyperLogLog hll2;
+	hll1.add_sequence(sequence1, 31);
+	hll2.add_sequence(sequence2, 31);
+	hll1.merge(hll2);
+	double estimate = hll1.estimate();
+	REQUIRE(estimate > 0.95 * 2 * (100000 - 30));
+	REQUIRE(estimate < 1.05 * 2 * (100000 - 30));
+	REQUIRE(hll1.get_total_kmers() == 2 * (100000 - 30));
+
+	HyperLogLog other(10);
+	REQUIRE_THROWS(hll1.merge(other));
+}
+
+TEST_CASE("HyperLogLog add_file", "[HyperLogLog add_file]") {
+	HyperLogLog fasta;
+	REQUIRE(fasta.add_file("../tests/data/reads.fa", 10) == 1.0);
+	// reads.fa contains a single read with 9 distinct 10-mers
+	REQUIRE(fasta.estimate() == 9);
+	REQUIRE_THROWS(fasta.add_file("../tests/data/nonexistent.fa", 10));
+}
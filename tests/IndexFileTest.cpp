@@ -0,0 +1,147 @@
+#include "catch.hpp"
+#include "utils.hpp"
+#include "../src/indexfile.hpp"
+#include "../src/dnasequence.hpp"
+#include <vector>
+#include <string>
+#include <map>
+#include <cstdio>
+#include <fstream>
+
+using namespace std;
+
+TEST_CASE("IndexFile", "[IndexFile]") {
+	string filename = "../tests/data/indexfile-test.index";
+	IndexHeader header = {};
+	header.kmer_size = 31;
+	header.add_reference = 1;
+	header.vcf.fingerprint = 17;
+	header.vcf.inode = 5;
+	header.reference.fingerprint = 42;
+
+	vector<unsigned char> bytes = {1, 2, 3};
+	vector<pair<uint32_t,uint32_t>> pairs = {{1, 2}, {3, 4}};
+	vector<vector<unsigned char>> nested = {{}, {5}, {6, 7}};
+	map<string, vector<DnaSequence>> sequences = {{"chr1", {DnaSequence("ACGTN"), DnaSequence("")}}, {"chr2", {DnaSequence("TTTTTTTTTC")}}};
+	{
+		IndexWriter writer(filename, header);
+		writer.begin_section("first");
+		writer(bytes, true, (size_t) 123456789, string("sample"), pairs);
+		writer.begin_section("second");
+		writer(nested, sequences);
+		CHECK_THROWS(writer.begin_section("first"));
+		writer.close();
+	}
+
+	IndexReader reader(filename);
+	REQUIRE(reader.get_header().kmer_size == 31);
+	REQUIRE(reader.get_header().add_reference == 1);
+	REQUIRE(reader.get_header().vcf.fingerprint == 17);
+	REQUIRE(reader.get_header().vcf.inode == 5);
+	REQUIRE(reader.get_header().reference.fingerprint == 42);
+	REQUIRE(reader.has_section("first"));
+	REQUIRE(!reader.has_section("third"));
+	vector<string> expected_sections = {"first", "second"};
+	REQUIRE(reader.get_section_names() == expected_sections);
+
+	// sections can be read in any order
+	vector<vector<unsigned char>> read_nested;
+	map<string, vector<DnaSequence>> read_sequences;
+	reader.seek_section("second");
+	reader(read_nested, read_sequences);
+	REQUIRE(read_nested == nested);
+	REQUIRE(read_sequences == sequences);
+	REQUIRE(read_sequences["chr1"][0].to_string() == "ACGTN");
+
+	vector<unsigned char> read_bytes;
+	bool flag = false;
+	size_t number = 0;
+	string name;
+	vector<pair<uint32_t,uint32_t>> read_pairs;
+	reader.seek_section("first");
+	reader(read_bytes, flag, number, name, read_pairs);
+	REQUIRE(read_bytes == bytes);
+	REQUIRE(flag);
+	REQUIRE(number == 123456789);
+	REQUIRE(name == "sample");
+	REQUIRE(read_pairs == pairs);
+	// reading beyond the end of a section fails
+	CHECK_THROWS(reader(number));
+	CHECK_THROWS(reader.seek_section("third"));
+
+	// not an index
+	CHECK_THROWS(IndexReader("../tests/data/small1.vcf"));
+	remove(filename.c_str());
+}
+
+TEST_CASE("IndexFile file_fingerprint", "[IndexFile file_fingerprint]") {
+	string filename = "../tests/data/indexfile-fingerprint.txt";
+	{
+		ofstream file(filename);
+		file << "ACGT" << endl;
+	}
+	uint64_t first = file_fingerprint(filename);
+	REQUIRE(first == file_fingerprint(filename));
+	{
+		ofstream file(filename);
+		file << "ACGA" << endl;
+	}
+	REQUIRE(first != file_fingerprint(filename));
+	REQUIRE(file_fingerprint("") == 0);
+	CHECK_THROWS(file_fingerprint("../tests/data/nonexistent.txt"));
+
+	// the whole content is hashed, also for files larger than the read buffer
+	string content(10 << 20, 'A');
+	for (size_t i = 0; i < content.size(); i += 7) content[i] = 'C';
+	{
+		ofstream file(filename, ios::out | ios::binary);
+		file << content;
+	}
+	uint64_t large = file_fingerprint(filename);
+	for (size_t position : {(size_t) (3 << 20) + 5, (size_t) (7 << 20) + 1, content.size() - 3}) {
+		string modified = content;
+		modified[position] = 'T';
+		{
+			ofstream file(filename, ios::out | ios::binary);
+			file << modified;
+		}
+		REQUIRE(file_fingerprint(filename) != large);
+	}
+	remove(filename.c_str());
+}
+
+TEST_CASE("IndexFile file_stamp", "[IndexFile file_stamp]") {
+	string filename = "../tests/data/indexfile-stamp.txt";
+	string copy = "../tests/data/indexfile-stamp-copy.txt";
+	{
+		ofstream file(filename);
+		file << "ACGTACGT" << endl;
+	}
+	FileStamp stamp = file_stamp(filename);
+	REQUIRE(stamp.fingerprint == file_fingerprint(filename));
+	REQUIRE(stamp.size == 9);
+	REQUIRE(file_matches_stamp(filename, stamp));
+	FileStamp empty = file_stamp("");
+	REQUIRE(empty.fingerprint == 0);
+	REQUIRE(empty.size == 0);
+
+	// a copy has another inode, but the same content
+	{
+		ofstream file(copy);
+		file << "ACGTACGT" << endl;
+	}
+	REQUIRE(file_matches_stamp(copy, stamp));
+
+	// modified in place with the same size, the content is compared as the modification time differs
+	FileStamp changed_time = stamp;
+	changed_time.modification_time -= 1;
+	{
+		ofstream file(filename);
+		file << "ACGTACGA" << endl;
+	}
+	REQUIRE_FALSE(file_matches_stamp(filename, changed_time));
+	REQUIRE_FALSE(file_matches_stamp(filename, file_stamp(copy)));
+	CHECK_THROWS(file_matches_stamp("../tests/data/nonexistent.txt", stamp));
+	remove(filename.c_str());
+	remove(copy.c_str());
+}
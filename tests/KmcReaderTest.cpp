@@ -0,0 +1,114 @@
+#include "catch.hpp"
+#include "utils.hpp"
+#include "../src/kmcreader.hpp"
+#include "../src/kmerprofile.hpp"
+#include <vector>
+#include <string>
+#include <fstream>
+
+using namespace std;
+
+TEST_CASE("KmcReader", "[KmcReader]") {
+	jellyfish::mer_dna::k(10);
+	KmcReader reader ("../tests/data/reads.kmc1", 10);
+	REQUIRE(reader.size() == 9);
+	string read = "ATGCTGTAAAAAAACGGC";
+	for (size_t i = 0; i < read.size()-9; ++i) {
+		string kmer = read.substr(i,10);
+		REQUIRE(reader.getKmerAbundance(kmer) == 1);
+	}
+	REQUIRE(reader.getKmerAbundance(string("AAAAAAAAAA")) == 0);
+	REQUIRE(reader.getKmerAbundance(string("GCCGTTTTTT")) == 1);
+	REQUIRE(reader.computeKmerCoverage(9) == 1);
+
+	// reads were counted on a single strand only
+	REQUIRE_THROWS(KmcReader("../tests/data/reads.no-canonical.kmc1", 10));
+
+	// wrong kmer size used
+	REQUIRE_THROWS(KmcReader("../tests/data/reads.kmc1", 11));
+
+	// database does not exist
+	REQUIRE_THROWS(KmcReader("../tests/data/nonexistent", 10));
+}
+
+TEST_CASE("KmcReader filtered", "[KmcReader filtered]") {
+	jellyfish::mer_dna::k(10);
+	string read = "ATGCTGTAAAAAAACGGC";
+	vector<uint64_t> kmers;
+	for (size_t i = 0; i < 4; ++i) {
+		kmers.push_back(KmerProfile::encode_kmer(jellyfish::mer_dna(read.substr(i,10))));
+	}
+	kmers.push_back(KmerProfile::encode_kmer(jellyfish::mer_dna(string("AAAAAAAAAA"))));
+
+	for (string database : {"../tests/data/reads.kmc1", "../tests/data/reads.kmc2"}) {
+		KmcReader reader (database, 10, kmers, 3);
+		for (size_t i = 0; i < read.size()-9; ++i) {
+			string kmer = read.substr(i,10);
+			REQUIRE(reader.getKmerAbundance(kmer) == ((i < 4) ? 1 : 0));
+		}
+		REQUIRE(reader.getKmerAbundance(string("AAAAAAAAAA")) == 0);
+	}
+}
+
+TEST_CASE("KmcReader getKmerAbundances", "[KmcReader getKmerAbundances]") {
+	jellyfish::mer_dna::k(10);
+	string read = "ATGCTGTAAAAAAACGGC";
+	vector<uint64_t> kmers;
+	for (size_t i = 0; i < read.size()-9; ++i) {
+		kmers.push_back(KmerProfile::encode_kmer(jellyfish::mer_dna(read.substr(i,10))));
+	}
+	kmers.push_back(KmerProfile::encode_kmer(jellyfish::mer_dna(string("CCCCCCCCCC"))));
+
+	// KMC2 databases only support batch lookups
+	KmcReader reader ("../tests/data/reads.kmc2", 10);
+	REQUIRE_THROWS(reader.getKmerAbundance(string("ATGCTGTAAA")));
+	vector<size_t> counts;
+	reader.getKmerAbundances(kmers, counts, 2);
+	REQUIRE(counts.size() == kmers.size());
+	for (size_t i = 0; i < read.size()-9; ++i) {
+		REQUIRE(counts[i] == 1);
+	}
+	REQUIRE(counts.back() == 0);
+}
+
+TEST_CASE("KmcReader kmc_tools dump", "[KmcReader kmc_tools dump]") {
+	// counts as dumped by kmc_tools (written by tests/data/make-kmc-databases.sh together with the databases)
+	ifstream dump("../tests/data/reads.kmc.dump");
+	if (!dump.good()) {
+		WARN("reads.kmc.dump not found, run tests/data/make-kmc-databases.sh (requires KMC 3) to check the databases against KMC.");
+		return;
+	}
+	jellyfish::mer_dna::k(10);
+	vector<string> dumped_kmers;
+	vector<size_t> dumped_counts;
+	string kmer;
+	size_t count;
+	while (dump >> kmer >> count) {
+		dumped_kmers.push_back(kmer);
+		dumped_counts.push_back(count);
+	}
+	REQUIRE(!dumped_kmers.empty());
+	vector<uint64_t> kmers;
+	for (auto& k : dumped_kmers) {
+		kmers.push_back(KmerProfile::encode_kmer(jellyfish::mer_dna(k)));
+	}
+
+	KmcReader kmc1 ("../tests/data/reads.kmc1", 10);
+	REQUIRE(kmc1.size() == dumped_kmers.size());
+	for (size_t i = 0; i < dumped_kmers.size(); ++i) {
+		REQUIRE(kmc1.getKmerAbundance(dumped_kmers[i]) == dumped_counts[i]);
+	}
+	KmcReader kmc2 ("../tests/data/reads.kmc2", 10);
+	REQUIRE(kmc2.size() == dumped_kmers.size());
+	vector<size_t> counts;
+	kmc2.getKmerAbundances(kmers, counts, 2);
+	REQUIRE(counts == dumped_counts);
+}
+
+TEST_CASE("KmcReader is_kmc_database", "[KmcReader is_kmc_database]") {
+	REQUIRE(KmcReader::is_kmc_database("sample.kmc_pre"));
+	REQUIRE(KmcReader::is_kmc_database("sample.kmc_suf"));
+	REQUIRE(!KmcReader::is_kmc_database("sample.jf"));
+	REQUIRE(KmcReader::database_name("path/sample.kmc_pre") == "path/sample");
+	REQUIRE(KmcReader::database_name("path/sample.kmc_suf") == "path/sample");
+}
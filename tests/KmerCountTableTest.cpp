@@ -0,0 +1,54 @@
+#include "catch.hpp"
+#include "utils.hpp"
+#include "../src/kmercounttable.hpp"
+#include <vector>
+
+using namespace std;
+
+TEST_CASE("KmerCountTable set_count", "[KmerCountTable set_count]") {
+	vector<uint64_t> kmers = {0, 1, 256, 17, 1, 123456789};
+	KmerCountTable table(kmers);
+	REQUIRE(table.size() == 5);
+
+	REQUIRE(table.contains(0));
+	REQUIRE(table.contains(256));
+	REQUIRE(table.contains(123456789));
+	REQUIRE(!table.contains(2));
+	REQUIRE(table.get_count(17) == 0);
+
+	REQUIRE(table.set_count(0, 5));
+	REQUIRE(table.set_count(17, 3));
+	REQUIRE(table.set_count(123456789, 70000));
+	// kmers not contained in the table are ignored
+	REQUIRE(!table.set_count(2, 10));
+	REQUIRE(!table.set_count(~((uint64_t) 0), 10));
+
+	REQUIRE(table.get_count(0) == 5);
+	REQUIRE(table.get_count(17) == 3);
+	REQUIRE(table.get_count(123456789) == 70000);
+	REQUIRE(table.get_count(1) == 0);
+	REQUIRE(table.get_count(2) == 0);
+	REQUIRE(table.get_count(~((uint64_t) 0)) == 0);
+}
+
+TEST_CASE("KmerCountTable many", "[KmerCountTable many]") {
+	vector<uint64_t> kmers;
+	for (uint64_t i = 0; i < 10000; ++i) kmers.push_back(i * 1024);
+	KmerCountTable table(kmers);
+	REQUIRE(table.size() == 10000);
+	for (uint64_t i = 0; i < 10000; ++i) {
+		REQUIRE(table.set_count(i * 1024, i));
+	}
+	for (uint64_t i = 0; i < 10000; ++i) {
+		REQUIRE(table.get_count(i * 1024) == i);
+		REQUIRE(!table.contains(i * 1024 + 1));
+	}
+}
+
+TEST_CASE("KmerCountTable empty", "[KmerCountTable empty]") {
+	vector<uint64_t> kmers;
+	KmerCountTable table(kmers);
+	REQUIRE(table.size() == 0);
+	REQUIRE(!table.contains(0));
+	REQUIRE(table.get_count(0) == 0);
+}
@@ -2,6 +2,7 @@
 #include "utils.hpp"
 #include "../src/jellyfishcounter.hpp"
 #include "../src/jellyfishreader.hpp"
+#include "../src/kmerprofile.hpp"
 #include <vector>
 #include <string>
 
@@ -46,3 +47,20 @@ TEST_CASE("JellyfishReader", "[JellyfishReader]") {
 	REQUIRE_THROWS(JellyfishReader("../tests/data/reads.jf", 11));
 
 }
+
+TEST_CASE("JellyfishReader filtered", "[JellyfishReader filtered]") {
+	jellyfish::mer_dna::k(10);
+	string read = "ATGCTGTAAAAAAACGGC";
+	// only keep the first half of the kmers
+	vector<uint64_t> kmers;
+	for (size_t i = 0; i < 4; ++i) {
+		kmers.push_back(KmerProfile::encode_kmer(jellyfish::mer_dna(read.substr(i,10))));
+	}
+	JellyfishReader reader ("../tests/data/reads.jf", 10, kmers, 2);
+	JellyfishReader full_reader ("../tests/data/reads.jf", 10);
+	for (size_t i = 0; i < read.size()-9; ++i) {
+		string kmer = read.substr(i,10);
+		REQUIRE(reader.getKmerAbundance(kmer) == ((i < 4) ? 1 : 0));
+	}
+	REQUIRE(reader.computeHistogram(10000, false) == full_reader.computeHistogram(10000, false));
+}
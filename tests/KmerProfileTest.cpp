@@ -0,0 +1,172 @@
+#include "catch.hpp"
+#include "utils.hpp"
+#include "../src/kmerprofile.hpp"
+#include "../src/profilekmercounter.hpp"
+#include "../src/variantreader.hpp"
+#include <vector>
+#include <string>
+#include <map>
+#include <cstdio>
+
+using namespace std;
+
+class MapKmerCounter : public KmerCounter {
+public:
+	map<string, size_t> counts;
+	size_t getKmerAbundance(string kmer) {
+		jellyfish::mer_dna jelly_kmer(kmer);
+		return this->getKmerAbundance(jelly_kmer);
+	}
+	size_t getKmerAbundance(jellyfish::mer_dna jelly_kmer) {
+		jelly_kmer.canonicalize();
+		auto it = this->counts.find(jelly_kmer.to_str());
+		return (it != this->counts.end()) ? it->second : 0;
+	}
+	size_t computeKmerCoverage(size_t genome_kmers) { return 0; }
+	size_t computeHistogram(size_t max_count, bool largest_peak, string filename = "") { return 0; }
+};
+
+TEST_CASE("KmerProfile encode_kmer", "[KmerProfile encode_kmer]") {
+	jellyfish::mer_dna::k(5);
+	REQUIRE(KmerProfile::encode_kmer(jellyfish::mer_dna("AAAAA")) == 0);
+	REQUIRE(KmerProfile::encode_kmer(jellyfish::mer_dna("AAAAC")) == 1);
+	REQUIRE(KmerProfile::encode_kmer(jellyfish::mer_dna("CAAAA")) == 256);
+	// canonical form is used
+	REQUIRE(KmerProfile::encode_kmer(jellyfish::mer_dna("TTTTT")) == 0);
+	REQUIRE(KmerProfile::encode_kmer(jellyfish::mer_dna("GTTTT")) == 1);
+}
+
+TEST_CASE("KmerProfile write and read", "[KmerProfile write and read]") {
+	jellyfish::mer_dna::k(5);
+	MapKmerCounter reads;
+	reads.counts["ACGTA"] = 12;
+	reads.counts["AAAAA"] = 100000;
+	reads.counts["CCCCA"] = 3;
+
+	vector<ProfileKmer> kmers;
+	kmers.push_back({KmerProfile::encode_kmer(jellyfish::mer_dna("TACGT")), 1});
+	kmers.push_back({KmerProfile::encode_kmer(jellyfish::mer_dna("AAAAA")), 2});
+	kmers.push_back({KmerProfile::encode_kmer(jellyfish::mer_dna("ACGTA")), 1});
+	kmers.push_back({KmerProfile::encode_kmer(jellyfish::mer_dna("GGGGG")), 1});
+	KmerProfile profile(5, kmers);
+	REQUIRE(profile.size() == 3);
+	profile.set_read_counts(&reads, 2);
+	profile.set_kmer_abundance_peak(12);
+	profile.write("../tests/data/kmerprofile-test.profile");
+
+	REQUIRE(KmerProfile::is_profile("../tests/data/kmerprofile-test.profile"));
+	REQUIRE_FALSE(KmerProfile::is_profile("../tests/data/reads.fa"));
+	REQUIRE_THROWS(KmerProfile("../tests/data/reads.fa"));
+
+	KmerProfile loaded("../tests/data/kmerprofile-test.profile");
+	REQUIRE(loaded.size() == 3);
+	REQUIRE(loaded.get_kmer_size() == 5);
+	REQUIRE(loaded.get_kmer_abundance_peak() == 12);
+	REQUIRE(loaded.get_fingerprint() == profile.get_fingerprint());
+
+	ProfileKmerCounter read_counts(&loaded, false);
+	ProfileKmerCounter genomic_counts(&loaded, true);
+	REQUIRE(read_counts.getKmerAbundance(string("ACGTA")) == 12);
+	REQUIRE(read_counts.getKmerAbundance(string("TACGT")) == 12);
+	// counts are saturated at 16 bits
+	REQUIRE(read_counts.getKmerAbundance(string("TTTTT")) == 65535);
+	REQUIRE(read_counts.getKmerAbundance(string("CCCCC")) == 0);
+	// kmers not contained in the profile
+	REQUIRE(read_counts.getKmerAbundance(string("CCCCA")) == 0);
+	REQUIRE(genomic_counts.getKmerAbundance(string("CCCCA")) == 0);
+	REQUIRE(genomic_counts.getKmerAbundance(string("AAAAA")) == 2);
+	REQUIRE(genomic_counts.getKmerAbundance(jellyfish::mer_dna("CCCCC")) == 1);
+	REQUIRE(read_counts.computeHistogram(10000, true) == 12);
+
+	// same kmers give the same fingerprint, different kmers a different one
+	vector<ProfileKmer> other_kmers = {{KmerProfile::encode_kmer(jellyfish::mer_dna("ACGTA")), 1}};
+	KmerProfile other(5, other_kmers);
+	REQUIRE(other.get_fingerprint() != profile.get_fingerprint());
+	REQUIRE_THROWS(KmerProfile(33, other_kmers));
+	remove("../tests/data/kmerprofile-test.profile");
+}
+
+TEST_CASE("KmerProfile panel fingerprint", "[KmerProfile panel fingerprint]") {
+	string fasta = "../tests/data/small1.fa";
+	VariantReader panel("../tests/data/small1.vcf", fasta, 10, true);
+	VariantReader other_panel("../tests/data/small2.vcf", fasta, 10, true);
+	vector<string> chromosomes, other_chromosomes;
+	panel.get_chromosomes(&chromosomes);
+	other_panel.get_chromosomes(&other_chromosomes);
+
+	jellyfish::mer_dna::k(5);
+	vector<ProfileKmer> kmers = {{KmerProfile::encode_kmer(jellyfish::mer_dna("ACGTA")), 1}};
+	KmerProfile profile(5, kmers);
+	profile.set_panel_fingerprint(panel.get_fingerprint(chromosomes));
+	profile.write("../tests/data/kmerprofile-panel.profile");
+
+	// a profile can only be used with the panel it was computed for
+	KmerProfile loaded("../tests/data/kmerprofile-panel.profile");
+	REQUIRE(loaded.get_panel_fingerprint() == panel.get_fingerprint(chromosomes));
+	REQUIRE(loaded.get_panel_fingerprint() != other_panel.get_fingerprint(other_chromosomes));
+	REQUIRE(loaded.get_panel_fingerprint() != panel.get_fingerprint({chromosomes[0]}));
+
+	// profiles for different panels cannot be merged
+	KmerProfile other(5, kmers);
+	other.set_panel_fingerprint(other_panel.get_fingerprint(other_chromosomes));
+	other.write("../tests/data/kmerprofile-other-panel.profile");
+	REQUIRE_THROWS(KmerProfile::merge({"../tests/data/kmerprofile-panel.profile", "../tests/data/kmerprofile-other-panel.profile"}, "../tests/data/kmerprofile-merged-panel.profile"));
+	KmerProfile::merge({"../tests/data/kmerprofile-panel.profile", "../tests/data/kmerprofile-panel.profile"}, "../tests/data/kmerprofile-merged-panel.profile");
+	REQUIRE(KmerProfile("../tests/data/kmerprofile-merged-panel.profile").get_panel_fingerprint() == loaded.get_panel_fingerprint());
+	remove("../tests/data/kmerprofile-panel.profile");
+	remove("../tests/data/kmerprofile-other-panel.profile");
+	remove("../tests/data/kmerprofile-merged-panel.profile");
+}
+
+TEST_CASE("KmerProfile merge", "[KmerProfile merge]") {
+	jellyfish::mer_dna::k(5);
+	vector<string> sequences = {"ACGTA", "CCCCC", "GATTA", "AAAAA"};
+	vector<ProfileKmer> kmers;
+	for (auto& s : sequences) kmers.push_back({KmerProfile::encode_kmer(jellyfish::mer_dna(s)), 1});
+
+	// two partial profiles computed on different subsets of the reads
+	MapKmerCounter reads1;
+	reads1.counts["ACGTA"] = 10;
+	reads1.counts["CCCCC"] = 60000;
+	reads1.counts["AAAAA"] = 3;
+	MapKmerCounter reads2;
+	reads2.counts["ACGTA"] = 5;
+	reads2.counts["CCCCC"] = 60000;
+	reads2.counts["GATTA"] = 7;
+	KmerProfile partial1(5, kmers);
+	partial1.set_read_counts(&reads1);
+	partial1.set_kmer_abundance_peak(10);
+	partial1.write("../tests/data/kmerprofile-partial1.profile");
+	KmerProfile partial2(5, kmers);
+	partial2.set_read_counts(&reads2);
+	partial2.set_kmer_abundance_peak(5);
+	partial2.write("../tests/data/kmerprofile-partial2.profile");
+
+	vector<string> partials = {"../tests/data/kmerprofile-partial1.profile", "../tests/data/kmerprofile-partial2.profile"};
+	for (size_t count_bytes : {2, 4}) {
+		KmerProfile::merge(partials, "../tests/data/kmerprofile-merged.profile", count_bytes);
+		KmerProfile merged("../tests/data/kmerprofile-merged.profile");
+		REQUIRE(merged.size() == 4);
+		REQUIRE(merged.get_fingerprint() == partial1.get_fingerprint());
+		// peak needs to be recomputed for the merged counts
+		REQUIRE(merged.get_kmer_abundance_peak() == 0);
+		ProfileKmerCounter counts(&merged, false);
+		REQUIRE(counts.getKmerAbundance(string("ACGTA")) == 15);
+		REQUIRE(counts.getKmerAbundance(string("AAAAA")) == 3);
+		REQUIRE(counts.getKmerAbundance(string("GATTA")) == 7);
+		// sum exceeds 16 bits and is saturated
+		REQUIRE(counts.getKmerAbundance(string("CCCCC")) == 65535);
+	}
+
+	// profiles for different kmers cannot be merged
+	vector<ProfileKmer> other_kmers = {{KmerProfile::encode_kmer(jellyfish::mer_dna("ACGTA")), 1}};
+	KmerProfile other(5, other_kmers);
+	other.write("../tests/data/kmerprofile-other.profile");
+	REQUIRE_THROWS(KmerProfile::merge({partials[0], "../tests/data/kmerprofile-other.profile"}, "../tests/data/kmerprofile-merged.profile"));
+	REQUIRE_THROWS(KmerProfile::merge({partials[0], "../tests/data/reads.fa"}, "../tests/data/kmerprofile-merged.profile"));
+	REQUIRE_THROWS(KmerProfile::merge(partials, "../tests/data/kmerprofile-merged.profile", 3));
+	remove("../tests/data/kmerprofile-partial1.profile");
+	remove("../tests/data/kmerprofile-partial2.profile");
+	remove("../tests/data/kmerprofile-merged.profile");
+	remove("../tests/data/kmerprofile-other.profile");
+}
@@ -0,0 +1,70 @@
+#include "catch.hpp"
+#include "../src/metrics.hpp"
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+
+using namespace std;
+
+TEST_CASE("Metrics write", "[Metrics write]") {
+	string filename = "../tests/data/metrics-test.json";
+	Metrics metrics;
+	metrics.add_stage("counting kmers", 2.5, 10.0, 2000);
+	metrics.add_stage("genotyping", 1.5, 3.0, 3000);
+	metrics.set_value("threads", 4);
+	metrics.add_to_value("kmers_looked_up", 10);
+	metrics.add_to_value("kmers_looked_up", 5);
+	REQUIRE(metrics.get_value("kmers_looked_up") == 15);
+	REQUIRE(metrics.get_value("unknown") == 0);
+	metrics.set_for_chromosome("chr2", "variants", 7);
+	metrics.add_to_chromosome("chr1", "genotyping_wall_time", 0.5);
+	metrics.add_to_chromosome("chr1", "genotyping_wall_time", 0.25);
+	// runs are sorted by chromosome, subset and window
+	metrics.add_run(RunMetrics{"chr1", "genotyping", 1, 0, 10, 0.5, 0.25});
+	metrics.add_run(RunMetrics{"chr1", "phasing", -1, 0, 10, 1.0, 1.0});
+	metrics.add_run(RunMetrics{"chr\"1", "genotyping", 0, 0, 10, 1.0, 1.0});
+	metrics.write(filename);
+
+	string expected = "{\n";
+	expected += "\t\"kmers_looked_up\": 15,\n";
+	expected += "\t\"threads\": 4,\n";
+	expected += "\t\"stages\": [\n";
+	expected += "\t\t{\"name\": \"counting kmers\", \"wall_time\": 2.5, \"cpu_time\": 10, \"peak_memory\": 2000},\n";
+	expected += "\t\t{\"name\": \"genotyping\", \"wall_time\": 1.5, \"cpu_time\": 3, \"peak_memory\": 3000}\n";
+	expected += "\t],\n\t\"chromosomes\": {\n";
+	expected += "\t\t\"chr1\": {\"genotyping_wall_time\": 0.75},\n";
+	expected += "\t\t\"chr2\": {\"variants\": 7}\n";
+	expected += "\t},\n\t\"runs\": [\n";
+	expected += "\t\t{\"chromosome\": \"chr\\\"1\", \"type\": \"genotyping\", \"subset\": 0, \"window\": 0, \"variants\": 10, \"wall_time\": 1, \"cpu_time\": 1},\n";
+	expected += "\t\t{\"chromosome\": \"chr1\", \"type\": \"phasing\", \"subset\": -1, \"window\": 0, \"variants\": 10, \"wall_time\": 1, \"cpu_time\": 1},\n";
+	expected += "\t\t{\"chromosome\": \"chr1\", \"type\": \"genotyping\", \"subset\": 1, \"window\": 0, \"variants\": 10, \"wall_time\": 0.5, \"cpu_time\": 0.25}\n";
+	expected += "\t]\n}\n";
+
+	ifstream file(filename);
+	stringstream content;
+	content << file.rdbuf();
+	REQUIRE(content.str() == expected);
+	remove(filename.c_str());
+}
+
+TEST_CASE("Metrics end_stage", "[Metrics end_stage]") {
+	string filename = "../tests/data/metrics-test.json";
+	Metrics metrics;
+	this_thread::sleep_for(chrono::milliseconds(20));
+	double wall_time = metrics.end_stage("sleeping");
+	REQUIRE(wall_time >= 0.02);
+	REQUIRE(Metrics::peak_memory() > 0);
+	REQUIRE(Metrics::current_memory() > 0);
+	// getrusage reports microseconds, the thread CPU time nanoseconds
+	double thread_time = Metrics::thread_cpu_time();
+	REQUIRE(Metrics::process_cpu_time() + 1E-5 >= thread_time);
+	metrics.write(filename);
+	ifstream file(filename);
+	stringstream content;
+	content << file.rdbuf();
+	REQUIRE(content.str().find("{\"name\": \"sleeping\", \"wall_time\": ") != string::npos);
+	remove(filename.c_str());
+}
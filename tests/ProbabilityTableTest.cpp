@@ -46,3 +46,14 @@ TEST_CASE ("ProbabilityTable2", "[ProbabilityTable2]") {
 	REQUIRE(doubles_equal(p.get_probability(6,1).get_probability_of(1), 0.149361205103));
 	REQUIRE(doubles_equal(p.get_probability(6,1).get_probability_of(2), 0.014872513059));
 }
+
+TEST_CASE ("ProbabilityTable contains", "[ProbabilityTable contains]") {
+	ProbabilityTable p(4,7,2,0.0);
+	REQUIRE(p.contains(4,0));
+	REQUIRE(p.contains(6,1));
+	REQUIRE(!p.contains(3,0));
+	REQUIRE(!p.contains(7,0));
+	REQUIRE(!p.contains(5,2));
+	// values outside of the table are computed on the fly
+	REQUIRE(doubles_equal(p.get_probability(7,0).get_probability_of(0), 0.99));
+}
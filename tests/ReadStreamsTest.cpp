@@ -0,0 +1,178 @@
+#include "catch.hpp"
+#include "utils.hpp"
+#include "../src/readstreams.hpp"
+#include "../src/bgzfreader.hpp"
+#include "../src/bgzfwriter.hpp"
+#include "../src/hyperloglog.hpp"
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+string read_content(string filename) {
+	ifstream file(filename, ios::in | ios::binary);
+	stringstream ss;
+	ss << file.rdbuf();
+	return ss.str();
+}
+
+TEST_CASE("ReadStreams get_compression", "[ReadStreams get_compression]") {
+	REQUIRE(ReadStreams::get_compression("../tests/data/reads.fq") == Compression::NONE);
+	REQUIRE(ReadStreams::get_compression("../tests/data/reads.fq.gz") == Compression::GZIP);
+	REQUIRE(ReadStreams::get_compression("../tests/data/reads.bgzf.fq.gz") == Compression::BGZF);
+	REQUIRE_THROWS(ReadStreams::get_compression("../tests/data/nonexistent.fq"));
+}
+
+TEST_CASE("BgzfReader read_block", "[BgzfReader read_block]") {
+	REQUIRE(BgzfReader::is_bgzf("../tests/data/reads.bgzf.fq.gz"));
+	REQUIRE_FALSE(BgzfReader::is_bgzf("../tests/data/reads.fq.gz"));
+
+	BgzfReader reader("../tests/data/reads.bgzf.fq.gz");
+	vector<char> block;
+	string decompressed;
+	string content;
+	size_t nr_blocks = 0;
+	uint64_t offset = 1;
+	while (reader.read_block(block, &offset)) {
+		if (nr_blocks == 0) REQUIRE(offset == 0);
+		BgzfReader::decompress_block(block, decompressed);
+		content += decompressed;
+		nr_blocks += 1;
+	}
+	// 7 data blocks and the empty EOF block
+	REQUIRE(nr_blocks == 8);
+	REQUIRE(content == read_content("../tests/data/reads.fq"));
+
+	REQUIRE_THROWS(BgzfReader("../tests/data/nonexistent.gz"));
+	BgzfReader gzip_reader("../tests/data/reads.fq.gz");
+	REQUIRE_THROWS(gzip_reader.read_block(block));
+}
+
+TEST_CASE("ReadStreams decompress", "[ReadStreams decompress]") {
+	string expected = read_content("../tests/data/reads.fq");
+	vector<string> filenames = {"../tests/data/reads.fq", "../tests/data/reads.fq.gz", "../tests/data/reads.bgzf.fq.gz"};
+	for (size_t nr_threads : {1, 4}) {
+		ReadStreams streams(filenames, nr_threads);
+		vector<string> paths = streams.get_paths();
+		REQUIRE(paths.size() == 3);
+		// uncompressed files are read directly
+		REQUIRE(paths[0] == filenames[0]);
+		// streams are consumed one after the other, like jellyfish does
+		for (auto& path : paths) {
+			REQUIRE(read_content(path) == expected);
+		}
+		REQUIRE_NOTHROW(streams.finish());
+	}
+}
+
+TEST_CASE("ReadStreams decompress many blocks", "[ReadStreams decompress many blocks]") {
+	// more blocks than the decompression pipeline keeps in flight
+	string expected;
+	for (size_t i = 0; i < 40000; ++i) {
+		expected += ">read" + to_string(i) + "\nACGTTGCAAGGCTTACCGATAGCTTACGATCGATTCGAAGCT\n";
+	}
+	string filename = "../tests/data/reads-many-blocks.fa.gz";
+	{
+		BgzfWriter writer(filename);
+		writer.write(expected);
+	}
+	for (size_t nr_threads : {1, 3}) {
+		ReadStreams streams({filename}, nr_threads);
+		REQUIRE(read_content(streams.get_paths()[0]) == expected);
+		REQUIRE_NOTHROW(streams.finish());
+	}
+
+	// a truncated file is reported after the complete blocks have been written
+	string compressed = read_content(filename);
+	{
+		ofstream truncated(filename, ios::out | ios::binary);
+		truncated.write(compressed.data(), compressed.size() / 2);
+	}
+	ReadStreams streams({filename}, 3);
+	string content = read_content(streams.get_paths()[0]);
+	REQUIRE(content.size() < expected.size());
+	REQUIRE(expected.compare(0, content.size(), content) == 0);
+	REQUIRE_THROWS(streams.finish());
+	remove(filename.c_str());
+}
+
+TEST_CASE("ReadStreams unread", "[ReadStreams unread]") {
+	// destroying the streams without reading them must not block
+	ReadStreams streams({"../tests/data/reads.fq.gz", "../tests/data/reads.bgzf.fq.gz"}, 2);
+	REQUIRE(streams.get_paths().size() == 2);
+}
+
+TEST_CASE("ReadStreams named pipe", "[ReadStreams named pipe]") {
+	REQUIRE(ReadStreams::is_stream("-"));
+	REQUIRE_FALSE(ReadStreams::is_stream("../tests/data/reads.fq"));
+	REQUIRE_FALSE(ReadStreams::is_stream("../tests/data/nonexistent.fq"));
+
+	string expected = read_content("../tests/data/reads.fq");
+	for (string input : {"../tests/data/reads.fq", "../tests/data/reads.fq.gz"}) {
+		string fifo = "../tests/data/reads-pipe.fq";
+		unlink(fifo.c_str());
+		REQUIRE(mkfifo(fifo.c_str(), 0600) == 0);
+		REQUIRE(ReadStreams::is_stream(fifo));
+		// upstream process writing (compressed or uncompressed) reads into the pipe
+		thread producer([&](){
+			string content = read_content(input);
+			ofstream pipe(fifo, ios::out | ios::binary);
+			pipe << content;
+		});
+		{
+			ReadStreams streams({fifo}, 1);
+			vector<string> paths = streams.get_paths();
+			REQUIRE(paths.size() == 1);
+			REQUIRE(paths[0] != fifo);
+			REQUIRE(read_content(paths[0]) == expected);
+			REQUIRE_NOTHROW(streams.finish());
+		}
+		producer.join();
+		unlink(fifo.c_str());
+	}
+	REQUIRE_THROWS(ReadStreams({"-", "-"}, 1));
+}
+
+TEST_CASE("ReadStreams add_generator", "[ReadStreams add_generator]") {
+	string expected = "";
+	for (size_t i = 0; i < 100000; ++i) expected += ">segment_" + to_string(i) + "\nACGTACGTNNACGT\n";
+	ReadStreams streams({});
+	// each generated stream can be read once
+	for (size_t i = 0; i < 2; ++i) {
+		string path = streams.add_generator([&expected](const function<void(const char*, size_t)>& write) {
+			for (size_t start = 0; start < expected.size(); start += 1000) {
+				write(expected.data() + start, min((size_t) 1000, expected.size() - start));
+			}
+		});
+		REQUIRE(ReadStreams::is_stream(path));
+		REQUIRE(read_content(path) == expected);
+	}
+	REQUIRE_NOTHROW(streams.finish());
+	// destroying the streams with a generator that is never read must not block
+	streams.add_generator([](const function<void(const char*, size_t)>& write) { write("ACGT", 4); });
+}
+
+TEST_CASE("ReadStreams add_generator error", "[ReadStreams add_generator error]") {
+	ReadStreams streams({});
+	string path = streams.add_generator([](const function<void(const char*, size_t)>& write) {
+		write(">a\n", 3);
+		throw runtime_error("failed");
+	});
+	read_content(path);
+	REQUIRE_THROWS(streams.finish());
+}
+
+TEST_CASE("HyperLogLog add_file compressed", "[HyperLogLog add_file compressed]") {
+	HyperLogLog plain;
+	HyperLogLog compressed;
+	REQUIRE(plain.add_file("../tests/data/reads.fq", 31) == 1.0);
+	REQUIRE(compressed.add_file("../tests/data/reads.bgzf.fq.gz", 31) == 1.0);
+	REQUIRE(plain.get_total_kmers() == 40*40);
+	REQUIRE(compressed.get_total_kmers() == plain.get_total_kmers());
+	REQUIRE(compressed.estimate() == plain.estimate());
+}
@@ -0,0 +1,27 @@
+#include "catch.hpp"
+#include "utils.hpp"
+#include "../src/tabixindex.hpp"
+#include <vector>
+#include <string>
+
+using namespace std;
+
+TEST_CASE("TabixIndex", "[TabixIndex]") {
+	REQUIRE(TabixIndex::find_index("../tests/data/small1.vcf.gz") == "../tests/data/small1.vcf.gz.tbi");
+	REQUIRE(TabixIndex::find_index("../tests/data/small1.vcf") == "");
+
+	TabixIndex index("../tests/data/small1-genotypes.vcf.gz.tbi");
+	vector<string> expected = {"chrA", "chrB"};
+	REQUIRE(index.get_sequence_names() == expected);
+
+	uint64_t begin_a, end_a, begin_b, end_b;
+	REQUIRE(index.get_range("chrA", begin_a, end_a));
+	REQUIRE(index.get_range("chrB", begin_b, end_b));
+	REQUIRE(begin_a < end_a);
+	REQUIRE(end_a <= begin_b);
+	REQUIRE(begin_b < end_b);
+	REQUIRE(!index.get_range("chrC", begin_a, end_a));
+
+	// not an index
+	CHECK_THROWS(TabixIndex("../tests/data/small1.vcf.gz"));
+}
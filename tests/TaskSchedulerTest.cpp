@@ -0,0 +1,133 @@
+#include "catch.hpp"
+#include "../src/taskscheduler.hpp"
+#include "../src/threadpool.hpp"
+#include <vector>
+#include <set>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <stdexcept>
+
+using namespace std;
+
+TEST_CASE("TaskScheduler priorities", "[TaskScheduler priorities]") {
+	TaskScheduler scheduler(1);
+	REQUIRE(scheduler.nr_of_threads() == 1);
+	// keep the only worker busy until all tasks are submitted
+	atomic<bool> released(false);
+	scheduler.submit([&released](){ while (!released) this_thread::sleep_for(chrono::milliseconds(1)); }, 100.0);
+	vector<int> order;
+	mutex order_mutex;
+	vector<double> priorities = {1.0, 5.0, 3.0, 5.0, 0.0};
+	for (size_t i = 0; i < priorities.size(); ++i) {
+		scheduler.submit([i, &order, &order_mutex](){ lock_guard<mutex> lock(order_mutex); order.push_back(i); }, priorities[i]);
+	}
+	released = true;
+	scheduler.wait();
+	// largest priority first, submission order for equal priorities
+	vector<int> expected = {1, 3, 2, 0, 4};
+	REQUIRE(order == expected);
+}
+
+TEST_CASE("TaskScheduler priorities from task", "[TaskScheduler priorities from task]") {
+	TaskScheduler scheduler(1);
+	vector<int> order;
+	mutex order_mutex;
+	vector<double> priorities = {1.0, 5.0, 3.0, 5.0, 0.0};
+	// tasks submitted by a running task are ordered by priority as well
+	scheduler.submit([&scheduler, &priorities, &order, &order_mutex](){
+		for (size_t i = 0; i < priorities.size(); ++i) {
+			scheduler.submit([i, &order, &order_mutex](){ lock_guard<mutex> lock(order_mutex); order.push_back(i); }, priorities[i]);
+		}
+	});
+	scheduler.wait();
+	vector<int> expected = {1, 3, 2, 0, 4};
+	REQUIRE(order == expected);
+}
+
+TEST_CASE("TaskScheduler groups", "[TaskScheduler groups]") {
+	TaskScheduler scheduler(4);
+	atomic<size_t> sum(0);
+	TaskGroup outer;
+	for (size_t i = 0; i < 10; ++i) {
+		scheduler.submit([i, &scheduler, &sum](){
+			// spawn child tasks and wait for them from within the task
+			TaskGroup inner;
+			for (size_t j = 0; j < 10; ++j) {
+				scheduler.submit([i, j, &sum](){ sum += i * 10 + j; }, 0.0, &inner);
+			}
+			scheduler.wait(inner);
+		}, i, &outer);
+	}
+	scheduler.wait(outer);
+	REQUIRE(outer.done());
+	REQUIRE(sum == 4950);
+}
+
+TEST_CASE("TaskScheduler stealing", "[TaskScheduler stealing]") {
+	TaskScheduler scheduler(4);
+	set<thread::id> threads;
+	mutex threads_mutex;
+	TaskGroup group;
+	// children of a single task are run by the other workers as well
+	scheduler.submit([&](){
+		for (size_t i = 0; i < 100; ++i) {
+			scheduler.submit([&](){
+				this_thread::sleep_for(chrono::milliseconds(1));
+				lock_guard<mutex> lock(threads_mutex);
+				threads.insert(this_thread::get_id());
+			}, 0.0, &group);
+		}
+	});
+	scheduler.wait();
+	REQUIRE(group.done());
+	REQUIRE(threads.size() > 1);
+}
+
+TEST_CASE("TaskScheduler exceptions", "[TaskScheduler exceptions]") {
+	TaskScheduler scheduler(2);
+	TaskGroup group;
+	atomic<size_t> counter(0);
+	for (size_t i = 0; i < 5; ++i) {
+		scheduler.submit([i, &counter](){
+			counter += 1;
+			if (i == 2) throw runtime_error("task failed");
+		}, 0.0, &group);
+	}
+	// all tasks run, the exception is rethrown once
+	CHECK_THROWS(scheduler.wait(group));
+	REQUIRE(counter == 5);
+	REQUIRE_NOTHROW(scheduler.wait(group));
+
+	// exceptions of tasks without group are rethrown by wait()
+	scheduler.submit([](){ throw runtime_error("task failed"); });
+	CHECK_THROWS(scheduler.wait());
+	REQUIRE_NOTHROW(scheduler.wait());
+
+	// a task cannot wait for all tasks
+	TaskGroup waiting;
+	scheduler.submit([&scheduler](){ scheduler.wait(); }, 0.0, &waiting);
+	CHECK_THROWS(scheduler.wait(waiting));
+}
+
+TEST_CASE("TaskScheduler busy_time", "[TaskScheduler busy_time]") {
+	TaskScheduler scheduler(2);
+	REQUIRE(scheduler.busy_time() == 0.0);
+	for (size_t i = 0; i < 4; ++i) {
+		scheduler.submit([](){ this_thread::sleep_for(chrono::milliseconds(20)); });
+	}
+	scheduler.wait();
+	REQUIRE(scheduler.busy_time() >= 0.08);
+}
+
+TEST_CASE("ThreadPool", "[ThreadPool]") {
+	atomic<size_t> counter(0);
+	{
+		ThreadPool threadPool(3);
+		for (size_t i = 0; i < 100; ++i) {
+			threadPool.submit([&counter](){ counter += 1; });
+		}
+	}
+	REQUIRE(counter == 100);
+}
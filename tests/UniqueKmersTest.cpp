@@ -230,3 +230,11 @@ TEST_CASE("UniqueKmers undefined_allele", "[UniqueKmers undefined_allele]"){
 	// make sure an execption is thrown in case an allele does not exist
 	REQUIRE_THROWS(u.set_undefined_allele(2));
 }
+
+TEST_CASE("UniqueKmers estimate_memory", "[UniqueKmers estimate_memory]") {
+	size_t memory = UniqueKmers::estimate_memory(10, 2);
+	REQUIRE(memory > sizeof(UniqueKmers));
+	// grows with the number of paths and alleles
+	REQUIRE(UniqueKmers::estimate_memory(20, 2) == memory + 10);
+	REQUIRE(UniqueKmers::estimate_memory(10, 3) > memory);
+}
@@ -2,14 +2,66 @@
 #define private public
 #include "../src/variantreader.hpp"
 #include "../src/uniquekmers.hpp"
+#include "../src/tabixindex.hpp"
+#include "utils.hpp"
 #include <vector>
 #include <string>
 #include <algorithm> 
 #include <random>
+#include <cstdio>
+#include <sstream>
+#include <cstring>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 
 using namespace std;
 
+/**
+* format the chromosomes on another thread in completion_order and write each one in the order given by chromosomes
+* as soon as it is available, the way PanGenie hands finished chromosomes to its output stage
+**/
+void format_and_write(VariantReader& v, const vector<string>& chromosomes, const vector<string>& completion_order, map<string, vector<GenotypingResult>>& results, map<string, vector<UniqueKmers*>>& unique_kmers) {
+	mutex output_mutex;
+	condition_variable output_changed;
+	map<string, VariantReader::FormattedResults> formatted;
+	map<string, exception_ptr> errors;
+	thread formatter([&](){
+		for (const string& chromosome : completion_order) {
+			VariantReader::FormattedResults records;
+			exception_ptr error;
+			try {
+				v.format_results(chromosome, results.at(chromosome), &unique_kmers.at(chromosome), false, records);
+			} catch (...) {
+				error = current_exception();
+			}
+			lock_guard<mutex> lock (output_mutex);
+			if (error) {
+				errors[chromosome] = error;
+			} else {
+				formatted[chromosome] = move(records);
+			}
+			output_changed.notify_all();
+		}
+	});
+	exception_ptr error;
+	for (const string& chromosome : chromosomes) {
+		unique_lock<mutex> lock (output_mutex);
+		output_changed.wait(lock, [&](){ return (formatted.find(chromosome) != formatted.end()) || (errors.find(chromosome) != errors.end()); });
+		if (errors.find(chromosome) != errors.end()) {
+			error = errors[chromosome];
+			break;
+		}
+		VariantReader::FormattedResults records = move(formatted[chromosome]);
+		formatted.erase(chromosome);
+		lock.unlock();
+		v.write_formatted(records);
+	}
+	formatter.join();
+	if (error) rethrow_exception(error);
+}
+
 TEST_CASE("VariantReader get_allele_string", "[VariantReader get_allele_string]") {
 	string vcf = "../tests/data/small1.vcf";
 	string fasta = "../tests/data/small1.fa";
@@ -121,6 +173,13 @@ TEST_CASE("VariantReader write_path_segments", "[VariantReader write_path_segmen
 		REQUIRE(expected[i] == computed[i]);
 	}
 
+	// segments generated in memory are identical to the file
+	string generated = "";
+	v.write_path_segments([&generated](const char* data, size_t size) { generated.append(data, size); });
+	ifstream segment_file("../tests/data/small1-segments.fa");
+	stringstream file_content;
+	file_content << segment_file.rdbuf();
+	REQUIRE(generated == file_content.str());
 }
 
 TEST_CASE("VariantReader write_path_segments_no_variants", "[VariantReader write_path_segments]") {
@@ -249,6 +308,71 @@ TEST_CASE("VariantReader write_genotypes_of", "[VariantReader write_genotypes_of
 	v.write_phasing_of("chrA", genotypes_chrA, &kmers_chrA);
 	v.write_phasing_of("chrB", genotypes_chrB, &kmers_chrB);
 	v.close_genotyping_outfile();
+	v.close_phasing_outfile();
+
+	// records formatted separately and written in order are the same, no matter in which order the chromosomes completed.
+	// Compressed output is indexed.
+	map<string, vector<GenotypingResult>> results = {{"chrA", genotypes_chrA}, {"chrB", genotypes_chrB}};
+	map<string, vector<UniqueKmers*>> unique_kmers = {{"chrA", kmers_chrA}, {"chrB", kmers_chrB}};
+	vector<string> reversed(chromosomes.rbegin(), chromosomes.rend());
+	for (vector<string> completion_order : {chromosomes, reversed}) {
+		v.open_genotyping_outfile("../tests/data/small1-genotypes-parallel.vcf.gz", 2);
+		v.open_phasing_outfile("../tests/data/small1-phasing-parallel.vcf.gz", 2);
+		format_and_write(v, chromosomes, completion_order, results, unique_kmers);
+		v.close_genotyping_outfile();
+		v.close_phasing_outfile();
+		for (string name : {"genotypes", "phasing"}) {
+			ifstream file("../tests/data/small1-" + name + ".vcf");
+			stringstream expected;
+			expected << file.rdbuf();
+			string compressed = "../tests/data/small1-" + name + "-parallel.vcf.gz";
+			REQUIRE(read_bgzf_file(compressed) == expected.str());
+			TabixIndex index(compressed + ".tbi");
+			REQUIRE(index.get_sequence_names() == expected_chromosomes);
+			remove(compressed.c_str());
+			remove((compressed + ".tbi").c_str());
+		}
+	}
+	// BCF output contains the same records
+	v.open_genotyping_outfile("../tests/data/small1-genotypes.bcf", 2);
+	format_and_write(v, chromosomes, reversed, results, unique_kmers);
+	v.close_genotyping_outfile();
+	string bcf = read_bgzf_file("../tests/data/small1-genotypes.bcf");
+	REQUIRE(bcf.substr(0, 5) == string("BCF\2\2", 5));
+	uint32_t header_length;
+	memcpy(&header_length, bcf.data() + 5, sizeof(uint32_t));
+	string header = bcf.substr(9, header_length);
+	REQUIRE(header.find("##contig=<ID=chrA>\n##contig=<ID=chrB>\n") != string::npos);
+	ifstream vcf_file("../tests/data/small1-genotypes.vcf");
+	string line;
+	vector<pair<int32_t,int32_t>> expected_positions;
+	while (getline(vcf_file, line)) {
+		if (line[0] == '#') continue;
+		vector<string> fields;
+		istringstream iss(line);
+		string field;
+		while (getline(iss, field, '\t')) fields.push_back(field);
+		expected_positions.push_back(make_pair((fields[0] == "chrA") ? 0 : 1, stoi(fields[1]) - 1));
+	}
+	vector<pair<int32_t,int32_t>> positions;
+	for (size_t offset = 9 + header_length; offset < bcf.size();) {
+		uint32_t lengths[2];
+		int32_t site[2];
+		memcpy(lengths, bcf.data() + offset, sizeof(lengths));
+		memcpy(site, bcf.data() + offset + sizeof(lengths), sizeof(site));
+		positions.push_back(make_pair(site[0], site[1]));
+		offset += sizeof(lengths) + lengths[0] + lengths[1];
+	}
+	REQUIRE(positions == expected_positions);
+	remove("../tests/data/small1-genotypes.bcf");
+	remove("../tests/data/small1-genotypes.bcf.csi");
+
+	// a result is required for every variant of the chromosome, the error is passed on to the writer
+	results["chrA"] = genotypes_chrB;
+	v.open_genotyping_outfile("../tests/data/small1-genotypes-parallel.vcf");
+	CHECK_THROWS(format_and_write(v, chromosomes, reversed, results, unique_kmers));
+	v.close_genotyping_outfile();
+	remove("../tests/data/small1-genotypes-parallel.vcf");
 	
 	for (size_t i = 0; i < kmers_chrA.size(); ++i) {
 		delete kmers_chrA[i];
@@ -329,6 +453,8 @@ TEST_CASE("VariantReader variant_ids1", "[VariantReader variant_ids1]") {
 	}
 	string chromosome = "chr1";
 	vector<string> variant_ids = {"var1", "var2", "var3", "var4", "var5:var6"};
+	// insert_ids only accesses existing entries
+	v.variant_ids[chromosome];
 	v.insert_ids(chromosome, alleles, variant_ids, true);
 
 	for (size_t i = 0; i < 10; ++i) {
@@ -361,6 +487,113 @@ TEST_CASE("VariantReader variant_ids2", "[VariantReader variant_ids2]") {
 	delete u[1];
 }
 
+TEST_CASE("VariantReader biallelic", "[VariantReader biallelic]") {
+	string vcf = "../tests/data/small1-ids.vcf";
+	string fasta = "../tests/data/small1.fa";
+	string callset = "../tests/data/small1-ids-callset.vcf";
+	{
+		ofstream file(callset);
+		file << "##fileformat=VCFv4.2" << endl;
+		file << "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO" << endl;
+		file << "chrA\t151\t.\tC\tG\t.\tPASS\tID=var1" << endl;
+		file << "chrA\t151\t.\tC\tCGGG,A,T\t.\tPASS\tID=var2,var3,var4" << endl;
+		file << "chrA\t161\t.\tG\tT\t.\tPASS\tID=var5" << endl;
+		file << "chrA\t155\t.\tA\tAT\t.\tPASS\tID=var6" << endl;
+		file << "chrB\t10\t.\tA\tT\t.\tPASS\tID=var7" << endl;
+	}
+	VariantReader v(vcf, fasta, 10, true);
+	vector<GenotypingResult> genotypes(2);
+	genotypes[0].add_to_likelihood(0, 1, 1.0);
+	genotypes[1].add_to_likelihood(1, 1, 1.0);
+	vector<unsigned char> path_to_allele;
+	vector<UniqueKmers*> u = { new UniqueKmers(0, path_to_allele), new UniqueKmers(1, path_to_allele) };
+	map<string, vector<GenotypingResult>> results = {{"chrA", genotypes}};
+	map<string, vector<UniqueKmers*>> unique_kmers = {{"chrA", u}};
+
+	// the biallelic records do not depend on the output format or the way they are written
+	vector<string> outputs;
+	for (string format : {"vcf", "vcf.gz"}) {
+		string filename = "../tests/data/small1-ids-biallelic." + format;
+		v.open_genotyping_outfile("../tests/data/small1-ids-genotypes." + format);
+		v.open_biallelic_outfile(filename, callset);
+		if (format == "vcf") {
+			v.write_genotypes_of("chrA", genotypes, &u);
+		} else {
+			format_and_write(v, {"chrA"}, {"chrA"}, results, unique_kmers);
+		}
+		v.close_genotyping_outfile();
+		v.close_biallelic_outfile();
+		string content;
+		if (format == "vcf") {
+			ifstream file(filename);
+			stringstream data;
+			data << file.rdbuf();
+			content = data.str();
+		} else {
+			content = read_bgzf_file(filename);
+		}
+		outputs.push_back(content.substr(content.find("#CHROM")));
+		remove(filename.c_str());
+		remove((filename + ".tbi").c_str());
+		remove(("../tests/data/small1-ids-genotypes." + format).c_str());
+		remove(("../tests/data/small1-ids-genotypes." + format + ".tbi").c_str());
+	}
+	// one record per ID, sorted by position. var1:var2 is the first ALT allele of the first variant, var5:var6 that of the second.
+	string expected = "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\tFORMAT\tsample\n";
+	expected += "chrA\t151\t.\tC\tG\t.\tPASS\tID=var1;UK=0;MA=0\tGT:GQ\t0/1:10000\n";
+	expected += "chrA\t151\t.\tC\tCGGG\t.\tPASS\tID=var2;UK=0;MA=0\tGT:GQ\t0/1:10000\n";
+	expected += "chrA\t151\t.\tC\tA\t.\tPASS\tID=var3;UK=0;MA=0\tGT:GQ\t0/0:10000\n";
+	expected += "chrA\t151\t.\tC\tT\t.\tPASS\tID=var4;UK=0;MA=0\tGT:GQ\t0/0:10000\n";
+	expected += "chrA\t155\t.\tA\tAT\t.\tPASS\tID=var6;UK=0;MA=0\tGT:GQ\t1/1:10000\n";
+	expected += "chrA\t161\t.\tG\tT\t.\tPASS\tID=var5;UK=0;MA=0\tGT:GQ\t1/1:10000\n";
+	REQUIRE(outputs[0] == expected);
+	REQUIRE(outputs[1] == expected);
+
+	// BCF output
+	v.open_genotyping_outfile("../tests/data/small1-ids-genotypes.bcf");
+	v.open_biallelic_outfile("../tests/data/small1-ids-biallelic.bcf", callset);
+	format_and_write(v, {"chrA"}, {"chrA"}, results, unique_kmers);
+	v.close_genotyping_outfile();
+	v.close_biallelic_outfile();
+	REQUIRE(read_bgzf_file("../tests/data/small1-ids-biallelic.bcf").substr(0, 5) == string("BCF\2\2", 5));
+	for (string name : {"genotypes", "biallelic"}) {
+		remove(("../tests/data/small1-ids-" + name + ".bcf").c_str());
+		remove(("../tests/data/small1-ids-" + name + ".bcf.csi").c_str());
+	}
+
+	// biallelic output needs the genotyping output
+	v.open_biallelic_outfile("../tests/data/small1-ids-biallelic.vcf", callset);
+	CHECK_THROWS(v.write_genotypes_of("chrA", genotypes, &u));
+	VariantReader::FormattedResults formatted;
+	CHECK_THROWS(v.format_results("chrA", genotypes, &u, false, formatted));
+	v.close_biallelic_outfile();
+	remove("../tests/data/small1-ids-biallelic.vcf");
+
+	// IDs missing in the callset
+	{
+		ofstream file(callset);
+		file << "chrA\t151\t.\tC\tG\t.\tPASS\tID=var1" << endl;
+	}
+	v.open_genotyping_outfile("../tests/data/small1-ids-genotypes.vcf");
+	v.open_biallelic_outfile("../tests/data/small1-ids-biallelic.vcf", callset);
+	CHECK_THROWS(v.write_genotypes_of("chrA", genotypes, &u));
+	v.close_genotyping_outfile();
+	v.close_biallelic_outfile();
+	remove("../tests/data/small1-ids-biallelic.vcf");
+	remove("../tests/data/small1-ids-genotypes.vcf");
+
+	// one ID per ALT allele is required
+	{
+		ofstream file(callset);
+		file << "chrA\t151\t.\tC\tG,T\t.\tPASS\tID=var1" << endl;
+	}
+	CHECK_THROWS(v.open_biallelic_outfile("../tests/data/small1-ids-biallelic.vcf", callset));
+	remove("../tests/data/small1-ids-biallelic.vcf");
+	remove(callset.c_str());
+	delete u[0];
+	delete u[1];
+}
+
 TEST_CASE("VariantReader close_to_start", "[VariantReader close_to_start]") {
 	string vcf = "../tests/data/close.vcf";
 	string fasta = "../tests/data/close.fa";
@@ -398,3 +631,149 @@ TEST_CASE("VariantReader too_many_alleles", "[VariantReader too_many_alleles]")
 }
 
 
+
+TEST_CASE("VariantReader bgzipped_vcf", "[VariantReader bgzipped_vcf]") {
+	string vcf = "../tests/data/small1.vcf";
+	string fasta = "../tests/data/small1.fa";
+	VariantReader expected(vcf, fasta, 10, true);
+
+	// same VCF compressed with bgzip and indexed with tabix
+	for (size_t nr_threads : {1, 2}) {
+		VariantReader v(vcf + ".gz", fasta, 10, true, "sample", nr_threads);
+		REQUIRE(v.nr_of_paths() == expected.nr_of_paths());
+		REQUIRE(v.nr_variants == expected.nr_variants);
+		vector<string> chromosomes;
+		v.get_chromosomes(&chromosomes);
+		vector<string> expected_chromosomes = {"chrA", "chrB"};
+		REQUIRE(chromosomes == expected_chromosomes);
+		for (auto chromosome : chromosomes) {
+			REQUIRE(v.size_of(chromosome) == expected.size_of(chromosome));
+			for (size_t i = 0; i < v.size_of(chromosome); ++i) {
+				REQUIRE(v.get_variant(chromosome, i) == expected.get_variant(chromosome, i));
+			}
+		}
+		REQUIRE(v.variant_ids == expected.variant_ids);
+	}
+
+	// bgzipped VCFs require an index
+	CHECK_THROWS(VariantReader("../tests/data/reads.bgzf.fq.gz", fasta, 10, true));
+	// gzip is not supported
+	CHECK_THROWS(VariantReader("../tests/data/reads.fq.gz", fasta, 10, true));
+}
+
+TEST_CASE("VariantReader stored_overhangs", "[VariantReader stored_overhangs]") {
+	string vcf = "../tests/data/small1.vcf";
+	string fasta = "../tests/data/small1.fa";
+	VariantReader v(vcf, fasta, 10, true);
+	vector<string> chromosomes;
+	v.get_chromosomes(&chromosomes);
+	for (auto chromosome : chromosomes) {
+		REQUIRE(v.left_overhangs.at(chromosome).size() == v.size_of(chromosome));
+		REQUIRE(v.right_overhangs.at(chromosome).size() == v.size_of(chromosome));
+		for (size_t i = 0; i < v.size_of(chromosome); ++i) {
+			// overhangs taken from the index must match those read from the reference
+			for (size_t length : {5, 10, 20, 30}) {
+				DnaSequence stored, expected;
+				v.get_left_overhang(chromosome, i, length, stored);
+				v.read_left_overhang(chromosome, i, length, expected);
+				REQUIRE(stored.to_string() == expected.to_string());
+				v.get_right_overhang(chromosome, i, length, stored);
+				v.read_right_overhang(chromosome, i, length, expected);
+				REQUIRE(stored.to_string() == expected.to_string());
+			}
+		}
+	}
+}
+
+TEST_CASE("VariantReader get_fingerprint", "[VariantReader get_fingerprint]") {
+	string fasta = "../tests/data/small1.fa";
+	VariantReader v1("../tests/data/small1.vcf", fasta, 10, true);
+	VariantReader v1_again("../tests/data/small1.vcf", fasta, 10, true, "other", 2);
+	VariantReader v1_kmer11("../tests/data/small1.vcf", fasta, 11, true);
+	VariantReader v2("../tests/data/small2.vcf", fasta, 10, true);
+	vector<string> chromosomes;
+	v1.get_chromosomes(&chromosomes);
+	uint64_t fingerprint = v1.get_fingerprint(chromosomes);
+	REQUIRE(v1_again.get_fingerprint(chromosomes, 2) == fingerprint);
+	// order of the chromosomes does not matter
+	vector<string> reversed(chromosomes.rbegin(), chromosomes.rend());
+	REQUIRE(v1.get_fingerprint(reversed) == fingerprint);
+	// other chromosomes, kmer size or variants
+	REQUIRE(v1.get_fingerprint({chromosomes[0]}) != fingerprint);
+	REQUIRE(v1_kmer11.get_fingerprint(chromosomes) != fingerprint);
+	vector<string> chromosomes2;
+	v2.get_chromosomes(&chromosomes2);
+	REQUIRE(v2.get_fingerprint(chromosomes2) != fingerprint);
+}
+
+TEST_CASE("VariantReader index", "[VariantReader index]") {
+	string vcf = "../tests/data/small1.vcf";
+	string fasta = "../tests/data/small1.fa";
+	string index = "../tests/data/small1-test.index";
+	VariantReader v(vcf, fasta, 10, true, "sample");
+	v.Store(index, vcf, fasta, 2);
+
+	VariantReader loaded;
+	loaded.Load(index, 10, true, vcf, fasta);
+	REQUIRE(loaded.get_kmer_size() == 10);
+	REQUIRE(loaded.nr_of_paths() == v.nr_of_paths());
+	REQUIRE(loaded.nr_of_genomic_kmers() == v.nr_of_genomic_kmers());
+	REQUIRE(loaded.sample == "sample");
+	vector<string> chromosomes, loaded_chromosomes;
+	v.get_chromosomes(&chromosomes);
+	loaded.get_chromosomes(&loaded_chromosomes);
+	REQUIRE(loaded_chromosomes == chromosomes);
+	for (auto chromosome : chromosomes) {
+		REQUIRE(loaded.size_of(chromosome) == v.size_of(chromosome));
+		for (size_t i = 0; i < v.size_of(chromosome); ++i) {
+			REQUIRE(loaded.get_variant(chromosome, i) == v.get_variant(chromosome, i));
+			REQUIRE(loaded.get_variant(chromosome, i).get_id() == v.get_variant(chromosome, i).get_id());
+			REQUIRE(loaded.get_left_overhang(chromosome, i, 20).to_string() == v.get_left_overhang(chromosome, i, 20).to_string());
+			REQUIRE(loaded.get_right_overhang(chromosome, i, 20).to_string() == v.get_right_overhang(chromosome, i, 20).to_string());
+		}
+	}
+
+	// the reference is not needed to load the index
+	VariantReader without_reference;
+	without_reference.Load(index, 10, true, vcf);
+	REQUIRE(without_reference.size_of("chrA") == v.size_of("chrA"));
+
+	// index built with other parameters or from other input files
+	VariantReader mismatch;
+	CHECK_THROWS(mismatch.Load(index, 11, true, vcf));
+	CHECK_THROWS(mismatch.Load(index, 10, false, vcf));
+	CHECK_THROWS(mismatch.Load(index, 10, true, "../tests/data/small2.vcf"));
+	CHECK_THROWS(mismatch.Load(index, 10, true, vcf, "../tests/data/close.fa"));
+
+	// load only the shard of one chromosome
+	VariantReader subset;
+	subset.Load(index, 10, true, vcf, "", {"chrB"}, 2);
+	vector<string> subset_chromosomes;
+	subset.get_chromosomes(&subset_chromosomes);
+	REQUIRE(subset_chromosomes == vector<string>({"chrB"}));
+	REQUIRE(subset.size_of("chrB") == v.size_of("chrB"));
+	for (size_t i = 0; i < v.size_of("chrB"); ++i) {
+		REQUIRE(subset.get_variant("chrB", i) == v.get_variant("chrB", i));
+	}
+	REQUIRE(subset.nr_of_genomic_kmers() == v.nr_of_genomic_kmers());
+	CHECK_THROWS(subset.Load(index, 10, true, vcf, "", {"chrC"}));
+
+	// the panel read from the index has the fingerprint of the panel read from the VCF
+	REQUIRE(loaded.get_fingerprint(chromosomes, 2) == v.get_fingerprint(chromosomes));
+	REQUIRE(subset.get_fingerprint({"chrB"}) == v.get_fingerprint({"chrB"}));
+	REQUIRE(subset.get_fingerprint({"chrB"}) != v.get_fingerprint(chromosomes));
+
+	// shards of another index are detected
+	VariantReader other(vcf, fasta, 10, true, "sample");
+	string other_index = "../tests/data/small1-other.index";
+	other.Store(other_index, "../tests/data/small2.vcf", fasta);
+	rename(VariantReader::shard_filename(other_index, 0).c_str(), VariantReader::shard_filename(index, 0).c_str());
+	CHECK_THROWS(subset.Load(index, 10, true, vcf));
+
+	remove(index.c_str());
+	remove(other_index.c_str());
+	for (size_t i = 0; i < chromosomes.size(); ++i) {
+		remove(VariantReader::shard_filename(index, i).c_str());
+		remove(VariantReader::shard_filename(other_index, i).c_str());
+	}
+}
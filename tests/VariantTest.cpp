@@ -165,6 +165,42 @@ TEST_CASE("Variant separate_variants", "[Variant separate_variants]") {
 	REQUIRE(single_variants[0] == v4);
 }
 
+TEST_CASE("Variant get_single_variants", "[Variant get_single_variants]") {
+	Variant v1("AAA", "TAC", "chr1", 10, 14, {"ATGC", "ATT"}, {0,0,1}, "var1");
+	Variant v2("GCT", "CCC", "chr1", 15, 16, {"A", "NNN"}, {0,1,0}, "var2");
+	v1.combine_variants(v2);
+	v1.add_flanking_sequence();
+
+	vector<SingleVariant> single_variants;
+	v1.get_single_variants(single_variants);
+	REQUIRE(single_variants.size() == 2);
+
+	REQUIRE(single_variants[0].start_position == 10);
+	REQUIRE(single_variants[0].id == "var1");
+	REQUIRE(single_variants[0].alleles.size() == 2);
+	REQUIRE(single_variants[0].alleles[0].to_string() == "ATGC");
+	REQUIRE(single_variants[0].alleles[1].to_string() == "ATT");
+	REQUIRE(single_variants[0].paths == vector<unsigned char>({0,0,1}));
+	REQUIRE(single_variants[0].nr_missing_alleles() == 0);
+
+	REQUIRE(single_variants[1].start_position == 15);
+	REQUIRE(single_variants[1].id == "var2");
+	REQUIRE(single_variants[1].alleles[0].to_string() == "A");
+	REQUIRE(single_variants[1].paths == vector<unsigned char>({0,1,0}));
+	REQUIRE(!single_variants[1].is_undefined_allele(0));
+	REQUIRE(single_variants[1].is_undefined_allele(1));
+	REQUIRE(single_variants[1].nr_missing_alleles() == 1);
+
+	vector<float> frequencies;
+	single_variants[1].allele_frequencies(false, frequencies);
+	REQUIRE(frequencies.size() == 2);
+	REQUIRE(doubles_equal(frequencies[0], 2.0/3.0));
+	REQUIRE(doubles_equal(frequencies[1], 1.0/3.0));
+	single_variants[1].allele_frequencies(true, frequencies);
+	REQUIRE(doubles_equal(frequencies[0], 0.5));
+	REQUIRE(doubles_equal(frequencies[1], 0.5));
+}
+
 TEST_CASE("Variant separate_variants_likelihoods", "Variant separate_variants_likelihoods") {
 	Variant v1 ("ATGA", "CTGA", "chr2", 4, 5, {"A", "T"}, {0,0,1,1});
 	Variant v2 ("AACT", "ACTG", "chr2", 7, 10, {"GAG", "ACC"}, {0,0,1,1});
@@ -752,3 +788,52 @@ TEST_CASE("Variant combine_variants_undefined_alleles", "[Variant combine_varian
 	REQUIRE(single_variants[1].is_undefined_allele(0));
 	REQUIRE(!single_variants[1].is_undefined_allele(1));
 }
+
+TEST_CASE("Variant shared_sequences", "[Variant shared_sequences]") {
+	// alleles and flanks with identical sequences are stored once
+	Variant v1("AAA", "CAT", "chr1", 10, 11, {"A", "G"}, {0,1,1});
+	Variant v2("AAC", "TAA", "chr1", 12, 13, {"A", "G"}, {1,0,1});
+	Variant v3("CAT", "AAA", "chr1", 14, 15, {"A", "AAA"}, {0,0,1});
+	Variant c = v1;
+	c.combine_variants(v2);
+	c.combine_variants(v3);
+	REQUIRE(c.nr_of_alleles() == 4);
+	REQUIRE(c.get_allele_string(0) == "ACATA");
+	REQUIRE(c.get_allele_string(1) == "ACGTA");
+	REQUIRE(c.get_allele_string(2) == "GCATA");
+	REQUIRE(c.get_allele_string(3) == "GCGTAAA");
+	REQUIRE(c.get_end_position() == 15);
+	c.add_flanking_sequence();
+	REQUIRE(c.get_allele_string(3) == "AAAGCGTAAAAAA");
+	REQUIRE(c.get_allele_sequence(3).to_string() == "AAAGCGTAAAAAA");
+
+	vector<Variant> single_variants;
+	c.separate_variants(&single_variants);
+	REQUIRE(single_variants.size() == 3);
+	REQUIRE(single_variants[0] == v1);
+	REQUIRE(single_variants[1] == v2);
+	REQUIRE(single_variants[2] == v3);
+}
+
+TEST_CASE("Variant compact", "[Variant compact]") {
+	Variant v1("AAA", "CAT", "chr1", 10, 11, {"A", "N"}, {0,1,1});
+	Variant v2("AAC", "TAA", "chr1", 12, 13, {"A", "G"}, {1,0,1});
+	Variant v3("CAT", "AAA", "chr1", 14, 15, {"A", "AAA", "NNN"}, {0,1,2});
+	Variant c = v1;
+	c.combine_variants(v2);
+	c.combine_variants(v3);
+	Variant compacted = c;
+	compacted.compact();
+	REQUIRE(compacted == c);
+	REQUIRE(compacted.nr_of_alleles() == 4);
+	for (size_t a = 0; a < compacted.nr_of_alleles(); ++a) {
+		REQUIRE(compacted.get_allele_string(a) == c.get_allele_string(a));
+	}
+	// undefined bases are not mistaken for the bases they are stored as
+	REQUIRE(compacted.get_allele_string(2) == "NCATAAA");
+	REQUIRE(compacted.get_allele_string(3) == "NCGTNNN");
+	// sequences can still be added after compacting
+	compacted.combine_variants(Variant("AAA", "AAA", "chr1", 17, 18, {"A", "C"}, {1,1,0}));
+	REQUIRE(compacted.get_allele_string(0) == "ACATAAAA");
+	REQUIRE(compacted.get_allele_string(3) == "NCGTNNNAAA");
+}
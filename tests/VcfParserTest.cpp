@@ -0,0 +1,80 @@
+#include "catch.hpp"
+#include "utils.hpp"
+#include "../src/vcfparser.hpp"
+#include <vector>
+#include <string>
+
+using namespace std;
+
+TEST_CASE("VcfParser split", "[VcfParser split]") {
+	vector<string_view> result;
+	VcfParser::split("A,CG,,T,", ',', result);
+	vector<string_view> expected = {"A", "CG", "", "T"};
+	REQUIRE(result == expected);
+}
+
+TEST_CASE("VcfParser records", "[VcfParser records]") {
+	VcfParser parser("../tests/data/parser-genotypes.vcf");
+	vector<string> expected_samples = {"sample1", "sample2"};
+	REQUIRE(parser.get_samples() == expected_samples);
+
+	vector<VcfRecord> records;
+	REQUIRE(parser.next_batch(records));
+	REQUIRE(records.size() == 5);
+
+	REQUIRE(records[0].chromosome == "chrA");
+	REQUIRE(records[0].position == 100);
+	REQUIRE(records[0].ref == "A");
+	REQUIRE(records[0].alt == "T,GC");
+	REQUIRE(records[0].alt_defined);
+	vector<string_view> expected_ids = {"var1", "var2"};
+	REQUIRE(records[0].ids == expected_ids);
+	REQUIRE(records[0].nr_columns == 11);
+	vector<unsigned char> expected_paths = {0, 2, VcfParser::UNDEFINED_ALLELE, 1};
+	REQUIRE(records[0].paths == expected_paths);
+	REQUIRE(records[0].genotype_error == nullptr);
+
+	// symbolic alleles
+	REQUIRE(!records[1].alt_defined);
+	REQUIRE(records[1].ids.empty());
+
+	// unphased and non-diploid genotypes
+	REQUIRE(records[2].genotype_error != nullptr);
+	REQUIRE(records[3].genotype_error != nullptr);
+
+	// missing columns
+	REQUIRE(records[4].nr_columns == 5);
+
+	REQUIRE(!parser.next_batch(records));
+	REQUIRE(records.empty());
+}
+
+TEST_CASE("VcfParser chunks", "[VcfParser chunks]") {
+	// results must not depend on the number of threads and the chunk size
+	vector<VcfRecord> expected;
+	VcfParser parser("../tests/data/small1.vcf");
+	parser.next_batch(expected);
+	REQUIRE(expected.size() == 10);
+
+	for (size_t chunk_size : {1, 50, 200}) {
+		VcfParser chunked_parser("../tests/data/small1.vcf", 3, chunk_size);
+		vector<VcfRecord> records;
+		vector<VcfRecord> batch;
+		while (chunked_parser.next_batch(batch)) {
+			records.insert(records.end(), batch.begin(), batch.end());
+		}
+		REQUIRE(records.size() == expected.size());
+		for (size_t i = 0; i < records.size(); ++i) {
+			REQUIRE(records[i].chromosome == expected[i].chromosome);
+			REQUIRE(records[i].position == expected[i].position);
+			REQUIRE(records[i].ref == expected[i].ref);
+			REQUIRE(records[i].alt == expected[i].alt);
+			REQUIRE(records[i].paths == expected[i].paths);
+		}
+	}
+}
+
+TEST_CASE("VcfParser broken_vcfs", "[VcfParser broken_vcfs]") {
+	CHECK_THROWS(VcfParser("../tests/data/no-paths.vcf"));
+	CHECK_THROWS(VcfParser("../tests/data/nonexistent.vcf"));
+}
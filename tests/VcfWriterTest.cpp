@@ -0,0 +1,188 @@
+#include "catch.hpp"
+#include "utils.hpp"
+#include "../src/bgzfwriter.hpp"
+#include "../src/bgzfreader.hpp"
+#include "../src/vcfwriter.hpp"
+#include "../src/tabixindex.hpp"
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+
+using namespace std;
+
+TEST_CASE("BgzfWriter", "[BgzfWriter]") {
+	string filename = "../tests/data/bgzfwriter-test.gz";
+	// several blocks of data, written in pieces of different sizes
+	string expected = "";
+	for (size_t i = 0; i < 30000; ++i) {
+		expected += "line " + to_string(i) + "\n";
+	}
+	for (size_t nr_threads : {1, 3}) {
+		BgzfWriter writer(filename, nr_threads);
+		size_t position = 0;
+		size_t piece = 1;
+		while (position < expected.size()) {
+			size_t size = min(piece, expected.size() - position);
+			writer.write(expected.data() + position, size);
+			position += size;
+			piece = (piece * 7) % 100000 + 1;
+		}
+		REQUIRE(writer.tell() == expected.size());
+		writer.close();
+
+		REQUIRE(BgzfReader::is_bgzf(filename));
+		REQUIRE(read_bgzf_file(filename) == expected);
+
+		// all blocks except the last two (remaining data and end-of-file marker) are full
+		BgzfReader reader(filename);
+		vector<char> block;
+		vector<size_t> sizes;
+		string data;
+		while (reader.read_block(block)) {
+			BgzfReader::decompress_block(block, data);
+			sizes.push_back(data.size());
+		}
+		REQUIRE(sizes.size() == expected.size() / BgzfWriter::BGZF_BLOCK_SIZE + 2);
+		for (size_t i = 0; i < sizes.size() - 2; ++i) {
+			REQUIRE(sizes[i] == BgzfWriter::BGZF_BLOCK_SIZE);
+		}
+		REQUIRE(sizes.back() == 0);
+	}
+	remove(filename.c_str());
+}
+
+TEST_CASE("BgzfWriter virtual_offset", "[BgzfWriter virtual_offset]") {
+	string filename = "../tests/data/bgzfwriter-test.gz";
+	string data(3 * BgzfWriter::BGZF_BLOCK_SIZE, 'A');
+	BgzfWriter writer(filename);
+	writer.write(data);
+	// nothing compressed yet
+	CHECK_THROWS(writer.virtual_offset(10));
+	writer.flush();
+	REQUIRE(writer.virtual_offset(0) == 0);
+	REQUIRE(writer.virtual_offset(10) == 10);
+	uint64_t second_block = writer.virtual_offset(BgzfWriter::BGZF_BLOCK_SIZE);
+	REQUIRE((second_block & 0xffff) == 0);
+	REQUIRE((second_block >> 16) > 0);
+	REQUIRE(writer.virtual_offset(BgzfWriter::BGZF_BLOCK_SIZE + 5) == second_block + 5);
+	writer.close();
+	remove(filename.c_str());
+}
+
+TEST_CASE("VcfWriter", "[VcfWriter]") {
+	string header = "##fileformat=VCFv4.2\n#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\tFORMAT\tsample\n";
+	string records_a = "";
+	for (size_t i = 0; i < 5000; ++i) {
+		records_a += "chrA\t" + to_string(100 * i + 1) + "\t.\tACGT\tA\t.\tPASS\t.\tGT\t0/1\n";
+	}
+	string records_b = "chrB\t5\t.\tA\tC\t.\tPASS\t.\tGT\t1/1\nchrB\t70000\t.\tA\tC\t.\tPASS\t.\tGT\t0/0\n";
+
+	for (string filename : {"../tests/data/vcfwriter-test.vcf", "../tests/data/vcfwriter-test.vcf.gz"}) {
+		bool compressed = VcfWriter::is_compressed(filename);
+		{
+			VcfWriter writer(filename, 2);
+			writer.write_header(header);
+			writer.write_records(records_a);
+			writer.write_records(records_b);
+			// header must come first
+			CHECK_THROWS(writer.write_header(header));
+			writer.close();
+		}
+
+		if (compressed) {
+			REQUIRE(read_bgzf_file(filename) == header + records_a + records_b);
+
+			TabixIndex index(filename + ".tbi");
+			vector<string> expected = {"chrA", "chrB"};
+			REQUIRE(index.get_sequence_names() == expected);
+			uint64_t begin_a, end_a, begin_b, end_b;
+			REQUIRE(index.get_range("chrA", begin_a, end_a));
+			REQUIRE(index.get_range("chrB", begin_b, end_b));
+			REQUIRE(begin_a < end_a);
+			REQUIRE(end_a <= begin_b);
+			REQUIRE(begin_b < end_b);
+
+			// the range of chrB starts with its first record
+			BgzfReader reader(filename);
+			reader.seek(begin_b >> 16);
+			vector<char> block;
+			string data;
+			REQUIRE(reader.read_block(block));
+			BgzfReader::decompress_block(block, data);
+			REQUIRE(data.substr(begin_b & 0xffff, records_b.size()) == records_b);
+			remove((filename + ".tbi").c_str());
+		} else {
+			ifstream file(filename);
+			stringstream content;
+			content << file.rdbuf();
+			REQUIRE(content.str() == header + records_a + records_b);
+		}
+		remove(filename.c_str());
+	}
+}
+
+TEST_CASE("VcfWriter unsorted", "[VcfWriter unsorted]") {
+	string filename = "../tests/data/vcfwriter-test.vcf.gz";
+	VcfWriter writer(filename);
+	writer.write_header("#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\n");
+	writer.write_records("chrA\t1\t.\tA\tC\t.\tPASS\t.\n");
+	writer.write_records("chrB\t1\t.\tA\tC\t.\tPASS\t.\n");
+	// chromosomes must not be interleaved (the index could not be built)
+	CHECK_THROWS(writer.write_records("chrA\t10\t.\tA\tC\t.\tPASS\t.\n"));
+	writer.close();
+	remove(filename.c_str());
+	remove((filename + ".tbi").c_str());
+}
+
+TEST_CASE("VcfWriter bcf", "[VcfWriter bcf]") {
+	string filename = "../tests/data/vcfwriter-test.bcf";
+	REQUIRE(VcfWriter::is_bcf(filename));
+	REQUIRE(!VcfWriter::is_compressed(filename));
+	string header = "##fileformat=VCFv4.2\n##FILTER=<ID=PASS,Description=\"All filters passed\">\n##contig=<ID=chrA>\n##contig=<ID=chrB>\n##contig=<ID=chrC>\n";
+	header += "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\n";
+	string records = "";
+	{
+		VcfWriter writer(filename);
+		// records can only be encoded once the header is known
+		REQUIRE(writer.get_bcf_encoder() == nullptr);
+		CHECK_THROWS(writer.write_records(""));
+		writer.write_header(header);
+		const BcfEncoder* encoder = writer.get_bcf_encoder();
+		REQUIRE(encoder != nullptr);
+		for (string chromosome : {"chrA", "chrC"}) {
+			for (int32_t position : {10, 20000, 40000}) {
+				string shared;
+				BcfEncoder::encode_site(shared, encoder->contig_index(chromosome), position, 1, 0, 2, 0, 0);
+				BcfEncoder::encode_string(shared, "");
+				BcfEncoder::encode_string(shared, "A");
+				BcfEncoder::encode_string(shared, "C");
+				BcfEncoder::encode_ints(shared, {encoder->key_index("PASS")});
+				BcfEncoder::append_record(records, shared, "");
+			}
+		}
+		writer.write_records(records);
+		// records of a chromosome must not be split
+		CHECK_THROWS(writer.write_records(records.substr(0, 10)));
+		writer.close();
+	}
+
+	string data = read_bgzf_file(filename);
+	uint32_t header_length = header.size() + 1;
+	string expected = string("BCF\2\2", 5) + string((const char*) &header_length, sizeof(uint32_t)) + header + '\0' + records;
+	REQUIRE(data == expected);
+
+	// CSI index without auxiliary data, one reference per contig
+	string index = read_bgzf_file(filename + ".csi");
+	REQUIRE(index.substr(0, 4) == string("CSI\1", 4));
+	int32_t values[4];
+	memcpy(values, index.data() + 4, sizeof(values));
+	REQUIRE(values[0] == 14);
+	REQUIRE(values[1] == 5);
+	REQUIRE(values[2] == 0);
+	REQUIRE(values[3] == 3);
+	remove(filename.c_str());
+	remove((filename + ".csi").c_str());
+}
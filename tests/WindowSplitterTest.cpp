@@ -0,0 +1,130 @@
+#include "catch.hpp"
+#include "utils.hpp"
+#include "../src/windowsplitter.hpp"
+#include "../src/uniquekmers.hpp"
+#include "../src/copynumber.hpp"
+#include "../src/hmm.hpp"
+#include <vector>
+
+using namespace std;
+
+TEST_CASE("WindowSplitter split", "[WindowSplitter split]") {
+	vector<size_t> positions = {100, 200, 300, 400, 5000, 5100, 5200, 5300, 5400, 9000, 9100, 9200};
+	vector<GenotypingWindow> windows;
+
+	// no windows
+	WindowSplitter whole (0, 2);
+	whole.split(positions, windows);
+	REQUIRE(windows.size() == 1);
+	REQUIRE(windows[0].begin == 0);
+	REQUIRE(windows[0].end == 12);
+	REQUIRE(windows[0].core_begin == 0);
+	REQUIRE(windows[0].core_end == 12);
+
+	// cut at the largest gaps
+	windows.clear();
+	WindowSplitter splitter (4, 2);
+	splitter.split(positions, windows);
+	REQUIRE(windows.size() == 3);
+	vector<size_t> expected_cores = {0, 4, 4, 9, 9, 12};
+	vector<size_t> expected_ranges = {0, 6, 2, 11, 7, 12};
+	for (size_t i = 0; i < windows.size(); ++i) {
+		REQUIRE(windows[i].core_begin == expected_cores[2*i]);
+		REQUIRE(windows[i].core_end == expected_cores[2*i+1]);
+		REQUIRE(windows[i].begin == expected_ranges[2*i]);
+		REQUIRE(windows[i].end == expected_ranges[2*i+1]);
+	}
+
+	// fewer variants than the window size
+	windows.clear();
+	vector<size_t> few = {10, 20};
+	splitter.split(few, windows);
+	REQUIRE(windows.size() == 1);
+	REQUIRE(windows[0].core_end == 2);
+
+	windows.clear();
+	vector<size_t> none = {};
+	splitter.split(none, windows);
+	REQUIRE(windows.size() == 1);
+	REQUIRE(windows[0].end == 0);
+
+	// windows of a single variant are rejected
+	REQUIRE_THROWS(WindowSplitter(1, 2));
+
+	// number and size of the windows used for scheduling and memory estimates
+	REQUIRE(whole.nr_windows(positions) == 1);
+	REQUIRE(whole.max_window_variants(12) == 12);
+	REQUIRE(splitter.nr_windows(positions) == 3);
+	REQUIRE(splitter.nr_windows(few) == 1);
+	REQUIRE(splitter.max_window_variants(12) == 10);
+	REQUIRE(splitter.max_window_variants(2) == 2);
+
+	// the smallest allowed window size
+	windows.clear();
+	WindowSplitter smallest (2, 0);
+	smallest.split(positions, windows);
+	REQUIRE(windows.size() == 6);
+	REQUIRE(windows.front().core_begin == 0);
+	REQUIRE(windows.back().core_end == 12);
+	for (size_t i = 1; i < windows.size(); ++i) {
+		REQUIRE(windows[i].core_begin == windows[i-1].core_end);
+	}
+	REQUIRE(smallest.nr_windows(positions) == 6);
+
+	// equal distances: cuts are made as early as possible, giving more windows than variants / window size
+	windows.clear();
+	vector<size_t> equal = {100, 200, 300, 400, 500, 600, 700, 800, 900, 1000, 1100, 1200};
+	splitter.split(equal, windows);
+	REQUIRE(windows.size() == 4);
+	REQUIRE(splitter.nr_windows(equal) == 4);
+}
+
+TEST_CASE("WindowSplitter genotyping", "[WindowSplitter genotyping]") {
+	vector<unsigned char> path_to_allele = {0, 1};
+	vector<unsigned char> a1 = {0};
+	vector<unsigned char> a2 = {1};
+	// two groups of variants far apart, such that the transition probabilities inbetween are fully mixed
+	vector<size_t> positions = {2000, 3000, 4000, 100002000, 100003000, 100004000};
+	vector<UniqueKmers> variants;
+	for (size_t i = 0; i < positions.size(); ++i) {
+		UniqueKmers u (positions[i], path_to_allele);
+		u.insert_kmer((i % 2 == 0) ? 10 : 20, a1);
+		u.insert_kmer((i % 3 == 0) ? 5 : 10, a2);
+		u.set_coverage(5);
+		variants.push_back(u);
+	}
+	vector<UniqueKmers*> unique_kmers;
+	for (auto& u : variants) unique_kmers.push_back(&u);
+
+	ProbabilityTable probs(5, 10, 30, 0.0L);
+	probs.modify_probability(5, 10, CopyNumber(0.1,0.9,0.1));
+	probs.modify_probability(5, 20, CopyNumber(0.01,0.01,0.9));
+	probs.modify_probability(5, 5, CopyNumber(0.9,0.3,0.1));
+
+	HMM hmm (&unique_kmers, &probs, true, false, 1.26, false, 25000.0L);
+	vector<double> expected_likelihoods;
+	for (auto result : hmm.get_genotyping_result()) {
+		expected_likelihoods.push_back(result.get_genotype_likelihood(0,0));
+		expected_likelihoods.push_back(result.get_genotype_likelihood(0,1));
+		expected_likelihoods.push_back(result.get_genotype_likelihood(1,1));
+	}
+
+	// windows without burn-in are cut at the gap and give the same results
+	vector<GenotypingWindow> windows;
+	WindowSplitter splitter (3, 0);
+	splitter.split(positions, windows);
+	REQUIRE(windows.size() == 2);
+	REQUIRE(windows[1].core_begin == 3);
+	vector<double> computed_likelihoods;
+	for (auto& window : windows) {
+		vector<UniqueKmers*> window_kmers (unique_kmers.begin() + window.begin, unique_kmers.begin() + window.end);
+		HMM window_hmm (&window_kmers, &probs, true, false, 1.26, false, 25000.0L);
+		vector<GenotypingResult> results = window_hmm.get_genotyping_result();
+		for (size_t i = window.core_begin; i < window.core_end; ++i) {
+			computed_likelihoods.push_back(results[i - window.begin].get_genotype_likelihood(0,0));
+			computed_likelihoods.push_back(results[i - window.begin].get_genotype_likelihood(0,1));
+			computed_likelihoods.push_back(results[i - window.begin].get_genotype_likelihood(1,1));
+		}
+	}
+	REQUIRE( compare_vectors(expected_likelihoods, computed_likelihoods) );
+}
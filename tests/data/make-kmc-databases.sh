@@ -0,0 +1,18 @@
+#!/bin/bash
+# Creates the KMC databases used by tests/KmcReaderTest.cpp from reads.fa (k = 10).
+# Requires kmc and kmc_tools (KMC 3, e.g. from bioconda). kmc writes the KMC2 format,
+# kmc_tools transform ... sort converts a database to the sorted KMC1 format.
+# The counts dumped by kmc_tools are the reference KmcReaderTest checks both databases against.
+set -e
+cd "$(dirname "$0")"
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+
+# canonical kmers (both strands), kmers occurring once are kept
+kmc -k10 -ci1 -cs255 -fm -t1 reads.fa reads.kmc2 "$tmp"
+kmc_tools transform reads.kmc2 sort reads.kmc1
+kmc_tools transform reads.kmc2 dump reads.kmc.dump
+
+# kmers counted on the given strand only (-b)
+kmc -k10 -ci1 -cs255 -fm -t1 -b reads.fa "$tmp/no-canonical" "$tmp"
+kmc_tools transform "$tmp/no-canonical" sort reads.no-canonical.kmc1
@@ -1,5 +1,6 @@
 #include "utils.hpp"
 #include <math.h>
+#include "../src/bgzfreader.hpp"
 
 bool doubles_equal(double a, double b) {
 	return std::abs(a - b) < 0.0000001;
@@ -13,3 +14,15 @@ bool compare_vectors (std::vector<double>& v1, std::vector<double>& v2) {
 	}
 	return true;
 }
+
+std::string read_bgzf_file(std::string filename) {
+	BgzfReader reader(filename);
+	std::vector<char> block;
+	std::string data;
+	std::string result;
+	while (reader.read_block(block)) {
+		BgzfReader::decompress_block(block, data);
+		result += data;
+	}
+	return result;
+}
@@ -3,3 +3,8 @@
 bool doubles_equal(double a, double b);
 
 bool compare_vectors (std::vector<double>& v1, std::vector<double>& v2);
+
+#include <string>
+
+/** decompress a complete BGZF file **/
+std::string read_bgzf_file(std::string filename);